@@ -75,6 +75,10 @@ ExternalProject_Add(ffmpeg
         
 	--enable-filter=scale
         --enable-filter=fps
+        --enable-filter=buffer
+        --enable-filter=buffersink
+        --enable-filter=bwdif
+        --enable-filter=yadif
 
     BUILD_IN_SOURCE 1
     BUILD_COMMAND make -j ${CPU_CORES_COUNT}
@@ -86,6 +90,7 @@ set( LIBAVCODEC_INCLUDE_DIRS  "${CMAKE_BINARY_DIR}/ffmpeg/install/usr/include" )
 set( LIBAVFORMAT_INCLUDE_DIRS "${CMAKE_BINARY_DIR}/ffmpeg/install/usr/include" )
 set( LIBAVUTIL_INCLUDE_DIRS   "${CMAKE_BINARY_DIR}/ffmpeg/install/usr/include" )
 set( LIBSWSCALE_INCLUDE_DIRS  "${CMAKE_BINARY_DIR}/ffmpeg/install/usr/include" )
+set( LIBAVFILTER_INCLUDE_DIRS "${CMAKE_BINARY_DIR}/ffmpeg/install/usr/include" )
 
 set( LIBAVCODEC_LIBRARIES  
 	"${CMAKE_BINARY_DIR}/ffmpeg/install/usr/lib/bluecherry/client/libavcodec${CMAKE_SHARED_LIBRARY_SUFFIX}" )
@@ -95,3 +100,5 @@ set( LIBAVUTIL_LIBRARIES
 	"${CMAKE_BINARY_DIR}/ffmpeg/install/usr/lib/bluecherry/client/libavutil${CMAKE_SHARED_LIBRARY_SUFFIX}" )
 set( LIBSWSCALE_LIBRARIES  
 	"${CMAKE_BINARY_DIR}/ffmpeg/install/usr/lib/bluecherry/client/libswscale${CMAKE_SHARED_LIBRARY_SUFFIX}" )
+set( LIBAVFILTER_LIBRARIES 
+	"${CMAKE_BINARY_DIR}/ffmpeg/install/usr/lib/bluecherry/client/libavfilter${CMAKE_SHARED_LIBRARY_SUFFIX}" )
@@ -0,0 +1,47 @@
+# - Find libavfilter
+# Find the BreakpadClient includes and library
+# This module defines
+#  LIBAVFILTER_INCLUDE_DIRS, where to find avfilter.h, etc.
+#  LIBAVFILTER_LIBRARIES, the libraries needed to use libavfilter.
+#  LIBAVFILTER_FOUND, If false, do not try to use libavfilter.
+# also defined, but not for general use are
+#  LIBAVFILTER_LIBRARY, where to find the JPEG library.
+
+#
+# Copyright 2010-2019 Bluecherry, LLC
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+if (NOT WIN32 AND NOT LIBAVFILTER_INCLUDE_DIRS)
+    find_package (PkgConfig)
+    if (PKG_CONFIG_FOUND)
+        pkg_check_modules (LIBAVFILTER QUIET libavfilter)
+    endif (PKG_CONFIG_FOUND)
+endif ()
+
+find_path (LIBAVFILTER_INCLUDE_DIR libavfilter/avfilter.h ${LIBAVFILTER_INCLUDE_DIRS} ${WIN32_LIBAV_DIR}/include)
+list (APPEND LIBAVFILTER_INCLUDE_DIRS ${LIBAVFILTER_INCLUDE_DIR})
+find_library (LIBAVFILTER_LIBRARY NAMES avfilter HINTS ${LIBAVFILTER_LIBDIR} ${LIBAVFILTER_LIBRARY_DIRS} ${WIN32_LIBAV_DIR}/bin)
+list (APPEND LIBAVFILTER_LIBRARIES ${LIBAVFILTER_LIBRARY})
+
+include (FindPackageHandleStandardArgs)
+find_package_handle_standard_args (LibAVFilter DEFAULT_MSG LIBAVFILTER_LIBRARIES LIBAVFILTER_INCLUDE_DIRS)
+set (LIBAVFILTER_FOUND ${LibAVFilter_FOUND})
+
+if (LIBAVFILTER_FOUND)
+    set (LIBAVFILTER_LIBRARIES ${LIBAVFILTER_LIBRARY})
+endif (LIBAVFILTER_FOUND)
+
+mark_as_advanced (LIBAVFILTER_INCLUDE_DIRS LIBAVFILTER_LIBRARIES)
@@ -21,6 +21,7 @@ find_package (LibAVCodec 53.35.0 REQUIRED)
 find_package (LibAVFormat 53.21.1 REQUIRED)
 find_package (LibAVUtil 51.22.1 REQUIRED)
 find_package (LibSWScale 2.1.0 REQUIRED)
+find_package (LibAVFilter 6.82.100 REQUIRED)
 endif()
 
 if ( UNIX )
@@ -38,12 +39,14 @@ include_directories (${LIBAVCODEC_INCLUDE_DIRS})
 include_directories (${LIBAVFORMAT_INCLUDE_DIRS})
 include_directories (${LIBAVUTIL_INCLUDE_DIRS})
 include_directories (${LIBSWSCALE_INCLUDE_DIRS})
+include_directories (${LIBAVFILTER_INCLUDE_DIRS})
 
 if ( WIN32 )
 link_directories (${LIBAVCODEC_LIBRARY_DIRS})
 link_directories (${LIBAVFORMAT_LIBRARY_DIRS})
 link_directories (${LIBAVUTIL_LIBRARY_DIRS})
 link_directories (${LIBSWSCALE_LIBRARY_DIRS})
+link_directories (${LIBAVFILTER_LIBRARY_DIRS})
 endif()
 
 # __STDC_CONSTANT_MACROS is necessary for libav on Linux
@@ -54,6 +57,7 @@ list (APPEND bluecherry_client_LIBRARIES
     ${LIBAVFORMAT_LIBRARIES}
     ${LIBAVUTIL_LIBRARIES}
     ${LIBSWSCALE_LIBRARIES}
+    ${LIBAVFILTER_LIBRARIES}
 )
 
 #get_filename_component (LIBAVCODEC_RPATH ${LIBAVCODEC_LIBRARY} PATH)
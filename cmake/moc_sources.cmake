@@ -23,8 +23,12 @@ set (bluecherry_client_MOC_SRCS
     src/core/BluecherryApp.h
     src/core/CameraPtzControl.h
     src/core/LiveStream.h
+    src/core/LiveStreamVisibility.h
+    src/core/LiveViewGovernor.h
     src/core/LiveViewManager.h
     src/core/MJpegStream.h
+    src/core/MJpegStreamDecoder.h
+    src/core/MJpegStreamReader.h
     src/core/PtzPresetsModel.h
     src/core/ServerRequestManager.h
     src/core/TransferRateCalculator.h
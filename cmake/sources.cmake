@@ -29,12 +29,21 @@ set (bluecherry_client_main_SRCS
 
     src/core/BluecherryApp.cpp
     src/core/CameraPtzControl.cpp
+    src/core/DecodePool.cpp
     src/core/EventData.cpp
     src/core/LanguageController.cpp
     src/core/LiveStream.cpp
+    src/core/LiveStreamBandwidthPolicy.cpp
+    src/core/LiveStreamTelemetry.cpp
+    src/core/LiveStreamVisibility.cpp
+    src/core/LiveViewGovernor.cpp
     src/core/LiveViewManager.cpp
     src/core/LoggableUrl.cpp
+    src/core/MJpegMultipartParser.cpp
     src/core/MJpegStream.cpp
+    src/core/MJpegStreamDecoder.cpp
+    src/core/MJpegStreamNetwork.cpp
+    src/core/MJpegStreamReader.cpp
     src/core/PtzPresetsModel.cpp
     src/core/ServerRequestManager.cpp
     src/core/ThreadPause.cpp
@@ -57,9 +66,20 @@ set (bluecherry_client_main_SRCS
     src/event/ThumbnailManager.cpp
 
     src/rtsp-stream/RtspStream.cpp
+    src/rtsp-stream/RtspStreamDecodePolicy.cpp
+    src/rtsp-stream/RtspStreamDecodeThreading.cpp
+    src/rtsp-stream/RtspStreamDeinterlacer.cpp
     src/rtsp-stream/RtspStreamFrame.cpp
     src/rtsp-stream/RtspStreamFrameFormatter.cpp
+    src/rtsp-stream/RtspStreamFrameScaler.cpp
     src/rtsp-stream/RtspStreamFrameQueue.cpp
+    src/rtsp-stream/RtspStreamPacketRing.cpp
+    src/rtsp-stream/RtspStreamParameters.cpp
+    src/rtsp-stream/RtspStreamPauseState.cpp
+    src/rtsp-stream/RtspStreamPresentationClock.cpp
+    src/rtsp-stream/RtspStreamReplayTask.cpp
+    src/rtsp-stream/RtspStreamStallDetector.cpp
+    src/rtsp-stream/RtspStreamTelemetry.cpp
     src/rtsp-stream/RtspStreamThread.cpp
     src/rtsp-stream/RtspStreamWorker.cpp
 
@@ -114,6 +134,7 @@ set (bluecherry_client_main_SRCS
     src/ui/OptionsServerPage.cpp
     src/ui/RemotePortCheckerWidget.cpp
     src/ui/ServerMenu.cpp
+    src/ui/ServerRatesText.cpp
     src/ui/SetupWizard.cpp
     src/ui/StatusBarServerAlert.cpp
     src/ui/SwitchEventsWidget.cpp
@@ -123,8 +144,11 @@ set (bluecherry_client_main_SRCS
 
     src/utils/DateTimeRange.cpp
     src/utils/DateTimeUtils.cpp
+    src/utils/ExponentialBackoff.cpp
     src/utils/FileUtils.cpp
     src/utils/ImageDecodeTask.cpp
+    src/utils/JpegDecoder.cpp
+    src/utils/LatencyHistogram.cpp
     src/utils/Range.cpp
     src/utils/RangeMap.cpp
     src/utils/StringUtils.cpp
@@ -1,6 +1,6 @@
 set (CMAKE_INCLUDE_CURRENT_DIR TRUE)
 
-macro (bluecherry_add_test name_)
+macro (bluecherry_add_test_executable name_)
     foreach (file ${ARGN})
         get_filename_component (mocFile "${file}" NAME_WE)
         set (mocFile "${CMAKE_CURRENT_BINARY_DIR}/${mocFile}.moc")
@@ -8,13 +8,40 @@ macro (bluecherry_add_test name_)
         set_property (SOURCE ${file} APPEND PROPERTY OBJECT_DEPENDS "${mocFile}")
     endforeach ()
 
-    file (RELATIVE_PATH sourcePath "${CMAKE_SOURCE_DIR}/tests" "${CMAKE_CURRENT_SOURCE_DIR}")
-
     get_filename_component (exeDir "${CMAKE_CURRENT_BINARY_DIR}/${name_}" PATH)
     file (MAKE_DIRECTORY "${exeDir}")
 
     add_executable (${name_} ${ARGN} ${bluecherry_client_SRCS})
+    target_link_libraries (${name_} ${bluecherry_client_LIBRARIES})
+endmacro ()
+
+macro (bluecherry_add_test name_)
+    bluecherry_add_test_executable (${name_} ${ARGN})
+
+    file (RELATIVE_PATH sourcePath "${CMAKE_SOURCE_DIR}/tests" "${CMAKE_CURRENT_SOURCE_DIR}")
     add_test ("${sourcePath}/${name_}" ${name_})
+endmacro ()
+
+# Benchmarks are built with the tests but only run by hand; some of them
+# simulate a hundred streams and take far longer than the unit tests
+macro (bluecherry_add_benchmark name_)
+    bluecherry_add_test_executable (${name_} ${ARGN})
+endmacro ()
+
+# Programs that are built with the tests but not run by them; headers are moc'ed
+macro (bluecherry_add_tool name_)
+    set (toolSources "")
+    foreach (file ${ARGN})
+        if (file MATCHES "\\.h$")
+            get_filename_component (mocFile "${file}" NAME_WE)
+            set (mocFile "${CMAKE_CURRENT_BINARY_DIR}/moc_${mocFile}.cpp")
+            qt4_generate_moc (${file} "${mocFile}")
+            list (APPEND toolSources "${mocFile}")
+        else ()
+            list (APPEND toolSources ${file})
+        endif ()
+    endforeach ()
 
+    add_executable (${name_} ${toolSources} ${bluecherry_client_SRCS})
     target_link_libraries (${name_} ${bluecherry_client_LIBRARIES})
 endmacro ()
@@ -19,9 +19,50 @@ if (NOT APPLE)
     enable_testing ()
     include (cmake/tests/bluecherry-add-test.cmake)
 
+    bluecherry_add_test (LiveStreamBandwidthPolicyTestCase tests/src/core/LiveStreamBandwidthPolicyTestCase.cpp)
+    bluecherry_add_test (LiveStreamVisibilityTestCase tests/src/core/LiveStreamVisibilityTestCase.cpp)
+    bluecherry_add_test (LiveViewGovernorTestCase tests/src/core/LiveViewGovernorTestCase.cpp)
+    bluecherry_add_test (MJpegMultipartParserTestCase tests/src/core/MJpegMultipartParserTestCase.cpp)
+    bluecherry_add_test (MJpegStreamDecoderTestCase tests/src/core/MJpegStreamDecoderTestCase.cpp)
+    bluecherry_add_test (TransferRateCalculatorTestCase tests/src/core/TransferRateCalculatorTestCase.cpp)
     bluecherry_add_test (VersionTestCase tests/src/core/VersionTestCase.cpp)
     bluecherry_add_test (DateTimeRangeTestCase tests/src/utils/DateTimeRangeTestCase.cpp)
+    bluecherry_add_test (ExponentialBackoffTestCase tests/src/utils/ExponentialBackoffTestCase.cpp)
+    bluecherry_add_test (LatencyHistogramTestCase tests/src/utils/LatencyHistogramTestCase.cpp)
     bluecherry_add_test (RangeMapTestCase tests/src/utils/RangeMapTestCase.cpp)
     bluecherry_add_test (RangeTestCase tests/src/utils/RangeTestCase.cpp)
+    bluecherry_add_test (SpscRingTestCase tests/src/utils/SpscRingTestCase.cpp)
     bluecherry_add_test (EventParserTestCase tests/src/event/EventParserTestCase.cpp)
+    bluecherry_add_test (RtspStreamDecodePolicyTestCase tests/src/rtsp-stream/RtspStreamDecodePolicyTestCase.cpp)
+    bluecherry_add_test (RtspStreamPacketRingTestCase tests/src/rtsp-stream/RtspStreamPacketRingTestCase.cpp)
+    bluecherry_add_test (RtspStreamParametersTestCase tests/src/rtsp-stream/RtspStreamParametersTestCase.cpp)
+    bluecherry_add_test (RtspStreamPauseStateTestCase tests/src/rtsp-stream/RtspStreamPauseStateTestCase.cpp)
+    bluecherry_add_test (RtspStreamPresentationClockTestCase tests/src/rtsp-stream/RtspStreamPresentationClockTestCase.cpp)
+    bluecherry_add_test (RtspStreamStallDetectorTestCase tests/src/rtsp-stream/RtspStreamStallDetectorTestCase.cpp)
+
+    bluecherry_add_benchmark (DecodePoolBenchmark tests/src/core/DecodePoolBenchmark.cpp)
+    bluecherry_add_benchmark (MJpegMultipartParserBenchmark tests/src/core/MJpegMultipartParserBenchmark.cpp)
+    bluecherry_add_benchmark (MJpegStreamReaderBenchmark tests/src/core/MJpegStreamReaderBenchmark.cpp)
+    bluecherry_add_benchmark (JpegDecoderBenchmark tests/src/utils/JpegDecoderBenchmark.cpp)
+    bluecherry_add_benchmark (RtspStreamDecodeThreadingBenchmark tests/src/rtsp-stream/RtspStreamDecodeThreadingBenchmark.cpp)
+    bluecherry_add_benchmark (RtspStreamDeinterlacerBenchmark tests/src/rtsp-stream/RtspStreamDeinterlacerBenchmark.cpp)
+    bluecherry_add_benchmark (RtspStreamFrameBenchmark tests/src/rtsp-stream/RtspStreamFrameBenchmark.cpp)
+    bluecherry_add_benchmark (RtspStreamFrameScalerBenchmark tests/src/rtsp-stream/RtspStreamFrameScalerBenchmark.cpp)
+
+    # Stand-in server to load the client with many cameras; see tests/standin/main.cpp
+    bluecherry_add_tool (bluecherry-standin
+        tests/standin/main.cpp
+        tests/standin/StandInDelivery.cpp
+        tests/standin/StandInH264Source.cpp
+        tests/standin/StandInH264Source.h
+        tests/standin/StandInHttpServer.cpp
+        tests/standin/StandInHttpServer.h
+        tests/standin/StandInLoadReport.cpp
+        tests/standin/StandInLoadReport.h
+        tests/standin/StandInMJpegSource.cpp
+        tests/standin/StandInMJpegSource.h
+        tests/standin/StandInRtspServer.cpp
+        tests/standin/StandInRtspServer.h
+        tests/standin/StandInRtspSession.cpp
+        tests/standin/StandInRtspSession.h)
 endif (NOT APPLE)
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DecodePool.h"
+#include <QThread>
+
+enum DecodeState
+{
+    Idle,
+    Queued,
+    Running,
+    RunningRescheduled,
+    Cancelled
+};
+
+/* Sleeping threads wake up this often anyway, in case a wake up was missed */
+static const unsigned long idleWaitTime = 100;
+
+class DecodePoolThread : public QThread
+{
+public:
+    DecodePoolThread(DecodePool *pool, int index)
+        : m_pool(pool), m_index(index)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        m_pool->runThread(m_index);
+    }
+
+private:
+    DecodePool *m_pool;
+    int m_index;
+};
+
+DecodeTask::DecodeTask()
+    : m_decodeState(Idle), m_homeThread(-1)
+{
+}
+
+DecodePool *DecodePool::m_instance = 0;
+
+DecodePool * DecodePool::instance()
+{
+    return m_instance ? m_instance : (m_instance = new DecodePool);
+}
+
+DecodePool::DecodePool(int threadCount)
+    : m_nextHomeThread(0), m_queuedTasks(0), m_stolenTasks(0), m_quit(0),
+      m_sleepingThreads(0), m_cancelWaiters(0)
+{
+    if (threadCount <= 0)
+        threadCount = qMax(QThread::idealThreadCount(), 1);
+
+    for (int i = 0; i < threadCount; ++i)
+        m_queues.append(new TaskQueue);
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        DecodePoolThread *thread = new DecodePoolThread(this, i);
+        m_threads.append(thread);
+        thread->start();
+    }
+}
+
+DecodePool::~DecodePool()
+{
+    m_quit.storeRelease(1);
+
+    m_sleepMutex.lock();
+    m_workAvailable.wakeAll();
+    m_sleepMutex.unlock();
+
+    foreach (DecodePoolThread *thread, m_threads)
+        thread->wait();
+
+    qDeleteAll(m_threads);
+    qDeleteAll(m_queues);
+}
+
+void DecodePool::schedule(DecodeTask *task)
+{
+    for (;;)
+    {
+        int state = task->m_decodeState.loadAcquire();
+        switch (state)
+        {
+        case Idle:
+            if (!task->m_decodeState.testAndSetOrdered(Idle, Queued))
+                continue;
+
+            if (task->m_homeThread < 0)
+                task->m_homeThread = (m_nextHomeThread.fetchAndAddRelaxed(1) & 0x7fffffff) % m_queues.size();
+            enqueue(task->m_homeThread, task);
+            return;
+        case Running:
+            /* The thread running it puts it back in a queue when done */
+            if (!task->m_decodeState.testAndSetOrdered(Running, RunningRescheduled))
+                continue;
+            return;
+        default:
+            return;
+        }
+    }
+}
+
+void DecodePool::enqueue(int queue, DecodeTask *task)
+{
+    TaskQueue *taskQueue = m_queues[queue];
+    taskQueue->mutex.lock();
+    taskQueue->tasks.append(task);
+    taskQueue->mutex.unlock();
+
+    m_queuedTasks.fetchAndAddOrdered(1);
+    if (m_sleepingThreads.fetchAndAddOrdered(0) > 0)
+    {
+        m_sleepMutex.lock();
+        m_workAvailable.wakeOne();
+        m_sleepMutex.unlock();
+    }
+}
+
+void DecodePool::cancel(DecodeTask *task)
+{
+    for (;;)
+    {
+        int state = task->m_decodeState.loadAcquire();
+        switch (state)
+        {
+        case Idle:
+            if (task->m_decodeState.testAndSetOrdered(Idle, Cancelled))
+                return;
+            continue;
+        case Queued:
+            if (!task->m_decodeState.testAndSetOrdered(Queued, Cancelled))
+                continue;
+
+            /* Tasks are taken out of a queue and marked running under the queue's
+             * lock, so once every queue was locked no thread can touch it anymore */
+            foreach (TaskQueue *taskQueue, m_queues)
+            {
+                QMutexLocker locker(&taskQueue->mutex);
+                if (taskQueue->tasks.removeOne(task))
+                    m_queuedTasks.fetchAndAddOrdered(-1);
+            }
+            return;
+        case Cancelled:
+            return;
+        default:
+        {
+            m_cancelWaiters.fetchAndAddOrdered(1);
+            m_finishedMutex.lock();
+            state = task->m_decodeState.loadAcquire();
+            if (state == Running || state == RunningRescheduled)
+                m_taskFinished.wait(&m_finishedMutex, idleWaitTime);
+            m_finishedMutex.unlock();
+            m_cancelWaiters.fetchAndAddOrdered(-1);
+            continue;
+        }
+        }
+    }
+}
+
+DecodeTask * DecodePool::takeTask(int queue)
+{
+    /* Own queue from the front, others from the back */
+    for (int i = 0; i < m_queues.size(); ++i)
+    {
+        TaskQueue *taskQueue = m_queues[(queue + i) % m_queues.size()];
+        QMutexLocker locker(&taskQueue->mutex);
+
+        while (!taskQueue->tasks.isEmpty())
+        {
+            DecodeTask *task = i ? taskQueue->tasks.takeLast() : taskQueue->tasks.takeFirst();
+            m_queuedTasks.fetchAndAddOrdered(-1);
+
+            if (!task->m_decodeState.testAndSetOrdered(Queued, Running))
+                continue;
+
+            if (i)
+                m_stolenTasks.fetchAndAddRelaxed(1);
+            return task;
+        }
+    }
+
+    return 0;
+}
+
+void DecodePool::runTask(int queue, DecodeTask *task)
+{
+    bool morePending = task->runDecodeTask();
+
+    if (!morePending && task->m_decodeState.testAndSetOrdered(Running, Idle))
+    {
+        /* Done for now */
+    }
+    else
+    {
+        /* Either it still has work or new work was scheduled while it ran. Nothing
+         * but this thread changes the state now, cancel() waits for it. */
+        task->m_decodeState.storeRelease(Queued);
+        enqueue(queue, task);
+    }
+
+    if (m_cancelWaiters.loadAcquire() > 0)
+    {
+        m_finishedMutex.lock();
+        m_taskFinished.wakeAll();
+        m_finishedMutex.unlock();
+    }
+}
+
+void DecodePool::runThread(int index)
+{
+    while (!m_quit.loadAcquire())
+    {
+        DecodeTask *task = takeTask(index);
+        if (task)
+        {
+            runTask(index, task);
+            continue;
+        }
+
+        m_sleepMutex.lock();
+        m_sleepingThreads.fetchAndAddOrdered(1);
+        if (m_queuedTasks.fetchAndAddOrdered(0) <= 0 && !m_quit.loadAcquire())
+            m_workAvailable.wait(&m_sleepMutex, idleWaitTime);
+        m_sleepingThreads.fetchAndAddOrdered(-1);
+        m_sleepMutex.unlock();
+    }
+}
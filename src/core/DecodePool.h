@@ -0,0 +1,113 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECODE_POOL_H
+#define DECODE_POOL_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+class DecodePool;
+class DecodePoolThread;
+
+/* Unit of work for DecodePool, typically one stream's decoder. A task
+ * is never run by two threads at once, so it can keep decoder state without
+ * locking; it may however move between pool threads from one run to the next. */
+class DecodeTask
+{
+    friend class DecodePool;
+
+public:
+    DecodeTask();
+    virtual ~DecodeTask() { }
+
+protected:
+    /* Does a bounded amount of work, so that other tasks get their turn, and
+     * returns true when more work is pending right away. */
+    virtual bool runDecodeTask() = 0;
+
+private:
+    QAtomicInt m_decodeState;
+    int m_homeThread;
+};
+
+/* Runs decode tasks on a fixed number of threads, by default one per core.
+ *
+ * Every thread has its own queue. schedule() puts a task on its home thread's
+ * queue and a task that still has work after its turn goes to the back of the
+ * queue of the thread that ran it. Threads that run out of work steal from the
+ * back of other queues, so one busy stream can't hold back the streams queued
+ * behind it while other cores are idle. */
+class DecodePool
+{
+    Q_DISABLE_COPY(DecodePool)
+
+public:
+    static DecodePool * instance();
+
+    explicit DecodePool(int threadCount = 0);
+    ~DecodePool();
+
+    int threadCount() const { return m_threads.size(); }
+    int stolenTasks() const { return m_stolenTasks.load(); }
+
+    /* Makes sure the task runs soon; does nothing if it is queued already. Safe
+     * from any thread, including from within the task. */
+    void schedule(DecodeTask *task);
+
+    /* Takes the task out of the pool, waiting for a run in progress to finish.
+     * The task is never run again afterwards and may be deleted. Must not be
+     * called from within the task. */
+    void cancel(DecodeTask *task);
+
+private:
+    friend class DecodePoolThread;
+
+    struct TaskQueue
+    {
+        QMutex mutex;
+        QList<DecodeTask *> tasks;
+    };
+
+    static DecodePool *m_instance;
+
+    QVector<TaskQueue *> m_queues;
+    QVector<DecodePoolThread *> m_threads;
+    QAtomicInt m_nextHomeThread;
+    QAtomicInt m_queuedTasks;
+    QAtomicInt m_stolenTasks;
+    QAtomicInt m_quit;
+
+    QMutex m_sleepMutex;
+    QWaitCondition m_workAvailable;
+    QAtomicInt m_sleepingThreads;
+
+    QMutex m_finishedMutex;
+    QWaitCondition m_taskFinished;
+    QAtomicInt m_cancelWaiters;
+
+    void enqueue(int queue, DecodeTask *task);
+    DecodeTask * takeTask(int queue);
+    void runThread(int index);
+    void runTask(int queue, DecodeTask *task);
+
+};
+
+#endif // DECODE_POOL_H
@@ -18,25 +18,32 @@
 #ifndef LIVESTREAM_H
 #define LIVESTREAM_H
 
+#include "core/LiveStreamTelemetry.h"
 #include <QImage>
 #include <QObject>
 #include <QSize>
+#include <QString>
 
 class LiveStream : public QObject
 {
     Q_OBJECT
-    Q_ENUMS(State)
+    Q_ENUMS(State Degradation)
 
     Q_PROPERTY(bool connected READ isConnected NOTIFY stateChanged)
     Q_PROPERTY(bool paused READ isPaused WRITE setPaused NOTIFY pausedChanged)
     Q_PROPERTY(int bandwidthMode READ bandwidthMode WRITE setBandwidthMode NOTIFY bandwidthModeChanged)
     Q_PROPERTY(float receivedFps READ receivedFps CONSTANT)
+    Q_PROPERTY(quint64 receivedRate READ receivedRate CONSTANT)
     Q_PROPERTY(QSize streamSize READ streamSize NOTIFY streamSizeChanged)
     Q_PROPERTY(State state READ state NOTIFY stateChanged)
     Q_PROPERTY(QString errdesc READ errorMessage CONSTANT)
     Q_PROPERTY(bool audio READ hasAudio NOTIFY audioChanged)
     Q_PROPERTY(bool audioPlaying READ isAudioEnabled NOTIFY audioChanged)
     Q_PROPERTY(bool hwVA READ hwAccelStatus NOTIFY hwAccelChanged)
+    Q_PROPERTY(bool lowLatency READ isLowLatency NOTIFY lowLatencyChanged)
+    Q_PROPERTY(bool stalled READ isStalled NOTIFY stalledChanged)
+    Q_PROPERTY(int degradation READ degradation NOTIFY degradationChanged)
+    Q_PROPERTY(int timeshift READ timeshift NOTIFY timeshiftChanged)
 
 public:
     enum State
@@ -50,6 +57,16 @@ public:
         Paused
     };
 
+    /* Steps the live view governor takes, in this order, while the system can't
+     * keep up with all streams */
+    enum Degradation
+    {
+        NotDegraded,
+        FrameRateCapped,
+        KeyframesOnly,
+        DecodingPaused
+    };
+
     explicit LiveStream(QObject *parent = 0);
     
     virtual int bandwidthMode() const = 0;
@@ -59,18 +76,59 @@ public:
     virtual QString errorMessage() const = 0;
 
     virtual QImage currentFrame() const = 0;
+    /* Frame prepared for the size hint given by consumer, for streams that scale
+     * per consumer; otherwise the same as currentFrame() */
+    virtual QImage scaledFrame(QObject *consumer) const { Q_UNUSED(consumer); return currentFrame(); }
     virtual QSize streamSize() const = 0;
 
     virtual float receivedFps() const = 0;
+    /* Bytes per second over the last few seconds */
+    virtual quint64 receivedRate() const { return 0; }
+    /* Per-stage latencies and drops since the stream connected; invalid for
+     * streams that don't collect them */
+    virtual LiveStreamTelemetry telemetry() const { return LiveStreamTelemetry(); }
 
     virtual bool isPaused() const = 0;
     virtual bool isConnected() const  = 0;
+    /* Connected, but video stopped arriving for longer than usual */
+    virtual bool isStalled() const { return false; }
 
     virtual bool hasAudio() const = 0;
     virtual bool isAudioEnabled() const  = 0;
-    virtual void setFrameSizeHint(int width, int height) = 0;
-    virtual void ref() = 0;
-    virtual void unref() = 0;
+    /* Every item displaying the stream refs it and reports the size it draws at */
+    virtual void setFrameSizeHint(QObject *consumer, int width, int height) = 0;
+    virtual void ref(QObject *consumer) = 0;
+    virtual void unref(QObject *consumer) = 0;
+    /* Whether the consumer is actually on screen; streams nobody can see may
+     * suspend themselves */
+    virtual void setConsumerVisible(QObject *consumer, bool visible) { Q_UNUSED(consumer); Q_UNUSED(visible); }
+    /* Consumers that need the picture as early as possible, such as while the
+     * camera is being moved, trade smoothness for latency; the stream is in low
+     * latency mode while any of them asks for it */
+    virtual bool isLowLatency() const { return false; }
+    virtual void setLowLatency(QObject *consumer, bool lowLatency) { Q_UNUSED(consumer); Q_UNUSED(lowLatency); }
+    /* Largest size any consumer draws the stream at; invalid if one of them
+     * draws it at native size */
+    virtual QSize largestFrameSizeHint() const { return QSize(); }
+
+    virtual int degradation() const { return NotDegraded; }
+    virtual void setDegradation(int degradation) { Q_UNUSED(degradation); }
+
+    /* Milliseconds of recent video kept locally to replay and export; none for
+     * streams that don't keep any */
+    virtual int replayLength() const { return 0; }
+    /* How far behind live the picture shown is, in milliseconds; 0 while live.
+     * Setting it pauses on the recent picture from that far back, setting 0
+     * returns to live. */
+    virtual int timeshift() const { return 0; }
+    virtual void setTimeshift(int msecs) { Q_UNUSED(msecs); }
+    /* Writes the last msecs of recent video to a Matroska file as it was
+     * received, without decoding it; replayExported() tells how that went */
+    virtual void exportReplay(const QString &fileName, int msecs)
+    {
+        Q_UNUSED(msecs);
+        emit replayExported(fileName, QString::fromLatin1("No recent video"));
+    }
 
 public slots:
     virtual void start() = 0;
@@ -88,6 +146,12 @@ signals:
     void pausedChanged(bool paused);
     void bandwidthModeChanged(int mode);
     void hwAccelChanged(bool status);
+    void lowLatencyChanged(bool lowLatency);
+    void stalledChanged(bool stalled);
+    void degradationChanged(int degradation);
+    void timeshiftChanged(int timeshift);
+    /* errorMessage is empty on success */
+    void replayExported(const QString &fileName, const QString &errorMessage);
 
     void streamRunning();
     void streamStopped();
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LiveStreamBandwidthPolicy.h"
+
+/* Below 320x240 keyframes are enough, full video again from 480x360 */
+static const int defaultLowArea = 320 * 240;
+static const int defaultFullArea = 480 * 360;
+static const qint64 defaultHoldTime = 15000;
+
+LiveStreamBandwidthPolicy::LiveStreamBandwidthPolicy()
+    : m_mode(LiveViewManager::FullBandwidth), m_lowArea(defaultLowArea), m_fullArea(defaultFullArea),
+      m_serverBudget(0), m_holdTime(defaultHoldTime), m_lastChange(-1), m_fullBitrate(0), m_lowBitrate(0)
+{
+}
+
+void LiveStreamBandwidthPolicy::setTileThresholds(int lowArea, int fullArea)
+{
+    Q_ASSERT(lowArea <= fullArea);
+
+    m_lowArea = lowArea;
+    m_fullArea = fullArea;
+}
+
+void LiveStreamBandwidthPolicy::setServerBudget(qint64 budget)
+{
+    m_serverBudget = qMax(Q_INT64_C(0), budget);
+}
+
+void LiveStreamBandwidthPolicy::setHoldTime(qint64 holdTime)
+{
+    m_holdTime = holdTime;
+}
+
+qint64 LiveStreamBandwidthPolicy::expectedBitrate() const
+{
+    return m_mode == LiveViewManager::FullBandwidth ? m_fullBitrate : m_lowBitrate;
+}
+
+void LiveStreamBandwidthPolicy::reset(LiveViewManager::BandwidthMode mode)
+{
+    m_mode = mode;
+    m_lastChange = -1;
+}
+
+void LiveStreamBandwidthPolicy::setMode(LiveViewManager::BandwidthMode mode, qint64 now)
+{
+    m_mode = mode;
+    m_lastChange = now;
+}
+
+bool LiveStreamBandwidthPolicy::update(const QSize &tileSize, qint64 bitrate, qint64 otherBitrate, qint64 now)
+{
+    /* Remember what each mode costs, to know what switching would save or add */
+    if (bitrate > 0)
+    {
+        if (m_mode == LiveViewManager::FullBandwidth)
+            m_fullBitrate = bitrate;
+        else
+            m_lowBitrate = bitrate;
+    }
+
+    if (m_lastChange >= 0 && now - m_lastChange < m_holdTime)
+        return false;
+
+    qint64 area = tileSize.isValid() ? qint64(tileSize.width()) * tileSize.height() : -1;
+
+    if (m_mode == LiveViewManager::FullBandwidth)
+    {
+        bool small = area >= 0 && area < m_lowArea;
+        bool overBudget = m_serverBudget > 0 && otherBitrate + m_fullBitrate > m_serverBudget;
+        if (!small && !overBudget)
+            return false;
+
+        setMode(LiveViewManager::LowBandwidth, now);
+        return true;
+    }
+
+    bool large = area < 0 || area >= m_fullArea;
+    /* Coming back has to leave a quarter of the budget free, or the next
+     * fluctuation would push it straight back down */
+    bool fits = m_serverBudget <= 0 || (otherBitrate + m_fullBitrate) * 4 <= m_serverBudget * 3;
+    if (!large || !fits)
+        return false;
+
+    setMode(LiveViewManager::FullBandwidth, now);
+    return true;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIVESTREAMBANDWIDTHPOLICY_H
+#define LIVESTREAMBANDWIDTHPOLICY_H
+
+#include <QSize>
+#include "core/LiveViewManager.h"
+
+/* Picks between full and keyframe-only streaming for one stream in automatic
+ * bandwidth mode.
+ *
+ * A stream drawn only in small tiles gets keyframes only; it goes back to full
+ * video once a tile grows well past that size again. When its server has a
+ * bandwidth budget, a stream also drops to keyframes once the streams from that
+ * server together exceed the budget, and only comes back when its full rate fits
+ * with room to spare. Each mode is held for a while before changing again, since
+ * every change means a new connection. */
+class LiveStreamBandwidthPolicy
+{
+public:
+    LiveStreamBandwidthPolicy();
+
+    LiveViewManager::BandwidthMode mode() const { return m_mode; }
+
+    /* Tile areas in pixels below which keyframes are enough, and from which full
+     * video is wanted again */
+    void setTileThresholds(int lowArea, int fullArea);
+    /* Bits per second all streams from one server may use together, 0 for no limit */
+    void setServerBudget(qint64 budget);
+    void setHoldTime(qint64 holdTime);
+
+    /* Bits per second the stream is expected to use in its current mode */
+    qint64 expectedBitrate() const;
+
+    /* Starts over in the given mode, free to change it on the next update */
+    void reset(LiveViewManager::BandwidthMode mode);
+
+    /* Takes the largest tile showing the stream (invalid if any consumer wants the
+     * native size), the measured bitrate of the stream, the expected bitrate of the
+     * other streams from its server, and the time in milliseconds on a monotonic
+     * clock. Returns true if mode() changed. */
+    bool update(const QSize &tileSize, qint64 bitrate, qint64 otherBitrate, qint64 now);
+
+private:
+    LiveViewManager::BandwidthMode m_mode;
+    int m_lowArea;
+    int m_fullArea;
+    qint64 m_serverBudget;
+    qint64 m_holdTime;
+    qint64 m_lastChange;
+    qint64 m_fullBitrate;
+    qint64 m_lowBitrate;
+
+    void setMode(LiveViewManager::BandwidthMode mode, qint64 now);
+};
+
+#endif // LIVESTREAMBANDWIDTHPOLICY_H
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LiveStreamTelemetry.h"
+#include <QStringList>
+
+LiveStreamTelemetry::LiveStreamTelemetry()
+    : m_valid(false), m_latencies(StageCount), m_drops(StageCount, 0),
+      m_bytesReceived(0), m_bitrate(0), m_timeToFirstFrame(-1)
+{
+}
+
+QString LiveStreamTelemetry::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case ReadStage:
+        return QLatin1String("read");
+    case DecodeStage:
+        return QLatin1String("decode");
+    case FormatStage:
+        return QLatin1String("format");
+    case QueueStage:
+        return QLatin1String("queue");
+    case PresentStage:
+        return QLatin1String("present");
+    default:
+        return QString();
+    }
+}
+
+QString LiveStreamTelemetry::toString() const
+{
+    if (!m_valid)
+        return QString();
+
+    QStringList lines;
+    lines << QString::fromLatin1("first frame %1 ms, %2 kbit/s, %3 bytes")
+             .arg(m_timeToFirstFrame).arg(m_bitrate / 1000).arg(m_bytesReceived);
+
+    for (int i = 0; i < StageCount; ++i)
+    {
+        const LatencySummary &latency = m_latencies.at(i);
+        lines << QString::fromLatin1("%1: %2 samples, mean %3 us, p50 %4 us, p99 %5 us, max %6 us, %7 dropped")
+                 .arg(stageName(Stage(i))).arg(latency.count()).arg(latency.mean())
+                 .arg(latency.percentile(50)).arg(latency.percentile(99)).arg(latency.max())
+                 .arg(m_drops.at(i));
+    }
+
+    return lines.join(QLatin1String("\n"));
+}
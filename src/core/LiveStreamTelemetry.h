@@ -0,0 +1,83 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIVESTREAMTELEMETRY_H
+#define LIVESTREAMTELEMETRY_H
+
+#include "utils/LatencyHistogram.h"
+#include <QString>
+#include <QVector>
+
+/* Where the time of a live stream's frames went since it connected, stage by
+ * stage, to compare cameras and client machines. Times are in microseconds.
+ *
+ *  - ReadStage: waiting for and reading each packet from the network
+ *  - DecodeStage: decoding each video packet
+ *  - FormatStage: deinterlacing and scaling each frame for its consumers
+ *  - QueueStage: from a frame being queued to it being shown
+ *  - PresentStage: how late each frame was shown compared to when it was due
+ *
+ * Drops count packets or frames given up at that stage: packets the decoder
+ * could not keep up with, decode and format failures, frames the full queue
+ * displaced, and frames skipped on screen because a newer one was due. */
+class LiveStreamTelemetry
+{
+public:
+    enum Stage
+    {
+        ReadStage,
+        DecodeStage,
+        FormatStage,
+        QueueStage,
+        PresentStage,
+        StageCount
+    };
+
+    LiveStreamTelemetry();
+
+    /* False for streams that don't collect telemetry */
+    bool isValid() const { return m_valid; }
+    void setValid(bool valid) { m_valid = valid; }
+
+    LatencySummary latency(Stage stage) const { return m_latencies.at(stage); }
+    void setLatency(Stage stage, const LatencySummary &latency) { m_latencies[stage] = latency; }
+    int drops(Stage stage) const { return m_drops.at(stage); }
+    void setDrops(Stage stage, int drops) { m_drops[stage] = drops; }
+
+    qint64 bytesReceived() const { return m_bytesReceived; }
+    void setBytesReceived(qint64 bytes) { m_bytesReceived = bytes; }
+    /* Average since the stream connected, in bits per second */
+    qint64 bitrate() const { return m_bitrate; }
+    void setBitrate(qint64 bitrate) { m_bitrate = bitrate; }
+    /* Milliseconds, or -1 before the first frame */
+    int timeToFirstFrame() const { return m_timeToFirstFrame; }
+    void setTimeToFirstFrame(int milliseconds) { m_timeToFirstFrame = milliseconds; }
+
+    static QString stageName(Stage stage);
+    /* One line per stage, for logs and bug reports */
+    QString toString() const;
+
+private:
+    bool m_valid;
+    QVector<LatencySummary> m_latencies;
+    QVector<int> m_drops;
+    qint64 m_bytesReceived;
+    qint64 m_bitrate;
+    int m_timeToFirstFrame;
+};
+
+#endif // LIVESTREAMTELEMETRY_H
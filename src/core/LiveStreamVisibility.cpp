@@ -0,0 +1,107 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LiveStreamVisibility.h"
+
+/* Long enough not to react to switching layouts or windows, in milliseconds */
+static const int suspendDecodingDelay = 3000;
+/* Reconnecting takes a moment; not worth it for a brief look elsewhere */
+static const int suspendConnectionDelay = 60000;
+
+LiveStreamVisibility::LiveStreamVisibility(QObject *parent)
+    : QObject(parent), m_suspension(NotSuspended)
+{
+    m_decodingTimer.setSingleShot(true);
+    m_decodingTimer.setInterval(suspendDecodingDelay);
+    connect(&m_decodingTimer, SIGNAL(timeout()), SLOT(suspendDecoding()));
+
+    m_connectionTimer.setSingleShot(true);
+    m_connectionTimer.setInterval(suspendConnectionDelay);
+    connect(&m_connectionTimer, SIGNAL(timeout()), SLOT(suspendConnection()));
+}
+
+void LiveStreamVisibility::setSuspendDelays(int decodingDelay, int connectionDelay)
+{
+    m_decodingTimer.setInterval(decodingDelay);
+    m_connectionTimer.setInterval(connectionDelay);
+}
+
+void LiveStreamVisibility::addConsumer(QObject *consumer)
+{
+    m_consumers.insert(consumer);
+    m_hiddenConsumers.remove(consumer);
+    update();
+}
+
+void LiveStreamVisibility::removeConsumer(QObject *consumer)
+{
+    m_consumers.remove(consumer);
+    m_hiddenConsumers.remove(consumer);
+    update();
+}
+
+void LiveStreamVisibility::setConsumerVisible(QObject *consumer, bool visible)
+{
+    if (!m_consumers.contains(consumer))
+        return;
+
+    if (visible)
+        m_hiddenConsumers.remove(consumer);
+    else
+        m_hiddenConsumers.insert(consumer);
+    update();
+}
+
+bool LiveStreamVisibility::isVisible() const
+{
+    return m_consumers.isEmpty() || m_hiddenConsumers.size() < m_consumers.size();
+}
+
+void LiveStreamVisibility::update()
+{
+    if (isVisible())
+    {
+        m_decodingTimer.stop();
+        m_connectionTimer.stop();
+        setSuspension(NotSuspended);
+    }
+    else if (m_suspension == NotSuspended && !m_decodingTimer.isActive())
+    {
+        m_decodingTimer.start();
+        m_connectionTimer.start();
+    }
+}
+
+void LiveStreamVisibility::suspendDecoding()
+{
+    if (m_suspension == NotSuspended)
+        setSuspension(DecodingSuspended);
+}
+
+void LiveStreamVisibility::suspendConnection()
+{
+    setSuspension(ConnectionSuspended);
+}
+
+void LiveStreamVisibility::setSuspension(Suspension suspension)
+{
+    if (m_suspension == suspension)
+        return;
+
+    m_suspension = suspension;
+    emit suspensionChanged(suspension);
+}
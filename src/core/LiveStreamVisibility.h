@@ -0,0 +1,75 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIVESTREAMVISIBILITY_H
+#define LIVESTREAMVISIBILITY_H
+
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+/* Tracks whether anyone can see a live stream, so that the stream can stop
+ * spending CPU and bandwidth on video nobody watches.
+ *
+ * Every consumer of the stream reports whether it is visible on screen. Once all
+ * of them have been hidden for a short grace period decoding is suspended, and
+ * after a longer one the connection as well. Any consumer becoming visible again
+ * lifts the suspension right away. A stream without consumers is left alone. */
+class LiveStreamVisibility : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Suspension
+    {
+        NotSuspended,
+        DecodingSuspended,
+        ConnectionSuspended
+    };
+
+    explicit LiveStreamVisibility(QObject *parent = 0);
+
+    /* Grace periods in milliseconds, counted from all consumers being hidden */
+    void setSuspendDelays(int decodingDelay, int connectionDelay);
+
+    /* Consumers count as visible until they say otherwise */
+    void addConsumer(QObject *consumer);
+    void removeConsumer(QObject *consumer);
+    void setConsumerVisible(QObject *consumer, bool visible);
+
+    bool isVisible() const;
+    Suspension suspension() const { return m_suspension; }
+
+signals:
+    void suspensionChanged(int suspension);
+
+private slots:
+    void suspendDecoding();
+    void suspendConnection();
+
+private:
+    QSet<QObject *> m_consumers;
+    QSet<QObject *> m_hiddenConsumers;
+    QTimer m_decodingTimer;
+    QTimer m_connectionTimer;
+    Suspension m_suspension;
+
+    void update();
+    void setSuspension(Suspension suspension);
+};
+
+#endif // LIVESTREAMVISIBILITY_H
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LiveViewGovernor.h"
+#include "core/BluecherryApp.h"
+#include "core/LiveStream.h"
+#include "core/LiveViewManager.h"
+#include "core/TransferRateCalculator.h"
+#include <QDebug>
+#include <QSettings>
+#include <QThread>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static const int eventLoopInterval = 50;
+static const int evaluateInterval = 1000;
+static const double defaultCpuBudget = 0.85;
+static const int defaultEventLoopLatencyBudget = 100;
+/* Headroom means staying below this share of every budget */
+static const double headroomShare = 0.6;
+/* Degrade after this many overloaded checks in a row, restore after this many with
+ * headroom; either way the streams get time to settle before the next step */
+static const int overloadedChecksToDegrade = 2;
+static const int headroomChecksToRestore = 4;
+static const int focusPriority = 1 << 20;
+static const int protectedPriority = 1 << 21;
+
+/* In microseconds, or -1 if unknown */
+static qint64 processCpuTime()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return -1;
+
+    quint64 kernelTime = (quint64(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    quint64 userTime = (quint64(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    /* In units of 100 nanoseconds */
+    return qint64((kernelTime + userTime) / 10);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+
+    return (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+}
+
+LiveViewGovernor::LiveViewGovernor(LiveViewManager *liveView)
+    : QObject(liveView), m_liveView(liveView), m_enabled(true), m_settingsConnected(false),
+      m_cpuBudget(defaultCpuBudget), m_eventLoopLatencyBudget(defaultEventLoopLatencyBudget), m_bitrateBudget(0),
+      m_eventLoopLatency(0), m_lastCpuTime(-1), m_overloadedChecks(0), m_headroomChecks(0)
+{
+    m_eventLoopTimer.setInterval(eventLoopInterval);
+    m_eventLoopTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_eventLoopTimer, SIGNAL(timeout()), SLOT(checkEventLoop()));
+
+    m_evaluateTimer.setInterval(evaluateInterval);
+    connect(&m_evaluateTimer, SIGNAL(timeout()), SLOT(evaluate()));
+}
+
+void LiveViewGovernor::setBudget(double cpu, int eventLoopLatency, qint64 bitrate)
+{
+    m_cpuBudget = cpu;
+    m_eventLoopLatencyBudget = eventLoopLatency;
+    m_bitrateBudget = bitrate;
+}
+
+LiveViewGovernor::Pressure LiveViewGovernor::pressure(const Load &load) const
+{
+    if (load.cpu > m_cpuBudget || load.eventLoopLatency > m_eventLoopLatencyBudget ||
+        (m_bitrateBudget > 0 && load.bitrate > m_bitrateBudget))
+        return Overloaded;
+
+    if (load.cpu < m_cpuBudget * headroomShare && load.eventLoopLatency < m_eventLoopLatencyBudget * headroomShare &&
+        (m_bitrateBudget <= 0 || load.bitrate < m_bitrateBudget * headroomShare))
+        return Headroom;
+
+    return Comfortable;
+}
+
+/* The least degraded streams go first, so every stream gets a frame rate cap
+ * before any gets keyframes only; among those the least important one */
+int LiveViewGovernor::nextToDegrade(const QList<Candidate> &candidates)
+{
+    int next = -1;
+    for (int i = 0; i < candidates.size(); ++i)
+    {
+        const Candidate &c = candidates.at(i);
+        if (c.degradation >= c.maximumDegradation)
+            continue;
+
+        if (next < 0 || c.degradation < candidates.at(next).degradation ||
+            (c.degradation == candidates.at(next).degradation && c.priority < candidates.at(next).priority))
+            next = i;
+    }
+
+    return next;
+}
+
+/* Exactly the reverse of nextToDegrade() */
+int LiveViewGovernor::nextToRestore(const QList<Candidate> &candidates)
+{
+    int next = -1;
+    for (int i = 0; i < candidates.size(); ++i)
+    {
+        const Candidate &c = candidates.at(i);
+        if (c.degradation <= 0)
+            continue;
+
+        if (next < 0 || c.degradation > candidates.at(next).degradation ||
+            (c.degradation == candidates.at(next).degradation && c.priority > candidates.at(next).priority))
+            next = i;
+    }
+
+    return next;
+}
+
+void LiveViewGovernor::setFocusedStream(LiveStream *stream)
+{
+    m_focusedStream = stream;
+}
+
+void LiveViewGovernor::start()
+{
+    if (!m_settingsConnected)
+    {
+        connect(bcApp, SIGNAL(settingsChanged()), SLOT(updateSettings()));
+        m_settingsConnected = true;
+    }
+
+    updateSettings();
+}
+
+void LiveViewGovernor::stop()
+{
+    m_eventLoopTimer.stop();
+    m_evaluateTimer.stop();
+}
+
+void LiveViewGovernor::updateSettings()
+{
+    QSettings settings;
+    m_enabled = settings.value(QLatin1String("ui/liveview/governor"), true).toBool();
+    /* In kbit/s */
+    m_bitrateBudget = settings.value(QLatin1String("ui/liveview/totalBandwidthLimit"), 0).toLongLong() * 1000;
+
+    if (!m_enabled)
+    {
+        stop();
+        restoreAll();
+        return;
+    }
+
+    if (m_evaluateTimer.isActive() || m_liveView->streams().isEmpty())
+        return;
+
+    m_eventLoopLatency = 0;
+    m_eventLoopClock.start();
+    m_eventLoopTimer.start();
+
+    m_lastCpuTime = processCpuTime();
+    m_cpuClock.start();
+    m_overloadedChecks = 0;
+    m_headroomChecks = 0;
+    m_evaluateTimer.start();
+}
+
+void LiveViewGovernor::checkEventLoop()
+{
+    int latency = int(m_eventLoopClock.restart()) - eventLoopInterval;
+    m_eventLoopLatency = qMax(m_eventLoopLatency, latency);
+}
+
+LiveViewGovernor::Load LiveViewGovernor::measureLoad()
+{
+    Load load;
+
+    qint64 cpuTime = processCpuTime();
+    qint64 elapsed = m_cpuClock.nsecsElapsed() / 1000;
+    if (cpuTime >= 0 && m_lastCpuTime >= 0 && elapsed > 0)
+        load.cpu = double(cpuTime - m_lastCpuTime) / (double(elapsed) * qMax(1, QThread::idealThreadCount()));
+    m_lastCpuTime = cpuTime;
+    m_cpuClock.restart();
+
+    load.eventLoopLatency = m_eventLoopLatency;
+    m_eventLoopLatency = 0;
+
+    load.bitrate = qint64(bcApp->globalRate->currentRate()) * 8;
+    return load;
+}
+
+LiveViewGovernor::Candidate LiveViewGovernor::candidate(LiveStream *stream) const
+{
+    Candidate c;
+    c.degradation = stream->degradation();
+
+    QSize size = stream->largestFrameSizeHint();
+    if (!size.isValid())
+        size = stream->streamSize();
+    /* Thousands of pixels shown */
+    c.priority = int(qint64(size.width()) * size.height() / 1000);
+
+    if (stream == m_focusedStream.data())
+        c.priority += focusPriority;
+
+    /* Keyframes only would be useless to listen to or to steer a camera by */
+    if (stream->isAudioEnabled() || stream->isLowLatency())
+    {
+        c.priority += protectedPriority;
+        c.maximumDegradation = LiveStream::FrameRateCapped;
+    }
+    else
+    {
+        c.maximumDegradation = LiveStream::DecodingPaused;
+    }
+
+    return c;
+}
+
+void LiveViewGovernor::evaluate()
+{
+    QList<LiveStream *> streams;
+    QList<Candidate> candidates;
+
+    foreach (LiveStream *stream, m_liveView->streams())
+    {
+        /* A stream that stopped starts over undegraded */
+        if (stream->state() < LiveStream::Connecting)
+        {
+            stream->setDegradation(LiveStream::NotDegraded);
+            continue;
+        }
+
+        Candidate c = candidate(stream);
+        /* Audio or PTZ was turned on since */
+        if (c.degradation > c.maximumDegradation)
+        {
+            stream->setDegradation(c.maximumDegradation);
+            c.degradation = c.maximumDegradation;
+        }
+
+        streams.append(stream);
+        candidates.append(c);
+    }
+
+    if (streams.isEmpty())
+    {
+        stop();
+        return;
+    }
+
+    Load load = measureLoad();
+    switch (pressure(load))
+    {
+    case Overloaded:
+        m_headroomChecks = 0;
+        if (++m_overloadedChecks >= overloadedChecksToDegrade)
+        {
+            m_overloadedChecks = 0;
+            qDebug() << "LiveViewGovernor: overloaded, cpu" << load.cpu << "event loop latency"
+                     << load.eventLoopLatency << "ms bitrate" << load.bitrate;
+
+            for (int next = nextToDegrade(candidates); next >= 0; next = nextToDegrade(candidates))
+            {
+                int degradation = candidates.at(next).degradation + 1;
+                streams.at(next)->setDegradation(degradation);
+                if (streams.at(next)->degradation() == degradation)
+                    break;
+
+                /* Not every kind of stream can be degraded */
+                candidates[next].maximumDegradation = candidates.at(next).degradation;
+            }
+        }
+        break;
+
+    case Headroom:
+        m_overloadedChecks = 0;
+        if (++m_headroomChecks >= headroomChecksToRestore)
+        {
+            m_headroomChecks = 0;
+            int next = nextToRestore(candidates);
+            if (next >= 0)
+                streams.at(next)->setDegradation(candidates.at(next).degradation - 1);
+        }
+        break;
+
+    case Comfortable:
+        m_overloadedChecks = 0;
+        m_headroomChecks = 0;
+        break;
+    }
+}
+
+void LiveViewGovernor::restoreAll()
+{
+    foreach (LiveStream *stream, m_liveView->streams())
+        stream->setDegradation(LiveStream::NotDegraded);
+}
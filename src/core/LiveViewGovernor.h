@@ -0,0 +1,121 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIVEVIEWGOVERNOR_H
+#define LIVEVIEWGOVERNOR_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class LiveStream;
+class LiveViewManager;
+
+/* Keeps the live view within what the machine can handle.
+ *
+ * Once a second it looks at the CPU time used by the process, how late the GUI
+ * event loop runs, and the total bitrate of all streams. While any of them is
+ * over budget, streams are degraded one step at a time: first every stream gets
+ * a frame rate cap, then keyframes only, then decoding is paused. The least
+ * important stream goes first in each round; importance comes from the size it
+ * is shown at and whether it has focus, and streams playing audio or under PTZ
+ * control are never degraded beyond the frame rate cap. Once there is headroom
+ * again for a while, streams are restored the other way round. */
+class LiveViewGovernor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Pressure
+    {
+        Headroom,
+        Comfortable,
+        Overloaded
+    };
+
+    struct Load
+    {
+        Load() : cpu(0), eventLoopLatency(0), bitrate(0) { }
+
+        /* Share of all cores, from 0 to 1 */
+        double cpu;
+        /* Worst delay of the event loop in milliseconds */
+        int eventLoopLatency;
+        /* Bits per second */
+        qint64 bitrate;
+    };
+
+    struct Candidate
+    {
+        Candidate() : priority(0), degradation(0), maximumDegradation(0) { }
+
+        int priority;
+        int degradation;
+        int maximumDegradation;
+    };
+
+    explicit LiveViewGovernor(LiveViewManager *liveView);
+
+    /* A bitrate budget of 0 means no limit */
+    void setBudget(double cpu, int eventLoopLatency, qint64 bitrate);
+    Pressure pressure(const Load &load) const;
+
+    /* Index of the candidate to degrade or restore by one step, or -1 */
+    static int nextToDegrade(const QList<Candidate> &candidates);
+    static int nextToRestore(const QList<Candidate> &candidates);
+
+    LiveStream * focusedStream() const { return m_focusedStream.data(); }
+    void setFocusedStream(LiveStream *stream);
+
+public slots:
+    /* Runs while there are live streams */
+    void start();
+    void stop();
+
+private slots:
+    void checkEventLoop();
+    void evaluate();
+    void updateSettings();
+
+private:
+    LiveViewManager *m_liveView;
+    QPointer<LiveStream> m_focusedStream;
+    bool m_enabled;
+    bool m_settingsConnected;
+
+    double m_cpuBudget;
+    int m_eventLoopLatencyBudget;
+    qint64 m_bitrateBudget;
+
+    QTimer m_eventLoopTimer;
+    QElapsedTimer m_eventLoopClock;
+    int m_eventLoopLatency;
+
+    QTimer m_evaluateTimer;
+    QElapsedTimer m_cpuClock;
+    qint64 m_lastCpuTime;
+    int m_overloadedChecks;
+    int m_headroomChecks;
+
+    Load measureLoad();
+    Candidate candidate(LiveStream *stream) const;
+    void restoreAll();
+};
+
+#endif // LIVEVIEWGOVERNOR_H
@@ -17,11 +17,18 @@
 
 #include "LiveViewManager.h"
 #include "core/LiveStream.h"
+#include "core/LiveViewGovernor.h"
 #include <QAction>
 
 LiveViewManager::LiveViewManager(QObject *parent)
     : QObject(parent), m_bandwidthMode(FullBandwidth)
 {
+    m_governor = new LiveViewGovernor(this);
+}
+
+QList<LiveStream *> LiveViewManager::streams() const
+{
+    return m_streams;
 }
 
 void LiveViewManager::switchAudio(LiveStream *stream)
@@ -39,6 +46,7 @@ void LiveViewManager::addStream(LiveStream *stream)
     m_streams.append(stream);
     connect(this, SIGNAL(bandwidthModeChanged(int)), stream, SLOT(setBandwidthMode(int)));
     stream->setBandwidthMode(bandwidthMode());
+    m_governor->start();
 }
 
 void LiveViewManager::removeStream(LiveStream *stream)
@@ -80,6 +88,7 @@ QList<QAction*> LiveViewManager::bandwidthActions(int cv, QObject *target,
 {
     QList<QAction*> re;
     re << createAction(tr("Full Bandwidth"), FullBandwidth, cv, target, slot)
-       << createAction(tr("Low Bandwidth"), LowBandwidth, cv, target, slot);
+       << createAction(tr("Low Bandwidth"), LowBandwidth, cv, target, slot)
+       << createAction(tr("Automatic Bandwidth"), AutoBandwidth, cv, target, slot);
     return re;
 }
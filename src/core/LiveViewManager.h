@@ -21,6 +21,7 @@
 #include <QObject>
 
 class LiveStream;
+class LiveViewGovernor;
 class QAction;
 
 class LiveViewManager : public QObject
@@ -34,7 +35,9 @@ public:
     enum BandwidthMode
     {
         FullBandwidth,
-        LowBandwidth
+        LowBandwidth,
+        /* Each stream picks one of the above from its tiles and its server's throughput */
+        AutoBandwidth
     };
 
     explicit LiveViewManager(QObject *parent = 0);
@@ -42,6 +45,7 @@ public:
     QList<LiveStream *> streams() const;
 
     BandwidthMode bandwidthMode() const { return m_bandwidthMode; }
+    LiveViewGovernor * governor() const { return m_governor; }
 
     QList<QAction*> bandwidthActions(int currentMode, QObject *target, const char *slot) const;
 
@@ -55,6 +59,7 @@ signals:
 private:
     QList<LiveStream*> m_streams;
     BandwidthMode m_bandwidthMode;
+    LiveViewGovernor *m_governor;
 
     friend class RtspStream;
     friend class MJpegStream;
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MJpegMultipartParser.h"
+#include <string.h>
+
+QByteArray MJpegMultipartParser::boundaryFromContentType(const QByteArray &contentType)
+{
+    QByteArray lower = contentType.toLower();
+
+    int sep = lower.indexOf(';');
+    if (sep < 0 || lower.left(sep).trimmed() != "multipart/x-mixed-replace")
+        return QByteArray();
+
+    sep = lower.indexOf("boundary=", sep);
+    if (sep < 0)
+        return QByteArray();
+
+    QByteArray boundary = contentType.mid(sep + 9).trimmed();
+    if (boundary.startsWith('"'))
+    {
+        int end = boundary.indexOf('"', 1);
+        return end > 1 ? boundary.mid(1, end - 1) : QByteArray();
+    }
+
+    int end = boundary.indexOf(';');
+    if (end >= 0)
+        boundary = boundary.left(end).trimmed();
+    return boundary;
+}
+
+MJpegMultipartParser::MJpegMultipartParser(int maximumBufferSize)
+    : m_maximumBufferSize(maximumBufferSize), m_readPos(0), m_size(0), m_searchPos(0),
+      m_handedOut(false), m_state(ParserBoundary), m_bodyLength(0)
+{
+    for (int i = 0; i < 256; ++i)
+        m_skip[i] = 1;
+}
+
+void MJpegMultipartParser::setBoundary(const QByteArray &boundary)
+{
+    clear();
+    m_boundary = boundary;
+
+    /* Horspool's table: how far the search may move on, by the last byte it compared */
+    int length = m_boundary.size();
+    for (int i = 0; i < 256; ++i)
+        m_skip[i] = length;
+    for (int i = 0; i < length - 1; ++i)
+        m_skip[(uchar)m_boundary[i]] = length - 1 - i;
+}
+
+void MJpegMultipartParser::clear()
+{
+    m_buffer = QByteArray();
+    m_readPos = m_size = m_searchPos = 0;
+    m_state = ParserBoundary;
+    m_bodyLength = 0;
+    m_handedOut = false;
+    m_errorMessage.clear();
+}
+
+char * MJpegMultipartParser::reserve(int size)
+{
+    if (bufferedSize() >= m_maximumBufferSize)
+    {
+        m_errorMessage = QLatin1String("Exceeded maximum buffer size");
+        return 0;
+    }
+
+    if (m_handedOut)
+    {
+        /* Parts still use the buffer; the rest of the data moves to a new one */
+        QByteArray buffer(m_buffer.constData() + m_readPos, bufferedSize());
+        m_searchPos -= m_readPos;
+        m_size -= m_readPos;
+        m_readPos = 0;
+        m_buffer = buffer;
+        m_handedOut = false;
+    }
+    else if (m_readPos && m_readPos >= bufferedSize())
+        compact();
+
+    if (m_buffer.size() < m_size + size)
+        m_buffer.resize(m_size + size);
+    return m_buffer.data() + m_size;
+}
+
+void MJpegMultipartParser::commit(int size)
+{
+    m_size += qBound(0, size, m_buffer.size() - m_size);
+}
+
+void MJpegMultipartParser::append(const char *data, int size)
+{
+    char *dest = reserve(size);
+    if (!dest)
+        return;
+
+    memcpy(dest, data, size);
+    commit(size);
+}
+
+bool MJpegMultipartParser::takePart(MJpegPart *part)
+{
+    if (!hasBoundary() || hasError())
+        return false;
+
+    for (;;)
+    {
+        switch (m_state)
+        {
+        case ParserBoundary:
+            if (!parseBoundary())
+                return false;
+            break;
+        case ParserHeaders:
+            if (!parseHeaders())
+                return false;
+            break;
+        case ParserBody:
+            if (!parseBody(part))
+                return false;
+            /* Empty parts are skipped */
+            if (!part->isEmpty())
+                return true;
+            break;
+        }
+    }
+}
+
+int MJpegMultipartParser::findBoundary(int from)
+{
+    const char *data = m_buffer.constData();
+    const char *boundary = m_boundary.constData();
+    const int length = m_boundary.size();
+    const uchar last = boundary[length - 1];
+
+    int pos = qMax(from, m_readPos);
+    while (pos + length <= m_size)
+    {
+        uchar c = data[pos + length - 1];
+        if (c == last && memcmp(data + pos, boundary, length - 1) == 0)
+            return pos;
+        pos += m_skip[c];
+    }
+
+    /* There's no match before pos, whatever follows */
+    m_searchPos = pos;
+    return -1;
+}
+
+/* Where the line of a boundary found at pos ends; 0 if that isn't known yet and
+ * -1 if it isn't a boundary after all */
+int MJpegMultipartParser::boundaryEnd(int pos) const
+{
+    const char *data = m_buffer.constData();
+    int end = pos + m_boundary.size();
+    int sz = m_size - end;
+
+    /* The last boundary ends in "--" */
+    if (sz >= 2 && data[end] == '-' && data[end+1] == '-')
+    {
+        end += 2;
+        sz -= 2;
+    }
+
+    if (sz >= 1 && data[end] == '\n')
+        return end + 1;
+    if (sz >= 2 && data[end] == '\r' && data[end+1] == '\n')
+        return end + 2;
+    if (sz < 2)
+        return 0;
+    return -1;
+}
+
+bool MJpegMultipartParser::parseBoundary()
+{
+    for (;;)
+    {
+        int boundary = findBoundary(m_searchPos);
+        if (boundary < 0)
+        {
+            /* Nothing before where the boundary could still start is needed */
+            m_readPos = qMin(m_searchPos, m_size);
+            return false;
+        }
+
+        int end = boundaryEnd(boundary);
+        if (!end)
+        {
+            m_readPos = m_searchPos = boundary;
+            return false;
+        }
+        if (end < 0)
+        {
+            m_searchPos = boundary + 1;
+            continue;
+        }
+
+        /* Reached the end of the boundary; headers follow */
+        m_readPos = m_searchPos = end;
+        m_state = ParserHeaders;
+        m_bodyLength = 0;
+        return true;
+    }
+}
+
+bool MJpegMultipartParser::parseHeaders()
+{
+    const char *data = m_buffer.constData();
+
+    for (;;)
+    {
+        const char *line = data + m_readPos;
+        const char *lineEnd = (const char *)memchr(line, '\n', m_size - m_readPos);
+        if (!lineEnd)
+            return false;
+
+        int length = lineEnd - line;
+        m_readPos += length + 1;
+
+        if (!length || (length == 1 && line[0] == '\r'))
+        {
+            m_searchPos = m_readPos;
+            m_state = ParserBody;
+            return true;
+        }
+
+        /* We only care about Content-Length */
+        if (length > 15 && qstrnicmp(line, "Content-Length:", 15) == 0)
+        {
+            bool ok = false;
+            m_bodyLength = QByteArray(line + 15, length - 15).trimmed().toInt(&ok);
+            /* A length that could never fit is as good as none */
+            if (!ok || m_bodyLength < 0 || m_bodyLength >= m_maximumBufferSize)
+                m_bodyLength = 0;
+        }
+    }
+}
+
+bool MJpegMultipartParser::parseBody(MJpegPart *part)
+{
+    const char *data = m_buffer.constData();
+    int bodyEnd;
+
+    if (m_bodyLength)
+    {
+        /* The easy route; Content-Length tells us where the body ends */
+        if (bufferedSize() < m_bodyLength)
+            return false;
+
+        bodyEnd = m_readPos + m_bodyLength;
+        m_searchPos = bodyEnd;
+    }
+    else
+    {
+        int boundary;
+        for (;;)
+        {
+            boundary = findBoundary(m_searchPos);
+            if (boundary < 0)
+                return false;
+
+            int end = boundaryEnd(boundary);
+            if (!end)
+            {
+                m_searchPos = boundary;
+                return false;
+            }
+            if (end > 0)
+                break;
+            m_searchPos = boundary + 1;
+        }
+
+        /* The line break and the "--" before the boundary belong to it */
+        bodyEnd = boundary;
+        if (bodyEnd - m_readPos >= 2 && data[bodyEnd-1] == '-' && data[bodyEnd-2] == '-')
+            bodyEnd -= 2;
+        if (bodyEnd > m_readPos && data[bodyEnd-1] == '\n')
+            --bodyEnd;
+        if (bodyEnd > m_readPos && data[bodyEnd-1] == '\r')
+            --bodyEnd;
+        m_searchPos = boundary;
+    }
+
+    part->buffer = m_buffer;
+    part->offset = m_readPos;
+    part->size = bodyEnd - m_readPos;
+    m_handedOut = true;
+
+    m_readPos = bodyEnd;
+    m_state = ParserBoundary;
+    return true;
+}
+
+void MJpegMultipartParser::compact()
+{
+    int size = bufferedSize();
+    memmove(m_buffer.data(), m_buffer.constData() + m_readPos, size);
+    m_searchPos -= m_readPos;
+    m_size = size;
+    m_readPos = 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MJPEG_MULTIPART_PARSER_H
+#define MJPEG_MULTIPART_PARSER_H
+
+#include <QByteArray>
+#include <QString>
+
+/* The body of one part, as a range of the buffer it arrived in. The parser
+ * never writes to a buffer again once it handed out a part of it. */
+struct MJpegPart
+{
+    MJpegPart() : offset(0), size(0) { }
+
+    QByteArray buffer;
+    int offset;
+    int size;
+
+    bool isEmpty() const { return size <= 0; }
+    /* Refers to buffer, which has to outlive the result */
+    QByteArray data() const { return QByteArray::fromRawData(buffer.constData() + offset, size); }
+};
+
+/* Splits a multipart/x-mixed-replace stream into the bodies of its parts.
+ *
+ * Data is read straight into the parser's buffer with reserve() and commit().
+ * The parser only moves offsets over it; the search for the boundary uses a skip
+ * table and never looks at the same bytes twice. A finished body is handed out
+ * along with the buffer it is in, and only whatever followed it is copied into
+ * a new buffer, which is rarely more than one read.
+ *
+ * The boundary is searched for as given in the header, without the "--" that
+ * should precede it. That works for feeds, notably from some Axis devices,
+ * that include the "--" in the header too. Anything that doesn't look like a
+ * boundary is skipped. */
+class MJpegMultipartParser
+{
+    Q_DISABLE_COPY(MJpegMultipartParser)
+
+public:
+    /* The boundary from a Content-Type header, or an empty array if it isn't
+     * multipart/x-mixed-replace */
+    static QByteArray boundaryFromContentType(const QByteArray &contentType);
+
+    explicit MJpegMultipartParser(int maximumBufferSize = 2 * 1024 * 1024);
+
+    bool hasBoundary() const { return !m_boundary.isEmpty(); }
+    /* Also starts over */
+    void setBoundary(const QByteArray &boundary);
+    void clear();
+
+    /* Room for size more bytes, valid until the next call to the parser */
+    char * reserve(int size);
+    /* How many of the reserved bytes were filled */
+    void commit(int size);
+    void append(const char *data, int size);
+
+    /* Takes the next complete body; false once there is none */
+    bool takePart(MJpegPart *part);
+
+    bool hasError() const { return !m_errorMessage.isEmpty(); }
+    QString errorMessage() const { return m_errorMessage; }
+    int bufferedSize() const { return m_size - m_readPos; }
+    int maximumBufferSize() const { return m_maximumBufferSize; }
+
+private:
+    enum State
+    {
+        ParserBoundary,
+        ParserHeaders,
+        ParserBody
+    };
+
+    const int m_maximumBufferSize;
+    QByteArray m_boundary;
+    int m_skip[256];
+
+    /* Valid data is m_buffer[m_readPos, m_size); the rest is reserved */
+    QByteArray m_buffer;
+    int m_readPos;
+    int m_size;
+    /* The boundary doesn't start before this */
+    int m_searchPos;
+    /* Set once a part refers to m_buffer, which then mustn't change */
+    bool m_handedOut;
+
+    State m_state;
+    int m_bodyLength;
+    QString m_errorMessage;
+
+    int findBoundary(int from);
+    int boundaryEnd(int pos) const;
+    bool parseBoundary();
+    bool parseHeaders();
+    bool parseBody(MJpegPart *part);
+    void compact();
+};
+
+#endif // MJPEG_MULTIPART_PARSER_H
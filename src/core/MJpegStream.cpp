@@ -18,35 +18,32 @@
 #include "BluecherryApp.h"
 #include "MJpegStream.h"
 #include "LiveViewManager.h"
-#include "utils/ImageDecodeTask.h"
+#include "MJpegStreamDecoder.h"
+#include "MJpegStreamNetwork.h"
+#include "MJpegStreamReader.h"
 #include "audio/AudioPlayer.h"
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
-#include <QNetworkReply>
+#include <QMetaObject>
 #include <QDebug>
 #include <QImage>
-#include <QThreadPool>
 #include <QTimer>
-#include <QDateTime>
 
 MJpegStream::MJpegStream(DVRCamera *camera, QObject *parent)
-    : LiveStream(parent), m_camera(camera), m_httpReply(0), m_currentFrameNo(0), m_latestFrameNo(0), m_fpsRecvTs(0), m_fpsRecvNo(0),
-      m_decodeTask(0), m_lastActivity(0), m_receivedFps(0), m_nam(0), m_httpBodyLength(0), m_state(NotConnected),
-      m_parserState(ParserBoundary), m_autoStart(false), m_paused(false), m_interval(1)
+    : LiveStream(parent), m_camera(camera), m_reader(0), m_currentFrameNo(0), m_state(NotConnected),
+      m_autoStart(false), m_paused(false), m_interval(1)
 {
     Q_ASSERT(m_camera);
     //connect(m_camera.data(), SIGNAL(destroyed(QObject*)), this, SLOT(deleteLater()));
 
     bcApp->liveView->addStream(this);
-    connect(&m_activityTimer, SIGNAL(timeout()), SLOT(checkActivity()));
 }
 
 MJpegStream::~MJpegStream()
 {
     bcApp->liveView->removeStream(this);
 
-    if (m_httpReply)
-        m_httpReply->deleteLater();
+    /* The reader deletes itself once it has stopped */
+    if (m_reader)
+        QMetaObject::invokeMethod(m_reader, "stop", Qt::QueuedConnection);
 }
 
 void MJpegStream::enableAudio(bool enable)
@@ -124,36 +121,31 @@ void MJpegStream::start()
 
     currentUrl.addEncodedQueryItem("activity", "1");
 
-    m_nam = bcApp->createNam();
+    /* A counter per connection, as the one of a reader that is still stopping
+     * may be counted into for a little longer */
+    m_transfer = bcApp->globalRate->createCounter(m_camera.data()->data().server());
+    m_currentFrameNo = 0;
 
-    m_httpReply = m_nam->get(QNetworkRequest(currentUrl));
-    m_httpReply->ignoreSslErrors();
-    connect(m_httpReply, SIGNAL(error(QNetworkReply::NetworkError)), SLOT(requestError()));
-    connect(m_httpReply, SIGNAL(finished()), SLOT(requestError()));
-    connect(m_httpReply, SIGNAL(readyRead()), SLOT(readable()));
+    m_reader = new MJpegStreamReader(currentUrl, m_transfer);
+    m_reader->setFrameSizeHint(largestFrameSizeHint());
+    connect(m_reader, SIGNAL(buffering()), SLOT(readerBuffering()), Qt::QueuedConnection);
+    connect(m_reader, SIGNAL(error(QString)), SLOT(readerError(QString)), Qt::QueuedConnection);
+    connect(m_reader->decoder(), SIGNAL(frameDecoded()), SLOT(frameDecoded()), Qt::QueuedConnection);
 
-    m_activityTimer.start(30000);
+    MJpegStreamNetwork::instance()->addReader(m_reader);
 }
 
 void MJpegStream::stop()
 {
-    if (m_httpReply)
+    if (m_reader)
     {
-        m_httpReply->disconnect(this);
-        m_httpReply->abort();
-        m_httpReply->deleteLater();
-        m_httpReply = 0;
+        /* Signals already on their way are ignored by the slots */
+        m_reader->disconnect(this);
+        m_reader->decoder()->disconnect(this);
+        QMetaObject::invokeMethod(m_reader, "stop", Qt::QueuedConnection);
+        m_reader = 0;
     }
 
-    if (m_nam)
-    {
-        m_nam->deleteLater();
-        m_nam = 0;
-    }
-
-    m_httpBuffer.clear();
-    m_httpBoundary.clear();
-
     if (state() > NotConnected)
     {
         if (state() != Paused)
@@ -161,11 +153,6 @@ void MJpegStream::stop()
 
         m_autoStart = false;
     }
-
-    m_activityTimer.stop();
-    m_fpsRecvTs = 0;
-    m_fpsRecvNo = 0;
-    m_receivedFps = 0;
 }
 
 void MJpegStream::setOnline(bool online)
@@ -193,6 +180,59 @@ QUrl MJpegStream::url() const
     return streamUrl;
 }
 
+void MJpegStream::setFrameSizeHint(QObject *consumer, int width, int height)
+{
+    QHash<QObject *, QSize>::iterator it = m_frameSizeHints.find(consumer);
+    if (it == m_frameSizeHints.end())
+        return;
+
+    *it = QSize(width, height);
+    if (m_reader)
+        m_reader->setFrameSizeHint(largestFrameSizeHint());
+}
+
+void MJpegStream::ref(QObject *consumer)
+{
+    /* No hint yet means the consumer gets the native size */
+    m_frameSizeHints.insert(consumer, QSize());
+    if (m_reader)
+        m_reader->setFrameSizeHint(largestFrameSizeHint());
+}
+
+void MJpegStream::unref(QObject *consumer)
+{
+    m_frameSizeHints.remove(consumer);
+    if (m_reader)
+        m_reader->setFrameSizeHint(largestFrameSizeHint());
+}
+
+/* Pictures are decoded at the smallest scale that covers this */
+QSize MJpegStream::largestFrameSizeHint() const
+{
+    QSize largest(0, 0);
+    foreach (const QSize &sizeHint, m_frameSizeHints)
+    {
+        if (!sizeHint.isValid())
+            return QSize();
+        largest = largest.expandedTo(sizeHint);
+    }
+
+    return largest.isEmpty() ? QSize() : largest;
+}
+
+float MJpegStream::receivedFps() const
+{
+    return m_reader ? m_reader->receivedFps() : 0;
+}
+
+quint64 MJpegStream::receivedRate() const
+{
+    if (state() < Connecting || !m_transfer)
+        return 0;
+
+    return bcApp->globalRate->counterRate(m_transfer.data());
+}
+
 void MJpegStream::setBandwidthMode(int value)
 {
     if (value == m_bandwidthMode)
@@ -200,9 +240,9 @@ void MJpegStream::setBandwidthMode(int value)
 
     m_bandwidthMode = (LiveViewManager::BandwidthMode)value;
     //TODO:
-    m_interval = m_bandwidthMode == LiveViewManager::FullBandwidth
-            ? 1
-            : 8;
+    m_interval = m_bandwidthMode == LiveViewManager::LowBandwidth
+            ? 8
+            : 1;
 
     emit bandwidthModeChanged(value);
 
@@ -238,265 +278,38 @@ void MJpegStream::setPaused(bool pause)
     emit pausedChanged(pause);
 }
 
-bool MJpegStream::processHeaders()
-{
-    Q_ASSERT(m_httpReply);
-
-    QByteArray data = m_httpReply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
-    QByteArray dataL = data.toLower();
-
-    /* Get the MIME type */
-    QByteArray mimeType;
-
-    int sep = dataL.indexOf(';');
-    if (sep > 0)
-        mimeType = dataL.left(sep).trimmed();
-
-    m_httpBoundary.clear();
-    sep = dataL.indexOf("boundary=", sep);
-    if (sep > 0)
-        m_httpBoundary = data.mid(sep+9);
-
-    if (mimeType != "multipart/x-mixed-replace" || m_httpBoundary.isEmpty())
-    {
-        setError(QLatin1String("Invalid content type"));
-        return false;
-    }
-
-//    if (m_httpBoundary.startsWith("--"))
-//    {
-//        /* Hack to work around broken MJPEG feeds, particularly some Axis devices,
-//         * which incorrectly include '--' in their boundary header (which would mean
-//         * that the actual boundary is ----xxx). We'll silently discard any extra data
-//         * before a boundary, so we can remove the extra --'s and it will work fine whether
-//         * they're properly included or not. */
-//        m_httpBoundary.remove(0, 2);
-//    }
-
-//    m_httpBoundary.prepend("\n--");
-    return true;
-}
-
-void MJpegStream::readable()
+void MJpegStream::readerBuffering()
 {
-    if (!m_httpReply)
+    if (sender() != m_reader)
         return;
 
-    m_lastActivity = QDateTime::currentDateTime().toTime_t();
-
-    if (m_httpBoundary.isNull())
-    {
-        if (!processHeaders())
-            return;
-        Q_ASSERT(!m_httpBoundary.isNull());
-
-        m_parserState = ParserBoundary;
-        setState(Buffering);
-    }
-
-    /* Don't allow the buffer to exceed 2MB */
-    static const int maxBuffer = 2*1024*1024;
-
-    for (;;)
-    {
-        qint64 avail = m_httpReply->bytesAvailable();
-        if (avail < 1)
-            break;
-
-        if (m_httpBuffer.size() >= maxBuffer)
-        {
-            setError(QLatin1String("Exceeded maximum buffer size"));
-            return;
-        }
-
-        int maxRead = qMin((int)avail, maxBuffer - m_httpBuffer.size());
-        int readPos = m_httpBuffer.size();
-        m_httpBuffer.resize(m_httpBuffer.size()+maxRead);
-
-        int rd = m_httpReply->read(m_httpBuffer.data()+readPos, maxRead);
-        if (rd < 0)
-        {
-            setError(QLatin1String("Read error"));
-            return;
-        }
-
-        if (rd < maxRead)
-            m_httpBuffer.truncate(readPos+rd);
-
-        if (!parseBuffer() || !m_httpReply)
-            return;
-    }
+    setState(Buffering);
 }
 
-bool MJpegStream::parseBuffer()
+void MJpegStream::readerError(const QString &message)
 {
-    if (m_parserState == ParserBoundary)
-    {
-        /* Search for the boundary */
-        int boundary = m_httpBuffer.indexOf(m_httpBoundary);
-        if (boundary < 0)
-        {
-            /* Everything up to the last m_httpBoundary-2 bytes may be safely discarded */
-            m_httpBuffer.remove(0, m_httpBuffer.size() - (m_httpBoundary.size()-2));
-            return true;
-        }
-
-        int boundaryStart = boundary;
-        if (boundaryStart && m_httpBuffer[boundaryStart-1] == '\r')
-            --boundaryStart;
-
-        boundary += m_httpBoundary.size();
-        int sz = m_httpBuffer.size() - boundary;
-
-        if (sz >= 2 && m_httpBuffer[boundary] == '-' && m_httpBuffer[boundary+1] == '-')
-        {
-            boundary += 2;
-            sz -= 2;
-        }
-
-        if (sz && m_httpBuffer[boundary] == '\n')
-        {
-            boundary++;
-        }
-        else if (sz >= 2 && m_httpBuffer[boundary] == '\r' && m_httpBuffer[boundary+1] == '\n')
-        {
-            boundary += 2;
-        }
-        else if (sz < 2)
-        {
-            /* Not enough to finish the boundary; remove everything up to the start and wait */
-            m_httpBuffer.remove(0, boundaryStart);
-            return true;
-        }
-        else
-        {
-            /* Invalid characters mean this isn't a boundary. Remove it. */
-            m_httpBuffer.remove(0, boundaryStart + m_httpBoundary.size());
-            return true;
-        }
-
-        /* Reached the end of the boundary; headers follow */
-        m_httpBuffer.remove(0, boundary);
-        m_parserState = ParserHeaders;
-        m_httpBodyLength = 0;
-    }
-
-    if (m_parserState == ParserHeaders)
-    {
-        int lnStart = 0, lnEnd = 0;
-        for (; (lnEnd = m_httpBuffer.indexOf('\n', lnStart)) >= 0; lnStart = lnEnd+1)
-        {
-            if (lnStart == lnEnd || ((lnEnd-lnStart) == 1 && m_httpBuffer[lnStart] == '\r'))
-            {
-                m_parserState = ParserBody;
-                /* Skip the final \n */
-                lnStart = lnEnd+1;
-
-                break;
-            }
-
-            /* We only care about Content-Length */
-            if ((lnEnd - lnStart) > 15 && qstrnicmp(m_httpBuffer.data()+lnStart, "Content-Length:", 15) == 0)
-            {
-                bool ok = false;
-                m_httpBodyLength = m_httpBuffer.mid(lnStart+15, lnEnd-lnStart-15).trimmed().toUInt(&ok);
-                if (!ok)
-                    m_httpBodyLength = 0;
-            }
-        }
-
-        /* All processed headers can be removed */
-        m_httpBuffer.remove(0, lnStart);
-    }
-
-    if (m_parserState == ParserBody)
-    {
-        if (m_httpBodyLength)
-        {
-            /* The easy route; Content-Length tells us where the body ends */
-            if (m_httpBuffer.size() < m_httpBodyLength)
-            {
-                /* Not enough data yet. */
-                return true;
-            }
-        }
-        else
-        {
-            /* Scan for the boundary */
-            int boundary = m_httpBuffer.indexOf(m_httpBoundary);
-            if (boundary < 0)
-                return true;
-
-            m_httpBodyLength = boundary;
-        }
-
-        /* End of the body; m_httpBodyLength is its length, at the beginning of m_httpBuffer */
-        /* Create a QByteArray for just the body, without copying */
-        decodeFrame(QByteArray(m_httpBuffer.data(), m_httpBodyLength));
-
-        m_httpBuffer.remove(0, m_httpBodyLength);
-        m_parserState = ParserBoundary;
-
-        /* Parse again; recursion isn't a problem because this should be a very rare case */
-        if (!m_httpBuffer.isEmpty())
-            parseBuffer();
-    }
-
-    return true;
-}
-
-void MJpegStream::checkActivity()
-{
-    if (QDateTime::currentDateTime().toTime_t() - m_lastActivity > 30)
-        setError(QLatin1String("Stream timeout"));
-}
-
-void MJpegStream::requestError()
-{
-    if (m_httpReply->error() == QNetworkReply::NoError)
-        setError(QLatin1String("Connection lost"));
-    else
-        setError(QString::fromLatin1("HTTP error: %1").arg(m_httpReply->errorString()));
-}
-
-void MJpegStream::decodeFrame(const QByteArray &data)
-{
-    /* This will cancel the task if it hasn't started yet; in-progress or completed tasks will still
-     * deliver a result */
-    if (m_decodeTask)
-        m_decodeTask->cancel();
-
-    m_decodeTask = new ImageDecodeTask(this, "decodeFrameResult", ++m_latestFrameNo);
-    m_decodeTask->setData(data);
-
-    QThreadPool::globalInstance()->start(m_decodeTask);
-
-    quint64 now = QDateTime::currentMSecsSinceEpoch();
-    if (now - m_fpsRecvTs >= 1500)
-    {
-        if (m_fpsRecvTs)
-            m_receivedFps = float((m_latestFrameNo - m_fpsRecvNo) * 1000 / double(now - m_fpsRecvTs));
+    if (sender() != m_reader)
+        return;
 
-        m_fpsRecvTs = now;
-        m_fpsRecvNo = m_latestFrameNo;
-    }
+    setError(message);
 }
 
-void MJpegStream::decodeFrameResult(ThreadTask *task)
+void MJpegStream::frameDecoded()
 {
-    ImageDecodeTask *decodeTask = static_cast<ImageDecodeTask*>(task);
-    if (m_decodeTask == decodeTask)
-        m_decodeTask = 0;
+    if (!m_reader || sender() != m_reader->decoder())
+        return;
 
-    if (decodeTask->result().isNull() || decodeTask->imageId <= m_currentFrameNo)
+    MJpegStreamDecoder::Frame frame;
+    if (!m_reader->decoder()->takeFrame(&frame) || frame.id <= m_currentFrameNo)
         return;
 
-    bool sizeChanged = decodeTask->result().size() != m_currentFrame.size();
-    m_currentFrame = decodeTask->result();
-    m_currentFrameNo = decodeTask->imageId;
+    bool sizeChanged = frame.pictureSize != m_streamSize;
+    m_currentFrame = frame.image;
+    m_currentFrameNo = frame.id;
+    m_streamSize = frame.pictureSize;
 
     if (sizeChanged)
-        emit streamSizeChanged(m_currentFrame.size());
+        emit streamSizeChanged(m_streamSize);
     emit updated();
 
     if (m_state == Buffering)
@@ -18,18 +18,18 @@
 #ifndef MJPEGSTREAM_H
 #define MJPEGSTREAM_H
 
+#include <QHash>
 #include <QObject>
 #include <QUrl>
 #include <QPixmap>
+#include <QSharedPointer>
 #include <QTimer>
 #include "camera/DVRCamera.h"
 #include "core/LiveViewManager.h"
 #include "core/LiveStream.h"
+#include "core/TransferRateCalculator.h"
 
-class QNetworkAccessManager;
-class QNetworkReply;
-class ThreadTask;
-class ImageDecodeTask;
+class MJpegStreamReader;
 
 class MJpegStream : public LiveStream
 {
@@ -49,18 +49,20 @@ public:
     QString errorMessage() const { return m_errorMessage; }
 
     QImage currentFrame() const { return m_currentFrame; }
-    QSize streamSize() const { return m_currentFrame.size(); }
+    QSize streamSize() const { return m_streamSize; }
 
-    float receivedFps() const { return m_receivedFps; }
+    float receivedFps() const;
+    quint64 receivedRate() const;
 
     bool isPaused() const { return m_paused; }
     bool isConnected() const { return state() > Connecting; }
 
     bool hasAudio() const { return false; }
     bool isAudioEnabled() const { return false; }
-    void setFrameSizeHint(int width, int height) { return; }
-    void ref() {}
-    void unref() {}
+    void setFrameSizeHint(QObject *consumer, int width, int height);
+    void ref(QObject *consumer);
+    void unref(QObject *consumer);
+    QSize largestFrameSizeHint() const;
 
 public slots:
     void start();
@@ -74,45 +76,30 @@ public slots:
     void enableHWAccel(bool hwAccel) {}
 
 private slots:
-    void readable();
-    void requestError();
-    void checkActivity();
+    void readerBuffering();
+    void readerError(const QString &message);
+    void frameDecoded();
 
 private:
     QWeakPointer<DVRCamera> m_camera;
 
     QString m_errorMessage;
-    QNetworkReply *m_httpReply;
-    QByteArray m_httpBoundary;
-    QByteArray m_httpBuffer;
+    /* The current connection, on a network thread */
+    MJpegStreamReader *m_reader;
+    QSharedPointer<TransferRateCalculator::Counter> m_transfer;
     QImage m_currentFrame;
-    quint64 m_currentFrameNo, m_latestFrameNo;
-    quint64 m_fpsRecvTs, m_fpsRecvNo;
-    ImageDecodeTask *m_decodeTask;
-    QTimer m_activityTimer;
-    uint m_lastActivity;
-    float m_receivedFps;
+    /* Of the pictures received, which m_currentFrame may be scaled down from */
+    QSize m_streamSize;
+    QHash<QObject *, QSize> m_frameSizeHints;
+    quint64 m_currentFrameNo;
 
-    QNetworkAccessManager *m_nam;
-
-    int m_httpBodyLength;
     State m_state;
-    enum {
-        ParserBoundary,
-        ParserHeaders,
-        ParserBody
-    } m_parserState;
     bool m_autoStart, m_paused;
     qint8 m_interval;
     LiveViewManager::BandwidthMode m_bandwidthMode;
 
     void setState(State newState);
     void setError(const QString &message);
-
-    bool processHeaders();
-    bool parseBuffer();
-    void decodeFrame(const QByteArray &data);
-    Q_INVOKABLE void decodeFrameResult(ThreadTask *task);
 };
 
 #endif // MJPEGSTREAM_H
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MJpegStreamDecoder.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QImageReader>
+
+/* main.cpp */
+extern const char *jpegFormatName;
+
+/* Whatever JpegDecoder can't handle may still be readable at full size */
+static QImage readImage(const QByteArray &data)
+{
+    QByteArray copy(data);
+    QBuffer buffer(&copy);
+    if (!buffer.open(QIODevice::ReadOnly))
+        return QImage();
+
+    QImageReader reader(&buffer, jpegFormatName);
+    QImage result;
+    if (!reader.read(&result) && result.isNull())
+        qDebug() << "Image decoding error:" << reader.errorString();
+
+    return result;
+}
+
+DecodePool * MJpegStreamDecoder::pool()
+{
+    static DecodePool *instance = new DecodePool;
+    return instance;
+}
+
+MJpegStreamDecoder::MJpegStreamDecoder(DecodePool *pool, QObject *parent)
+    : QObject(parent), m_pool(pool ? pool : MJpegStreamDecoder::pool()), m_pictures(1), m_frames(1),
+      m_frameNotified(0), m_droppedPictures(0)
+{
+}
+
+MJpegStreamDecoder::~MJpegStreamDecoder()
+{
+    m_pool->cancel(this);
+
+    delete m_pictures.pop();
+    delete m_frames.pop();
+}
+
+bool MJpegStreamDecoder::queuePicture(quint64 id, const MJpegPart &part, const QSize &sizeHint)
+{
+    Picture *picture = new Picture;
+    picture->id = id;
+    picture->part = part;
+    picture->sizeHint = sizeHint;
+
+    Picture *dropped = m_pictures.pushOverwrite(picture);
+    delete dropped;
+    if (dropped)
+        m_droppedPictures.fetchAndAddRelaxed(1);
+
+    m_pool->schedule(this);
+    return !dropped;
+}
+
+bool MJpegStreamDecoder::takeFrame(Frame *frame)
+{
+    /* Cleared first, so that a frame pushed from here on is announced again */
+    m_frameNotified.storeRelease(0);
+
+    Frame *newest = 0;
+    while (Frame *next = m_frames.pop())
+    {
+        delete newest;
+        newest = next;
+    }
+
+    if (!newest)
+        return false;
+
+    *frame = *newest;
+    delete newest;
+    return true;
+}
+
+bool MJpegStreamDecoder::runDecodeTask()
+{
+    Picture *picture = m_pictures.pop();
+    if (!picture)
+        return false;
+
+    QByteArray data = picture->part.data();
+
+    Frame *frame = new Frame;
+    frame->id = picture->id;
+    frame->image = m_decoder.decode(data.constData(), data.size(), picture->sizeHint);
+    if (frame->image.isNull())
+        frame->image = readImage(data);
+    frame->pictureSize = JpegDecoder::pictureSize(data.constData(), data.size());
+    if (!frame->pictureSize.isValid())
+        frame->pictureSize = frame->image.size();
+
+    delete picture;
+
+    if (frame->image.isNull())
+        delete frame;
+    else
+    {
+        /* Only the newest frame is of any use */
+        delete m_frames.pushOverwrite(frame);
+        if (!m_frameNotified.fetchAndStoreOrdered(1))
+            emit frameDecoded();
+    }
+
+    return !m_pictures.isEmpty();
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MJPEG_STREAM_DECODER_H
+#define MJPEG_STREAM_DECODER_H
+
+#include "core/DecodePool.h"
+#include "core/MJpegMultipartParser.h"
+#include "utils/JpegDecoder.h"
+#include "utils/SpscRing.h"
+#include <QAtomicInt>
+#include <QImage>
+#include <QObject>
+#include <QSize>
+
+/* Decodes the pictures of one MJPEG stream on a decode pool that only MJPEG
+ * streams use, apart from the global thread pool and from RTSP decoding.
+ *
+ * A stream has at most one picture being decoded and one waiting. A picture
+ * that arrives while another is still waiting takes its place, so a stream that
+ * falls behind skips to its newest picture instead of queueing up, and the one
+ * being decoded is never thrown away. Decoded frames come back through a
+ * lock-free ring; frameDecoded() is emitted once for however many frames were
+ * decoded until the next takeFrame(). */
+class MJpegStreamDecoder : public QObject, public DecodeTask
+{
+    Q_OBJECT
+
+public:
+    struct Frame
+    {
+        quint64 id;
+        QImage image;
+        /* Of the picture, which image may be scaled down from */
+        QSize pictureSize;
+    };
+
+    static DecodePool * pool();
+
+    explicit MJpegStreamDecoder(DecodePool *pool = 0, QObject *parent = 0);
+    /* Waits for a picture being decoded */
+    virtual ~MJpegStreamDecoder();
+
+    /* The thread owning the decoder, the reader's network thread; returns false
+     * if a waiting picture was dropped to make room */
+    bool queuePicture(quint64 id, const MJpegPart &part, const QSize &sizeHint);
+    /* The consumer side of the frame ring, so only ever called from one thread,
+     * the GUI thread; the newest frame decoded since last time */
+    bool takeFrame(Frame *frame);
+
+    int droppedPictures() const { return m_droppedPictures.load(); }
+
+signals:
+    void frameDecoded();
+
+protected:
+    virtual bool runDecodeTask();
+
+private:
+    struct Picture
+    {
+        quint64 id;
+        MJpegPart part;
+        QSize sizeHint;
+    };
+
+    DecodePool *m_pool;
+    SpscRing<Picture> m_pictures;
+    SpscRing<Frame> m_frames;
+    QAtomicInt m_frameNotified;
+    QAtomicInt m_droppedPictures;
+    JpegDecoder m_decoder;
+};
+
+#endif // MJPEG_STREAM_DECODER_H
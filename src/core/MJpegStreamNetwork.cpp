@@ -0,0 +1,123 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MJpegStreamNetwork.h"
+#include "MJpegStreamReader.h"
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QThread>
+#include <QUrl>
+
+MJpegStreamNetwork * MJpegStreamNetwork::instance()
+{
+    /* Reading and parsing is little work next to decoding, so a few threads
+     * cover any number of streams */
+    static MJpegStreamNetwork *instance = new MJpegStreamNetwork(qBound(1, QThread::idealThreadCount() / 4, 4));
+    return instance;
+}
+
+MJpegStreamNetwork::MJpegStreamNetwork(int threadCount)
+    : m_nextThread(0)
+{
+    for (int i = 0; i < threadCount; ++i)
+    {
+        QThread *thread = new QThread;
+        thread->setObjectName(QString::fromLatin1("MJPEG network %1").arg(i));
+        thread->start();
+        m_threads.append(thread);
+    }
+}
+
+MJpegStreamNetwork::~MJpegStreamNetwork()
+{
+    foreach (QThread *thread, m_threads)
+    {
+        thread->quit();
+        thread->wait();
+    }
+
+    /* Their threads are gone, so nothing else can be using them */
+    qDeleteAll(m_managerReaders.keys());
+    qDeleteAll(m_threads);
+}
+
+QString MJpegStreamNetwork::serverKey(const QUrl &url)
+{
+    return url.scheme().toLower() + QLatin1String("://") + url.host().toLower()
+            + QLatin1Char(':') + QString::number(url.port());
+}
+
+void MJpegStreamNetwork::addReader(MJpegStreamReader *reader)
+{
+    reader->m_network = this;
+
+    if (!m_threads.isEmpty())
+    {
+        QString key = serverKey(reader->url());
+
+        QMutexLocker locker(&m_mutex);
+        QThread *&thread = m_serverThreads[key];
+        if (!thread)
+        {
+            thread = m_threads.at(m_nextThread);
+            m_nextThread = (m_nextThread + 1) % m_threads.size();
+        }
+
+        reader->moveToThread(thread);
+    }
+
+    QMetaObject::invokeMethod(reader, "start", Qt::QueuedConnection);
+}
+
+QNetworkAccessManager * MJpegStreamNetwork::acquireNetworkManager(const QUrl &url)
+{
+    /* QNetworkAccessManager's connections per host, which can't be changed */
+    static const int readersPerManager = 6;
+
+    QString key = serverKey(url);
+
+    QMutexLocker locker(&m_mutex);
+    QList<QNetworkAccessManager *> &managers = m_managers[key];
+    foreach (QNetworkAccessManager *manager, managers)
+    {
+        int &readers = m_managerReaders[manager];
+        if (readers < readersPerManager)
+        {
+            ++readers;
+            return manager;
+        }
+    }
+
+    /* Created on the server's thread, which it then belongs to */
+    Q_ASSERT(m_threads.isEmpty() || QThread::currentThread() == m_serverThreads.value(key));
+    QNetworkAccessManager *manager = new QNetworkAccessManager;
+    managers.append(manager);
+    m_managerReaders.insert(manager, 1);
+    return manager;
+}
+
+void MJpegStreamNetwork::releaseNetworkManager(QNetworkAccessManager *manager)
+{
+    /* Managers are kept for the next streams; connections they keep alive are
+     * closed by the manager after a while */
+    QMutexLocker locker(&m_mutex);
+    QHash<QNetworkAccessManager *, int>::iterator it = m_managerReaders.find(manager);
+    Q_ASSERT(it != m_managerReaders.end() && *it > 0);
+    if (it != m_managerReaders.end())
+        --*it;
+}
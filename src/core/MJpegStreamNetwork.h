@@ -0,0 +1,75 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MJPEG_STREAM_NETWORK_H
+#define MJPEG_STREAM_NETWORK_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+class MJpegStreamReader;
+class QNetworkAccessManager;
+class QThread;
+class QUrl;
+
+/* Threads that MJPEG streams do their network I/O and multipart parsing on,
+ * away from the GUI thread, which only sees decoded frames.
+ *
+ * Each server is given one of the threads, and its streams share network
+ * managers on that thread. A manager opens no more than six connections to a
+ * host and queues further requests, which for streams that never finish means
+ * forever, so every six streams of a server take another manager. A network
+ * without threads of its own
+ * runs readers on the thread that adds them, as streams used to; that is only
+ * useful for comparisons. */
+class MJpegStreamNetwork
+{
+    Q_DISABLE_COPY(MJpegStreamNetwork)
+
+public:
+    static MJpegStreamNetwork * instance();
+
+    explicit MJpegStreamNetwork(int threadCount);
+    ~MJpegStreamNetwork();
+
+    int threadCount() const { return m_threads.size(); }
+
+    /* Moves the reader to its server's thread and starts it there. The reader is
+     * stopped with MJpegStreamReader::stop(), which also deletes it. */
+    void addReader(MJpegStreamReader *reader);
+
+    /* A manager of the url's server with a connection to spare; only from that
+     * server's thread. Each is given back with releaseNetworkManager(). */
+    QNetworkAccessManager * acquireNetworkManager(const QUrl &url);
+    void releaseNetworkManager(QNetworkAccessManager *manager);
+
+private:
+    QVector<QThread *> m_threads;
+
+    QMutex m_mutex;
+    QHash<QString, QThread *> m_serverThreads;
+    QHash<QString, QList<QNetworkAccessManager *> > m_managers;
+    QHash<QNetworkAccessManager *, int> m_managerReaders;
+    int m_nextThread;
+
+    static QString serverKey(const QUrl &url);
+};
+
+#endif // MJPEG_STREAM_NETWORK_H
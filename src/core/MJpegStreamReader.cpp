@@ -0,0 +1,193 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MJpegStreamReader.h"
+#include "MJpegStreamDecoder.h"
+#include "MJpegStreamNetwork.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+MJpegStreamReader::MJpegStreamReader(const QUrl &url, const QSharedPointer<TransferRateCalculator::Counter> &transfer)
+    : m_url(url), m_network(0), m_nam(0), m_httpReply(0), m_transfer(transfer), m_decoder(new MJpegStreamDecoder(0, this)),
+      m_latestFrameNo(0), m_fpsRecvTs(0), m_fpsRecvNo(0), m_receivedFps(0), m_activityTimer(this),
+      m_lastActivity(0), m_failed(false)
+{
+    connect(&m_activityTimer, SIGNAL(timeout()), SLOT(checkActivity()));
+}
+
+MJpegStreamReader::~MJpegStreamReader()
+{
+    if (m_httpReply)
+    {
+        m_httpReply->disconnect(this);
+        m_httpReply->abort();
+        m_httpReply->deleteLater();
+    }
+
+    if (m_nam)
+        m_network->releaseNetworkManager(m_nam);
+}
+
+void MJpegStreamReader::setFrameSizeHint(const QSize &sizeHint)
+{
+    QMutexLocker locker(&m_sizeHintMutex);
+    m_sizeHint = sizeHint;
+}
+
+void MJpegStreamReader::start()
+{
+    Q_ASSERT(m_network);
+    Q_ASSERT(!m_httpReply);
+
+    m_nam = m_network->acquireNetworkManager(m_url);
+
+    /* Errors are ignored outright, as they always were for streams; certificates
+     * are confirmed when logging in to the server */
+    m_httpReply = m_nam->get(QNetworkRequest(m_url));
+    m_httpReply->ignoreSslErrors();
+    connect(m_httpReply, SIGNAL(error(QNetworkReply::NetworkError)), SLOT(requestError()));
+    connect(m_httpReply, SIGNAL(finished()), SLOT(requestError()));
+    connect(m_httpReply, SIGNAL(readyRead()), SLOT(readable()));
+
+    m_lastActivity = QDateTime::currentDateTime().toTime_t();
+    m_activityTimer.start(30000);
+}
+
+void MJpegStreamReader::stop()
+{
+    deleteLater();
+}
+
+void MJpegStreamReader::setError(const QString &message)
+{
+    if (m_failed)
+        return;
+
+    m_failed = true;
+    m_activityTimer.stop();
+    if (m_httpReply)
+    {
+        m_httpReply->disconnect(this);
+        m_httpReply->abort();
+    }
+
+    emit error(message);
+}
+
+bool MJpegStreamReader::processHeaders()
+{
+    Q_ASSERT(m_httpReply);
+
+    QByteArray contentType = m_httpReply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+    QByteArray boundary = MJpegMultipartParser::boundaryFromContentType(contentType);
+    if (boundary.isEmpty())
+    {
+        setError(QLatin1String("Invalid content type"));
+        return false;
+    }
+
+    m_parser.setBoundary(boundary);
+    return true;
+}
+
+void MJpegStreamReader::readable()
+{
+    if (!m_httpReply || m_failed)
+        return;
+
+    m_lastActivity = QDateTime::currentDateTime().toTime_t();
+
+    if (!m_parser.hasBoundary())
+    {
+        if (!processHeaders())
+            return;
+
+        emit buffering();
+    }
+
+    for (;;)
+    {
+        qint64 avail = m_httpReply->bytesAvailable();
+        if (avail < 1)
+            break;
+
+        /* The parser doesn't allow the buffer to exceed 2MB */
+        int maxRead = qMin(avail, qint64(m_parser.maximumBufferSize() - m_parser.bufferedSize()));
+        char *data = m_parser.reserve(maxRead);
+        if (!data)
+        {
+            setError(m_parser.errorMessage());
+            return;
+        }
+
+        /* Read straight into the parser's buffer */
+        int rd = m_httpReply->read(data, maxRead);
+        if (rd < 0)
+        {
+            setError(QLatin1String("Read error"));
+            return;
+        }
+
+        m_parser.commit(rd);
+        m_transfer->add(rd);
+
+        MJpegPart part;
+        while (m_parser.takePart(&part))
+            decodeFrame(part);
+    }
+}
+
+void MJpegStreamReader::checkActivity()
+{
+    if (QDateTime::currentDateTime().toTime_t() - m_lastActivity > 30)
+        setError(QLatin1String("Stream timeout"));
+}
+
+void MJpegStreamReader::requestError()
+{
+    if (m_httpReply->error() == QNetworkReply::NoError)
+        setError(QLatin1String("Connection lost"));
+    else
+        setError(QString::fromLatin1("HTTP error: %1").arg(m_httpReply->errorString()));
+}
+
+void MJpegStreamReader::decodeFrame(const MJpegPart &part)
+{
+    QSize sizeHint;
+    {
+        QMutexLocker locker(&m_sizeHintMutex);
+        sizeHint = m_sizeHint;
+    }
+
+    /* A picture still waiting to be decoded is dropped for this one; the one being
+     * decoded is left to finish */
+    m_decoder->queuePicture(++m_latestFrameNo, part, sizeHint);
+
+    quint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - m_fpsRecvTs >= 1500)
+    {
+        if (m_fpsRecvTs)
+            m_receivedFps.store(int((m_latestFrameNo - m_fpsRecvNo) * 100000 / double(now - m_fpsRecvTs)));
+
+        m_fpsRecvTs = now;
+        m_fpsRecvNo = m_latestFrameNo;
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MJPEG_STREAM_READER_H
+#define MJPEG_STREAM_READER_H
+
+#include "core/MJpegMultipartParser.h"
+#include "core/TransferRateCalculator.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+#include <QTimer>
+#include <QUrl>
+
+class MJpegStreamDecoder;
+class MJpegStreamNetwork;
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/* One connection of an MJPEG stream, living on a thread of MJpegStreamNetwork.
+ * It reads the reply straight into its multipart parser and queues every
+ * picture on its decoder, so the stream's own thread only takes decoded frames
+ * from decoder().
+ *
+ * Apart from the constructor, decoder(), setFrameSizeHint() and receivedFps(),
+ * the reader is only used through queued calls and signals. */
+class MJpegStreamReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    MJpegStreamReader(const QUrl &url, const QSharedPointer<TransferRateCalculator::Counter> &transfer);
+    virtual ~MJpegStreamReader();
+
+    QUrl url() const { return m_url; }
+    MJpegStreamDecoder *decoder() const { return m_decoder; }
+
+    /* Any thread; the size pictures are decoded for from then on */
+    void setFrameSizeHint(const QSize &sizeHint);
+    /* Any thread */
+    float receivedFps() const { return m_receivedFps.load() / 100.0f; }
+
+public slots:
+    void start();
+    /* Aborts the connection and deletes the reader */
+    void stop();
+
+signals:
+    /* The reply is a multipart stream and pictures are on their way */
+    void buffering();
+    void error(const QString &message);
+
+private slots:
+    void readable();
+    void requestError();
+    void checkActivity();
+
+private:
+    friend class MJpegStreamNetwork;
+
+    const QUrl m_url;
+    MJpegStreamNetwork *m_network;
+    QNetworkAccessManager *m_nam;
+    QNetworkReply *m_httpReply;
+    QSharedPointer<TransferRateCalculator::Counter> m_transfer;
+    MJpegMultipartParser m_parser;
+    MJpegStreamDecoder *m_decoder;
+
+    mutable QMutex m_sizeHintMutex;
+    QSize m_sizeHint;
+
+    quint64 m_latestFrameNo;
+    quint64 m_fpsRecvTs, m_fpsRecvNo;
+    /* Hundredths of a frame per second */
+    QAtomicInt m_receivedFps;
+    QTimer m_activityTimer;
+    uint m_lastActivity;
+    bool m_failed;
+
+    void setError(const QString &message);
+    bool processHeaders();
+    void decodeFrame(const MJpegPart &part);
+};
+
+#endif // MJPEG_STREAM_READER_H
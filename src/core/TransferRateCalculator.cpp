@@ -16,39 +16,107 @@
  */
 
 #include "TransferRateCalculator.h"
+#include <QMetaObject>
+#include <QMutexLocker>
 #include <cstring>
 
 TransferRateCalculator::TransferRateCalculator(QObject *parent)
-    : QObject(parent), m_nextSample(0), m_nSample(0)
+    : QObject(parent), m_nSample(0)
 {
     memset(m_samples, 0, sizeof(m_samples));
 }
 
-void TransferRateCalculator::addSampleValue(unsigned bytes)
+QSharedPointer<TransferRateCalculator::Counter> TransferRateCalculator::createCounter(const QObject *group)
+{
+    QSharedPointer<Counter> counter(new Counter);
+
+    Source source;
+    source.counter = counter;
+    source.group = group;
+    source.lastBytes = 0;
+    source.samples.fill(0, sampleCount);
+
+    QMutexLocker locker(&m_sourcesLock);
+    m_sources.append(source);
+    locker.unlock();
+
+    /* The timer can only be started from our own thread */
+    QMetaObject::invokeMethod(this, "startSampling", Qt::AutoConnection);
+
+    return counter;
+}
+
+void TransferRateCalculator::startSampling()
 {
-    Q_ASSERT(bytes < 0x80000000);
-    m_nextSample.fetchAndAddAcquire((int)bytes);
     if (!m_timer.isActive())
         m_timer.start(interval, this);
 }
 
-unsigned TransferRateCalculator::currentRate()
+quint64 TransferRateCalculator::rate(const quint64 *samples)
 {
-    unsigned r = 0;
+    quint64 r = 0;
     for (int i = 0; i < sampleCount; ++i)
-        r += m_samples[i];
-    return r/sampleCount;
+        r += samples[i];
+    return r * 1000 / (sampleCount * interval);
+}
+
+quint64 TransferRateCalculator::currentRate() const
+{
+    return rate(m_samples);
+}
+
+quint64 TransferRateCalculator::groupRate(const QObject *group) const
+{
+    QMutexLocker locker(&m_sourcesLock);
+    quint64 r = 0;
+    foreach (const Source &source, m_sources)
+    {
+        if (source.group == group)
+            r += rate(source.samples.constData());
+    }
+    return r;
+}
+
+quint64 TransferRateCalculator::counterRate(const Counter *counter) const
+{
+    QMutexLocker locker(&m_sourcesLock);
+    foreach (const Source &source, m_sources)
+    {
+        if (source.counter.data() == counter)
+            return rate(source.samples.constData());
+    }
+    return 0;
 }
 
 void TransferRateCalculator::timerEvent(QTimerEvent *)
 {
-    m_samples[m_nSample] = m_nextSample;
-    m_nextSample = 0;
+    quint64 total = 0;
+
+    QMutexLocker locker(&m_sourcesLock);
+    for (QList<Source>::iterator it = m_sources.begin(); it != m_sources.end(); )
+    {
+        QSharedPointer<Counter> counter = it->counter.toStrongRef();
+        if (!counter)
+        {
+            it = m_sources.erase(it);
+            continue;
+        }
+
+        quint64 bytes = counter->bytes();
+        it->samples[m_nSample] = bytes - it->lastBytes;
+        it->lastBytes = bytes;
+        total += it->samples[m_nSample];
+        ++it;
+    }
+
+    m_samples[m_nSample] = total;
     if (++m_nSample == sampleCount)
         m_nSample = 0;
 
-    unsigned r = currentRate();
-    if (!r)
+    quint64 r = currentRate();
+    if (!r && m_sources.isEmpty())
         m_timer.stop();
+    locker.unlock();
+
     emit rateUpdated(r);
 }
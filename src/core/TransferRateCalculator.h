@@ -20,27 +20,55 @@
 
 #include <QObject>
 #include <QBasicTimer>
-#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+#include <QWeakPointer>
 
+/* Transfer rates of everything the client downloads, in total and per group
+ * (such as a server) and counter (such as a stream connection).
+ *
+ * Whoever transfers data counts bytes into a Counter of its own, which is a
+ * plain atomic store; the calculator samples all counters on a timer in the GUI
+ * thread. Nothing is signalled per transfer. */
 class TransferRateCalculator : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(unsigned currentRate READ currentRate NOTIFY rateUpdated)
+    Q_PROPERTY(quint64 currentRate READ currentRate NOTIFY rateUpdated)
 
 public:
+    class Counter
+    {
+    public:
+        Counter() : m_bytes(0) { }
+
+        /* Only one thread may add to a counter; any thread may read it */
+        void add(quint64 bytes) { m_bytes.store(m_bytes.load() + bytes); }
+        quint64 bytes() const { return m_bytes.load(); }
+
+    private:
+        QAtomicInteger<quint64> m_bytes;
+    };
+
     TransferRateCalculator(QObject *parent = 0);
 
-    /* Current transfer rate in bytes per second */
-    unsigned currentRate();
+    /* The counter is sampled for as long as anyone else holds it; bytes counted
+     * after the last sample before that are not. group is only compared, never
+     * dereferenced. May be called from any thread. */
+    QSharedPointer<Counter> createCounter(const QObject *group = 0);
 
-public slots:
-    /* Record that x bytes have been added since the last sample. This
-     * function is threadsafe, if you can guarantee that the instance will
-     * not be destroyed. */
-    void addSampleValue(unsigned bytes);
+    /* Transfer rates in bytes per second */
+    quint64 currentRate() const;
+    quint64 groupRate(const QObject *group) const;
+    quint64 counterRate(const Counter *counter) const;
 
 signals:
-    void rateUpdated(unsigned currentRate);
+    void rateUpdated(quint64 currentRate);
+
+private slots:
+    void startSampling();
 
 protected:
     virtual void timerEvent(QTimerEvent *ev);
@@ -49,13 +77,22 @@ private:
     static const int interval = 750;
     static const int sampleCount = (3*(1000/interval));
 
-    QBasicTimer m_timer;
-    QAtomicInt m_nextSample;
-    unsigned m_samples[sampleCount];
-    qint8 m_nSample;
+    struct Source
+    {
+        QWeakPointer<Counter> counter;
+        const QObject *group;
+        quint64 lastBytes;
+        /* Bytes per interval */
+        QVector<quint64> samples;
+    };
 
-    void startTimer();
+    QBasicTimer m_timer;
+    mutable QMutex m_sourcesLock;
+    QList<Source> m_sources;
+    quint64 m_samples[sampleCount];
+    int m_nSample;
 
+    static quint64 rate(const quint64 *samples);
 };
 
 #endif // TRANSFERRATECALCULATOR_H
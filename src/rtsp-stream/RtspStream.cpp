@@ -16,10 +16,18 @@
  */
 
 #include "RtspStream.h"
+#include "RtspStreamDecodePolicy.h"
 #include "RtspStreamFrame.h"
+#include "RtspStreamFrameFormatter.h"
+#include "RtspStreamPacketRing.h"
+#include "RtspStreamPresentationClock.h"
+#include "RtspStreamReplayTask.h"
+#include "RtspStreamTelemetry.h"
 #include "RtspStreamThread.h"
 #include "RtspStreamWorker.h"
+#include "camera/DVRCameraData.h"
 #include "core/BluecherryApp.h"
+#include "core/DecodePool.h"
 #include "core/LiveViewManager.h"
 #include "core/LoggableUrl.h"
 #include "audio/AudioPlayer.h"
@@ -29,9 +37,11 @@
 #include <QDebug>
 #include <QSettings>
 #include <QDateTime>
+#include <QThreadPool>
 
 extern "C" {
 #   include "libavcodec/avcodec.h"
+#   include "libavfilter/avfilter.h"
 #   include "libavformat/avformat.h"
 #   include "libavutil/mathematics.h"
 }
@@ -73,21 +83,42 @@ protected:
     }
 };
 
-QTimer *RtspStream::m_renderTimer = 0;
-static const int renderTimerFps = 30;
 QTimer *RtspStream::m_stateTimer = 0;
+/* Frames due within this many microseconds are shown right away */
+static const qint64 presentationTolerance = 4000;
+static const qint64 fpsUpdateInterval = 1500;
+static const int initialReconnectDelay = 500;
+static const int maximumReconnectDelay = 16000;
+static const int defaultReplayLength = 30;
+static const int defaultReplayMemoryLimit = 256;
+
+/* Thread per stream decoding is kept around to compare against */
+static DecodePool * decodePool()
+{
+    QSettings settings;
+    if (settings.value(QLatin1String("ui/liveview/threadPerStreamDecoding"), false).toBool())
+        return 0;
+
+    return DecodePool::instance();
+}
+
+/* A frame rate cap also skips what the capped frames could have referred to */
+static int minimumDecodeLevel(LiveStream::Degradation degradation)
+{
+    if (degradation >= LiveStream::FrameRateCapped)
+        return RtspStreamDecodePolicy::MinimalDecode;
+
+    return RtspStreamDecodePolicy::FullDecode;
+}
 
 void RtspStream::init()
 {
     av_lockmgr_register(bc_av_lockmgr);
     av_register_all();
+    avfilter_register_all();
     //av_log_set_level(AV_LOG_FATAL);
     avformat_network_init();
 
-    m_renderTimer = new AutoTimer;
-    m_renderTimer->setInterval(1000 / renderTimerFps);
-    m_renderTimer->setSingleShot(false);
-
     m_stateTimer = new AutoTimer;
     m_stateTimer->setInterval(5000);
     m_stateTimer->setSingleShot(false);
@@ -95,10 +126,14 @@ void RtspStream::init()
 
 RtspStream::RtspStream(DVRCamera *camera, QObject *parent)
     : LiveStream(parent), m_camera(camera), m_thread(0), m_currentFrameMutex(QMutex::Recursive),
-      m_frame(0), m_state(NotConnected),
-      m_autoStart(false), m_bandwidthMode(LiveViewManager::FullBandwidth), m_fpsUpdateCnt(0), m_fpsUpdateHits(0),
-      m_fps(0), m_hasAudio(false), m_isAudioEnabled(false), m_isHWAccelEnabled(false),
-      m_refcount(0)
+      m_streamSize(0, 0), m_connectionSuspended(false),
+      m_degradation(NotDegraded),
+      m_state(NotConnected), m_stalled(false),
+      m_autoStart(false), m_bandwidthMode(LiveViewManager::FullBandwidth),
+      m_threadBandwidthMode(LiveViewManager::FullBandwidth), m_standbyBandwidthMode(LiveViewManager::FullBandwidth),
+      m_replayPosition(-1), m_replayFrameId(0), m_replayTaskId(0), m_replayTask(0),
+      m_reconnectBackoff(initialReconnectDelay, maximumReconnectDelay), m_pendingFrame(0), m_lateFrames(0),
+      m_timeToFirstFrame(-1), m_fpsFrames(0), m_fps(0), m_hasAudio(false), m_isAudioEnabled(false), m_isHWAccelEnabled(false)
 {
     Q_ASSERT(m_camera);
     //connect(m_camera.data(), SIGNAL(destroyed(QObject*)), this, SLOT(deleteLater()));
@@ -106,6 +141,15 @@ RtspStream::RtspStream(DVRCamera *camera, QObject *parent)
     bcApp->liveView->addStream(this);
     connect(bcApp, SIGNAL(settingsChanged()), SLOT(updateSettings()));
     connect(m_stateTimer, SIGNAL(timeout()), SLOT(checkState()));
+
+    connect(&m_visibility, SIGNAL(suspensionChanged(int)), SLOT(updateSuspension()));
+
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, SIGNAL(timeout()), SLOT(reconnect()));
+
+    m_presentationTimer.setSingleShot(true);
+    m_presentationTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_presentationTimer, SIGNAL(timeout()), SLOT(presentFrames()));
 }
 
 RtspStream::~RtspStream()
@@ -150,7 +194,8 @@ void RtspStream::enableAudio(bool enable)
     if (enable)
     {
         bcApp->audioPlayer->setAudioFormat(m_audioSampleFmt, m_audioChannels, m_audioSampleRate);
-        connect(m_thread.data(), SIGNAL(audioSamplesAvailable(void *, int, int)), bcApp->audioPlayer, SLOT(feedSamples(void *, int, int)), Qt::DirectConnection);
+        connect(m_thread.data(), SIGNAL(audioSamplesAvailable(void *, int, int)), bcApp->audioPlayer, SLOT(feedSamples(void *, int, int)),
+                Qt::ConnectionType(Qt::DirectConnection | Qt::UniqueConnection));
         bcApp->audioPlayer->play();
     }
     else
@@ -171,6 +216,8 @@ void RtspStream::setState(State newState)
 
     if (m_state != Error)
         m_errorMessage.clear();
+    if (m_state < Streaming)
+        setStalled(false);
 
     emit stateChanged(newState);
 
@@ -184,29 +231,156 @@ void RtspStream::setState(State newState)
 }
 
 QUrl RtspStream::url() const
+{
+    return streamUrl(effectiveBandwidthMode());
+}
+
+QUrl RtspStream::streamUrl(LiveViewManager::BandwidthMode mode) const
 {
     if (!m_camera)
         return QUrl();
 
     QUrl streamUrl = m_camera.data()->rtspStreamUrl();
-    if (m_bandwidthMode == LiveViewManager::LowBandwidth)
+    if (mode == LiveViewManager::LowBandwidth)
         streamUrl.setPath(streamUrl.path() + QLatin1String("/mode=keyframe"));
     return streamUrl;
 }
 
+DVRServer * RtspStream::server() const
+{
+    if (!m_camera)
+        return 0;
+
+    return m_camera.data()->data().server();
+}
+
+LiveViewManager::BandwidthMode RtspStream::effectiveBandwidthMode() const
+{
+    if (m_degradation >= KeyframesOnly)
+        return LiveViewManager::LowBandwidth;
+    if (m_bandwidthMode == LiveViewManager::AutoBandwidth)
+        return m_bandwidthPolicy.mode();
+
+    return m_bandwidthMode;
+}
+
 void RtspStream::setBandwidthMode(int value)
 {
     if (value == m_bandwidthMode)
         return;
 
+    bool wasAuto = m_bandwidthMode == LiveViewManager::AutoBandwidth;
     m_bandwidthMode = (LiveViewManager::BandwidthMode)value;
     emit bandwidthModeChanged(value);
 
-    if (state() >= Connecting)
+    if (m_bandwidthMode == LiveViewManager::AutoBandwidth && !wasAuto)
+    {
+        /* Carry on in the current mode until the policy has seen the stream */
+        m_bandwidthPolicy.reset(state() >= Connecting ? m_threadBandwidthMode : LiveViewManager::FullBandwidth);
+        updateAutoBandwidth();
+    }
+
+    updateBandwidthMode();
+}
+
+/* Switches the running stream to the current bandwidth mode. A stream that is
+ * showing video keeps showing it from the old connection until the new one has
+ * a frame ready, so the tile never goes black. */
+void RtspStream::updateBandwidthMode()
+{
+    LiveViewManager::BandwidthMode mode = effectiveBandwidthMode();
+
+    if (mode == m_threadBandwidthMode)
+    {
+        dropStandby();
+        return;
+    }
+
+    /* start() connects in the right mode anyway */
+    if (state() < Connecting)
+        return;
+
+    if (state() != Streaming || m_pauseState.isSuspended())
     {
         stop();
         start();
+        return;
     }
+
+    if (m_standbyThread && m_standbyBandwidthMode == mode)
+        return;
+
+    qDebug() << "RtspStream:" << LoggableUrl(streamUrl(mode)) << "connecting to switch bandwidth mode";
+
+    dropStandby();
+    m_standbyBandwidthMode = mode;
+    m_standbyTelemetry = QSharedPointer<RtspStreamTelemetry>(new RtspStreamTelemetry(bcApp->globalRate->createCounter(server())));
+    m_standbyReplayRing = createReplayRing();
+    m_standbyThread.reset(createThread(m_standbyTelemetry, m_standbyReplayRing));
+    connect(m_standbyThread.data(), SIGNAL(framesQueued()), this, SLOT(switchToStandby()));
+    connect(m_standbyThread.data(), SIGNAL(fatalError(QString)), this, SLOT(standbyFailed(QString)));
+    m_standbyThread->start(streamUrl(mode), m_isHWAccelEnabled, decodePool());
+
+    updateSettings();
+    updateFrameSizeHints();
+}
+
+void RtspStream::switchToStandby()
+{
+    if (!m_standbyThread)
+        return;
+
+    qDebug() << "RtspStream:" << LoggableUrl(streamUrl(m_standbyBandwidthMode)) << "switched bandwidth mode";
+
+    m_presentationTimer.stop();
+    if (m_pendingFrame)
+    {
+        m_thread->recycleFrame(m_pendingFrame);
+        m_pendingFrame = 0;
+    }
+
+    /* Only the standby connections; the ones from createThread() stay */
+    disconnect(m_standbyThread.data(), SIGNAL(framesQueued()), this, SLOT(switchToStandby()));
+    disconnect(m_standbyThread.data(), SIGNAL(fatalError(QString)), this, SLOT(standbyFailed(QString)));
+    m_thread.reset(m_standbyThread.take());
+    m_telemetry = m_standbyTelemetry;
+    m_standbyTelemetry.clear();
+    /* The recent video of the old connection goes with it */
+    leaveReplay();
+    m_replayRing = m_standbyReplayRing;
+    m_standbyReplayRing.clear();
+    m_threadBandwidthMode = m_standbyBandwidthMode;
+
+    connectThread();
+    setStalled(false);
+    if (m_isAudioEnabled)
+        enableAudio(true);
+
+    presentFrames();
+}
+
+void RtspStream::standbyFailed(const QString &message)
+{
+    qDebug() << "RtspStream:" << LoggableUrl(streamUrl(m_standbyBandwidthMode)) << "could not switch bandwidth mode:" << message;
+
+    /* Restarting reports the error, and reconnects, the usual way */
+    dropStandby();
+    stop();
+    start();
+}
+
+void RtspStream::dropStandby()
+{
+    if (!m_standbyThread)
+        return;
+
+    /* This may run from one of the thread's own signals */
+    RtspStreamThread *thread = m_standbyThread.take();
+    disconnect(thread, 0, this, 0);
+    thread->stop();
+    thread->deleteLater();
+    m_standbyTelemetry.clear();
+    m_standbyReplayRing.clear();
 }
 
 void RtspStream::enableHWAccel(bool hwAccel)
@@ -250,36 +424,95 @@ void RtspStream::start()
         return;
     }
 
-    connect(m_renderTimer, SIGNAL(timeout()), SLOT(updateFrame()), Qt::UniqueConnection);
-
+    m_reconnectTimer.stop();
+    m_pauseState.reset();
+    m_connectionSuspended = false;
     m_frameInterval.start();
+    m_fpsTimer.start();
+    m_fpsFrames = 0;
+    m_connectTimer.start();
+    m_timeToFirstFrame = -1;
 
     if (m_thread)
         m_thread->stop();
+    dropStandby();
+
+    m_presentationTimer.stop();
+    delete m_pendingFrame;
+    m_pendingFrame = 0;
 
     updateHwAccelSettings();
 
-    m_thread.reset(new RtspStreamThread());
-    connect(m_thread.data(), SIGNAL(fatalError(QString)), this, SLOT(fatalError(QString)));
-    connect(m_thread.data(), SIGNAL(hwAccelDisabled()), this, SLOT(hwAccelDisabled()));
-    connect(m_thread.data(), SIGNAL(audioFormat(enum AVSampleFormat, int, int)), this, SLOT(setAudioFormat(AVSampleFormat,int,int)), Qt::DirectConnection);
-    m_thread->start(url(), m_isHWAccelEnabled);
+    m_threadBandwidthMode = effectiveBandwidthMode();
+
+    m_telemetry = QSharedPointer<RtspStreamTelemetry>(new RtspStreamTelemetry(bcApp->globalRate->createCounter(server())));
+    m_replayRing = createReplayRing();
+    m_thread.reset(createThread(m_telemetry, m_replayRing));
+    connectThread();
+    m_thread->start(streamUrl(m_threadBandwidthMode), m_isHWAccelEnabled, decodePool());
 
     updateSettings();
+    updateFrameSizeHints();
     setState(Connecting);
 }
 
+RtspStreamThread * RtspStream::createThread(const QSharedPointer<RtspStreamTelemetry> &telemetry,
+                                            const QSharedPointer<RtspStreamPacketRing> &replayRing)
+{
+    RtspStreamThread *thread = new RtspStreamThread();
+    thread->setTelemetry(telemetry);
+    thread->setPacketRing(replayRing);
+    thread->setLowLatency(isLowLatency());
+    thread->setMinimumDecodeLevel(minimumDecodeLevel(m_degradation));
+    connect(thread, SIGNAL(hwAccelDisabled()), this, SLOT(hwAccelDisabled()));
+    connect(thread, SIGNAL(audioFormat(enum AVSampleFormat, int, int)), this, SLOT(setAudioFormat(AVSampleFormat,int,int)), Qt::DirectConnection);
+    return thread;
+}
+
+/* In seconds and megabytes; no replay at all unless enabled in the options, or
+ * with a length of 0 */
+QSharedPointer<RtspStreamPacketRing> RtspStream::createReplayRing() const
+{
+    QSettings settings;
+    if (!settings.value(QLatin1String("ui/liveview/enableReplay"), false).toBool())
+        return QSharedPointer<RtspStreamPacketRing>();
+
+    RtspStreamPacketRing::setMemoryLimit(settings.value(QLatin1String("ui/liveview/replayMemoryLimit"),
+                                                        defaultReplayMemoryLimit).toLongLong() * 1024 * 1024);
+
+    qint64 length = settings.value(QLatin1String("ui/liveview/replayLength"), defaultReplayLength).toLongLong();
+    if (length <= 0)
+        return QSharedPointer<RtspStreamPacketRing>();
+
+    return QSharedPointer<RtspStreamPacketRing>(new RtspStreamPacketRing(length * 1000000));
+}
+
+/* The signals only the thread on screen gets to deliver */
+void RtspStream::connectThread()
+{
+    connect(m_thread.data(), SIGNAL(fatalError(QString)), this, SLOT(fatalError(QString)));
+    connect(m_thread.data(), SIGNAL(framesQueued()), this, SLOT(presentFrames()));
+    connect(m_thread.data(), SIGNAL(stalled(bool)), this, SLOT(setStalled(bool)));
+}
+
 void RtspStream::stop()
 {
-    disconnect(m_renderTimer, SIGNAL(timeout()), this, SLOT(updateFrame()));
+    m_presentationTimer.stop();
+    dropStandby();
+    leaveReplay();
+    m_replayRing.clear();
 
     if (m_isAudioEnabled)
         bcApp->audioPlayer->stop();
 
     m_thread.reset();
 
-    delete m_frame;
-    m_frame = 0;
+    delete m_pendingFrame;
+    m_pendingFrame = 0;
+
+    m_currentFrameMutex.lock();
+    m_streamSize = QSize(0, 0);
+    m_currentFrameMutex.unlock();
 
     if (state() > NotConnected)
     {
@@ -309,7 +542,11 @@ void RtspStream::setPaused(bool pause)
     if (pause == (state() == Paused) || state() < Streaming || !m_thread || !m_thread->hasWorker())
         return;
 
-    m_thread->setPaused(pause);
+    if (pause)
+        dropStandby();
+    /* Unpaused while suspended, the worker resumes once the suspension is lifted */
+    if (m_pauseState.setUserPaused(pause))
+        m_thread->setPaused(pause);
 
     if (pause)
         setState(Paused);
@@ -318,85 +555,359 @@ void RtspStream::setPaused(bool pause)
     m_frameInterval.restart();
 }
 
-void RtspStream::updateFrame()
+void RtspStream::presentFrames()
 {
     if (state() < Connecting || !m_thread || !m_thread->isRunning())
         return;
 
-    if (++m_fpsUpdateCnt == int(1.5*renderTimerFps))
-    {
-        m_fps = m_fpsUpdateHits/1.5;
-        m_fpsUpdateCnt = m_fpsUpdateHits = 0;
-    }
+    /* Before looking at the queue, so that frames queued from now on wake us again */
+    m_thread->clearFramesQueued();
 
-    if (!m_thread || !m_thread->hasWorker())
-        return;
+    qint64 now = RtspStreamPresentationClock::currentTime();
 
-    RtspStreamFrame *sf = m_thread->frameToDisplay();
-    if (!sf) // no new frame
+    if (isLowLatency())
+    {
+        /* Whatever is newest goes on screen right away, even if that is jerky */
+        RtspStreamFrame *newest = m_thread->newestFrameToDisplay();
+        if (newest && m_pendingFrame)
+        {
+            m_thread->recycleFrame(m_pendingFrame);
+            m_lateFrames++;
+            m_telemetry->frameSkipped();
+        }
+        if (newest)
+            m_pendingFrame = newest;
+
+        if (m_pendingFrame)
+        {
+            m_presentationTimer.stop();
+            m_telemetry->frameShown(m_pendingFrame->queuedTime(), m_pendingFrame->presentationTime(), now);
+            showFrame(m_pendingFrame);
+            m_pendingFrame = 0;
+        }
+
+        updateFps();
         return;
+    }
 
+    for (;;)
+    {
+        if (!m_pendingFrame)
+            m_pendingFrame = m_thread->frameToDisplay();
+        if (!m_pendingFrame)
+            break;
+
+        qint64 wait = m_pendingFrame->presentationTime() - now;
+        if (wait > presentationTolerance)
+        {
+            m_presentationTimer.start(int((wait + 999) / 1000));
+            break;
+        }
+
+        RtspStreamFrame *next = m_thread->frameToDisplay();
+        if (next && next->presentationTime() - now <= presentationTolerance)
+        {
+            /* A newer frame is due already, so this one is late */
+            m_thread->recycleFrame(m_pendingFrame);
+            m_pendingFrame = next;
+            m_lateFrames++;
+            m_telemetry->frameSkipped();
+            continue;
+        }
+
+        m_telemetry->frameShown(m_pendingFrame->queuedTime(), m_pendingFrame->presentationTime(), now);
+        showFrame(m_pendingFrame);
+        m_pendingFrame = next;
+    }
 
+    updateFps();
+}
 
-    m_fpsUpdateHits++;
+void RtspStream::showFrame(RtspStreamFrame *sf)
+{
+    m_fpsFrames++;
 
     if (state() == Connecting)
+    {
+        m_timeToFirstFrame = int(m_connectTimer.elapsed());
+        m_reconnectBackoff.reset();
+        qDebug() << "RtspStream:" << LoggableUrl(url()) << "first frame after" << m_timeToFirstFrame << "ms";
         setState(Streaming);
+        /* Suspensions asked for while connecting apply from now on; not from
+         * here, as that could stop the stream in the middle of presenting */
+        QMetaObject::invokeMethod(this, "updateSuspension", Qt::QueuedConnection);
+    }
     m_frameInterval.restart();
 
-    QMutexLocker locker(&m_currentFrameMutex);
-    //bool sizeChanged = (m_currentFrame.width() != sf->avFrame()->width ||
-    //                    m_currentFrame.height() != sf->avFrame()->height);
-    bool sizeChanged = m_frame == 0 || (m_frame->width() != sf->width() || m_frame->height() != sf->height());
-
-    m_currentFrame = QImage(sf->avFrame()->data[0], sf->avFrame()->width, sf->avFrame()->height,
-                            sf->avFrame()->linesize[0], QImage::Format_RGB32).copy();
+    /* Live video keeps arriving, but the replayed picture stays on screen */
+    if (m_replayPosition >= 0)
+    {
+        m_thread->recycleFrame(sf);
+        return;
+    }
 
-    delete m_frame;
-    m_frame = sf;
+    QMutexLocker locker(&m_currentFrameMutex);
+    QSize streamSize(sf->width(), sf->height());
+    bool sizeChanged = streamSize != m_streamSize;
+
+    /* The images share the frame's buffers; the frame itself can go back to the
+     * worker right away, which will not write into those buffers again while an
+     * image (or any copy handed out by currentFrame()) is alive. */
+    m_currentFrames.resize(sf->outputCount());
+    for (int i = 0; i < sf->outputCount(); ++i)
+        m_currentFrames[i] = sf->image(i);
+    m_streamSize = streamSize;
+    m_thread->recycleFrame(sf);
 
     if (sizeChanged)
-        emit streamSizeChanged(m_currentFrame.size());
+        emit streamSizeChanged(m_streamSize);
     emit updated();
 }
 
-void RtspStream::setFrameSizeHint(int width, int height)
+void RtspStream::updateFps()
 {
-    if (m_refcount > 1)
+    qint64 elapsed = m_fpsTimer.elapsed();
+    if (elapsed < fpsUpdateInterval)
         return;
 
-    if (state() < Connecting || !m_thread || !m_thread->isRunning())
+    m_fps = m_fpsFrames * 1000.0f / elapsed;
+    m_fpsFrames = 0;
+    m_fpsTimer.restart();
+}
+
+void RtspStream::setFrameSizeHint(QObject *consumer, int width, int height)
+{
+    QSize sizeHint(width, height);
+
+    QHash<QObject *, QSize>::iterator it = m_frameSizeHints.find(consumer);
+    if (it == m_frameSizeHints.end() || *it == sizeHint)
         return;
 
-    QMutexLocker locker(&m_currentFrameMutex);
+    *it = sizeHint;
+    updateFrameSizeHints();
+}
+
+void RtspStream::ref(QObject *consumer)
+{
+    /* No hint yet means the consumer gets the native size */
+    m_frameSizeHints.insert(consumer, QSize());
+    updateFrameSizeHints();
+    m_visibility.addConsumer(consumer);
+}
+
+void RtspStream::unref(QObject *consumer)
+{
+    if (m_frameSizeHints.remove(consumer))
+        updateFrameSizeHints();
+    m_visibility.removeConsumer(consumer);
+
+    bool wasLowLatency = isLowLatency();
+    if (m_lowLatencyConsumers.remove(consumer))
+        updateLowLatency(wasLowLatency);
+}
+
+void RtspStream::setConsumerVisible(QObject *consumer, bool visible)
+{
+    m_visibility.setConsumerVisible(consumer, visible);
+}
+
+void RtspStream::setDegradation(int degradation)
+{
+    if (degradation == m_degradation)
+        return;
+
+    qDebug() << "RtspStream:" << LoggableUrl(url()) << "degradation" << m_degradation << "->" << degradation;
+    m_degradation = Degradation(degradation);
+
+    if (m_thread)
+        m_thread->setMinimumDecodeLevel(minimumDecodeLevel(m_degradation));
+    if (m_standbyThread)
+        m_standbyThread->setMinimumDecodeLevel(minimumDecodeLevel(m_degradation));
+
+    updateBandwidthMode();
+    updateSuspension();
+
+    emit degradationChanged(degradation);
+}
+
+void RtspStream::updateSuspension()
+{
+    /* Pausing for the governor works like nobody watching, but never disconnects */
+    LiveStreamVisibility::Suspension suspension = m_visibility.suspension();
+    if (suspension == LiveStreamVisibility::NotSuspended && m_degradation == DecodingPaused)
+        suspension = LiveStreamVisibility::DecodingSuspended;
+
+    switch (suspension)
+    {
+    case LiveStreamVisibility::NotSuspended:
+        if (m_connectionSuspended)
+        {
+            qDebug() << "RtspStream:" << LoggableUrl(url()) << "visible again, reconnecting";
+            m_connectionSuspended = false;
+            start();
+        }
+        else if (m_pauseState.isSuspended())
+        {
+            /* The worker skips to the next keyframe after a pause; a stream the
+             * user paused meanwhile stays paused */
+            if (m_pauseState.setSuspended(false) && m_thread && m_thread->hasWorker())
+                m_thread->setPaused(false);
+            m_frameInterval.restart();
+        }
+        break;
+
+    case LiveStreamVisibility::DecodingSuspended:
+        /* Not a pause the user would see; the state stays as it is, and a
+         * stream the user paused meanwhile is still suspended underneath */
+        if ((state() == Streaming || state() == Paused) && !m_pauseState.isSuspended()
+                && m_thread && m_thread->hasWorker())
+        {
+            qDebug() << "RtspStream:" << LoggableUrl(url())
+                     << (m_degradation == DecodingPaused ? "pausing to relieve the system" : "not visible, pausing");
+            dropStandby();
+            if (m_pauseState.setSuspended(true))
+                m_thread->setPaused(true);
+        }
+        break;
+
+    case LiveStreamVisibility::ConnectionSuspended:
+        if (state() == Error || (state() >= Connecting && state() != Paused))
+        {
+            qDebug() << "RtspStream:" << LoggableUrl(url()) << "not visible, disconnecting";
+            stop();
+            m_pauseState.reset();
+            m_connectionSuspended = true;
+        }
+        break;
+    }
+}
+
+void RtspStream::setLowLatency(QObject *consumer, bool lowLatency)
+{
+    bool wasLowLatency = isLowLatency();
+    if (lowLatency)
+        m_lowLatencyConsumers.insert(consumer);
+    else
+        m_lowLatencyConsumers.remove(consumer);
+
+    updateLowLatency(wasLowLatency);
+}
+
+void RtspStream::updateLowLatency(bool wasLowLatency)
+{
+    bool lowLatency = isLowLatency();
+    if (lowLatency == wasLowLatency)
+        return;
+
+    qDebug() << "RtspStream:" << LoggableUrl(url()) << (lowLatency ? "entering" : "leaving") << "low latency mode";
+    if (m_thread)
+        m_thread->setLowLatency(lowLatency);
+    if (m_standbyThread)
+        m_standbyThread->setLowLatency(lowLatency);
+
+    /* A frame held back for its presentation time is due now */
+    if (lowLatency)
+        presentFrames();
 
-    m_thread->setFrameSizeHint(width, height);
+    emit lowLatencyChanged(lowLatency);
 }
 
-void RtspStream::ref()
+void RtspStream::updateFrameSizeHints()
 {
-    if (m_refcount)
-        setFrameSizeHint(-1, -1);
+    if (!m_thread || !m_thread->isRunning())
+        return;
 
-    m_refcount++;
+    /* The worker converts each distinct size once, however many consumers share it */
+    QList<QSize> sizeHints;
+    foreach (const QSize &sizeHint, m_frameSizeHints)
+    {
+        if (!sizeHints.contains(sizeHint))
+            sizeHints.append(sizeHint);
+    }
+
+    m_thread->setFrameSizeHints(sizeHints);
+    if (m_standbyThread)
+        m_standbyThread->setFrameSizeHints(sizeHints);
 }
 
-void RtspStream::unref()
+/* An invalid size means some consumer draws the stream at its native size */
+QSize RtspStream::largestFrameSizeHint() const
 {
-    m_refcount--;
+    QSize largest(0, 0);
+    foreach (const QSize &sizeHint, m_frameSizeHints)
+    {
+        if (!sizeHint.isValid())
+            return QSize();
+        if (sizeHint.width() * sizeHint.height() > largest.width() * largest.height())
+            largest = sizeHint;
+    }
+
+    return largest;
 }
 
 QImage RtspStream::currentFrame() const
 {
     QMutexLocker locker(&m_currentFrameMutex);
-    return m_currentFrame.copy();
+    return largestFrame();
+}
+
+QImage RtspStream::scaledFrame(QObject *consumer) const
+{
+    QMutexLocker locker(&m_currentFrameMutex);
+
+    QSize outputSize = RtspStreamFrameFormatter::outputSize(m_frameSizeHints.value(consumer), m_streamSize);
+    foreach (const QImage &frame, m_currentFrames)
+    {
+        if (frame.size() == outputSize)
+            return frame;
+    }
+
+    /* The consumer's size was only just requested; draw what we have until it arrives */
+    return largestFrame();
+}
+
+// Calling this method should be protected by m_currentFrameMutex
+QImage RtspStream::largestFrame() const
+{
+    QImage largest;
+    foreach (const QImage &frame, m_currentFrames)
+    {
+        if (frame.width() * frame.height() > largest.width() * largest.height())
+            largest = frame;
+    }
+
+    return largest;
+}
+
+int RtspStream::frameQueueDepth() const
+{
+    return m_thread ? m_thread->frameQueueDepth() : 0;
+}
+
+int RtspStream::droppedFrames() const
+{
+    return m_thread ? m_thread->droppedFrames() : 0;
+}
+
+int RtspStream::presentationJitter() const
+{
+    return m_thread ? m_thread->presentationJitter() : 0;
+}
+
+LiveStreamTelemetry RtspStream::telemetry() const
+{
+    if (!m_telemetry)
+        return LiveStreamTelemetry();
+
+    LiveStreamTelemetry result = m_telemetry->snapshot(droppedFrames());
+    result.setTimeToFirstFrame(m_timeToFirstFrame);
+    return result;
 }
 
 QSize RtspStream::streamSize() const
 {
     QMutexLocker locker(&m_currentFrameMutex);
-    //return m_currentFrame.size();
-    return m_frame ? QSize(m_frame->width(), m_frame->height()) : QSize(0, 0);
+    return m_streamSize;
 }
 
 void RtspStream::fatalError(const QString &message)
@@ -408,22 +919,233 @@ void RtspStream::fatalError(const QString &message)
 
     m_errorMessage = message;
     setState(Error);
-    /* stateTimer will handle reconnection */
+
+    /* One failure often reports itself more than once */
+    if (m_reconnectTimer.isActive())
+        return;
+
+    int delay = m_reconnectBackoff.nextDelay();
+    qDebug() << "RtspStream:" << LoggableUrl(url()) << "reconnecting in" << delay << "ms";
+    m_reconnectTimer.start(delay);
 }
 
-void RtspStream::checkState()
+void RtspStream::setStalled(bool stalled)
 {
-    if (state() == Error)
+    if (stalled == m_stalled)
+        return;
+
+    m_stalled = stalled;
+    emit stalledChanged(stalled);
+}
+
+void RtspStream::reconnect()
+{
+    if (state() == Error && !m_connectionSuspended)
         start();
 }
 
+void RtspStream::checkState()
+{
+    if (state() >= Connecting)
+        updateFps();
+
+    if (m_bandwidthMode == LiveViewManager::AutoBandwidth)
+        updateAutoBandwidth();
+}
+
+quint64 RtspStream::receivedRate() const
+{
+    if (state() < Connecting || !m_telemetry)
+        return 0;
+
+    return bcApp->globalRate->counterRate(m_telemetry->transferCounter());
+}
+
+void RtspStream::updateAutoBandwidth()
+{
+    /* Only a stream on screen in its policy's mode says anything about that mode;
+     * switching would also end a replay */
+    if (state() != Streaming || m_pauseState.isSuspended() || m_standbyThread || m_replayPosition >= 0)
+        return;
+
+    qint64 now = RtspStreamPresentationClock::currentTime() / 1000;
+    if (m_bandwidthPolicy.update(largestFrameSizeHint(), qint64(receivedRate()) * 8, serverBitrate(), now))
+    {
+        qDebug() << "RtspStream:" << LoggableUrl(url()) << "automatic bandwidth mode chose"
+                 << (m_bandwidthPolicy.mode() == LiveViewManager::LowBandwidth ? "keyframes only" : "full video");
+        updateBandwidthMode();
+    }
+}
+
+qint64 RtspStream::expectedBitrate() const
+{
+    if (state() < Connecting || m_pauseState.isSuspended())
+        return 0;
+
+    if (m_bandwidthMode == LiveViewManager::AutoBandwidth && m_bandwidthPolicy.expectedBitrate() > 0)
+        return m_bandwidthPolicy.expectedBitrate();
+
+    return qint64(receivedRate()) * 8;
+}
+
+/* What the other streams from the same server are expected to use. Streams that
+ * just changed mode count with what the new mode is known to cost, so streams
+ * checked after them in the same round do not react to the old total. */
+qint64 RtspStream::serverBitrate() const
+{
+    DVRServer *ownServer = server();
+    qint64 bitrate = 0;
+
+    foreach (LiveStream *stream, bcApp->liveView->streams())
+    {
+        RtspStream *other = qobject_cast<RtspStream *>(stream);
+        if (other && other != this && other->server() == ownServer)
+            bitrate += other->expectedBitrate();
+    }
+
+    return bitrate;
+}
+
 void RtspStream::updateSettings()
 {
+    QSettings settings;
+    /* In kbit/s, shared by all streams from one server in automatic bandwidth mode */
+    m_bandwidthPolicy.setServerBudget(settings.value(QLatin1String("ui/liveview/serverBandwidthLimit"), 0).toLongLong() * 1000);
+
     if (!m_thread || !m_thread->hasWorker())
         return;
 
-    QSettings settings;
-    m_thread->setAutoDeinterlacing(settings.value(QLatin1String("ui/liveview/autoDeinterlace"), false).toBool());
+    bool autoDeinterlacing = settings.value(QLatin1String("ui/liveview/autoDeinterlace"), false).toBool();
+    m_thread->setAutoDeinterlacing(autoDeinterlacing);
+    if (m_standbyThread && m_standbyThread->hasWorker())
+        m_standbyThread->setAutoDeinterlacing(autoDeinterlacing);
 
     updateHwAccelSettings();
 }
+
+int RtspStream::replayLength() const
+{
+    if (!m_replayRing)
+        return 0;
+
+    return int((m_replayRing->endTime() - m_replayRing->startTime()) / 1000);
+}
+
+int RtspStream::timeshift() const
+{
+    if (m_replayPosition < 0 || !m_replayRing)
+        return 0;
+
+    return int((m_replayRing->endTime() - m_replayPosition) / 1000);
+}
+
+void RtspStream::setTimeshift(int msecs)
+{
+    if (msecs <= 0 || !m_replayRing || state() < Streaming)
+    {
+        leaveReplay();
+        return;
+    }
+
+    /* What has been dropped since can't be shown anymore */
+    m_replayPosition = qMax(m_replayRing->startTime(), m_replayRing->endTime() - qint64(msecs) * 1000);
+    requestReplayFrame();
+    emit timeshiftChanged(timeshift());
+}
+
+/* Only the newest request matters; one that hasn't started yet is cancelled */
+void RtspStream::requestReplayFrame()
+{
+    if (m_replayTask)
+        m_replayTask->cancel();
+
+    m_replayTask = new RtspStreamReplayTask(this, "replayTaskFinished", ++m_replayTaskId);
+    m_replayTask->setClip(m_replayRing->clip(m_replayPosition, m_replayPosition));
+    m_replayTask->setPosition(m_replayPosition);
+    QThreadPool::globalInstance()->start(m_replayTask);
+}
+
+void RtspStream::leaveReplay()
+{
+    if (m_replayPosition < 0)
+        return;
+
+    if (m_replayTask)
+    {
+        m_replayTask->cancel();
+        m_replayTask = 0;
+    }
+
+    /* Back to the last live picture until the next one arrives, which matters
+     * while paused */
+    m_replayPosition = -1;
+    if (!m_liveFrames.isEmpty())
+    {
+        QMutexLocker locker(&m_currentFrameMutex);
+        m_currentFrames = m_liveFrames;
+        m_liveFrames.clear();
+        QImage frame = largestFrame();
+        bool sizeChanged = frame.size() != m_streamSize;
+        m_streamSize = frame.size();
+        locker.unlock();
+
+        if (sizeChanged)
+            emit streamSizeChanged(m_streamSize);
+        emit updated();
+    }
+
+    emit timeshiftChanged(0);
+}
+
+void RtspStream::exportReplay(const QString &fileName, int msecs)
+{
+    if (!m_replayRing || state() < Streaming)
+    {
+        emit replayExported(fileName, tr("No recent video"));
+        return;
+    }
+
+    qint64 end = m_replayRing->endTime();
+    RtspStreamReplayTask *task = new RtspStreamReplayTask(this, "replayTaskFinished");
+    task->setClip(m_replayRing->clip(end - qint64(msecs) * 1000, end));
+    task->setExportFileName(fileName);
+    QThreadPool::globalInstance()->start(task);
+}
+
+void RtspStream::replayTaskFinished(ThreadTask *task)
+{
+    RtspStreamReplayTask *replayTask = static_cast<RtspStreamReplayTask *>(task);
+
+    if (!replayTask->exportFileName().isEmpty())
+    {
+        QString errorMessage = replayTask->errorMessage();
+        qDebug() << "RtspStream:" << LoggableUrl(url()) << "exported recent video to" << replayTask->exportFileName()
+                 << errorMessage;
+        emit replayExported(replayTask->exportFileName(), errorMessage);
+        return;
+    }
+
+    if (m_replayTask == replayTask)
+        m_replayTask = 0;
+
+    if (m_replayPosition < 0 || replayTask->result().isNull() || replayTask->taskId <= m_replayFrameId)
+        return;
+
+    m_replayFrameId = replayTask->taskId;
+
+    QMutexLocker locker(&m_currentFrameMutex);
+    QImage frame = replayTask->result();
+    bool sizeChanged = frame.size() != m_streamSize;
+
+    /* Consumers draw this one scaled, however large they are */
+    if (m_liveFrames.isEmpty())
+        m_liveFrames = m_currentFrames;
+    m_currentFrames.resize(1);
+    m_currentFrames[0] = frame;
+    m_streamSize = frame.size();
+    locker.unlock();
+
+    if (sizeChanged)
+        emit streamSizeChanged(m_streamSize);
+    emit updated();
+}
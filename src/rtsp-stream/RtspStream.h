@@ -23,12 +23,26 @@
 #include <QThread>
 #include <QImage>
 #include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
 #include "camera/DVRCamera.h"
 #include "core/LiveStream.h"
+#include "core/LiveStreamBandwidthPolicy.h"
+#include "core/LiveStreamVisibility.h"
 #include "core/LiveViewManager.h"
 #include "audio/AudioPlayer.h"
+#include "utils/ExponentialBackoff.h"
+#include "rtsp-stream/RtspStreamPauseState.h"
 
+class RtspStreamFrame;
+class RtspStreamPacketRing;
+class RtspStreamReplayTask;
+class RtspStreamTelemetry;
 class RtspStreamThread;
+class ThreadTask;
 
 class RtspStream : public LiveStream
 {
@@ -41,6 +55,7 @@ public:
     virtual ~RtspStream();
 
     QUrl url() const;
+    DVRServer *server() const;
 
     int bandwidthMode() const { return m_bandwidthMode; }
     bool hwAccelStatus() const { return m_isHWAccelEnabled; };
@@ -49,17 +64,41 @@ public:
     QString errorMessage() const { return m_errorMessage; }
 
     QImage currentFrame() const;
+    QImage scaledFrame(QObject *consumer) const;
     QSize streamSize() const;
 
     float receivedFps() const { return m_fps; }
+    /* Frames waiting to be displayed, and frames the queue dropped because the
+     * display could not keep up */
+    int frameQueueDepth() const;
+    int droppedFrames() const;
+    /* Interarrival jitter of the stream in microseconds, and frames skipped on
+     * display because a newer one was already due */
+    int presentationJitter() const;
+    int lateFrames() const { return m_lateFrames; }
+    /* Milliseconds from start() to the first frame shown, or -1 */
+    int timeToFirstFrame() const { return m_timeToFirstFrame; }
+    virtual LiveStreamTelemetry telemetry() const;
+    quint64 receivedRate() const;
 
     bool isPaused() const { return state() == Paused; }
     bool isConnected() const { return state() > Connecting; }
+    bool isStalled() const { return m_stalled; }
     bool hasAudio() const { return m_hasAudio; }
     bool isAudioEnabled() const { return m_isAudioEnabled; }
-    void setFrameSizeHint(int width, int height);
-    void ref();
-    void unref();
+    void setFrameSizeHint(QObject *consumer, int width, int height);
+    void ref(QObject *consumer);
+    void unref(QObject *consumer);
+    void setConsumerVisible(QObject *consumer, bool visible);
+    bool isLowLatency() const { return !m_lowLatencyConsumers.isEmpty(); }
+    void setLowLatency(QObject *consumer, bool lowLatency);
+    QSize largestFrameSizeHint() const;
+    int degradation() const { return m_degradation; }
+    void setDegradation(int degradation);
+    int replayLength() const;
+    int timeshift() const;
+    void setTimeshift(int msecs);
+    void exportReplay(const QString &fileName, int msecs);
 
 public slots:
     void start();
@@ -74,28 +113,71 @@ public slots:
     void setAudioFormat(enum AVSampleFormat, int, int);
 
 private slots:
-    void updateFrame();
+    void presentFrames();
+    void setStalled(bool stalled);
     void fatalError(const QString &message);
+    void switchToStandby();
+    void standbyFailed(const QString &message);
     void updateSettings();
     void checkState();
+    void reconnect();
+    void updateSuspension();
     void hwAccelDisabled();
     void updateHwAccelSettings();
+    void replayTaskFinished(ThreadTask *task);
 
 private:
-    static QTimer *m_renderTimer, *m_stateTimer;
+    static QTimer *m_stateTimer;
 
     QWeakPointer<DVRCamera> m_camera;
     QScopedPointer<RtspStreamThread> m_thread;
-    QImage m_currentFrame;
+    QSharedPointer<RtspStreamTelemetry> m_telemetry;
+    /* Connects in a new bandwidth mode while m_thread keeps the old one on screen */
+    QScopedPointer<RtspStreamThread> m_standbyThread;
+    QSharedPointer<RtspStreamTelemetry> m_standbyTelemetry;
+    /* Recent packets of the connection on screen, for replay; replaced along
+     * with the connection */
+    QSharedPointer<RtspStreamPacketRing> m_replayRing;
+    QSharedPointer<RtspStreamPacketRing> m_standbyReplayRing;
+    /* Shown instead of live video, on m_replayRing's clock; -1 while live */
+    qint64 m_replayPosition;
+    /* What was on screen when the replay started */
+    QVector<QImage> m_liveFrames;
+    quint64 m_replayFrameId;
+    quint64 m_replayTaskId;
+    RtspStreamReplayTask *m_replayTask;
+    QVector<QImage> m_currentFrames;
     mutable QMutex m_currentFrameMutex;
-    class RtspStreamFrame *m_frame;
+    QSize m_streamSize;
+    QHash<QObject *, QSize> m_frameSizeHints;
+    QSet<QObject *> m_lowLatencyConsumers;
+    LiveStreamVisibility m_visibility;
+    /* Paused by the user, suspended, or both */
+    RtspStreamPauseState m_pauseState;
+    bool m_connectionSuspended;
+    Degradation m_degradation;
     QString m_errorMessage;
     State m_state;
+    bool m_stalled;
     bool m_autoStart;
     LiveViewManager::BandwidthMode m_bandwidthMode;
+    LiveViewManager::BandwidthMode m_threadBandwidthMode;
+    LiveViewManager::BandwidthMode m_standbyBandwidthMode;
+    LiveStreamBandwidthPolicy m_bandwidthPolicy;
 
-    int m_fpsUpdateCnt;
-    int m_fpsUpdateHits;
+    /* Reconnecting after errors waits longer each time until a frame comes through */
+    QTimer m_reconnectTimer;
+    ExponentialBackoff m_reconnectBackoff;
+
+    QTimer m_presentationTimer;
+    RtspStreamFrame *m_pendingFrame;
+    int m_lateFrames;
+
+    QElapsedTimer m_connectTimer;
+    int m_timeToFirstFrame;
+
+    QElapsedTimer m_fpsTimer;
+    int m_fpsFrames;
     float m_fps;
     bool m_hasAudio;
     bool m_isAudioEnabled;
@@ -106,9 +188,26 @@ private:
     enum AVSampleFormat m_audioSampleFmt;
     int m_audioChannels;
     int m_audioSampleRate;
-    int m_refcount;
 
     void setState(State newState);
+    QUrl streamUrl(LiveViewManager::BandwidthMode mode) const;
+    LiveViewManager::BandwidthMode effectiveBandwidthMode() const;
+    RtspStreamThread *createThread(const QSharedPointer<RtspStreamTelemetry> &telemetry,
+                                   const QSharedPointer<RtspStreamPacketRing> &replayRing);
+    QSharedPointer<RtspStreamPacketRing> createReplayRing() const;
+    void requestReplayFrame();
+    void leaveReplay();
+    void connectThread();
+    void dropStandby();
+    void updateBandwidthMode();
+    void updateAutoBandwidth();
+    qint64 expectedBitrate() const;
+    qint64 serverBitrate() const;
+    void showFrame(RtspStreamFrame *frame);
+    void updateFps();
+    void updateFrameSizeHints();
+    void updateLowLatency(bool wasLowLatency);
+    QImage largestFrame() const;
 
 };
 
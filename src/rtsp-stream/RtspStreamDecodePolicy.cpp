@@ -0,0 +1,123 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamDecodePolicy.h"
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+
+/* A level is used below these fractions of the stream area... */
+static const double levelScales[] = { 1.0, 1.0 / 4, 1.0 / 16, 1.0 / 100 };
+/* ...and left again only once the stream is shown this much larger */
+static const double levelHysteresis = 1.5;
+static const int levelMaxFps[] = { 0, 15, 10, 0 };
+/* Allow for timestamp jitter when capping the frame rate */
+static const qint64 frameIntervalTolerance = 5000;
+
+RtspStreamDecodePolicy::RtspStreamDecodePolicy()
+    : m_level(FullDecode), m_scaleLevel(FullDecode), m_minimumLevel(FullDecode), m_appliedLevel(FullDecode),
+      m_lastFramePts(AV_NOPTS_VALUE)
+{
+}
+
+RtspStreamDecodePolicy::Level RtspStreamDecodePolicy::levelForScale(double scale, Level currentLevel)
+{
+    for (int level = KeyframeDecode; level > FullDecode; --level)
+    {
+        double threshold = levelScales[level];
+        if (level <= currentLevel)
+            threshold *= levelHysteresis;
+
+        if (scale < threshold)
+            return Level(level);
+    }
+
+    return FullDecode;
+}
+
+void RtspStreamDecodePolicy::update(const QList<QSize> &sizeHints, const QSize &streamSize)
+{
+    /* Consumers without a hint get the stream at native size */
+    bool nativeSize = sizeHints.isEmpty() || streamSize.isEmpty();
+    qint64 shownArea = 0;
+    foreach (const QSize &sizeHint, sizeHints)
+    {
+        if (sizeHint.isEmpty())
+            nativeSize = true;
+        shownArea = qMax(shownArea, qint64(sizeHint.width()) * sizeHint.height());
+    }
+
+    if (nativeSize)
+    {
+        m_scaleLevel = FullDecode;
+    }
+    else
+    {
+        double scale = double(shownArea) / (qint64(streamSize.width()) * streamSize.height());
+        m_scaleLevel = levelForScale(scale, m_scaleLevel);
+    }
+
+    m_level = qMax(m_scaleLevel, m_minimumLevel);
+}
+
+void RtspStreamDecodePolicy::apply(AVCodecContext *codecContext, bool keyFrame)
+{
+    if (m_level == m_appliedLevel)
+        return;
+
+    if (m_appliedLevel == KeyframeDecode && !keyFrame)
+        return;
+
+    switch (m_level)
+    {
+    case FullDecode:
+        codecContext->skip_loop_filter = AVDISCARD_DEFAULT;
+        codecContext->skip_frame = AVDISCARD_DEFAULT;
+        break;
+    case ReducedDecode:
+        codecContext->skip_loop_filter = AVDISCARD_ALL;
+        codecContext->skip_frame = AVDISCARD_DEFAULT;
+        break;
+    case MinimalDecode:
+        codecContext->skip_loop_filter = AVDISCARD_ALL;
+        codecContext->skip_frame = AVDISCARD_NONREF;
+        break;
+    case KeyframeDecode:
+        codecContext->skip_loop_filter = AVDISCARD_ALL;
+        codecContext->skip_frame = AVDISCARD_NONKEY;
+        break;
+    }
+
+    m_appliedLevel = m_level;
+}
+
+bool RtspStreamDecodePolicy::acceptFrame(qint64 pts)
+{
+    int maxFps = levelMaxFps[m_appliedLevel];
+    if (!maxFps || pts == (qint64)AV_NOPTS_VALUE)
+        return true;
+
+    /* Timestamps going backwards mean the stream restarted */
+    if (m_lastFramePts != (qint64)AV_NOPTS_VALUE && pts >= m_lastFramePts &&
+        pts - m_lastFramePts < 1000000 / maxFps - frameIntervalTolerance)
+        return false;
+
+    m_lastFramePts = pts;
+    return true;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_DECODE_POLICY_H
+#define RTSP_STREAM_DECODE_POLICY_H
+
+#include <QList>
+#include <QSize>
+
+struct AVCodecContext;
+
+/* Decides how much of a stream is worth decoding from the largest size it is
+ * shown at. A 1080p camera in a thumbnail sized tile doesn't need deblocking,
+ * every frame, or anything but keyframes when the tile is tiny.
+ *
+ * Levels change with some hysteresis so that resizing around a threshold does
+ * not flip between them, and a decoder that only saw keyframes is switched back
+ * on the next keyframe, as the frames in between have no references. */
+class RtspStreamDecodePolicy
+{
+public:
+    enum Level
+    {
+        FullDecode,
+        ReducedDecode,      /* no loop filter, at most 15 fps */
+        MinimalDecode,      /* also no non-reference frames, at most 10 fps */
+        KeyframeDecode      /* keyframes only */
+    };
+
+    RtspStreamDecodePolicy();
+
+    /* Level for a stream shown at scale (shown area / stream area) */
+    static Level levelForScale(double scale, Level currentLevel);
+
+    Level level() const { return m_level; }
+    Level appliedLevel() const { return m_appliedLevel; }
+
+    void update(const QList<QSize> &sizeHints, const QSize &streamSize);
+    /* Decodes at least this little regardless of size, while the system is overloaded */
+    void setMinimumLevel(Level level) { m_minimumLevel = level; }
+    Level minimumLevel() const { return m_minimumLevel; }
+    void apply(AVCodecContext *codecContext, bool keyFrame);
+    /* The decoder was replaced by one with default settings */
+    void decoderReset() { m_appliedLevel = FullDecode; }
+
+    /* Frame rate cap of the applied level; pts in microseconds */
+    bool acceptFrame(qint64 pts);
+
+private:
+    Level m_level;
+    Level m_scaleLevel;
+    Level m_minimumLevel;
+    Level m_appliedLevel;
+    qint64 m_lastFramePts;
+
+};
+
+#endif // RTSP_STREAM_DECODE_POLICY_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamDecodeThreading.h"
+#include <QAtomicInt>
+#include <QByteArray>
+
+extern "C"
+{
+#include "libavutil/dict.h"
+}
+
+/* Roughly what one core decodes in real time, in H.264 1080p pixels; see
+ * RtspStreamDecodeThreadingBenchmark for the crossover points */
+static const qint64 pixelsPerThread = 1920 * 1080;
+static const int hevcCostFactor = 2;
+static const int maxThreads = 8;
+/* Beyond this frame threading's delay is the lesser evil */
+static const int maxSliceThreads = 2;
+
+static QAtomicInt liveStreamCount;
+
+RtspStreamDecodeThreading::RtspStreamDecodeThreading()
+    : m_threadCount(1), m_threadType(FF_THREAD_SLICE)
+{
+}
+
+RtspStreamDecodeThreading RtspStreamDecodeThreading::choose(AVCodecID codecId, int codecCapabilities, int width, int height,
+                                                            int liveStreams, int cores, bool lowDelay)
+{
+    RtspStreamDecodeThreading threading;
+
+    bool sliceThreads = codecCapabilities & AV_CODEC_CAP_SLICE_THREADS;
+    bool frameThreads = !lowDelay && (codecCapabilities & AV_CODEC_CAP_FRAME_THREADS);
+    if (width <= 0 || height <= 0 || (!sliceThreads && !frameThreads))
+        return threading;
+
+    int coresPerStream = cores / qMax(liveStreams, 1);
+    if (coresPerStream <= 1)
+        return threading;
+
+    qint64 cost = qint64(width) * height;
+    if (codecId == AV_CODEC_ID_HEVC)
+        cost *= hevcCostFactor;
+
+    int threads = int((cost + pixelsPerThread - 1) / pixelsPerThread);
+    threads = qBound(1, threads, qMin(coresPerStream, maxThreads));
+    if (threads == 1)
+        return threading;
+
+    threading.m_threadCount = threads;
+    if (frameThreads && (threads > maxSliceThreads || !sliceThreads))
+        threading.m_threadType = FF_THREAD_FRAME;
+    else
+        threading.m_threadType = FF_THREAD_SLICE;
+
+    return threading;
+}
+
+int RtspStreamDecodeThreading::liveStreams()
+{
+    return liveStreamCount.load();
+}
+
+void RtspStreamDecodeThreading::addLiveStream()
+{
+    liveStreamCount.ref();
+}
+
+void RtspStreamDecodeThreading::removeLiveStream()
+{
+    liveStreamCount.deref();
+}
+
+void RtspStreamDecodeThreading::setOptions(AVDictionary **options) const
+{
+    av_dict_set(options, "threads", QByteArray::number(m_threadCount).constData(), 0);
+    av_dict_set(options, "thread_type", m_threadType == FF_THREAD_FRAME ? "frame" : "slice", 0);
+}
+
+bool RtspStreamDecodeThreading::operator==(const RtspStreamDecodeThreading &other) const
+{
+    return m_threadCount == other.m_threadCount && m_threadType == other.m_threadType;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_DECODE_THREADING_H
+#define RTSP_STREAM_DECODE_THREADING_H
+
+extern "C" {
+#   include "libavcodec/avcodec.h"
+}
+
+struct AVDictionary;
+
+/* Codec threading for one video stream. Streams are already decoded in parallel
+ * with each other, so a stream only gets threads of its own when there are cores
+ * left over per live stream and its resolution and codec need more than one
+ * core. Slice threading adds no delay but only helps streams encoded in several
+ * slices; frame threading always scales but holds back a frame per extra thread,
+ * so it is used only where a couple of threads would not keep up anyway, and
+ * never for low delay streams. */
+class RtspStreamDecodeThreading
+{
+public:
+    RtspStreamDecodeThreading();
+
+    static RtspStreamDecodeThreading choose(AVCodecID codecId, int codecCapabilities, int width, int height,
+                                            int liveStreams, int cores, bool lowDelay = false);
+
+    /* Video streams with an open decoder, counted by the workers */
+    static int liveStreams();
+    static void addLiveStream();
+    static void removeLiveStream();
+
+    int threadCount() const { return m_threadCount; }
+    int threadType() const { return m_threadType; }
+
+    void setOptions(AVDictionary **options) const;
+
+    bool operator==(const RtspStreamDecodeThreading &other) const;
+    bool operator!=(const RtspStreamDecodeThreading &other) const { return !(*this == other); }
+
+private:
+    int m_threadCount;
+    int m_threadType;
+
+};
+
+#endif // RTSP_STREAM_DECODE_THREADING_H
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamDeinterlacer.h"
+#include <QString>
+#include <QDebug>
+
+extern "C"
+{
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+#include "libavutil/frame.h"
+}
+
+/* Output one frame per frame, and deinterlace every frame we are given: solo
+ * cards don't flag their interlaced frames, see RtspStreamFrameFormatter */
+static const char *filterOptions = "mode=send_frame:parity=auto:deint=all";
+
+RtspStreamDeinterlacer::RtspStreamDeinterlacer(AVRational timeBase, AVRational sampleAspectRatio)
+    : m_timeBase(timeBase), m_sampleAspectRatio(sampleAspectRatio), m_graph(0), m_source(0), m_sink(0),
+      m_output(av_frame_alloc()), m_width(0), m_height(0), m_format(-1), m_graphFailed(false)
+{
+    if (m_timeBase.num <= 0 || m_timeBase.den <= 0)
+    {
+        m_timeBase.num = 1;
+        m_timeBase.den = 90000;
+    }
+
+    if (m_sampleAspectRatio.num <= 0 || m_sampleAspectRatio.den <= 0)
+    {
+        m_sampleAspectRatio.num = 1;
+        m_sampleAspectRatio.den = 1;
+    }
+}
+
+RtspStreamDeinterlacer::~RtspStreamDeinterlacer()
+{
+    freeGraph();
+    av_frame_free(&m_output);
+}
+
+const char * RtspStreamDeinterlacer::filterName()
+{
+    if (avfilter_get_by_name("bwdif"))
+        return "bwdif";
+    if (avfilter_get_by_name("yadif"))
+        return "yadif";
+    return 0;
+}
+
+AVFrame * RtspStreamDeinterlacer::deinterlace(AVFrame *avFrame, Mode mode)
+{
+    if (avFrame->width != m_width || avFrame->height != m_height || avFrame->format != m_format)
+    {
+        freeGraph();
+        m_width = avFrame->width;
+        m_height = avFrame->height;
+        m_format = avFrame->format;
+        m_graphFailed = false;
+    }
+
+    if (mode == FieldDeinterlacing)
+    {
+        /* Frames fed to the filter later must not be compared with old ones */
+        freeGraph();
+        return field(avFrame);
+    }
+
+    AVFrame *result = filter(avFrame);
+    if (!result)
+        return field(avFrame);
+
+    return result;
+}
+
+AVFrame * RtspStreamDeinterlacer::field(AVFrame *avFrame)
+{
+    av_frame_unref(m_output);
+    if (av_frame_ref(m_output, avFrame) < 0)
+        return avFrame;
+
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && m_output->data[i]; ++i)
+        m_output->linesize[i] *= 2;
+    m_output->height /= 2;
+    m_output->interlaced_frame = 0;
+
+    return m_output;
+}
+
+AVFrame * RtspStreamDeinterlacer::filter(AVFrame *avFrame)
+{
+    if (!m_graph && (m_graphFailed || !createGraph(avFrame)))
+        return 0;
+
+    if (av_buffersrc_add_frame_flags(m_source, avFrame, AV_BUFFERSRC_FLAG_KEEP_REF) < 0)
+    {
+        freeGraph();
+        return 0;
+    }
+
+    av_frame_unref(m_output);
+    int ret = av_buffersink_get_frame(m_sink, m_output);
+    if (ret == AVERROR(EAGAIN))
+        return 0;
+
+    if (ret < 0)
+    {
+        freeGraph();
+        return 0;
+    }
+
+    /* The filtered picture is a frame late; show it in place of this one */
+    m_output->pts = avFrame->pts;
+    m_output->interlaced_frame = 0;
+    return m_output;
+}
+
+bool RtspStreamDeinterlacer::createGraph(AVFrame *avFrame)
+{
+    const char *name = filterName();
+    const AVFilter *deinterlaceFilter = name ? avfilter_get_by_name(name) : 0;
+    const AVFilter *bufferFilter = avfilter_get_by_name("buffer");
+    const AVFilter *bufferSinkFilter = avfilter_get_by_name("buffersink");
+    if (!deinterlaceFilter || !bufferFilter || !bufferSinkFilter)
+    {
+        qDebug("RtspStreamDeinterlacer: no deinterlacing filter available, showing single fields");
+        m_graphFailed = true;
+        return false;
+    }
+
+    m_graph = avfilter_graph_alloc();
+    if (!m_graph)
+    {
+        m_graphFailed = true;
+        return false;
+    }
+
+    /* We already run on one of the decode pool's threads */
+    m_graph->nb_threads = 1;
+
+    QByteArray sourceArgs = QString::fromLatin1("video_size=%1x%2:pix_fmt=%3:time_base=%4/%5:pixel_aspect=%6/%7")
+            .arg(avFrame->width).arg(avFrame->height).arg(avFrame->format)
+            .arg(m_timeBase.num).arg(m_timeBase.den)
+            .arg(m_sampleAspectRatio.num).arg(m_sampleAspectRatio.den).toLatin1();
+
+    AVFilterContext *deinterlaceContext = 0;
+    bool ok = avfilter_graph_create_filter(&m_source, bufferFilter, "in", sourceArgs.constData(), NULL, m_graph) >= 0
+            && avfilter_graph_create_filter(&deinterlaceContext, deinterlaceFilter, "deinterlace", filterOptions, NULL, m_graph) >= 0
+            && avfilter_graph_create_filter(&m_sink, bufferSinkFilter, "out", NULL, NULL, m_graph) >= 0
+            && avfilter_link(m_source, 0, deinterlaceContext, 0) >= 0
+            && avfilter_link(deinterlaceContext, 0, m_sink, 0) >= 0
+            && avfilter_graph_config(m_graph, NULL) >= 0;
+
+    if (!ok)
+    {
+        qDebug("RtspStreamDeinterlacer: %s does not take %dx%d pixel format %d, showing single fields",
+               name, avFrame->width, avFrame->height, avFrame->format);
+        freeGraph();
+        m_graphFailed = true;
+        return false;
+    }
+
+    return true;
+}
+
+void RtspStreamDeinterlacer::freeGraph()
+{
+    /* Frees the filter contexts with it */
+    avfilter_graph_free(&m_graph);
+    m_source = 0;
+    m_sink = 0;
+}
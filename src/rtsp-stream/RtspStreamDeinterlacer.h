@@ -0,0 +1,83 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_DEINTERLACER_H
+#define RTSP_STREAM_DEINTERLACER_H
+
+#include <QtGlobal>
+
+extern "C" {
+#   include "libavutil/rational.h"
+}
+
+struct AVFilterContext;
+struct AVFilterGraph;
+struct AVFrame;
+
+/* Deinterlaces the decoded frames of one stream, on the thread decoding it.
+ *
+ * FilterDeinterlacing runs a bwdif (or, on older FFmpeg, yadif) filter graph
+ * that is built on first use and kept until the picture format changes. The
+ * filter needs the next frame to finish the current one, so its output is one
+ * frame behind; the first frame, and any frame the graph fails on, falls back
+ * to FieldDeinterlacing.
+ *
+ * FieldDeinterlacing costs nothing: the result is the top field of the frame,
+ * a reference to the same buffers with twice the line size and half the
+ * height. Scaling it back to the output size doubles the lines. That is all
+ * the detail a tile no taller than one field can show anyway. */
+class RtspStreamDeinterlacer
+{
+    Q_DISABLE_COPY(RtspStreamDeinterlacer)
+
+public:
+    enum Mode
+    {
+        FieldDeinterlacing,
+        FilterDeinterlacing
+    };
+
+    RtspStreamDeinterlacer(AVRational timeBase, AVRational sampleAspectRatio);
+    ~RtspStreamDeinterlacer();
+
+    /* Name of the filter used for FilterDeinterlacing, or 0 if there is none */
+    static const char * filterName();
+
+    /* Returns the deinterlaced picture with the pts of avFrame. It stays valid
+     * until the next call; avFrame itself is left untouched. */
+    AVFrame * deinterlace(AVFrame *avFrame, Mode mode);
+
+private:
+    AVRational m_timeBase;
+    AVRational m_sampleAspectRatio;
+    AVFilterGraph *m_graph;
+    AVFilterContext *m_source;
+    AVFilterContext *m_sink;
+    AVFrame *m_output;
+    int m_width;
+    int m_height;
+    int m_format;
+    bool m_graphFailed;
+
+    AVFrame * field(AVFrame *avFrame);
+    AVFrame * filter(AVFrame *avFrame);
+    bool createGraph(AVFrame *avFrame);
+    void freeGraph();
+
+};
+
+#endif // RTSP_STREAM_DEINTERLACER_H
@@ -19,21 +19,91 @@
 
 extern "C" {
 #   include "libavformat/avformat.h"
+#   include "libavutil/buffer.h"
+#   include "libavutil/imgutils.h"
 }
 
-RtspStreamFrame::RtspStreamFrame(AVFrame *avFrame, int width, int height)
-    : m_avFrame(avFrame), m_streamWidth(width), m_streamHeight(height)
+static void releaseImageBuffer(void *buffer)
 {
-    Q_ASSERT(m_avFrame);
+    AVBufferRef *bufferRef = static_cast<AVBufferRef *>(buffer);
+    av_buffer_unref(&bufferRef);
+}
+
+RtspStreamFrame::RtspStreamFrame()
+    : m_streamWidth(0), m_streamHeight(0), m_presentationTime(0), m_queuedTime(0)
+{
+    setOutputCount(1);
 }
 
 RtspStreamFrame::~RtspStreamFrame()
 {
-    av_free(m_avFrame->data[0]);
-    av_frame_free(&m_avFrame);
+    setOutputCount(0);
+}
+
+void RtspStreamFrame::setOutputCount(int count)
+{
+    while (m_outputs.size() > count)
+    {
+        AVFrame *output = m_outputs.takeLast();
+        av_frame_free(&output);
+    }
+
+    while (m_outputs.size() < count)
+    {
+        AVFrame *output = av_frame_alloc();
+        Q_ASSERT(output);
+        m_outputs.append(output);
+    }
 }
 
-AVFrame * RtspStreamFrame::avFrame() const
+bool RtspStreamFrame::prepare(int output, AVBufferPool *bufferPool, AVPixelFormat pixelFormat, int width, int height)
 {
-    return m_avFrame;
+    AVFrame *avFrame = m_outputs.value(output);
+    if (!avFrame)
+        return false;
+
+    /* A buffer that is not writable is still referenced by an image() */
+    if (avFrame->buf[0] && av_buffer_is_writable(avFrame->buf[0]) &&
+        avFrame->format == pixelFormat && avFrame->width == width && avFrame->height == height)
+        return true;
+
+    av_frame_unref(avFrame);
+
+    AVBufferRef *buffer = av_buffer_pool_get(bufferPool);
+    if (!buffer)
+        return false;
+
+    avFrame->buf[0] = buffer;
+    av_image_fill_arrays(avFrame->data, avFrame->linesize, buffer->data, pixelFormat, width, height, 4);
+    avFrame->format = pixelFormat;
+    avFrame->width = width;
+    avFrame->height = height;
+
+    return true;
+}
+
+void RtspStreamFrame::setStreamSize(int width, int height)
+{
+    m_streamWidth = width;
+    m_streamHeight = height;
+}
+
+AVFrame * RtspStreamFrame::avFrame(int output) const
+{
+    return m_outputs.value(output);
+}
+
+QImage RtspStreamFrame::image(int output) const
+{
+    AVFrame *avFrame = m_outputs.value(output);
+    if (!avFrame || !avFrame->buf[0] || avFrame->format != AV_PIX_FMT_BGRA)
+        return QImage();
+
+    AVBufferRef *bufferRef = av_buffer_ref(avFrame->buf[0]);
+    if (!bufferRef)
+        return QImage();
+
+    /* Built over const data, so that anything writing to the image detaches instead */
+    return QImage((const uchar *)avFrame->data[0], avFrame->width, avFrame->height, avFrame->linesize[0],
+                  QImage::Format_RGB32, releaseImageBuffer, bufferRef);
 }
@@ -18,26 +18,60 @@
 #ifndef RTSP_STREAM_FRAME_H
 #define RTSP_STREAM_FRAME_H
 
-#include <QtGlobal>
+#include <QImage>
+#include <QVector>
 
+extern "C" {
+#   include "libavutil/pixfmt.h"
+}
+
+struct AVBufferPool;
 struct AVFrame;
 
+/* Decoded frame, scaled to one or more output sizes (one per distinct consumer
+ * size). Frames are recycled through RtspStreamFrameQueue, so output buffers are
+ * kept across uses and only replaced when the requested format or size changes,
+ * or while an image() of them is still referenced. Buffers come from the
+ * formatter's pools and go back to them when released. */
 class RtspStreamFrame
 {
     Q_DISABLE_COPY(RtspStreamFrame);
 
 public:
-    explicit RtspStreamFrame(AVFrame *avFrame, int width, int height);
+    RtspStreamFrame();
     ~RtspStreamFrame();
 
-    AVFrame * avFrame() const;
+    int outputCount() const { return m_outputs.size(); }
+    void setOutputCount(int count);
+
+    /* Makes avFrame(output) hold a buffer for a width x height image in pixelFormat,
+     * reusing the current one when it already matches and taking a new one from
+     * bufferPool otherwise. */
+    bool prepare(int output, AVBufferPool *bufferPool, AVPixelFormat pixelFormat, int width, int height);
+    void setStreamSize(int width, int height);
+
+    AVFrame * avFrame(int output = 0) const;
+
+    /* Implicitly shared image over an output's buffer, made without copying. The
+     * buffer holds a reference for every live copy of the image and is freed, or
+     * reused, only after the last one is gone. */
+    QImage image(int output = 0) const;
     int width() { return m_streamWidth; }
     int height() { return m_streamHeight; }
 
+    /* Monotonic time in microseconds at which the frame is due on screen */
+    qint64 presentationTime() const { return m_presentationTime; }
+    void setPresentationTime(qint64 presentationTime) { m_presentationTime = presentationTime; }
+    /* Monotonic time in microseconds at which the frame was queued */
+    qint64 queuedTime() const { return m_queuedTime; }
+    void setQueuedTime(qint64 queuedTime) { m_queuedTime = queuedTime; }
+
 private:
-    AVFrame *m_avFrame;
+    QVector<AVFrame *> m_outputs;
     int m_streamWidth;
     int m_streamHeight;
+    qint64 m_presentationTime;
+    qint64 m_queuedTime;
 };
 
 #endif // RTSP_STREAM_FRAME_H
@@ -16,7 +16,9 @@
  */
 
 #include "RtspStreamFrameFormatter.h"
+#include "RtspStreamDeinterlacer.h"
 #include "RtspStreamFrame.h"
+#include "RtspStreamFrameScaler.h"
 #include <QDebug>
 
 extern "C"
@@ -24,11 +26,12 @@ extern "C"
 #include "libavcodec/avcodec.h"
 #include "libavformat/avformat.h"
 #include "libswscale/swscale.h"
+#include "libavutil/buffer.h"
 #include "libavutil/imgutils.h"
 }
 
-RtspStreamFrameFormatter::RtspStreamFrameFormatter(AVStream *stream) :
-        m_stream(stream), m_sws_context(0), m_pixelFormat(AV_PIX_FMT_BGRA),
+RtspStreamFrameFormatter::RtspStreamFrameFormatter(const AVCodecParameters *parameters, AVRational timeBase) :
+        m_parameters(parameters), m_timeBase(timeBase), m_deinterlacer(0), m_pixelFormat(AV_PIX_FMT_BGRA),
         m_autoDeinterlacing(true), m_shouldTryDeinterlaceStream(shouldTryDeinterlaceStream()),
         m_width(0), m_height(0)
 {
@@ -36,7 +39,17 @@ RtspStreamFrameFormatter::RtspStreamFrameFormatter(AVStream *stream) :
 
 RtspStreamFrameFormatter::~RtspStreamFrameFormatter()
 {
-    sws_freeContext(m_sws_context);
+    for (int i = 0; i < m_scalers.size(); ++i)
+        freeScaler(m_scalers[i]);
+    delete m_deinterlacer;
+}
+
+QSize RtspStreamFrameFormatter::outputSize(const QSize &sizeHint, const QSize &streamSize)
+{
+    if (sizeHint.isEmpty() || sizeHint.width() >= streamSize.width() || sizeHint.height() >= streamSize.height())
+        return streamSize;
+
+    return sizeHint;
 }
 
 void RtspStreamFrameFormatter::setAutoDeinterlacing(bool autoDeinterlacing)
@@ -44,29 +57,63 @@ void RtspStreamFrameFormatter::setAutoDeinterlacing(bool autoDeinterlacing)
     m_autoDeinterlacing = autoDeinterlacing;
 }
 
+void RtspStreamFrameFormatter::updateStreamParameters()
+{
+    m_shouldTryDeinterlaceStream = shouldTryDeinterlaceStream();
+}
+
 bool RtspStreamFrameFormatter::shouldTryDeinterlaceStream()
 {
     /* Assume that H.264 D1-resolution video is interlaced, to work around a solo(?) bug
      * that results in interlaced_frame not being set for videos from solo6110. */
 
-    if (m_stream->codecpar->codec_id != AV_CODEC_ID_H264)
+    if (m_parameters->codec_id != AV_CODEC_ID_H264)
         return false;
 
-    if (m_stream->codecpar->width == 704 && m_stream->codecpar->height == 480)
+    if (m_parameters->width == 704 && m_parameters->height == 480)
         return true;
 
-    if (m_stream->codecpar->width == 720 && m_stream->codecpar->height == 576)
+    if (m_parameters->width == 720 && m_parameters->height == 576)
         return true;
 
     return false;
 }
 
-RtspStreamFrame * RtspStreamFrameFormatter::formatFrame(AVFrame* avFrame, int width, int height)
+bool RtspStreamFrameFormatter::formatFrame(AVFrame *avFrame, const QList<QSize> &sizeHints, RtspStreamFrame *frame)
 {
+    Q_ASSERT(avFrame->width != 0);
+    Q_ASSERT(avFrame->height != 0);
+    m_width = avFrame->width;
+    m_height = avFrame->height;
+
+    QSize streamSize(m_width, m_height);
+    QVector<QSize> sizes;
+    foreach (const QSize &sizeHint, sizeHints)
+    {
+        QSize size = outputSize(sizeHint, streamSize);
+        if (!sizes.contains(size))
+            sizes.append(size);
+    }
+
+    if (sizes.isEmpty())
+        sizes.append(streamSize);
+
+    AVFrame *picture = avFrame;
     if (shouldTryDeinterlaceFrame(avFrame))
-        deinterlaceFrame(avFrame);
+        picture = deinterlaceFrame(avFrame, sizes);
+
+    releaseUnusedScalers(sizes);
+    frame->setOutputCount(sizes.size());
+
+    for (int i = 0; i < sizes.size(); ++i)
+    {
+        Scaler *scaler = scalerForSize(sizes.at(i));
+        if (!scaler || !scaleFrame(picture, *scaler, i, frame))
+            return false;
+    }
 
-    return new RtspStreamFrame(scaleFrame(avFrame, width, height), avFrame->width, avFrame->height);
+    frame->setStreamSize(m_width, m_height);
+    return true;
 }
 
 bool RtspStreamFrameFormatter::shouldTryDeinterlaceFrame(AVFrame *avFrame)
@@ -80,77 +127,124 @@ bool RtspStreamFrameFormatter::shouldTryDeinterlaceFrame(AVFrame *avFrame)
     return m_shouldTryDeinterlaceStream;
 }
 
-void RtspStreamFrameFormatter::deinterlaceFrame(AVFrame* avFrame)
+AVFrame * RtspStreamFrameFormatter::deinterlaceFrame(AVFrame *avFrame, const QVector<QSize> &sizes)
 {
-    //int ret = avpicture_deinterlace((AVPicture*)avFrame, (AVPicture*)avFrame,
-    //                                m_stream->codecpar->format, m_stream->codecpar->width, m_stream->codecpar->height);
-    int ret = -1;
-    if (ret < 0)
-        qDebug("deinterlacing failed");
+    if (!m_deinterlacer)
+        m_deinterlacer = new RtspStreamDeinterlacer(m_timeBase, m_parameters->sample_aspect_ratio);
+
+    int outputHeight = 0;
+    foreach (const QSize &size, sizes)
+        outputHeight = qMax(outputHeight, size.height());
+
+    /* Scaling one field down loses nothing the output could show */
+    RtspStreamDeinterlacer::Mode mode = outputHeight <= m_height / 2
+            ? RtspStreamDeinterlacer::FieldDeinterlacing
+            : RtspStreamDeinterlacer::FilterDeinterlacing;
+
+    return m_deinterlacer->deinterlace(avFrame, mode);
 }
 
-AVFrame * RtspStreamFrameFormatter::scaleFrame(AVFrame* avFrame, int width, int height)
+bool RtspStreamFrameFormatter::scaleFrame(AVFrame *avFrame, Scaler &scaler, int output, RtspStreamFrame *frame)
 {
-    Q_ASSERT(avFrame->width != 0);
-    Q_ASSERT(avFrame->height != 0);
-    m_width = avFrame->width;
-    m_height = avFrame->height;
-
-    if (width == -1 || height == -1)
+    AVPixelFormat pixelFormat = sourcePixelFormat();
+    if (m_pixelFormat == AV_PIX_FMT_BGRA && RtspStreamFrameScaler::isSupported(pixelFormat))
     {
-        width = m_width;
-        height = m_height;
-    }
+        if (!frame->prepare(output, scaler.bufferPool, m_pixelFormat, scaler.size.width(), scaler.size.height()))
+            return false;
 
-    updateSWSContext(width, height);
+        if (!scaler.frameScaler)
+            scaler.frameScaler = new RtspStreamFrameScaler;
 
-    if (!m_sws_context)
-        return NULL;
+        AVFrame *result = frame->avFrame(output);
+        scaler.frameScaler->scale(avFrame->data, avFrame->linesize, pixelFormat, avFrame->width, avFrame->height,
+                                  result->data[0], result->linesize[0], result->width, result->height);
+        result->pts = avFrame->pts;
+        return true;
+    }
 
-    int bufSize  = av_image_get_buffer_size(m_pixelFormat, width, height, 4);
-    uint8_t *buf = (uint8_t*) av_malloc(bufSize);
+    scaler.swsContext = sws_getCachedContext(scaler.swsContext,
+                                             avFrame->width, avFrame->height,
+                                             pixelFormat,
+                                             scaler.size.width(), scaler.size.height(),
+                                             m_pixelFormat,
+                                             SWS_FAST_BILINEAR, NULL, NULL, NULL);
 
-    AVFrame *result = av_frame_alloc();
+    if (!scaler.swsContext)
+        return false;
 
-    av_image_fill_arrays(result->data, result->linesize, buf, m_pixelFormat, width, height, 4);
-    sws_scale(m_sws_context, (const uint8_t**)avFrame->data, avFrame->linesize, 0, m_height,
+    if (!frame->prepare(output, scaler.bufferPool, m_pixelFormat, scaler.size.width(), scaler.size.height()))
+        return false;
+
+    AVFrame *result = frame->avFrame(output);
+    sws_scale(scaler.swsContext, (const uint8_t**)avFrame->data, avFrame->linesize, 0, avFrame->height,
               result->data, result->linesize);
 
-    result->width = width;
-    result->height = height;
     result->pts = avFrame->pts;
 
-    return result;
+    return true;
 }
 
-void RtspStreamFrameFormatter::updateSWSContext(int dstWidth, int dstHeight)
+AVPixelFormat RtspStreamFrameFormatter::sourcePixelFormat() const
 {
-    AVPixelFormat pixFormat;
-
     //convert deprecated pixel format in incoming stream
     //in order to suppress swscaler warning
-    switch (m_stream->codecpar->format)
+    switch (m_parameters->format)
     {
     case AV_PIX_FMT_YUVJ420P :
-        pixFormat = AV_PIX_FMT_YUV420P;
-        break;
+        return AV_PIX_FMT_YUV420P;
     case AV_PIX_FMT_YUVJ422P  :
-        pixFormat = AV_PIX_FMT_YUV422P;
-        break;
+        return AV_PIX_FMT_YUV422P;
     case AV_PIX_FMT_YUVJ444P   :
-        pixFormat = AV_PIX_FMT_YUV444P;
-        break;
+        return AV_PIX_FMT_YUV444P;
     case AV_PIX_FMT_YUVJ440P :
-        pixFormat = AV_PIX_FMT_YUV440P;
+        return AV_PIX_FMT_YUV440P;
     default:
-        pixFormat = (AVPixelFormat) m_stream->codecpar->format;
-        break;
+        return (AVPixelFormat) m_parameters->format;
     }
+}
 
-    m_sws_context = sws_getCachedContext(m_sws_context,
-                                         m_width, m_height,
-                                         pixFormat,
-                                         dstWidth, dstHeight,
-                                         m_pixelFormat,
-                                         SWS_FAST_BILINEAR, NULL, NULL, NULL);
+RtspStreamFrameFormatter::Scaler * RtspStreamFrameFormatter::scalerForSize(const QSize &size)
+{
+    for (int i = 0; i < m_scalers.size(); ++i)
+    {
+        if (m_scalers.at(i).size == size)
+            return &m_scalers[i];
+    }
+
+    int bufferSize = av_image_get_buffer_size(m_pixelFormat, size.width(), size.height(), 4);
+    if (bufferSize <= 0)
+        return 0;
+
+    Scaler scaler;
+    scaler.size = size;
+    scaler.swsContext = 0;
+    scaler.frameScaler = 0;
+    scaler.bufferPool = av_buffer_pool_init(bufferSize, NULL);
+    if (!scaler.bufferPool)
+        return 0;
+
+    m_scalers.append(scaler);
+    return &m_scalers.last();
+}
+
+void RtspStreamFrameFormatter::releaseUnusedScalers(const QVector<QSize> &sizes)
+{
+    for (int i = m_scalers.size() - 1; i >= 0; --i)
+    {
+        if (sizes.contains(m_scalers.at(i).size))
+            continue;
+
+        freeScaler(m_scalers[i]);
+        m_scalers.remove(i);
+    }
+}
+
+void RtspStreamFrameFormatter::freeScaler(Scaler &scaler)
+{
+    sws_freeContext(scaler.swsContext);
+    scaler.swsContext = 0;
+    delete scaler.frameScaler;
+    scaler.frameScaler = 0;
+    /* Buffers of this size are freed as the frames and images holding them are released */
+    av_buffer_pool_uninit(&scaler.bufferPool);
 }
@@ -18,28 +18,60 @@
 #ifndef RTSP_STREAM_FRAME_FORMATTER_H
 #define RTSP_STREAM_FRAME_FORMATTER_H
 
+#include <QList>
+#include <QSize>
+#include <QVector>
+
 extern "C" {
 #   include "libavutil/pixfmt.h"
+#   include "libavutil/rational.h"
 }
 
+class RtspStreamDeinterlacer;
 class RtspStreamFrame;
+class RtspStreamFrameScaler;
+struct AVBufferPool;
+struct AVCodecParameters;
 struct AVFrame;
-struct AVStream;
 
 struct SwsContext;
- 
+
+/* Deinterlaces decoded frames and converts them to BGRA once for every distinct
+ * size the stream's consumers asked for. Each output size keeps its own scaler
+ * and buffer pool for as long as some consumer wants it. YUV 4:2:0 streams go
+ * through RtspStreamFrameScaler, anything else through swscale.
+ *
+ * Interlaced frames are filtered only when some output is taller than one
+ * field; smaller outputs are scaled from a single field. */
 class RtspStreamFrameFormatter
 {
 public:
-    explicit RtspStreamFrameFormatter(AVStream *stream);
+    /* parameters are the worker's copy of the stream's, which must outlive the formatter */
+    RtspStreamFrameFormatter(const AVCodecParameters *parameters, AVRational timeBase);
     ~RtspStreamFrameFormatter();
 
+    /* Size of the output serving a consumer with sizeHint. Consumers without a hint,
+     * or that are not smaller than the stream, share the native-size output. */
+    static QSize outputSize(const QSize &sizeHint, const QSize &streamSize);
+
     void setAutoDeinterlacing(bool autoDeinterlacing);
-    RtspStreamFrame * formatFrame(AVFrame *avFrame, int width, int height);
+    /* The stream's codec parameters were corrected after the formatter was made */
+    void updateStreamParameters();
+    bool formatFrame(AVFrame *avFrame, const QList<QSize> &sizeHints, RtspStreamFrame *frame);
 
 private:
-    AVStream *m_stream;
-    SwsContext *m_sws_context;
+    struct Scaler
+    {
+        QSize size;
+        SwsContext *swsContext;
+        RtspStreamFrameScaler *frameScaler;
+        AVBufferPool *bufferPool;
+    };
+
+    const AVCodecParameters *m_parameters;
+    AVRational m_timeBase;
+    RtspStreamDeinterlacer *m_deinterlacer;
+    QVector<Scaler> m_scalers;
     AVPixelFormat m_pixelFormat;
     bool m_autoDeinterlacing;
     bool m_shouldTryDeinterlaceStream;
@@ -48,9 +80,12 @@ private:
 
     bool shouldTryDeinterlaceStream();
     bool shouldTryDeinterlaceFrame(AVFrame *avFrame);
-    void deinterlaceFrame(AVFrame *avFrame);
-    AVFrame * scaleFrame(AVFrame *avFrame, int width, int height);
-    void updateSWSContext(int dstWidth, int dstHeight);
+    AVFrame * deinterlaceFrame(AVFrame *avFrame, const QVector<QSize> &sizes);
+    bool scaleFrame(AVFrame *avFrame, Scaler &scaler, int output, RtspStreamFrame *frame);
+    AVPixelFormat sourcePixelFormat() const;
+    Scaler * scalerForSize(const QSize &size);
+    void releaseUnusedScalers(const QVector<QSize> &sizes);
+    void freeScaler(Scaler &scaler);
 
 };
 
@@ -18,16 +18,10 @@
 #include "RtspStreamFrameQueue.h"
 #include "RtspStreamFrame.h"
 
-extern "C" {
-#   include "libavcodec/avcodec.h"
-#   include "libavutil/avutil.h"
-#   include "libavutil/mathematics.h"
-}
-
-#define RENDER_TIMER_FPS 30
-
+/* Frames can be queued, displayed, or being formatted at the same time; anything
+ * beyond that which comes back to the free list is simply deleted. */
 RtspStreamFrameQueue::RtspStreamFrameQueue(quint16 sizeLimit) :
-        m_frameQueueLock(QMutex::NonRecursive), m_sizeLimit(sizeLimit), m_ptsBase(AV_NOPTS_VALUE)
+        m_frameQueue(sizeLimit), m_freeFrames(sizeLimit + 2), m_droppedFrames(0), m_wakeUpPending(0)
 {
 }
 
@@ -38,67 +32,81 @@ RtspStreamFrameQueue::~RtspStreamFrameQueue()
 
 RtspStreamFrame * RtspStreamFrameQueue::dequeue()
 {
-    QMutexLocker locker(&m_frameQueueLock);
-    if (m_frameQueue.isEmpty())
+    return m_frameQueue.pop();
+}
+
+RtspStreamFrame * RtspStreamFrameQueue::dequeueNewest()
+{
+    RtspStreamFrame *frame = m_frameQueue.pop();
+    if (!frame)
         return 0;
 
-    if (m_ptsBase == (int64_t)AV_NOPTS_VALUE)
+    RtspStreamFrame *next;
+    while ((next = m_frameQueue.pop()))
     {
-        m_ptsBase = m_frameQueue.head()->avFrame()->pts;
-        m_ptsTimer.start();
+        m_droppedFrames.fetchAndAddRelaxed(1);
+        recycle(frame);
+        frame = next;
     }
 
-    //qint64 now = m_ptsTimer.elapsed() * 1000;
-
-    // TODO: needs checking
-    // something is wrong with this code as after few minutes all frames are considered outdated - some calculation is off here
-    RtspStreamFrame *frame = m_frameQueue.dequeue();
-    /*while (!m_frameQueue.isEmpty() && frame)
-    {
-        qint64 scaledFrameDisplayTime = av_rescale_rnd(frame->avFrame()->pts - m_ptsBase, AV_TIME_BASE, 90000, AV_ROUND_NEAR_INF);
-        if (abs(scaledFrameDisplayTime - now) >= AV_TIME_BASE/2)
-        {
-            m_ptsBase = frame->avFrame()->pts;
-            m_ptsTimer.start();
-            now = scaledFrameDisplayTime = 0;
-        }
-
-        if (now >= scaledFrameDisplayTime || (scaledFrameDisplayTime - now) <= AV_TIME_BASE/(RENDER_TIMER_FPS*2))
-        {
-            delete frame;
-            frame = m_frameQueue.dequeue();
-        }
-        else
-            break;
-    }*/
-
     return frame;
 }
 
-void RtspStreamFrameQueue::enqueue(RtspStreamFrame *frame)
+void RtspStreamFrameQueue::recycle(RtspStreamFrame *frame)
 {
     if (!frame)
         return;
 
-    QMutexLocker locker(&m_frameQueueLock);
-    m_frameQueue.enqueue(frame);
+    if (!m_freeFrames.push(frame))
+        delete frame;
+}
+
+RtspStreamFrame * RtspStreamFrameQueue::takeFreeFrame()
+{
+    if (!m_spareFrames.isEmpty())
+        return m_spareFrames.takeLast();
+
+    RtspStreamFrame *frame = m_freeFrames.pop();
+    if (!frame)
+        frame = new RtspStreamFrame();
 
-    dropOldFrames();
+    return frame;
 }
 
-void RtspStreamFrameQueue::clear()
+void RtspStreamFrameQueue::clearWakeUp()
 {
-    QMutexLocker locker(&m_frameQueueLock);
-    qDeleteAll(m_frameQueue);
-    m_frameQueue.clear();
+    m_wakeUpPending.fetchAndStoreOrdered(0);
 }
 
-// Calling this method should be proteced by m_frameQueueLock
-void RtspStreamFrameQueue::dropOldFrames()
+bool RtspStreamFrameQueue::enqueue(RtspStreamFrame *frame, qint64 pts)
 {
-    while (m_frameQueue.size() >= 6)
+    if (!frame)
+        return false;
+
+    qint64 now = RtspStreamPresentationClock::currentTime();
+    frame->setPresentationTime(m_clock.presentationTime(pts, now));
+    frame->setQueuedTime(now);
+
+    /* The free list is filled by the consumer, so frames dropped here are kept
+     * aside on the producer side instead */
+    RtspStreamFrame *dropped = m_frameQueue.pushOverwrite(frame);
+    if (dropped)
     {
-        RtspStreamFrame *frame = m_frameQueue.dequeue();
-        delete frame;
+        m_droppedFrames.fetchAndAddRelaxed(1);
+        m_spareFrames.append(dropped);
     }
+
+    return m_wakeUpPending.testAndSetOrdered(0, 1);
+}
+
+void RtspStreamFrameQueue::clear()
+{
+    RtspStreamFrame *frame;
+    while ((frame = m_frameQueue.pop()))
+        delete frame;
+    while ((frame = m_freeFrames.pop()))
+        delete frame;
+
+    qDeleteAll(m_spareFrames);
+    m_spareFrames.clear();
 }
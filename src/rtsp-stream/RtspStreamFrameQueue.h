@@ -18,35 +18,55 @@
 #ifndef RTSP_STREAM_FRAME_QUEUE_H
 #define RTSP_STREAM_FRAME_QUEUE_H
 
-#include "core/ThreadPause.h"
-#include <QDateTime>
-#include <QElapsedTimer>
-#include <QMutex>
-#include <QObject>
-#include <QQueue>
+#include "RtspStreamPresentationClock.h"
+#include "utils/SpscRing.h"
+#include <QAtomicInt>
+#include <QVector>
 
 class RtspStreamFrame;
 
+/* Hands formatted frames from the worker thread (producer) to the GUI thread
+ * (consumer) without locking. When the queue is full the oldest frame is dropped.
+ * Dropped and displayed frames are not deleted but returned to a free list, from
+ * which the worker takes frames to format into.
+ *
+ * Frames are stamped with the time they are due on screen when queued. Only the
+ * first frame queued after the consumer called clearWakeUp() asks for a wake up,
+ * so a busy consumer is not flooded with notifications. */
 class RtspStreamFrameQueue
 {
     Q_DISABLE_COPY(RtspStreamFrameQueue)
 
 public:
-    RtspStreamFrameQueue(quint16 sizeLimit);
+    explicit RtspStreamFrameQueue(quint16 sizeLimit);
     ~RtspStreamFrameQueue();
 
+    /* Consumer side */
     RtspStreamFrame * dequeue();
-    void enqueue(RtspStreamFrame *frame);
+    /* Recycles everything older than the newest frame, counting it as dropped */
+    RtspStreamFrame * dequeueNewest();
+    void recycle(RtspStreamFrame *frame);
+    void clearWakeUp();
+
+    /* Producer side */
+    RtspStreamFrame * takeFreeFrame();
+    bool enqueue(RtspStreamFrame *frame, qint64 pts);
+
+    /* Neither side may use the queue while it is being cleared */
     void clear();
 
-private:
-    QMutex m_frameQueueLock;
-    QQueue<RtspStreamFrame *> m_frameQueue;
-    quint16 m_sizeLimit;
-    qint64 m_ptsBase;
-    QElapsedTimer m_ptsTimer;
+    int depth() const { return m_frameQueue.size(); }
+    int droppedFrames() const { return m_droppedFrames.load(); }
+    int jitter() const { return m_clock.jitter(); }
+    int playoutDelay() const { return m_clock.playoutDelay(); }
 
-    void dropOldFrames();
+private:
+    SpscRing<RtspStreamFrame> m_frameQueue;
+    SpscRing<RtspStreamFrame> m_freeFrames;
+    QVector<RtspStreamFrame *> m_spareFrames;
+    QAtomicInt m_droppedFrames;
+    QAtomicInt m_wakeUpPending;
+    RtspStreamPresentationClock m_clock;
 
 };
 
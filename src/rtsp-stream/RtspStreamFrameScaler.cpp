@@ -0,0 +1,480 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamFrameScaler.h"
+#include <string.h>
+
+extern "C"
+{
+#include "libavutil/cpu.h"
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define FRAME_SCALER_SSE2
+#   include <emmintrin.h>
+#   if defined(__GNUC__) || defined(_MSC_VER)
+#       define FRAME_SCALER_AVX2
+#       include <immintrin.h>
+#   endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define FRAME_SCALER_NEON
+#   include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__)
+#   define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#   define TARGET_AVX2
+#endif
+
+/* BT.601 studio range in 6 bit fixed point. The largest intermediate sums
+ * saturate in 16 bit lanes, but only where the result clamps to 255 anyway, so
+ * all implementations give the same output. */
+static const int lumaOffset = 16;
+static const int chromaOffset = 128;
+static const int lumaGain = 74;         /* 1.164 */
+static const int vToR = 102;            /* 1.596 */
+static const int uToG = 25;             /* 0.391 */
+static const int vToG = 52;             /* 0.813 */
+static const int uToB = 129;            /* 2.018 */
+static const int rounding = 32;
+
+static inline uint8_t clampToByte(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/* chromaShift is 1 when u and v have a sample for every other pixel */
+static void convertRowC(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width, int chromaShift)
+{
+    for (int x = 0; x < width; ++x)
+    {
+        int luma = (y[x] - lumaOffset) * lumaGain + rounding;
+        int cb = u[x >> chromaShift] - chromaOffset;
+        int cr = v[x >> chromaShift] - chromaOffset;
+
+        dst[4 * x] = clampToByte((luma + uToB * cb) >> 6);
+        dst[4 * x + 1] = clampToByte((luma - uToG * cb - vToG * cr) >> 6);
+        dst[4 * x + 2] = clampToByte((luma + vToR * cr) >> 6);
+        dst[4 * x + 3] = 255;
+    }
+}
+
+/* fraction is how much of the second row to take, out of 256 */
+static void blendRowsC(const uint8_t *first, const uint8_t *second, uint8_t *dst, int width, int fraction)
+{
+    for (int x = 0; x < width; ++x)
+        dst[x] = (first[x] * (256 - fraction) + second[x] * fraction + 128) >> 8;
+}
+
+#ifdef FRAME_SCALER_SSE2
+
+static inline __m128i loadChromaSse2(const uint8_t *chroma, int chromaShift)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    if (!chromaShift)
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)chroma), zero);
+
+    int samples;
+    memcpy(&samples, chroma, sizeof(samples));
+    __m128i duplicated = _mm_cvtsi32_si128(samples);
+    duplicated = _mm_unpacklo_epi8(duplicated, duplicated);
+    return _mm_unpacklo_epi8(duplicated, zero);
+}
+
+static void convertRowSse2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width, int chromaShift)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8(-1);
+    const __m128i lumaOffsetVector = _mm_set1_epi16(lumaOffset);
+    const __m128i chromaOffsetVector = _mm_set1_epi16(chromaOffset);
+    const __m128i lumaGainVector = _mm_set1_epi16(lumaGain);
+    const __m128i roundingVector = _mm_set1_epi16(rounding);
+    const __m128i vToRVector = _mm_set1_epi16(vToR);
+    const __m128i uToGVector = _mm_set1_epi16(uToG);
+    const __m128i vToGVector = _mm_set1_epi16(vToG);
+    const __m128i uToBVector = _mm_set1_epi16(uToB);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(y + x)), zero);
+        __m128i cb = _mm_sub_epi16(loadChromaSse2(u + (x >> chromaShift), chromaShift), chromaOffsetVector);
+        __m128i cr = _mm_sub_epi16(loadChromaSse2(v + (x >> chromaShift), chromaShift), chromaOffsetVector);
+
+        luma = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(luma, lumaOffsetVector), lumaGainVector), roundingVector);
+
+        __m128i b = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(cb, uToBVector)), 6);
+        __m128i g = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(luma, _mm_mullo_epi16(cb, uToGVector)),
+                                                  _mm_mullo_epi16(cr, vToGVector)), 6);
+        __m128i r = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(cr, vToRVector)), 6);
+
+        b = _mm_packus_epi16(b, b);
+        g = _mm_packus_epi16(g, g);
+        r = _mm_packus_epi16(r, r);
+
+        __m128i bg = _mm_unpacklo_epi8(b, g);
+        __m128i ra = _mm_unpacklo_epi8(r, alpha);
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+
+    convertRowC(y + x, u + (x >> chromaShift), v + (x >> chromaShift), dst + 4 * x, width - x, chromaShift);
+}
+
+static void blendRowsSse2(const uint8_t *first, const uint8_t *second, uint8_t *dst, int width, int fraction)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i firstWeight = _mm_set1_epi16(256 - fraction);
+    const __m128i secondWeight = _mm_set1_epi16(fraction);
+    const __m128i roundingVector = _mm_set1_epi16(128);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(first + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(second + x));
+
+        /* Weights add up to 256, so the sums fit in unsigned 16 bit lanes */
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), firstWeight),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), secondWeight));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), firstWeight),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), secondWeight));
+        low = _mm_srli_epi16(_mm_add_epi16(low, roundingVector), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, roundingVector), 8);
+
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(low, high));
+    }
+
+    blendRowsC(first + x, second + x, dst + x, width - x, fraction);
+}
+
+#endif
+
+#ifdef FRAME_SCALER_AVX2
+
+TARGET_AVX2 static inline __m256i loadChromaAvx2(const uint8_t *chroma, int chromaShift)
+{
+    if (!chromaShift)
+        return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)chroma));
+
+    __m128i samples = _mm_loadl_epi64((const __m128i *)chroma);
+    return _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(samples, samples));
+}
+
+TARGET_AVX2 static inline __m128i packAvx2(__m256i value)
+{
+    /* packus works within 128 bit lanes; put both halves back in order */
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(value, value), 0xD8));
+}
+
+TARGET_AVX2 static void convertRowAvx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width, int chromaShift)
+{
+    const __m128i alpha = _mm_set1_epi8(-1);
+    const __m256i lumaOffsetVector = _mm256_set1_epi16(lumaOffset);
+    const __m256i chromaOffsetVector = _mm256_set1_epi16(chromaOffset);
+    const __m256i lumaGainVector = _mm256_set1_epi16(lumaGain);
+    const __m256i roundingVector = _mm256_set1_epi16(rounding);
+    const __m256i vToRVector = _mm256_set1_epi16(vToR);
+    const __m256i uToGVector = _mm256_set1_epi16(uToG);
+    const __m256i vToGVector = _mm256_set1_epi16(vToG);
+    const __m256i uToBVector = _mm256_set1_epi16(uToB);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i luma = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y + x)));
+        __m256i cb = _mm256_sub_epi16(loadChromaAvx2(u + (x >> chromaShift), chromaShift), chromaOffsetVector);
+        __m256i cr = _mm256_sub_epi16(loadChromaAvx2(v + (x >> chromaShift), chromaShift), chromaOffsetVector);
+
+        luma = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(luma, lumaOffsetVector), lumaGainVector),
+                                roundingVector);
+
+        __m128i b = packAvx2(_mm256_srai_epi16(_mm256_adds_epi16(luma, _mm256_mullo_epi16(cb, uToBVector)), 6));
+        __m128i g = packAvx2(_mm256_srai_epi16(_mm256_subs_epi16(_mm256_subs_epi16(luma, _mm256_mullo_epi16(cb, uToGVector)),
+                                                                 _mm256_mullo_epi16(cr, vToGVector)), 6));
+        __m128i r = packAvx2(_mm256_srai_epi16(_mm256_adds_epi16(luma, _mm256_mullo_epi16(cr, vToRVector)), 6));
+
+        __m128i bgLow = _mm_unpacklo_epi8(b, g);
+        __m128i bgHigh = _mm_unpackhi_epi8(b, g);
+        __m128i raLow = _mm_unpacklo_epi8(r, alpha);
+        __m128i raHigh = _mm_unpackhi_epi8(r, alpha);
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_unpacklo_epi16(bgLow, raLow));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 16), _mm_unpackhi_epi16(bgLow, raLow));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 32), _mm_unpacklo_epi16(bgHigh, raHigh));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 48), _mm_unpackhi_epi16(bgHigh, raHigh));
+    }
+
+    convertRowSse2(y + x, u + (x >> chromaShift), v + (x >> chromaShift), dst + 4 * x, width - x, chromaShift);
+}
+
+#endif
+
+#ifdef FRAME_SCALER_NEON
+
+static inline int16x8_t loadChromaNeon(const uint8_t *chroma, int chromaShift)
+{
+    uint8x8_t samples;
+    if (!chromaShift)
+    {
+        samples = vld1_u8(chroma);
+    }
+    else
+    {
+        uint32_t packed;
+        memcpy(&packed, chroma, sizeof(packed));
+        samples = vreinterpret_u8_u32(vdup_n_u32(packed));
+        samples = vzip_u8(samples, samples).val[0];
+    }
+
+    return vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(samples)), vdupq_n_s16(chromaOffset));
+}
+
+static void convertRowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width, int chromaShift)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        int16x8_t luma = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x)));
+        int16x8_t cb = loadChromaNeon(u + (x >> chromaShift), chromaShift);
+        int16x8_t cr = loadChromaNeon(v + (x >> chromaShift), chromaShift);
+
+        luma = vaddq_s16(vmulq_n_s16(vsubq_s16(luma, vdupq_n_s16(lumaOffset)), lumaGain), vdupq_n_s16(rounding));
+
+        uint8x8x4_t pixels;
+        pixels.val[0] = vqshrun_n_s16(vqaddq_s16(luma, vmulq_n_s16(cb, uToB)), 6);
+        pixels.val[1] = vqshrun_n_s16(vqsubq_s16(vqsubq_s16(luma, vmulq_n_s16(cb, uToG)), vmulq_n_s16(cr, vToG)), 6);
+        pixels.val[2] = vqshrun_n_s16(vqaddq_s16(luma, vmulq_n_s16(cr, vToR)), 6);
+        pixels.val[3] = vdup_n_u8(255);
+        vst4_u8(dst + 4 * x, pixels);
+    }
+
+    convertRowC(y + x, u + (x >> chromaShift), v + (x >> chromaShift), dst + 4 * x, width - x, chromaShift);
+}
+
+static void blendRowsNeon(const uint8_t *first, const uint8_t *second, uint8_t *dst, int width, int fraction)
+{
+    /* Never called with a zero fraction, so both weights fit in a byte */
+    const uint8x8_t firstWeight = vdup_n_u8(256 - fraction);
+    const uint8x8_t secondWeight = vdup_n_u8(fraction);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        uint16x8_t sum = vmull_u8(vld1_u8(first + x), firstWeight);
+        sum = vmlal_u8(sum, vld1_u8(second + x), secondWeight);
+        vst1_u8(dst + x, vrshrn_n_u16(sum, 8));
+    }
+
+    blendRowsC(first + x, second + x, dst + x, width - x, fraction);
+}
+
+#endif
+
+/* Maps destination pixel centers onto the source, in 8 bit fractions. Positions
+ * past the last source pixel clamp to it. */
+static void buildTable(int srcSize, int dstSize, QVector<int> &positions, QVector<int> &fractions)
+{
+    positions.resize(dstSize);
+    fractions.resize(dstSize);
+
+    for (int i = 0; i < dstSize; ++i)
+    {
+        qint64 position = (qint64(2 * i + 1) * srcSize << 16) / (2 * dstSize) - (1 << 15);
+        if (position < 0)
+            position = 0;
+
+        int index = int(position >> 16);
+        int fraction = int(position >> 8) & 0xff;
+        if (index >= srcSize - 1)
+        {
+            index = srcSize - 1;
+            fraction = 0;
+        }
+
+        positions[i] = index;
+        fractions[i] = fraction;
+    }
+}
+
+/* pixelSize is 2 for interleaved chroma, which is sampled as pairs. src needs
+ * pixelSize bytes of padding after its last sample. */
+static void sampleRow(const uint8_t *src, uint8_t *dst, int width, const int *positions, const int *fractions,
+                      int pixelSize, int component)
+{
+    for (int x = 0; x < width; ++x)
+    {
+        const uint8_t *sample = src + positions[x] * pixelSize + component;
+        int fraction = fractions[x];
+        dst[x] = (sample[0] * (256 - fraction) + sample[pixelSize] * fraction + 128) >> 8;
+    }
+}
+
+bool RtspStreamFrameScaler::isSupported(AVPixelFormat format)
+{
+    switch (format)
+    {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_NV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+RtspStreamFrameScaler::RtspStreamFrameScaler()
+    : m_convertRow(convertRowC), m_blendRows(blendRowsC),
+      m_srcWidth(0), m_srcHeight(0), m_dstWidth(0), m_dstHeight(0)
+{
+#ifdef FRAME_SCALER_SSE2
+    m_convertRow = convertRowSse2;
+    m_blendRows = blendRowsSse2;
+#endif
+#ifdef FRAME_SCALER_AVX2
+    if (av_get_cpu_flags() & AV_CPU_FLAG_AVX2)
+        m_convertRow = convertRowAvx2;
+#endif
+#ifdef FRAME_SCALER_NEON
+    m_convertRow = convertRowNeon;
+    m_blendRows = blendRowsNeon;
+#endif
+}
+
+void RtspStreamFrameScaler::updateTables(int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    if (srcWidth == m_srcWidth && srcHeight == m_srcHeight && dstWidth == m_dstWidth && dstHeight == m_dstHeight)
+        return;
+
+    m_srcWidth = srcWidth;
+    m_srcHeight = srcHeight;
+    m_dstWidth = dstWidth;
+    m_dstHeight = dstHeight;
+
+    int chromaWidth = (srcWidth + 1) / 2;
+    int chromaHeight = (srcHeight + 1) / 2;
+
+    buildTable(srcWidth, dstWidth, m_columns, m_columnFractions);
+    buildTable(chromaWidth, dstWidth, m_chromaColumns, m_chromaColumnFractions);
+    buildTable(srcHeight, dstHeight, m_rows, m_rowFractions);
+    buildTable(chromaHeight, dstHeight, m_chromaRows, m_chromaRowFractions);
+
+    /* Rows are padded for sampleRow */
+    m_lumaRow.resize(srcWidth + 1);
+    m_chromaRow.resize(chromaWidth * 2 + 2);
+    m_y.resize(dstWidth);
+    m_u.resize(dstWidth);
+    m_v.resize(dstWidth);
+}
+
+const uint8_t * RtspStreamFrameScaler::blendedRow(const uint8_t *plane, int stride, int row, int fraction, int lastRow,
+                                                  int width, int pixelSize, QVector<uint8_t> &buffer)
+{
+    const uint8_t *first = plane + row * stride;
+    int size = width * pixelSize;
+    uint8_t *dst = buffer.data();
+
+    if (fraction && row < lastRow)
+        m_blendRows(first, first + stride, dst, size, fraction);
+    else
+        memcpy(dst, first, size);
+
+    memcpy(dst + size, dst + size - pixelSize, pixelSize);
+    return dst;
+}
+
+void RtspStreamFrameScaler::scale(const uint8_t * const src[], const int srcStride[], AVPixelFormat format,
+                                  int srcWidth, int srcHeight, uint8_t *dst, int dstStride, int dstWidth, int dstHeight)
+{
+    bool interleavedChroma = format == AV_PIX_FMT_NV12;
+    int chromaWidth = (srcWidth + 1) / 2;
+    int chromaHeight = (srcHeight + 1) / 2;
+
+    /* Same size pictures need no filtering; chroma is taken from the nearest
+     * sample, like swscale's unscaled converters do */
+    if (srcWidth == dstWidth && srcHeight == dstHeight)
+    {
+        if (interleavedChroma)
+        {
+            m_u.resize(chromaWidth);
+            m_v.resize(chromaWidth);
+            m_dstWidth = 0;
+        }
+
+        for (int y = 0; y < dstHeight; ++y)
+        {
+            const uint8_t *u = src[1] + (y / 2) * srcStride[1];
+            const uint8_t *v;
+
+            if (interleavedChroma)
+            {
+                for (int x = 0; x < chromaWidth; ++x)
+                {
+                    m_u[x] = u[2 * x];
+                    m_v[x] = u[2 * x + 1];
+                }
+                u = m_u.constData();
+                v = m_v.constData();
+            }
+            else
+            {
+                v = src[2] + (y / 2) * srcStride[2];
+            }
+
+            m_convertRow(src[0] + y * srcStride[0], u, v, dst + y * dstStride, dstWidth, 1);
+        }
+        return;
+    }
+
+    updateTables(srcWidth, srcHeight, dstWidth, dstHeight);
+    bool sameWidth = srcWidth == dstWidth;
+
+    for (int y = 0; y < dstHeight; ++y)
+    {
+        const uint8_t *luma = blendedRow(src[0], srcStride[0], m_rows[y], m_rowFractions[y], srcHeight - 1,
+                                         srcWidth, 1, m_lumaRow);
+        if (!sameWidth)
+        {
+            sampleRow(luma, m_y.data(), dstWidth, m_columns.constData(), m_columnFractions.constData(), 1, 0);
+            luma = m_y.data();
+        }
+
+        const int *chromaColumns = m_chromaColumns.constData();
+        const int *chromaFractions = m_chromaColumnFractions.constData();
+        if (interleavedChroma)
+        {
+            const uint8_t *chroma = blendedRow(src[1], srcStride[1], m_chromaRows[y], m_chromaRowFractions[y],
+                                               chromaHeight - 1, chromaWidth, 2, m_chromaRow);
+            sampleRow(chroma, m_u.data(), dstWidth, chromaColumns, chromaFractions, 2, 0);
+            sampleRow(chroma, m_v.data(), dstWidth, chromaColumns, chromaFractions, 2, 1);
+        }
+        else
+        {
+            const uint8_t *chroma = blendedRow(src[1], srcStride[1], m_chromaRows[y], m_chromaRowFractions[y],
+                                               chromaHeight - 1, chromaWidth, 1, m_chromaRow);
+            sampleRow(chroma, m_u.data(), dstWidth, chromaColumns, chromaFractions, 1, 0);
+            chroma = blendedRow(src[2], srcStride[2], m_chromaRows[y], m_chromaRowFractions[y],
+                                chromaHeight - 1, chromaWidth, 1, m_chromaRow);
+            sampleRow(chroma, m_v.data(), dstWidth, chromaColumns, chromaFractions, 1, 0);
+        }
+
+        m_convertRow(luma, m_u.data(), m_v.data(), dst + y * dstStride, dstWidth, 0);
+    }
+}
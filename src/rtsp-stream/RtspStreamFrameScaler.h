@@ -0,0 +1,85 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_FRAME_SCALER_H
+#define RTSP_STREAM_FRAME_SCALER_H
+
+#include <QVector>
+#include <stdint.h>
+
+extern "C" {
+#   include "libavutil/pixfmt.h"
+}
+
+/* Converts YUV 4:2:0 pictures, planar or NV12, to BGRA and resizes them by any
+ * ratio in the same pass. Work is done a row at a time so that intermediate rows
+ * stay in cache: source rows are blended vertically, sampled horizontally and
+ * converted straight into the destination.
+ *
+ * Filtering is bilinear, about what SWS_FAST_BILINEAR gives, and colors are
+ * BT.601 studio range like swscale's default. Row blending and color conversion
+ * use SSE2, AVX2 or NEON, whichever the CPU has. Other formats are left to
+ * swscale, see isSupported(). */
+class RtspStreamFrameScaler
+{
+    Q_DISABLE_COPY(RtspStreamFrameScaler)
+
+public:
+    static bool isSupported(AVPixelFormat format);
+
+    RtspStreamFrameScaler();
+
+    void scale(const uint8_t * const src[], const int srcStride[], AVPixelFormat format, int srcWidth, int srcHeight,
+               uint8_t *dst, int dstStride, int dstWidth, int dstHeight);
+
+private:
+    typedef void (*ConvertRowFunction)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                                       int width, int chromaShift);
+    typedef void (*BlendRowsFunction)(const uint8_t *first, const uint8_t *second, uint8_t *dst, int width,
+                                      int fraction);
+
+    ConvertRowFunction m_convertRow;
+    BlendRowsFunction m_blendRows;
+
+    int m_srcWidth;
+    int m_srcHeight;
+    int m_dstWidth;
+    int m_dstHeight;
+
+    /* Source position and 8 bit fraction for every destination column and row */
+    QVector<int> m_columns;
+    QVector<int> m_columnFractions;
+    QVector<int> m_chromaColumns;
+    QVector<int> m_chromaColumnFractions;
+    QVector<int> m_rows;
+    QVector<int> m_rowFractions;
+    QVector<int> m_chromaRows;
+    QVector<int> m_chromaRowFractions;
+
+    QVector<uint8_t> m_lumaRow;
+    QVector<uint8_t> m_chromaRow;
+    QVector<uint8_t> m_y;
+    QVector<uint8_t> m_u;
+    QVector<uint8_t> m_v;
+
+    void updateTables(int srcWidth, int srcHeight, int dstWidth, int dstHeight);
+    const uint8_t * blendedRow(const uint8_t *plane, int stride, int row, int fraction, int lastRow, int width,
+                               int pixelSize, QVector<uint8_t> &buffer);
+
+};
+
+#endif // RTSP_STREAM_FRAME_SCALER_H
@@ -0,0 +1,405 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamPacketRing.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/mathematics.h>
+}
+
+static const AVRational microseconds = { 1, 1000000 };
+
+QAtomicInteger<qint64> RtspStreamPacketRing::s_memoryLimit(Q_INT64_C(256) * 1024 * 1024);
+QAtomicInteger<qint64> RtspStreamPacketRing::s_memoryUsed(0);
+
+static AVCodecParameters * copyParameters(const AVCodecParameters *parameters)
+{
+    if (!parameters)
+        return 0;
+
+    AVCodecParameters *copy = avcodec_parameters_alloc();
+    if (copy && avcodec_parameters_copy(copy, parameters) < 0)
+        avcodec_parameters_free(&copy);
+    return copy;
+}
+
+/* Decoding order, which unlike presentation order only ever goes forward */
+static qint64 packetTimestamp(const AVPacket *packet)
+{
+    return packet->dts != (qint64)AV_NOPTS_VALUE ? packet->dts : packet->pts;
+}
+
+static QString errorMessageFromCode(int errorCode)
+{
+    char error[512];
+    av_strerror(errorCode, error, sizeof(error));
+    return QString::fromLatin1(error);
+}
+
+RtspStreamPacketClip::Data::Data()
+    : video(0), audio(0)
+{
+    videoTimeBase.num = audioTimeBase.num = 0;
+    videoTimeBase.den = audioTimeBase.den = 1;
+}
+
+RtspStreamPacketClip::Data::~Data()
+{
+    foreach (AVPacket *packet, packets)
+        av_packet_free(&packet);
+    avcodec_parameters_free(&video);
+    avcodec_parameters_free(&audio);
+}
+
+RtspStreamPacketClip::RtspStreamPacketClip()
+{
+}
+
+AVRational RtspStreamPacketClip::videoTimeBase() const
+{
+    if (d)
+        return d->videoTimeBase;
+
+    AVRational none = { 0, 1 };
+    return none;
+}
+
+qint64 RtspStreamPacketClip::startTime() const
+{
+    return isEmpty() ? 0 : d->times.first();
+}
+
+qint64 RtspStreamPacketClip::endTime() const
+{
+    return isEmpty() ? 0 : d->times.last();
+}
+
+bool RtspStreamPacketClip::writeMatroska(const QString &fileName, QString *errorMessage) const
+{
+    if (isEmpty() || !d->video)
+    {
+        if (errorMessage)
+            *errorMessage = QCoreApplication::translate("RtspStreamPacketClip", "No recent video");
+        return false;
+    }
+
+    QByteArray path = QFile::encodeName(fileName);
+    AVFormatContext *output = 0;
+    AVRational timeBases[2] = { d->videoTimeBase, d->audioTimeBase };
+    int errorCode = avformat_alloc_output_context2(&output, NULL, "matroska", path.constData());
+    if (errorCode < 0)
+        goto fail;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const AVCodecParameters *parameters = i ? d->audio : d->video;
+        if (!parameters)
+            break;
+
+        AVStream *stream = avformat_new_stream(output, NULL);
+        if (!stream)
+        {
+            errorCode = AVERROR(ENOMEM);
+            goto fail;
+        }
+
+        errorCode = avcodec_parameters_copy(stream->codecpar, parameters);
+        if (errorCode < 0)
+            goto fail;
+        /* Tags are specific to the container they came in */
+        stream->codecpar->codec_tag = 0;
+        stream->time_base = timeBases[i];
+    }
+
+    /* Audio that arrived with the first keyframe may be timed a little before it */
+    output->avoid_negative_ts = AVFMT_AVOID_NEG_TS_MAKE_ZERO;
+
+    errorCode = avio_open(&output->pb, path.constData(), AVIO_FLAG_WRITE);
+    if (errorCode < 0)
+        goto fail;
+
+    errorCode = avformat_write_header(output, NULL);
+    if (errorCode < 0)
+        goto fail;
+
+    {
+        /* The clip starts at zero in the file */
+        qint64 start = packetTimestamp(d->packets.first());
+        if (start == (qint64)AV_NOPTS_VALUE)
+            start = 0;
+
+        foreach (const AVPacket *packet, d->packets)
+        {
+            if (packet->stream_index >= (int)output->nb_streams)
+                continue;
+
+            AVPacket copy;
+            av_init_packet(&copy);
+            errorCode = av_packet_ref(&copy, packet);
+            if (errorCode < 0)
+                goto fail;
+
+            AVRational timeBase = timeBases[packet->stream_index];
+            qint64 offset = av_rescale_q(start, d->videoTimeBase, timeBase);
+            if (copy.pts != (qint64)AV_NOPTS_VALUE)
+                copy.pts -= offset;
+            if (copy.dts != (qint64)AV_NOPTS_VALUE)
+                copy.dts -= offset;
+            av_packet_rescale_ts(&copy, timeBase, output->streams[packet->stream_index]->time_base);
+
+            /* Takes the reference, whether or not it succeeds */
+            errorCode = av_interleaved_write_frame(output, &copy);
+            if (errorCode < 0)
+                goto fail;
+        }
+    }
+
+    errorCode = av_write_trailer(output);
+    if (errorCode < 0)
+        goto fail;
+
+    avio_closep(&output->pb);
+    avformat_free_context(output);
+    return true;
+
+fail:
+    if (errorMessage)
+        *errorMessage = errorMessageFromCode(errorCode);
+
+    if (output)
+    {
+        avio_closep(&output->pb);
+        avformat_free_context(output);
+        QFile::remove(fileName);
+    }
+
+    return false;
+}
+
+void RtspStreamPacketRing::setMemoryLimit(qint64 bytes)
+{
+    s_memoryLimit.store(bytes);
+}
+
+qint64 RtspStreamPacketRing::memoryLimit()
+{
+    return s_memoryLimit.load();
+}
+
+qint64 RtspStreamPacketRing::memoryUsed()
+{
+    return s_memoryUsed.load();
+}
+
+RtspStreamPacketRing::RtspStreamPacketRing(qint64 length)
+    : m_length(length), m_video(0), m_audio(0), m_videoStreamIndex(-1), m_audioStreamIndex(-1),
+      m_endTime(0), m_bytes(0), m_awaitingKeyFrame(true)
+{
+    m_videoTimeBase.num = m_audioTimeBase.num = 0;
+    m_videoTimeBase.den = m_audioTimeBase.den = 1;
+}
+
+RtspStreamPacketRing::~RtspStreamPacketRing()
+{
+    clear();
+    avcodec_parameters_free(&m_video);
+    avcodec_parameters_free(&m_audio);
+}
+
+void RtspStreamPacketRing::setStreams(const AVFormatContext *context, int videoStreamIndex, int audioStreamIndex)
+{
+    QMutexLocker locker(&m_mutex);
+
+    clear();
+    m_awaitingKeyFrame = true;
+    avcodec_parameters_free(&m_video);
+    avcodec_parameters_free(&m_audio);
+
+    m_videoStreamIndex = videoStreamIndex;
+    m_audioStreamIndex = audioStreamIndex;
+
+    if (videoStreamIndex >= 0)
+    {
+        m_video = copyParameters(context->streams[videoStreamIndex]->codecpar);
+        m_videoTimeBase = context->streams[videoStreamIndex]->time_base;
+    }
+
+    if (audioStreamIndex >= 0)
+    {
+        m_audio = copyParameters(context->streams[audioStreamIndex]->codecpar);
+        m_audioTimeBase = context->streams[audioStreamIndex]->time_base;
+    }
+}
+
+void RtspStreamPacketRing::append(const AVPacket *packet)
+{
+    bool isVideo = packet->stream_index == m_videoStreamIndex;
+    if (!isVideo && (packet->stream_index != m_audioStreamIndex || !m_audio))
+        return;
+    if (isVideo && !m_video)
+        return;
+
+    bool isKeyFrame = isVideo && (packet->flags & AV_PKT_FLAG_KEY);
+
+    QMutexLocker locker(&m_mutex);
+
+    if (m_awaitingKeyFrame)
+    {
+        if (!isKeyFrame)
+            return;
+        m_awaitingKeyFrame = false;
+    }
+
+    Entry entry;
+    entry.packet = av_packet_alloc();
+    if (!entry.packet)
+        return;
+    if (av_packet_ref(entry.packet, packet) < 0)
+    {
+        av_packet_free(&entry.packet);
+        return;
+    }
+
+    /* Audio goes with the video it arrived with */
+    qint64 timestamp = packetTimestamp(packet);
+    if (isVideo && timestamp != (qint64)AV_NOPTS_VALUE)
+        m_endTime = av_rescale_q(timestamp, m_videoTimeBase, microseconds);
+
+    entry.time = m_endTime;
+    entry.isVideo = isVideo;
+    if (isKeyFrame)
+        m_keyFrames.enqueue(entry.time);
+
+    m_entries.append(entry);
+    m_bytes += packet->size;
+    s_memoryUsed.fetchAndAddRelaxed(packet->size);
+
+    trim();
+}
+
+void RtspStreamPacketRing::interrupt()
+{
+    QMutexLocker locker(&m_mutex);
+    m_awaitingKeyFrame = true;
+}
+
+qint64 RtspStreamPacketRing::startTime() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.isEmpty() ? m_endTime : m_entries.first().time;
+}
+
+qint64 RtspStreamPacketRing::endTime() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_endTime;
+}
+
+qint64 RtspStreamPacketRing::bytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+RtspStreamPacketClip RtspStreamPacketRing::clip(qint64 start, qint64 end) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    RtspStreamPacketClip result;
+    if (m_entries.isEmpty())
+        return result;
+
+    /* The ring starts on a keyframe, so there always is one to start from */
+    int first = 0;
+    for (int i = 0; i < m_entries.size() && m_entries.at(i).time <= start; ++i)
+    {
+        const Entry &entry = m_entries.at(i);
+        if (entry.isVideo && (entry.packet->flags & AV_PKT_FLAG_KEY))
+            first = i;
+    }
+
+    result.d = QSharedPointer<RtspStreamPacketClip::Data>(new RtspStreamPacketClip::Data);
+    result.d->video = copyParameters(m_video);
+    result.d->audio = copyParameters(m_audio);
+    result.d->videoTimeBase = m_videoTimeBase;
+    result.d->audioTimeBase = m_audioTimeBase;
+
+    for (int i = first; i < m_entries.size() && m_entries.at(i).time <= end; ++i)
+    {
+        const Entry &entry = m_entries.at(i);
+        AVPacket *packet = av_packet_alloc();
+        if (!packet || av_packet_ref(packet, entry.packet) < 0)
+        {
+            av_packet_free(&packet);
+            break;
+        }
+
+        packet->stream_index = entry.isVideo ? 0 : 1;
+        result.d->packets.append(packet);
+        result.d->times.append(entry.time);
+    }
+
+    return result;
+}
+
+void RtspStreamPacketRing::clear()
+{
+    foreach (Entry entry, m_entries)
+        av_packet_free(&entry.packet);
+
+    s_memoryUsed.fetchAndAddRelaxed(-m_bytes);
+    m_entries.clear();
+    m_keyFrames.clear();
+    m_bytes = 0;
+}
+
+/* Drops the oldest group of pictures, along with the audio that came with it */
+void RtspStreamPacketRing::dropOldest()
+{
+    m_keyFrames.dequeue();
+
+    do
+    {
+        Entry entry = m_entries.takeFirst();
+        m_bytes -= entry.packet->size;
+        s_memoryUsed.fetchAndAddRelaxed(-entry.packet->size);
+        av_packet_free(&entry.packet);
+    } while (!m_entries.isEmpty() && !(m_entries.first().isVideo && (m_entries.first().packet->flags & AV_PKT_FLAG_KEY)));
+}
+
+void RtspStreamPacketRing::trim()
+{
+    while (m_keyFrames.size() > 1 && m_endTime - m_keyFrames.at(1) >= m_length)
+        dropOldest();
+
+    while (s_memoryUsed.load() > s_memoryLimit.load() && !m_entries.isEmpty())
+    {
+        if (m_keyFrames.size() > 1)
+            dropOldest();
+        else
+        {
+            clear();
+            m_awaitingKeyFrame = true;
+        }
+    }
+}
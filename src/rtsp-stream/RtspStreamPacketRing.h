@@ -0,0 +1,152 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_PACKET_RING_H
+#define RTSP_STREAM_PACKET_RING_H
+
+#include <QAtomicInteger>
+#include <QList>
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+extern "C" {
+#   include "libavutil/rational.h"
+}
+
+struct AVCodecParameters;
+struct AVFormatContext;
+struct AVPacket;
+
+/* Recent packets of a live stream cut out of an RtspStreamPacketRing. The clip
+ * starts on a video keyframe, so it can be decoded or remuxed on its own; video
+ * is stream 0 and audio, if any, stream 1. Copies share the packets. */
+class RtspStreamPacketClip
+{
+public:
+    RtspStreamPacketClip();
+
+    bool isEmpty() const { return !d || d->packets.isEmpty(); }
+
+    const AVCodecParameters * videoParameters() const { return d ? d->video : 0; }
+    AVRational videoTimeBase() const;
+    int packetCount() const { return d ? d->packets.size() : 0; }
+    const AVPacket * packet(int i) const { return d->packets.at(i); }
+    /* Microseconds, on the ring's clock */
+    qint64 packetTime(int i) const { return d->times.at(i); }
+    qint64 startTime() const;
+    qint64 endTime() const;
+
+    /* Remuxes the clip into a Matroska file, without decoding it */
+    bool writeMatroska(const QString &fileName, QString *errorMessage = 0) const;
+
+private:
+    friend class RtspStreamPacketRing;
+
+    struct Data
+    {
+        Data();
+        ~Data();
+
+        AVCodecParameters *video;
+        AVCodecParameters *audio;
+        AVRational videoTimeBase;
+        AVRational audioTimeBase;
+        QList<AVPacket *> packets;
+        QVector<qint64> times;
+    };
+
+    QSharedPointer<Data> d;
+};
+
+/* The last few seconds of one connection of a live stream, as compressed
+ * packets, for replaying and exporting them locally.
+ *
+ * The reading thread appends every packet it reads; the packets share their
+ * buffers with whatever decodes them. The ring always starts on a video keyframe
+ * and drops whole groups of pictures from its front once the rest still covers
+ * the length it was asked to keep. All rings together stay within a memory limit;
+ * a ring that finds it exceeded drops its own oldest video first, and if that is
+ * all it has, starts over from the next keyframe.
+ *
+ * Times are in microseconds on the video stream's clock. Clips can be taken from
+ * any thread. */
+class RtspStreamPacketRing
+{
+    Q_DISABLE_COPY(RtspStreamPacketRing)
+
+public:
+    /* Bytes of packets all rings may hold together */
+    static void setMemoryLimit(qint64 bytes);
+    static qint64 memoryLimit();
+    static qint64 memoryUsed();
+
+    /* length in microseconds */
+    explicit RtspStreamPacketRing(qint64 length);
+    ~RtspStreamPacketRing();
+
+    qint64 length() const { return m_length; }
+
+    /* Reading thread; setStreams() empties the ring */
+    void setStreams(const AVFormatContext *context, int videoStreamIndex, int audioStreamIndex);
+    void append(const AVPacket *packet);
+    /* Packets were missed, so video can only go on from a keyframe */
+    void interrupt();
+
+    /* Times of the first and the last video packet held; equal while empty */
+    qint64 startTime() const;
+    qint64 endTime() const;
+    qint64 bytes() const;
+    /* From the last keyframe at or before start through end */
+    RtspStreamPacketClip clip(qint64 start, qint64 end) const;
+
+private:
+    struct Entry
+    {
+        AVPacket *packet;
+        qint64 time;
+        bool isVideo;
+    };
+
+    static QAtomicInteger<qint64> s_memoryLimit;
+    static QAtomicInteger<qint64> s_memoryUsed;
+
+    const qint64 m_length;
+    mutable QMutex m_mutex;
+    AVCodecParameters *m_video;
+    AVCodecParameters *m_audio;
+    AVRational m_videoTimeBase;
+    AVRational m_audioTimeBase;
+    int m_videoStreamIndex;
+    int m_audioStreamIndex;
+
+    QList<Entry> m_entries;
+    /* Times of the keyframes in m_entries, oldest first */
+    QQueue<qint64> m_keyFrames;
+    qint64 m_endTime;
+    qint64 m_bytes;
+    bool m_awaitingKeyFrame;
+
+    /* Calling these requires m_mutex */
+    void clear();
+    void dropOldest();
+    void trim();
+};
+
+#endif // RTSP_STREAM_PACKET_RING_H
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamParameters.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSettings>
+#include <QUrl>
+#include <cstring>
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/mem.h"
+}
+
+static const int formatVersion = 1;
+
+QString RtspStreamParameters::cacheKey(const QUrl &url)
+{
+    /* Settings keys can't hold a URL, and credentials have no place there */
+    QByteArray urlData = url.toString(QUrl::RemoveUserInfo).toUtf8();
+    return QString::fromLatin1(QCryptographicHash::hash(urlData, QCryptographicHash::Sha1).toHex());
+}
+
+RtspStreamParameters RtspStreamParameters::load(const QString &key)
+{
+    QSettings settings;
+    return fromByteArray(settings.value(QLatin1String("rtspStreamParameters/") + key).toByteArray());
+}
+
+void RtspStreamParameters::remove(const QString &key)
+{
+    QSettings settings;
+    settings.remove(QLatin1String("rtspStreamParameters/") + key);
+}
+
+void RtspStreamParameters::save(const QString &key) const
+{
+    QSettings settings;
+    settings.setValue(QLatin1String("rtspStreamParameters/") + key, toByteArray());
+}
+
+RtspStreamParameters RtspStreamParameters::fromContext(const AVFormatContext *context)
+{
+    RtspStreamParameters result;
+    for (unsigned int i = 0; i < context->nb_streams; ++i)
+        result.m_streams.append(fromCodecParameters(context->streams[i]->codecpar));
+    return result;
+}
+
+RtspStreamParameters::Stream RtspStreamParameters::fromCodecParameters(const AVCodecParameters *parameters)
+{
+    Stream stream;
+    stream.codecType = parameters->codec_type;
+    stream.codecId = parameters->codec_id;
+    stream.codecTag = parameters->codec_tag;
+    stream.format = parameters->format;
+    stream.profile = parameters->profile;
+    stream.level = parameters->level;
+    stream.width = parameters->width;
+    stream.height = parameters->height;
+    stream.sampleAspectNum = parameters->sample_aspect_ratio.num;
+    stream.sampleAspectDen = parameters->sample_aspect_ratio.den;
+    stream.fieldOrder = parameters->field_order;
+    stream.colorRange = parameters->color_range;
+    stream.sampleRate = parameters->sample_rate;
+    stream.channels = parameters->channels;
+    stream.channelLayout = parameters->channel_layout;
+    stream.frameSize = parameters->frame_size;
+    stream.blockAlign = parameters->block_align;
+    stream.bitsPerCodedSample = parameters->bits_per_coded_sample;
+    if (parameters->extradata_size > 0)
+        stream.extradata = QByteArray((const char *)parameters->extradata, parameters->extradata_size);
+    return stream;
+}
+
+bool RtspStreamParameters::matches(const AVFormatContext *context) const
+{
+    if (isEmpty() || int(context->nb_streams) != m_streams.size())
+        return false;
+
+    for (int i = 0; i < m_streams.size(); ++i)
+    {
+        const Stream &stream = m_streams.at(i);
+        const AVCodecParameters *parameters = context->streams[i]->codecpar;
+
+        if (parameters->codec_type != stream.codecType || parameters->codec_id != stream.codecId)
+            return false;
+
+        /* Unprobed, whatever is known came from the session description */
+        if (parameters->extradata_size > 0 &&
+                QByteArray::fromRawData((const char *)parameters->extradata, parameters->extradata_size) != stream.extradata)
+            return false;
+
+        if (parameters->width > 0 && (parameters->width != stream.width || parameters->height != stream.height))
+            return false;
+
+        if (parameters->sample_rate > 0 && parameters->sample_rate != stream.sampleRate)
+            return false;
+
+        if (stream.codecType == AVMEDIA_TYPE_VIDEO && (stream.format < 0 || stream.width <= 0 || stream.height <= 0))
+            return false;
+    }
+
+    return true;
+}
+
+bool RtspStreamParameters::apply(AVFormatContext *context) const
+{
+    if (int(context->nb_streams) != m_streams.size())
+        return false;
+
+    for (int i = 0; i < m_streams.size(); ++i)
+    {
+        if (!applyTo(m_streams.at(i), context->streams[i]->codecpar))
+            return false;
+    }
+
+    return true;
+}
+
+bool RtspStreamParameters::applyTo(const Stream &stream, AVCodecParameters *parameters)
+{
+    parameters->codec_tag = stream.codecTag;
+    parameters->format = stream.format;
+    parameters->profile = stream.profile;
+    parameters->level = stream.level;
+    parameters->width = stream.width;
+    parameters->height = stream.height;
+    parameters->sample_aspect_ratio.num = stream.sampleAspectNum;
+    parameters->sample_aspect_ratio.den = stream.sampleAspectDen;
+    parameters->field_order = (AVFieldOrder)stream.fieldOrder;
+    parameters->color_range = (AVColorRange)stream.colorRange;
+    parameters->sample_rate = stream.sampleRate;
+    parameters->channels = stream.channels;
+    parameters->channel_layout = stream.channelLayout;
+    parameters->frame_size = stream.frameSize;
+    parameters->block_align = stream.blockAlign;
+    parameters->bits_per_coded_sample = stream.bitsPerCodedSample;
+
+    if (parameters->extradata_size > 0 || stream.extradata.isEmpty())
+        return true;
+
+    parameters->extradata = (uint8_t *)av_mallocz(stream.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!parameters->extradata)
+        return false;
+
+    memcpy(parameters->extradata, stream.extradata.constData(), stream.extradata.size());
+    parameters->extradata_size = stream.extradata.size();
+    return true;
+}
+
+QByteArray RtspStreamParameters::toByteArray() const
+{
+    QByteArray result;
+    QDataStream data(&result, QIODevice::WriteOnly);
+    data.setVersion(QDataStream::Qt_4_5);
+
+    data << formatVersion << m_streams.size();
+    foreach (const Stream &stream, m_streams)
+    {
+        data << stream.codecType << stream.codecId << stream.codecTag << stream.format
+             << stream.profile << stream.level << stream.width << stream.height
+             << stream.sampleAspectNum << stream.sampleAspectDen << stream.fieldOrder << stream.colorRange
+             << stream.sampleRate << stream.channels << stream.channelLayout
+             << stream.frameSize << stream.blockAlign << stream.bitsPerCodedSample
+             << stream.extradata;
+    }
+
+    return result;
+}
+
+RtspStreamParameters RtspStreamParameters::fromByteArray(const QByteArray &buffer)
+{
+    RtspStreamParameters result;
+    if (buffer.isEmpty())
+        return result;
+
+    QDataStream data(buffer);
+    data.setVersion(QDataStream::Qt_4_5);
+
+    int version = 0, streamCount = 0;
+    data >> version >> streamCount;
+    if (data.status() != QDataStream::Ok || version != formatVersion || streamCount <= 0)
+        return result;
+
+    for (int i = 0; i < streamCount; ++i)
+    {
+        Stream stream;
+        data >> stream.codecType >> stream.codecId >> stream.codecTag >> stream.format
+             >> stream.profile >> stream.level >> stream.width >> stream.height
+             >> stream.sampleAspectNum >> stream.sampleAspectDen >> stream.fieldOrder >> stream.colorRange
+             >> stream.sampleRate >> stream.channels >> stream.channelLayout
+             >> stream.frameSize >> stream.blockAlign >> stream.bitsPerCodedSample
+             >> stream.extradata;
+
+        if (data.status() != QDataStream::Ok)
+            return RtspStreamParameters();
+
+        result.m_streams.append(stream);
+    }
+
+    return result;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_PARAMETERS_H
+#define RTSP_STREAM_PARAMETERS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class QUrl;
+struct AVCodecParameters;
+struct AVFormatContext;
+
+/* Codec parameters of every stream of an RTSP session, as avformat_find_stream_info
+ * found them, kept in the settings per stream URL.
+ *
+ * avformat_find_stream_info reads and decodes packets until it knows each
+ * stream's size and pixel format, which is most of the time it takes a camera
+ * to connect. A camera's streams rarely change, so the next connection fills
+ * the parameters in from here instead, as long as what the server announces
+ * in its session description still agrees with them. */
+class RtspStreamParameters
+{
+public:
+    static QString cacheKey(const QUrl &url);
+    static RtspStreamParameters load(const QString &key);
+    static void remove(const QString &key);
+    static RtspStreamParameters fromContext(const AVFormatContext *context);
+    static RtspStreamParameters fromByteArray(const QByteArray &data);
+
+    bool isEmpty() const { return m_streams.isEmpty(); }
+    int streamCount() const { return m_streams.size(); }
+
+    /* The context's streams, as opened but not probed, could be these */
+    bool matches(const AVFormatContext *context) const;
+    bool apply(AVFormatContext *context) const;
+
+    void save(const QString &key) const;
+    QByteArray toByteArray() const;
+
+private:
+    struct Stream
+    {
+        int codecType;
+        int codecId;
+        quint32 codecTag;
+        int format;
+        int profile;
+        int level;
+        int width;
+        int height;
+        int sampleAspectNum;
+        int sampleAspectDen;
+        int fieldOrder;
+        int colorRange;
+        int sampleRate;
+        int channels;
+        quint64 channelLayout;
+        int frameSize;
+        int blockAlign;
+        int bitsPerCodedSample;
+        QByteArray extradata;
+    };
+
+    QList<Stream> m_streams;
+
+    static Stream fromCodecParameters(const AVCodecParameters *parameters);
+    static bool applyTo(const Stream &stream, AVCodecParameters *parameters);
+
+};
+
+#endif // RTSP_STREAM_PARAMETERS_H
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamPauseState.h"
+
+RtspStreamPauseState::RtspStreamPauseState()
+    : m_userPaused(false), m_suspended(false)
+{
+}
+
+bool RtspStreamPauseState::setUserPaused(bool paused)
+{
+    bool wasPaused = isWorkerPaused();
+    m_userPaused = paused;
+    return isWorkerPaused() != wasPaused;
+}
+
+bool RtspStreamPauseState::setSuspended(bool suspended)
+{
+    bool wasPaused = isWorkerPaused();
+    m_suspended = suspended;
+    return isWorkerPaused() != wasPaused;
+}
+
+void RtspStreamPauseState::reset()
+{
+    m_userPaused = false;
+    m_suspended = false;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_PAUSE_STATE_H
+#define RTSP_STREAM_PAUSE_STATE_H
+
+/* Why the worker of an RTSP stream is paused. The user can pause a stream, and
+ * the stream can be suspended because nobody can see it or to relieve the
+ * system. Either can be set or lifted while the other holds, so they are kept
+ * apart: the worker is paused while either holds and resumes only once both are
+ * lifted. */
+class RtspStreamPauseState
+{
+public:
+    RtspStreamPauseState();
+
+    bool isUserPaused() const { return m_userPaused; }
+    bool isSuspended() const { return m_suspended; }
+    bool isWorkerPaused() const { return m_userPaused || m_suspended; }
+
+    /* Both return true when the worker has to be paused or resumed */
+    bool setUserPaused(bool paused);
+    bool setSuspended(bool suspended);
+
+    /* A new connection starts out running */
+    void reset();
+
+private:
+    bool m_userPaused;
+    bool m_suspended;
+
+};
+
+#endif // RTSP_STREAM_PAUSE_STATE_H
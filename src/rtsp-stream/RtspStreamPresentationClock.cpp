@@ -0,0 +1,105 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamPresentationClock.h"
+#include <QElapsedTimer>
+
+extern "C" {
+#   include "libavutil/avutil.h"
+}
+
+/* A transit delay this far off means the stream jumped (restart, pts wrap) */
+static const qint64 resyncThreshold = 1000000;
+/* Never hold frames back longer than this to absorb jitter */
+static const qint64 maxPlayoutDelay = 200000;
+/* Fraction of a slower transit delay taken over per frame */
+static const int transitDriftDivisor = 128;
+
+RtspStreamPresentationClock::RtspStreamPresentationClock()
+    : m_publishedJitter(0), m_publishedPlayoutDelay(0)
+{
+    reset();
+}
+
+static QElapsedTimer startedTimer()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+
+qint64 RtspStreamPresentationClock::currentTime()
+{
+    static const QElapsedTimer timer = startedTimer();
+    return timer.nsecsElapsed() / 1000;
+}
+
+void RtspStreamPresentationClock::reset()
+{
+    m_synced = false;
+    m_transitDelay = 0;
+    m_lastPts = 0;
+    m_lastArrivalTime = 0;
+    m_lastPresentationTime = 0;
+    m_jitter = 0;
+    m_publishedJitter.store(0);
+    m_publishedPlayoutDelay.store(0);
+}
+
+void RtspStreamPresentationClock::resync(qint64 pts, qint64 arrivalTime)
+{
+    m_synced = true;
+    m_transitDelay = arrivalTime - pts;
+    m_jitter = 0;
+}
+
+qint64 RtspStreamPresentationClock::presentationTime(qint64 pts, qint64 arrivalTime)
+{
+    if (pts == (qint64)AV_NOPTS_VALUE)
+        return arrivalTime;
+
+    qint64 transitDelay = arrivalTime - pts;
+
+    if (!m_synced || qAbs(transitDelay - m_transitDelay) > resyncThreshold || pts < m_lastPts)
+    {
+        resync(pts, arrivalTime);
+    }
+    else
+    {
+        /* D(i-1,i) from RFC 3550, smoothed by 1/16 */
+        qint64 difference = (arrivalTime - m_lastArrivalTime) - (pts - m_lastPts);
+        m_jitter += (qAbs(difference) - m_jitter) / 16;
+
+        if (transitDelay < m_transitDelay)
+            m_transitDelay = transitDelay;
+        else
+            m_transitDelay += (transitDelay - m_transitDelay) / transitDriftDivisor;
+    }
+
+    m_lastPts = pts;
+    m_lastArrivalTime = arrivalTime;
+
+    qint64 playoutDelay = qMin(2 * m_jitter, maxPlayoutDelay);
+    m_publishedJitter.store(int(m_jitter));
+    m_publishedPlayoutDelay.store(int(playoutDelay));
+
+    /* Keep presentation order even while the playout delay shrinks */
+    qint64 presentationTime = qMax(pts + m_transitDelay + playoutDelay, m_lastPresentationTime);
+    m_lastPresentationTime = presentationTime;
+
+    return presentationTime;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_PRESENTATION_CLOCK_H
+#define RTSP_STREAM_PRESENTATION_CLOCK_H
+
+#include <QAtomicInt>
+#include <QtGlobal>
+
+/* Maps stream timestamps to local monotonic time, so that frames are shown at the
+ * pace the camera captured them rather than whenever they happen to arrive.
+ *
+ * The clock follows the smallest observed transit delay (arrival time minus pts),
+ * slowly letting it grow to follow a camera clock that runs slower than ours, and
+ * resyncs on discontinuities. Interarrival jitter is estimated as in RFC 3550 and
+ * frames are held back by a playout delay derived from it, so jitter is absorbed
+ * here instead of reaching the screen.
+ *
+ * All times are in microseconds. presentationTime() and reset() belong to the
+ * thread producing frames; jitter() and playoutDelay() may be read from anywhere. */
+class RtspStreamPresentationClock
+{
+    Q_DISABLE_COPY(RtspStreamPresentationClock)
+
+public:
+    RtspStreamPresentationClock();
+
+    static qint64 currentTime();
+
+    void reset();
+    qint64 presentationTime(qint64 pts, qint64 arrivalTime);
+
+    int jitter() const { return m_publishedJitter.load(); }
+    int playoutDelay() const { return m_publishedPlayoutDelay.load(); }
+
+private:
+    bool m_synced;
+    qint64 m_transitDelay;
+    qint64 m_lastPts;
+    qint64 m_lastArrivalTime;
+    qint64 m_lastPresentationTime;
+    qint64 m_jitter;
+    QAtomicInt m_publishedJitter;
+    QAtomicInt m_publishedPlayoutDelay;
+
+    void resync(qint64 pts, qint64 arrivalTime);
+
+};
+
+#endif // RTSP_STREAM_PRESENTATION_CLOCK_H
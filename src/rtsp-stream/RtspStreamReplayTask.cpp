@@ -0,0 +1,141 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamReplayTask.h"
+#include "RtspStreamFrameScaler.h"
+#include <QDebug>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/mathematics.h>
+#include <libswscale/swscale.h>
+}
+
+RtspStreamReplayTask::RtspStreamReplayTask(QObject *caller, const char *callback, quint64 id)
+    : ThreadTask(caller, callback), taskId(id), m_position(0)
+{
+}
+
+void RtspStreamReplayTask::runTask()
+{
+    if (isCancelled())
+        return;
+
+    if (!m_exportFileName.isEmpty())
+        m_clip.writeMatroska(m_exportFileName, &m_errorMessage);
+    else if (!m_clip.isEmpty())
+        decode();
+
+    /* Let go of the packets here rather than whenever the result is picked up */
+    m_clip = RtspStreamPacketClip();
+}
+
+void RtspStreamReplayTask::decode()
+{
+    const AVCodecParameters *parameters = m_clip.videoParameters();
+    AVCodec *codec = avcodec_find_decoder(parameters->codec_id);
+    if (!codec)
+        return;
+
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    AVFrame *picture = av_frame_alloc();
+    if (!avctx || !frame || !picture || avcodec_parameters_to_context(avctx, parameters) < 0)
+        goto done;
+
+    /* One group of pictures at most, as fast as possible */
+    avctx->thread_count = 0;
+    if (avcodec_open2(avctx, codec, NULL) < 0)
+        goto done;
+
+    {
+        AVRational microseconds = { 1, 1000000 };
+        bool reached = false;
+
+        for (int i = 0; i <= m_clip.packetCount() && !reached; ++i)
+        {
+            if (isCancelled())
+                goto done;
+
+            /* Past the last packet, whatever the decoder still holds */
+            const AVPacket *packet = i < m_clip.packetCount() ? m_clip.packet(i) : 0;
+            if (packet && packet->stream_index != 0)
+                continue;
+
+            int ret = avcodec_send_packet(avctx, packet);
+            if (ret < 0 && ret != AVERROR(EAGAIN))
+                continue;
+
+            while (!reached && avcodec_receive_frame(avctx, frame) == 0)
+            {
+                qint64 time = frame->best_effort_timestamp;
+                if (time != (qint64)AV_NOPTS_VALUE)
+                    time = av_rescale_q(time, m_clip.videoTimeBase(), microseconds);
+
+                if (picture->buf[0] && time != (qint64)AV_NOPTS_VALUE && time > m_position)
+                {
+                    reached = true;
+                    break;
+                }
+
+                av_frame_unref(picture);
+                av_frame_move_ref(picture, frame);
+            }
+        }
+    }
+
+    if (picture->buf[0])
+        m_result = toImage(picture);
+
+done:
+    av_frame_free(&frame);
+    av_frame_free(&picture);
+    avcodec_free_context(&avctx);
+}
+
+QImage RtspStreamReplayTask::toImage(const AVFrame *frame) const
+{
+    QImage image(frame->width, frame->height, QImage::Format_RGB32);
+    if (image.isNull())
+        return image;
+
+    AVPixelFormat format = (AVPixelFormat)frame->format;
+    if (RtspStreamFrameScaler::isSupported(format))
+    {
+        RtspStreamFrameScaler scaler;
+        scaler.scale(frame->data, frame->linesize, format, frame->width, frame->height,
+                     image.bits(), image.bytesPerLine(), image.width(), image.height());
+        return image;
+    }
+
+    SwsContext *context = sws_getContext(frame->width, frame->height, format,
+                                         image.width(), image.height(), AV_PIX_FMT_BGRA,
+                                         SWS_FAST_BILINEAR, NULL, NULL, NULL);
+    if (!context)
+    {
+        qDebug() << "RtspStreamReplayTask: cannot convert pixel format" << format;
+        return QImage();
+    }
+
+    uint8_t *data[1] = { image.bits() };
+    int linesize[1] = { image.bytesPerLine() };
+    sws_scale(context, frame->data, frame->linesize, 0, frame->height, data, linesize);
+    sws_freeContext(context);
+
+    return image;
+}
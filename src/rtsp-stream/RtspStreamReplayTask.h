@@ -0,0 +1,63 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_REPLAY_TASK_H
+#define RTSP_STREAM_REPLAY_TASK_H
+
+#include "RtspStreamPacketRing.h"
+#include "utils/ThreadTask.h"
+#include <QImage>
+#include <QString>
+
+struct AVFrame;
+
+/* Works on a clip of recent packets away from the stream's own decoder: either
+ * decodes the picture at one position, with a decoder of its own, or remuxes
+ * the clip into a file. */
+class RtspStreamReplayTask : public ThreadTask
+{
+public:
+    const quint64 taskId;
+
+    RtspStreamReplayTask(QObject *caller, const char *callback, quint64 taskId = 0);
+
+    void setClip(const RtspStreamPacketClip &clip) { m_clip = clip; }
+    /* Decode the last picture at or before position, in the clip's microseconds */
+    void setPosition(qint64 position) { m_position = position; }
+    /* Write the clip to fileName instead */
+    void setExportFileName(const QString &fileName) { m_exportFileName = fileName; }
+
+    qint64 position() const { return m_position; }
+    QString exportFileName() const { return m_exportFileName; }
+    QImage result() const { return m_result; }
+    QString errorMessage() const { return m_errorMessage; }
+
+protected:
+    virtual void runTask();
+
+private:
+    RtspStreamPacketClip m_clip;
+    qint64 m_position;
+    QString m_exportFileName;
+    QImage m_result;
+    QString m_errorMessage;
+
+    void decode();
+    QImage toImage(const AVFrame *frame) const;
+};
+
+#endif // RTSP_STREAM_REPLAY_TASK_H
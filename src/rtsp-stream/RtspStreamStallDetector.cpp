@@ -0,0 +1,81 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamStallDetector.h"
+#include <algorithm>
+
+/* Assumed until the stream shows its own pace */
+static const qint64 defaultInterval = 250000;
+static const int missedIntervals = 4;
+/* Bursty arrival can make the learned interval look shorter than it is */
+static const qint64 minStallTime = 400000;
+static const qint64 maxStallTime = 5000000;
+static const int recoveryFactor = 4;
+static const qint64 minRecoveryTime = 2000000;
+
+RtspStreamStallDetector::RtspStreamStallDetector()
+    : m_lastArrival(-1), m_interval(defaultInterval), m_learned(false), m_gapCount(0)
+{
+}
+
+void RtspStreamStallDetector::reset()
+{
+    m_lastArrival = -1;
+}
+
+void RtspStreamStallDetector::packetArrived(qint64 now)
+{
+    if (m_lastArrival >= 0)
+        learnGap(now - m_lastArrival);
+
+    m_lastArrival = now;
+}
+
+void RtspStreamStallDetector::learnGap(qint64 gap)
+{
+    if (!m_learned)
+    {
+        if (m_gapCount >= IgnoredGaps)
+            m_learningGaps[m_gapCount - IgnoredGaps] = gap;
+        if (++m_gapCount < IgnoredGaps + LearningGaps)
+            return;
+
+        std::nth_element(m_learningGaps, m_learningGaps + LearningGaps / 2, m_learningGaps + LearningGaps);
+        m_interval = m_learningGaps[LearningGaps / 2];
+        m_learned = true;
+        return;
+    }
+
+    qint64 stall = stallTime();
+    if (gap <= stall)
+        m_interval += (gap - m_interval) / 8;
+    else
+        m_interval += (qMin(gap, 2 * stall) - m_interval) / 16;
+}
+
+qint64 RtspStreamStallDetector::stallTime() const
+{
+    if (!m_learned)
+        return maxStallTime;
+
+    return qBound(minStallTime, m_interval * missedIntervals, maxStallTime);
+}
+
+qint64 RtspStreamStallDetector::recoveryTime() const
+{
+    return qMax(minRecoveryTime, stallTime() * recoveryFactor);
+}
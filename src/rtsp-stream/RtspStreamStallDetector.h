@@ -0,0 +1,72 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_STALL_DETECTOR_H
+#define RTSP_STREAM_STALL_DETECTOR_H
+
+#include <QtGlobal>
+
+/* Notices a stream that stopped sending video long before any network timeout
+ * would. It learns how often video packets normally arrive, as a moving average
+ * of the gaps between them, and considers the stream stalled after a few of
+ * those intervals pass without one. A stall that goes on for several times as
+ * long is worth reconnecting over.
+ *
+ * The first gaps of a stream often come in a burst of what the server had
+ * buffered, so the first few are ignored and the median of the next few is the
+ * first estimate; until then only a long silence counts as a stall. Gaps long
+ * enough to count as stalls pull the estimate up slowly, so a stream slower
+ * than it first looked stops showing as stalled without a single outage moving
+ * it much. Times are in microseconds from RtspStreamPresentationClock; the
+ * detector belongs to the thread reading the stream, and costs a subtraction or
+ * two per packet. */
+class RtspStreamStallDetector
+{
+public:
+    RtspStreamStallDetector();
+
+    /* Forget the last packet, such as after pausing; the interval is kept */
+    void reset();
+    void packetArrived(qint64 now);
+
+    /* Nothing is a stall before the first packet */
+    bool isActive() const { return m_lastArrival >= 0; }
+    qint64 frameInterval() const { return m_interval; }
+    qint64 stallTime() const;
+    qint64 recoveryTime() const;
+
+    bool isStalled(qint64 now) const { return isActive() && now - m_lastArrival > stallTime(); }
+    bool needsRecovery(qint64 now) const { return isActive() && now - m_lastArrival > recoveryTime(); }
+
+private:
+    enum
+    {
+        IgnoredGaps = 3,
+        LearningGaps = 5
+    };
+
+    qint64 m_lastArrival;
+    qint64 m_interval;
+    bool m_learned;
+    int m_gapCount;
+    qint64 m_learningGaps[LearningGaps];
+
+    void learnGap(qint64 gap);
+
+};
+
+#endif // RTSP_STREAM_STALL_DETECTOR_H
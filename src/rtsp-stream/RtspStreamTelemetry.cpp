@@ -0,0 +1,106 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtspStreamTelemetry.h"
+#include "RtspStreamPresentationClock.h"
+
+RtspStreamTelemetry::RtspStreamTelemetry(const QSharedPointer<TransferRateCalculator::Counter> &transfer)
+    : m_startTime(RtspStreamPresentationClock::currentTime()), m_transfer(transfer), m_readDrops(0),
+      m_decodeDrops(0), m_formatDrops(0), m_presentDrops(0)
+{
+    if (!m_transfer)
+        m_transfer = QSharedPointer<TransferRateCalculator::Counter>(new TransferRateCalculator::Counter);
+}
+
+void RtspStreamTelemetry::increment(QAtomicInteger<int> &counter)
+{
+    /* Single writer; see the class comment */
+    counter.store(counter.load() + 1);
+}
+
+void RtspStreamTelemetry::packetRead(qint64 duration, int bytes)
+{
+    m_read.record(duration);
+    m_transfer->add(bytes);
+}
+
+void RtspStreamTelemetry::packetDropped()
+{
+    increment(m_readDrops);
+}
+
+void RtspStreamTelemetry::frameDecoded(qint64 duration)
+{
+    m_decode.record(duration);
+}
+
+void RtspStreamTelemetry::decodeFailed()
+{
+    increment(m_decodeDrops);
+}
+
+void RtspStreamTelemetry::packetsSkipped(int count)
+{
+    m_decodeDrops.store(m_decodeDrops.load() + count);
+}
+
+void RtspStreamTelemetry::frameFormatted(qint64 duration)
+{
+    m_format.record(duration);
+}
+
+void RtspStreamTelemetry::formatFailed()
+{
+    increment(m_formatDrops);
+}
+
+void RtspStreamTelemetry::frameShown(qint64 queuedTime, qint64 presentationTime, qint64 now)
+{
+    m_queue.record(now - queuedTime);
+    m_present.record(now - presentationTime);
+}
+
+void RtspStreamTelemetry::frameSkipped()
+{
+    increment(m_presentDrops);
+}
+
+LiveStreamTelemetry RtspStreamTelemetry::snapshot(int queueDrops) const
+{
+    LiveStreamTelemetry result;
+    result.setValid(true);
+
+    result.setLatency(LiveStreamTelemetry::ReadStage, m_read.summary());
+    result.setLatency(LiveStreamTelemetry::DecodeStage, m_decode.summary());
+    result.setLatency(LiveStreamTelemetry::FormatStage, m_format.summary());
+    result.setLatency(LiveStreamTelemetry::QueueStage, m_queue.summary());
+    result.setLatency(LiveStreamTelemetry::PresentStage, m_present.summary());
+
+    result.setDrops(LiveStreamTelemetry::ReadStage, m_readDrops.load());
+    result.setDrops(LiveStreamTelemetry::DecodeStage, m_decodeDrops.load());
+    result.setDrops(LiveStreamTelemetry::FormatStage, m_formatDrops.load());
+    result.setDrops(LiveStreamTelemetry::QueueStage, queueDrops);
+    result.setDrops(LiveStreamTelemetry::PresentStage, m_presentDrops.load());
+
+    qint64 bytes = m_transfer->bytes();
+    qint64 elapsed = RtspStreamPresentationClock::currentTime() - m_startTime;
+    result.setBytesReceived(bytes);
+    if (elapsed > 0)
+        result.setBitrate(bytes * 8 * 1000000 / elapsed);
+
+    return result;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTSP_STREAM_TELEMETRY_H
+#define RTSP_STREAM_TELEMETRY_H
+
+#include "core/LiveStreamTelemetry.h"
+#include "core/TransferRateCalculator.h"
+#include "utils/LatencyHistogram.h"
+#include <QAtomicInteger>
+#include <QSharedPointer>
+
+/* Collects LiveStreamTelemetry for one connection of an RtspStream.
+ *
+ * Every stage is written by one thread only: reading by the worker's thread,
+ * decoding and formatting by whichever thread runs the stream's decode task
+ * (never two at once), queueing and presenting by the GUI thread. So each
+ * stage's storage has a single writer and nothing here takes a lock or does an
+ * atomic read-modify-write on the frame path. snapshot() can be taken from any
+ * thread. */
+class RtspStreamTelemetry
+{
+    Q_DISABLE_COPY(RtspStreamTelemetry)
+
+public:
+    /* Bytes read are also counted into transfer, if given */
+    explicit RtspStreamTelemetry(const QSharedPointer<TransferRateCalculator::Counter> &transfer =
+            QSharedPointer<TransferRateCalculator::Counter>());
+
+    /* Reading thread */
+    void packetRead(qint64 duration, int bytes);
+    void packetDropped();
+
+    /* Decoding thread */
+    void frameDecoded(qint64 duration);
+    void decodeFailed();
+    void packetsSkipped(int count);
+    void frameFormatted(qint64 duration);
+    void formatFailed();
+
+    /* GUI thread; times from RtspStreamPresentationClock */
+    void frameShown(qint64 queuedTime, qint64 presentationTime, qint64 now);
+    void frameSkipped();
+
+    /* Drops of the frame queue are counted by the queue itself */
+    LiveStreamTelemetry snapshot(int queueDrops) const;
+    qint64 bytesReceived() const { return m_transfer->bytes(); }
+    const TransferRateCalculator::Counter * transferCounter() const { return m_transfer.data(); }
+
+private:
+    qint64 m_startTime;
+
+    LatencyHistogram m_read;
+    QSharedPointer<TransferRateCalculator::Counter> m_transfer;
+    QAtomicInteger<int> m_readDrops;
+
+    LatencyHistogram m_decode;
+    QAtomicInteger<int> m_decodeDrops;
+    LatencyHistogram m_format;
+    QAtomicInteger<int> m_formatDrops;
+
+    LatencyHistogram m_queue;
+    LatencyHistogram m_present;
+    QAtomicInteger<int> m_presentDrops;
+
+    static void increment(QAtomicInteger<int> &counter);
+
+};
+
+#endif // RTSP_STREAM_TELEMETRY_H
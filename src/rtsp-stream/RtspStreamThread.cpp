@@ -16,16 +16,18 @@
  */
 
 #include "RtspStreamThread.h"
+#include "RtspStreamDecodePolicy.h"
 #include "RtspStreamWorker.h"
+#include "RtspStreamFrame.h"
 #include "RtspStreamFrameQueue.h"
-#include "core/BluecherryApp.h"
 #include "core/LoggableUrl.h"
 #include <QDebug>
 #include <QThread>
 #include <QUrl>
 
 RtspStreamThread::RtspStreamThread(QObject *parent) :
-        QObject(parent), m_workerMutex(QMutex::Recursive), m_isRunning(false)
+        QObject(parent), m_workerMutex(QMutex::Recursive), m_isRunning(false),
+        m_lowLatency(false), m_minimumDecodeLevel(RtspStreamDecodePolicy::FullDecode)
 {
 }
 
@@ -41,7 +43,7 @@ void RtspStreamThread::clearWorker()
     m_worker.clear();
 }
 
-void RtspStreamThread::start(const QUrl &url, bool hwaccelerated)
+void RtspStreamThread::start(const QUrl &url, bool hwaccelerated, DecodePool *decodePool)
 {
     QMutexLocker locker(&m_workerMutex);
 
@@ -58,18 +60,24 @@ void RtspStreamThread::start(const QUrl &url, bool hwaccelerated)
         worker->moveToThread(m_thread.data());
 
         m_worker.data()->setUrl(url);
+        m_worker.data()->setDecodePool(decodePool);
+        m_worker.data()->setLowLatency(m_lowLatency);
+        m_worker.data()->setMinimumDecodeLevel(m_minimumDecodeLevel);
+        if (m_telemetry)
+            m_worker.data()->setTelemetry(m_telemetry);
+        m_worker.data()->setPacketRing(m_packetRing);
 
         connect(m_thread.data(), SIGNAL(started()), m_worker.data(), SLOT(run()));
         connect(m_thread.data(), SIGNAL(finished()), m_thread.data(), SLOT(deleteLater()));
         connect(m_worker.data(), SIGNAL(fatalError(QString)), this, SIGNAL(fatalError(QString)));
         connect(m_worker.data(), SIGNAL(hwAccelDisabled()), this, SIGNAL(hwAccelDisabled()));
+        connect(m_worker.data(), SIGNAL(framesQueued()), this, SIGNAL(framesQueued()));
+        connect(m_worker.data(), SIGNAL(stalled(bool)), this, SIGNAL(stalled(bool)));
         connect(m_worker.data(), SIGNAL(destroyed()), this, SLOT(clearWorker()), Qt::DirectConnection);
         connect(m_worker.data(), SIGNAL(destroyed()), m_thread.data(), SLOT(quit()));
         connect(m_worker.data(), SIGNAL(audioFormat(enum AVSampleFormat, int, int)), this, SIGNAL(audioFormat(enum AVSampleFormat,int,int)), Qt::DirectConnection);
         connect(m_worker.data(), SIGNAL(audioSamplesAvailable(void *, int, int)), this, SIGNAL(audioSamplesAvailable(void*,int,int)), Qt::DirectConnection);
 
-        connect(m_worker.data(), SIGNAL(bytesDownloaded(uint)), bcApp->globalRate, SLOT(addSampleValue(uint)));
-
         m_thread.data()->start();
     }
     else
@@ -86,12 +94,12 @@ void RtspStreamThread::enableAudio(bool enabled)
         m_worker.data()->enableAudio(enabled);
 }
 
-void RtspStreamThread::setFrameSizeHint(int width, int height)
+void RtspStreamThread::setFrameSizeHints(const QList<QSize> &sizeHints)
 {
     QMutexLocker locker(&m_workerMutex);
 
     if (hasWorker())
-        m_worker.data()->setFrameSizeHint(width, height);
+        m_worker.data()->setFrameSizeHints(sizeHints);
 }
 
 void RtspStreamThread::stop()
@@ -140,6 +148,34 @@ void RtspStreamThread::setAutoDeinterlacing(bool autoDeinterlacing)
         m_worker.data()->setAutoDeinterlacing(autoDeinterlacing);
 }
 
+void RtspStreamThread::setLowLatency(bool lowLatency)
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    m_lowLatency = lowLatency;
+    if (hasWorker())
+        m_worker.data()->setLowLatency(lowLatency);
+}
+
+void RtspStreamThread::setMinimumDecodeLevel(int level)
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    m_minimumDecodeLevel = level;
+    if (hasWorker())
+        m_worker.data()->setMinimumDecodeLevel(level);
+}
+
+RtspStreamFrame * RtspStreamThread::newestFrameToDisplay()
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    if (m_frameQueue)
+        return m_frameQueue->dequeueNewest();
+    else
+        return 0;
+}
+
 RtspStreamFrame * RtspStreamThread::frameToDisplay()
 {
     QMutexLocker locker(&m_workerMutex);
@@ -149,3 +185,42 @@ RtspStreamFrame * RtspStreamThread::frameToDisplay()
     else
         return 0;
 }
+
+void RtspStreamThread::recycleFrame(RtspStreamFrame *frame)
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    if (m_frameQueue)
+        m_frameQueue->recycle(frame);
+    else
+        delete frame;
+}
+
+int RtspStreamThread::frameQueueDepth()
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    return m_frameQueue ? m_frameQueue->depth() : 0;
+}
+
+int RtspStreamThread::droppedFrames()
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    return m_frameQueue ? m_frameQueue->droppedFrames() : 0;
+}
+
+int RtspStreamThread::presentationJitter()
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    return m_frameQueue ? m_frameQueue->jitter() : 0;
+}
+
+void RtspStreamThread::clearFramesQueued()
+{
+    QMutexLocker locker(&m_workerMutex);
+
+    if (m_frameQueue)
+        m_frameQueue->clearWakeUp();
+}
@@ -18,16 +18,21 @@
 #ifndef RTSP_STREAM_THREAD_H
 #define RTSP_STREAM_THREAD_H
 
+#include <QList>
 #include <QMutex>
 #include <QObject>
 #include <QWeakPointer>
 #include <QSharedPointer>
 #include "audio/AudioPlayer.h"
 
+class DecodePool;
 class RtspStreamFrame;
 class RtspStreamWorker;
 class RtspStreamFrameQueue;
+class RtspStreamPacketRing;
+class RtspStreamTelemetry;
 class QThread;
+class QSize;
 class QUrl;
 
 class RtspStreamThread : public QObject
@@ -38,7 +43,11 @@ public:
     explicit RtspStreamThread(QObject *parent = 0);
     virtual ~RtspStreamThread();
 
-    void start(const QUrl &url, bool hwaccelerated);
+    /* Given to the worker on start */
+    void setTelemetry(const QSharedPointer<RtspStreamTelemetry> &telemetry) { m_telemetry = telemetry; }
+    void setPacketRing(const QSharedPointer<RtspStreamPacketRing> &packetRing) { m_packetRing = packetRing; }
+    /* Without a decode pool, the stream is decoded on its own reading thread */
+    void start(const QUrl &url, bool hwaccelerated, DecodePool *decodePool = 0);
     void stop();
     void setPaused(bool paused);
 
@@ -47,8 +56,16 @@ public:
     void enableAudio(bool enabled);
 
     void setAutoDeinterlacing(bool autoDeinterlacing);
+    void setLowLatency(bool lowLatency);
+    void setMinimumDecodeLevel(int level);
     RtspStreamFrame * frameToDisplay();
-    void setFrameSizeHint(int width, int height);
+    RtspStreamFrame * newestFrameToDisplay();
+    void recycleFrame(RtspStreamFrame *frame);
+    int frameQueueDepth();
+    int droppedFrames();
+    int presentationJitter();
+    void clearFramesQueued();
+    void setFrameSizeHints(const QList<QSize> &sizeHints);
 
 signals:
     void fatalError(const QString &error);
@@ -56,13 +73,19 @@ signals:
     void audioFormat(enum AVSampleFormat fmt, int channelsNum, int sampleRate);
     void audioSamplesAvailable(void *data, int samplesNum, int bytesNum);
     void hwAccelDisabled();
+    void framesQueued();
+    void stalled(bool stalled);
 
 private:
     QWeakPointer<QThread> m_thread;
     QWeakPointer<RtspStreamWorker> m_worker;
     QSharedPointer<RtspStreamFrameQueue> m_frameQueue;
+    QSharedPointer<RtspStreamTelemetry> m_telemetry;
+    QSharedPointer<RtspStreamPacketRing> m_packetRing;
     QMutex m_workerMutex;
     bool m_isRunning;
+    bool m_lowLatency;
+    int m_minimumDecodeLevel;
 
 private slots:
     void clearWorker();
@@ -19,6 +19,10 @@
 #include "RtspStreamFrame.h"
 #include "RtspStreamFrameFormatter.h"
 #include "RtspStreamFrameQueue.h"
+#include "RtspStreamPacketRing.h"
+#include "RtspStreamParameters.h"
+#include "RtspStreamPresentationClock.h"
+#include "RtspStreamTelemetry.h"
 #include "core/BluecherryApp.h"
 #include <QDebug>
 #include <QCoreApplication>
@@ -35,6 +39,16 @@ extern "C"
 #define ASSERT_WORKER_THREAD() Q_ASSERT(QThread::currentThread() == thread())
 
 static const int maxDecodeErrors = 3;
+/* Recoveries without a frame decoded in between before giving up on the session */
+static const int maxDecodeRecoveries = 3;
+/* Longer than the keyframe interval of any sensible live stream */
+static const qint64 keyFrameRecoveryTimeout = 4000;
+/* About two seconds of video; beyond that decoding is not keeping up anyway */
+static const int maxQueuedPackets = 64;
+/* Packets decoded in one turn on the decode pool before other streams go first */
+static const int decodeBatchSize = 4;
+/* Packets waiting for decoding before a low latency stream skips ahead */
+static const int maxLowLatencyBacklog = 4;
 
 int rtspStreamInterruptCallback(void *opaque)
 {
@@ -44,25 +58,34 @@ int rtspStreamInterruptCallback(void *opaque)
 
 RtspStreamWorker::RtspStreamWorker(QSharedPointer<RtspStreamFrameQueue> &shared_queue, bool hwaccelerated, QObject *parent)
     : QObject(parent), m_ctx(0),
-      m_videoCodecCtx(0), m_audioCodecCtx(0),
-      m_frame(0), m_decodeErrorsCnt(0),
+      m_videoCodecCtx(0), m_audioCodecCtx(0), m_videoParameters(0),
+      m_frame(0), m_decodeErrorsCnt(0), m_decodeRecoveries(0), m_awaitingKeyFrame(false), m_decodeAborted(false),
       m_videoStreamIndex(-1), m_audioStreamIndex(-1),
       m_audioEnabled(false),
-      m_hwaccelEnabled(hwaccelerated),
-      m_frameWidthHint(-1), m_frameHeightHint(-1),
+      m_hwaccelEnabled(hwaccelerated), m_lowLatency(0), m_minimumDecodeLevel(RtspStreamDecodePolicy::FullDecode), m_decoderLowLatency(false),
+      m_usingCachedParameters(false), m_parametersVerified(false),
+      m_decodedFormat(-1), m_decodedParametersChanged(0),
+      m_stalled(false), m_stallInterrupted(false),
+      m_frameSizeHintsChanged(0),
+      m_decodePool(0), m_packetQueue(maxQueuedPackets), m_decodeFailed(0), m_skipToKeyFrame(false),
       m_cancelFlag(false), m_autoDeinterlacing(true),
-      m_frameQueue(new RtspStreamFrameQueue(6))
+      m_frameQueue(new RtspStreamFrameQueue(6)), m_telemetry(new RtspStreamTelemetry)
 {
     shared_queue = m_frameQueue;
 }
 
 RtspStreamWorker::~RtspStreamWorker()
 {
+    avcodec_parameters_free(&m_videoParameters);
+
     if (!m_ctx)
         return;
 
     av_frame_free(&m_frame);
 
+    if (m_videoCodecCtx)
+        RtspStreamDecodeThreading::removeLiveStream();
+
     avcodec_close(m_videoCodecCtx);
     avcodec_close(m_audioCodecCtx);
 
@@ -85,15 +108,45 @@ void RtspStreamWorker::setAutoDeinterlacing(bool autoDeinterlacing)
         m_frameFormatter->setAutoDeinterlacing(autoDeinterlacing);
 }
 
-bool RtspStreamWorker::shouldInterrupt() const
+void RtspStreamWorker::setLowLatency(bool lowLatency)
+{
+    m_lowLatency.store(lowLatency ? 1 : 0);
+}
+
+void RtspStreamWorker::setMinimumDecodeLevel(int level)
+{
+    m_minimumDecodeLevel.store(level);
+}
+
+bool RtspStreamWorker::shouldInterrupt()
 {
     if (m_cancelFlag)
         return true;
 
-    if (m_timeout < QDateTime::currentDateTime())
+    qint64 now = RtspStreamPresentationClock::currentTime();
+    if (m_timeout < now)
         return true;
 
-    return false;
+    return m_stallDetector.isActive() && checkStall(now);
+}
+
+/* Returns true when the stall has lasted long enough to give up on the session */
+bool RtspStreamWorker::checkStall(qint64 now)
+{
+    bool isStalled = m_stallDetector.isStalled(now);
+    if (isStalled != m_stalled)
+    {
+        m_stalled = isStalled;
+        if (isStalled)
+            qDebug() << "RtspStreamWorker: no video for" << m_stallDetector.stallTime() / 1000 << "ms, stalled";
+        emit stalled(isStalled);
+    }
+
+    if (!m_stallDetector.needsRecovery(now))
+        return false;
+
+    m_stallInterrupted = true;
+    return true;
 }
 
 void RtspStreamWorker::run()
@@ -107,6 +160,12 @@ void RtspStreamWorker::run()
     if (setup())
         processStreamLoop();
 
+    if (m_decodePool)
+    {
+        m_decodePool->cancel(this);
+        clearPacketQueue();
+    }
+
     deleteLater();
 }
 
@@ -128,11 +187,115 @@ bool RtspStreamWorker::processStream()
     if (!ok)
         return false;
 
+    if (m_decodedParametersChanged.testAndSetAcquire(1, 0))
+        saveDecodedParameters();
+
+    if (m_packetRing)
+        m_packetRing->append(&packet);
+
+    if (m_skipToKeyFrame && packet.stream_index == m_videoStreamIndex)
+    {
+        if (!(packet.flags & AV_PKT_FLAG_KEY))
+        {
+            m_telemetry->packetDropped();
+            av_packet_unref(&packet);
+            return true;
+        }
+        m_skipToKeyFrame = false;
+    }
+
+    if (m_decodePool)
+        return queuePacket(packet);
+
     bool result = processPacket(packet);
     av_packet_unref(&packet);
     return result;
 }
 
+bool RtspStreamWorker::queuePacket(AVPacket &packet)
+{
+    if (m_decodeFailed.loadAcquire())
+    {
+        av_packet_unref(&packet);
+        return false;
+    }
+
+    bool isVideo = packet.stream_index == m_videoStreamIndex;
+    AVPacket *queuedPacket = av_packet_alloc();
+    av_packet_move_ref(queuedPacket, &packet);
+
+    if (!m_packetQueue.push(queuedPacket))
+    {
+        /* Later packets refer to this one, so video can only go on from a keyframe */
+        av_packet_free(&queuedPacket);
+        m_telemetry->packetDropped();
+        if (isVideo)
+            m_skipToKeyFrame = true;
+    }
+
+    m_decodePool->schedule(this);
+    return true;
+}
+
+bool RtspStreamWorker::runDecodeTask()
+{
+    if (m_lowLatency.load() && m_packetQueue.size() > maxLowLatencyBacklog)
+        return decodeFromLatestKeyFrame();
+
+    for (int i = 0; i < decodeBatchSize; ++i)
+    {
+        AVPacket *packet = m_packetQueue.pop();
+        if (!packet)
+            return false;
+
+        if (!m_decodeFailed.loadAcquire() && !processPacket(*packet))
+            m_decodeFailed.storeRelease(1);
+        av_packet_free(&packet);
+    }
+
+    return !m_packetQueue.isEmpty();
+}
+
+void RtspStreamWorker::clearPacketQueue()
+{
+    AVPacket *packet;
+    while ((packet = m_packetQueue.pop()))
+        av_packet_free(&packet);
+}
+
+/* Everything queued is late already. Whatever comes before the newest keyframe
+ * among it would only delay the picture further, so the decoder starts over
+ * from there; without a keyframe the backlog is decoded as usual. */
+bool RtspStreamWorker::decodeFromLatestKeyFrame()
+{
+    QList<AVPacket *> backlog;
+    int keyFrame = 0;
+
+    AVPacket *packet;
+    while ((packet = m_packetQueue.pop()))
+    {
+        if (packet->stream_index == m_videoStreamIndex && (packet->flags & AV_PKT_FLAG_KEY))
+            keyFrame = backlog.size();
+        backlog.append(packet);
+    }
+
+    if (keyFrame > 0)
+    {
+        avcodec_flush_buffers(m_videoCodecCtx);
+        m_telemetry->packetsSkipped(keyFrame);
+    }
+
+    for (int i = 0; i < backlog.size(); ++i)
+    {
+        packet = backlog.at(i);
+        if (i >= keyFrame && !m_decodeFailed.loadAcquire() && !processPacket(*packet))
+            m_decodeFailed.storeRelease(1);
+        av_packet_free(&packet);
+    }
+
+    return !m_packetQueue.isEmpty();
+}
+
 AVPacket RtspStreamWorker::readPacket(bool *ok)
 {
     if (ok)
@@ -140,11 +303,25 @@ AVPacket RtspStreamWorker::readPacket(bool *ok)
 
     AVPacket packet;
     startInterruptableOperation(30);
+    qint64 readStart = RtspStreamPresentationClock::currentTime();
     int re = av_read_frame(m_ctx, &packet);
     if (0 == re)
-        return packet;
+    {
+        qint64 now = RtspStreamPresentationClock::currentTime();
+        m_telemetry->packetRead(now - readStart, packet.size);
+        if (packet.stream_index == m_videoStreamIndex)
+            m_stallDetector.packetArrived(now);
+
+        /* Audio alone would keep reading from ever blocking, so check here too */
+        if (!m_stallDetector.isActive() || !checkStall(now))
+            return packet;
+    }
 
-    emit fatalError(QString::fromLatin1("Reading error: %1").arg(errorMessageFromCode(re)));
+    if (m_stallInterrupted)
+        emit fatalError(QString::fromLatin1("Stream stalled: no video for %1 seconds")
+                        .arg(m_stallDetector.recoveryTime() / 1000000));
+    else
+        emit fatalError(QString::fromLatin1("Reading error: %1").arg(errorMessageFromCode(re)));
     av_packet_unref(&packet);
 
     if (ok)
@@ -154,8 +331,6 @@ AVPacket RtspStreamWorker::readPacket(bool *ok)
 
 bool RtspStreamWorker::processPacket(struct AVPacket packet)
 {
-    emit bytesDownloaded(packet.size);
-
     while (packet.size > 0)
     {
         if (packet.stream_index == m_audioStreamIndex)
@@ -179,12 +354,19 @@ bool RtspStreamWorker::processPacket(struct AVPacket packet)
 
         if (packet.stream_index == m_videoStreamIndex)
         {
-            AVFrame *frame = extractVideoFrame(packet);
+            if (m_awaitingKeyFrame && !skipUntilKeyFrame(packet))
+                return !m_decodeAborted;
 
+            updateDecodePolicy(packet);
+            qint64 decodeStart = RtspStreamPresentationClock::currentTime();
+            AVFrame *frame = extractVideoFrame(packet);
             if (frame)
+            {
+                m_telemetry->frameDecoded(RtspStreamPresentationClock::currentTime() - decodeStart);
                 processVideoFrame(frame);
+            }
 
-            if (m_decodeErrorsCnt >= maxDecodeErrors)
+            if (m_decodeAborted)
                 return false;
 
             break; //always expect single frame in video packets
@@ -199,8 +381,6 @@ bool RtspStreamWorker::processPacket(struct AVPacket packet)
 
 AVFrame * RtspStreamWorker::extractAudioFrame(AVPacket &packet)
 {
-    startInterruptableOperation(5);
-
     int ret = avcodec_send_packet(m_audioCodecCtx, &packet);
 
     if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
@@ -219,8 +399,6 @@ AVFrame * RtspStreamWorker::extractAudioFrame(AVPacket &packet)
 
 AVFrame * RtspStreamWorker::extractVideoFrame(AVPacket &packet)
 {
-    startInterruptableOperation(5);
-
     int ret = avcodec_send_packet(m_videoCodecCtx, &packet);
 
     if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
@@ -257,24 +435,109 @@ AVFrame * RtspStreamWorker::extractVideoFrame(AVPacket &packet)
 #endif
     }
     m_decodeErrorsCnt = 0; //reset error counter if extracting frame was successful
+    m_decodeRecoveries = 0;
 
     return m_frame;
 
 fail:
 
     m_decodeErrorsCnt++;
+    m_telemetry->decodeFailed();
 
     if (m_decodeErrorsCnt >= maxDecodeErrors)
-        emit fatalError(QString::fromLatin1("Decoding error: %1").arg(errorMessageFromCode(ret)));
+        recoverFromDecodeErrors(ret);
 
     return 0;
 }
 
+void RtspStreamWorker::recoverFromDecodeErrors(int errorCode)
+{
+    m_decodeErrorsCnt = 0;
+    if (++m_decodeRecoveries > maxDecodeRecoveries)
+    {
+        abortDecoding(QString::fromLatin1("Decoding error: %1").arg(errorMessageFromCode(errorCode)));
+        return;
+    }
+
+    /* Likely a damaged group of pictures; whatever refers to it is useless too */
+    qDebug() << "RtspStreamWorker: decoding error" << errorMessageFromCode(errorCode)
+             << "- waiting for a keyframe to start over";
+    avcodec_flush_buffers(m_videoCodecCtx);
+    m_awaitingKeyFrame = true;
+    m_recoveryTimer.start();
+}
+
+/* Returns false while the packet should be dropped */
+bool RtspStreamWorker::skipUntilKeyFrame(const AVPacket &packet)
+{
+    if (packet.flags & AV_PKT_FLAG_KEY)
+    {
+        qDebug() << "RtspStreamWorker: recovered from decoding errors after" << m_recoveryTimer.elapsed() << "ms";
+        m_awaitingKeyFrame = false;
+        return true;
+    }
+
+    m_telemetry->packetsSkipped(1);
+    if (m_recoveryTimer.elapsed() > keyFrameRecoveryTimeout)
+        abortDecoding(QString::fromLatin1("Decoding error: no keyframe to recover from"));
+
+    return false;
+}
+
+void RtspStreamWorker::abortDecoding(const QString &message)
+{
+    m_decodeAborted = true;
+    m_awaitingKeyFrame = false;
+    if (m_usingCachedParameters)
+        RtspStreamParameters::remove(m_parametersKey);
+    emit fatalError(message);
+}
+
+void RtspStreamWorker::updateDecodePolicy(const AVPacket &packet)
+{
+    if (m_frameSizeHintsChanged.fetchAndStoreAcquire(0))
+    {
+        QMutexLocker locker(&m_frameSizeHintsMutex);
+        m_activeFrameSizeHints = m_frameSizeHints;
+    }
+
+    if (packet.flags & AV_PKT_FLAG_KEY)
+        updateDecoder();
+
+    m_decodePolicy.setMinimumLevel(RtspStreamDecodePolicy::Level(m_minimumDecodeLevel.load()));
+    m_decodePolicy.update(m_activeFrameSizeHints, QSize(m_videoCodecCtx->width, m_videoCodecCtx->height));
+    m_decodePolicy.apply(m_videoCodecCtx, packet.flags & AV_PKT_FLAG_KEY);
+}
+
 void RtspStreamWorker::processVideoFrame(struct AVFrame *rawFrame)
 {
     Q_ASSERT(m_frameFormatter);
-    startInterruptableOperation(5);
-    m_frameQueue->enqueue(m_frameFormatter->formatFrame(rawFrame, m_frameWidthHint, m_frameHeightHint));
+
+    qint64 pts = rawFrame->best_effort_timestamp;
+    if (pts != (qint64)AV_NOPTS_VALUE)
+    {
+        AVRational microseconds = { 1, 1000000 };
+        pts = av_rescale_q(pts, m_videoTimeBase, microseconds);
+    }
+
+    if (!m_decodePolicy.acceptFrame(pts))
+        return;
+
+    if (!m_parametersVerified)
+        verifyCachedParameters(rawFrame);
+
+    RtspStreamFrame *frame = m_frameQueue->takeFreeFrame();
+    qint64 formatStart = RtspStreamPresentationClock::currentTime();
+    if (!m_frameFormatter->formatFrame(rawFrame, m_activeFrameSizeHints, frame))
+    {
+        m_telemetry->formatFailed();
+        delete frame;
+        return;
+    }
+
+    m_telemetry->frameFormatted(RtspStreamPresentationClock::currentTime() - formatStart);
+    if (m_frameQueue->enqueue(frame, pts))
+        emit framesQueued();
 }
 
 QString RtspStreamWorker::errorMessageFromCode(int errorCode)
@@ -288,6 +551,7 @@ bool RtspStreamWorker::setup()
 {
     ASSERT_WORKER_THREAD();
 
+    m_connectTimer.start();
     m_ctx = avformat_alloc_context();
     m_ctx->interrupt_callback.callback = rtspStreamInterruptCallback;
     m_ctx->interrupt_callback.opaque = this;
@@ -298,9 +562,16 @@ bool RtspStreamWorker::setup()
 
     if (prepared)
     {
-        m_frameFormatter.reset(new RtspStreamFrameFormatter(m_ctx->streams[m_videoStreamIndex]));
+        AVStream *videoStream = m_ctx->streams[m_videoStreamIndex];
+        m_videoParameters = avcodec_parameters_alloc();
+        avcodec_parameters_copy(m_videoParameters, videoStream->codecpar);
+        m_videoTimeBase = videoStream->time_base;
+
+        m_frameFormatter.reset(new RtspStreamFrameFormatter(m_videoParameters, m_videoTimeBase));
         m_frameFormatter->setAutoDeinterlacing(m_autoDeinterlacing);
         m_frame = av_frame_alloc();
+        if (m_packetRing)
+            m_packetRing->setStreams(m_ctx, m_videoStreamIndex, m_audioStreamIndex);
     }
     else if (m_ctx)
     {
@@ -316,22 +587,102 @@ bool RtspStreamWorker::prepareStream(AVFormatContext **context, AVDictionary *op
     if (!openInput(context, options))
         return false;
 
-    if (!findStreamInfo(*context, options))
+    bool cached = applyCachedParameters(*context);
+    if (!cached && !findStreamInfo(*context, options))
         return false;
 
     if (!openCodecs(*context, options))
+    {
+        /* Whatever was wrong, the next attempt should probe */
+        if (cached)
+            RtspStreamParameters::remove(m_parametersKey);
+        return false;
+    }
+
+    if (!cached)
+        RtspStreamParameters::fromContext(*context).save(m_parametersKey);
+
+    qDebug() << "RtspStreamWorker: codecs opened after" << m_connectTimer.elapsed() << "ms"
+             << (cached ? "from cached stream parameters" : "probing the stream");
+    return true;
+}
+
+bool RtspStreamWorker::applyCachedParameters(AVFormatContext *context)
+{
+    m_parametersKey = RtspStreamParameters::cacheKey(m_url);
+    m_usingCachedParameters = false;
+    m_parametersVerified = true;
+
+    RtspStreamParameters parameters = RtspStreamParameters::load(m_parametersKey);
+    if (parameters.isEmpty())
         return false;
 
+    /* Streams are only filled in from the session description so far, and
+     * applying what agrees with it changes nothing a probe would look at */
+    if (!parameters.matches(context) || !parameters.apply(context))
+    {
+        qDebug() << "RtspStreamWorker: cached stream parameters don't match, probing";
+        return false;
+    }
+
+    m_usingCachedParameters = true;
+    m_parametersVerified = false;
     return true;
 }
 
+void RtspStreamWorker::verifyCachedParameters(const AVFrame *frame)
+{
+    m_parametersVerified = true;
+
+    AVCodecParameters *parameters = m_videoParameters;
+    bool sizeMatches = frame->width == parameters->width && frame->height == parameters->height;
+    /* Hardware decoded frames come back in the transfer format */
+    bool formatMatches = m_hwaccelEnabled || frame->format == parameters->format;
+    if (sizeMatches && formatMatches)
+        return;
+
+    /* What a probe would have found, now that the decoder has seen the stream */
+    qDebug() << "RtspStreamWorker: stream changed from cached parameters, now"
+             << frame->width << "x" << frame->height << "format" << frame->format;
+    parameters->width = frame->width;
+    parameters->height = frame->height;
+    if (!m_hwaccelEnabled)
+        parameters->format = frame->format;
+
+    m_frameFormatter->updateStreamParameters();
+
+    /* This may run on the decode pool; the format context belongs to the reading thread */
+    m_decodedSize = QSize(frame->width, frame->height);
+    m_decodedFormat = parameters->format;
+    m_decodedParametersChanged.storeRelease(1);
+}
+
+void RtspStreamWorker::saveDecodedParameters()
+{
+    AVCodecParameters *parameters = m_ctx->streams[m_videoStreamIndex]->codecpar;
+    parameters->width = m_decodedSize.width();
+    parameters->height = m_decodedSize.height();
+    parameters->format = m_decodedFormat;
+
+    RtspStreamParameters::fromContext(m_ctx).save(m_parametersKey);
+}
+
 AVDictionary * RtspStreamWorker::createOptions() const
 {
     AVDictionary *options = 0;
 
     av_dict_set(&options, "threads", "1", 0);
     //av_dict_set(&options, "allowed_media_types", "-audio-data", 0);
-    av_dict_set(&options, "max_delay", QByteArray::number(qint64(0.3*AV_TIME_BASE)).constData(), 0);
+    if (m_lowLatency.load())
+    {
+        /* Over TCP packets can't be reordered anyway, so nothing waits for them */
+        av_dict_set(&options, "max_delay", "0", 0);
+        av_dict_set(&options, "fflags", "nobuffer", 0);
+        /* For the decoder; the demuxer leaves it alone */
+        av_dict_set(&options, "flags", "low_delay", 0);
+    }
+    else
+        av_dict_set(&options, "max_delay", QByteArray::number(qint64(0.3*AV_TIME_BASE)).constData(), 0);
     /* Because the server always starts streams on a keyframe, we don't need any time here.
      * If the first frame is not a keyframe, this could result in failures or corruption. */
     av_dict_set(&options, "analyzeduration", "0", 0);
@@ -412,24 +763,9 @@ bool RtspStreamWorker::openCodecs(AVFormatContext *context, AVDictionary *option
         }
 
         AVStream *stream = context->streams[i];
+        setupHwAccel(stream->codecpar, avctx);
 
-        if (m_hwaccelEnabled)
-        {
-#if defined(Q_OS_LINUX)
-            if (stream->codecpar->codec_type==AVMEDIA_TYPE_VIDEO && bcApp->vaapi->isAvailable())
-            {
-                avctx->get_format = VaapiHWAccel::get_format;
-                avctx->get_buffer2 = VaapiHWAccel::get_buffer;
-
-                //TODO: filter out low-res video streams?
-
-                qDebug() << "trying to use VAAPI acceleration for video stream decoding";
-                av_log_set_level(AV_LOG_VERBOSE);
-            }
-#endif
-        }
-
-        bool codecOpened = openCodec(stream, avctx, options);
+        bool codecOpened = openCodec(stream->codecpar, avctx, options);
         if (!codecOpened)
         {
             qDebug() << "RtspStream: cannot find decoder for stream" << i << "codec" <<
@@ -440,6 +776,8 @@ bool RtspStreamWorker::openCodecs(AVFormatContext *context, AVDictionary *option
 
         if (stream->codecpar->codec_type==AVMEDIA_TYPE_VIDEO)
         {
+            if (!m_videoCodecCtx)
+                RtspStreamDecodeThreading::addLiveStream();
             m_videoStreamIndex = i;
             m_videoCodecCtx = avctx;
         }
@@ -483,29 +821,115 @@ bool RtspStreamWorker::openCodecs(AVFormatContext *context, AVDictionary *option
     return true;
 }
 
-bool RtspStreamWorker::openCodec(AVStream *stream, AVCodecContext *avctx, AVDictionary *options)
+void RtspStreamWorker::setupHwAccel(const AVCodecParameters *parameters, AVCodecContext *avctx)
 {
-    if (avcodec_parameters_to_context(avctx, stream->codecpar) < 0)
+    if (!m_hwaccelEnabled)
+        return;
+
+#if defined(Q_OS_LINUX)
+    if (parameters->codec_type==AVMEDIA_TYPE_VIDEO && bcApp->vaapi->isAvailable())
+    {
+        avctx->get_format = VaapiHWAccel::get_format;
+        avctx->get_buffer2 = VaapiHWAccel::get_buffer;
+
+        //TODO: filter out low-res video streams?
+
+        qDebug() << "trying to use VAAPI acceleration for video stream decoding";
+        av_log_set_level(AV_LOG_VERBOSE);
+    }
+#else
+    Q_UNUSED(parameters);
+    Q_UNUSED(avctx);
+#endif
+}
+
+bool RtspStreamWorker::openCodec(const AVCodecParameters *parameters, AVCodecContext *avctx, AVDictionary *options)
+{
+    if (avcodec_parameters_to_context(avctx, parameters) < 0)
         return false;
 
     startInterruptableOperation(5);
-    AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    AVCodec *codec = avcodec_find_decoder(parameters->codec_id);
 
     if (codec == NULL)
         return false;
 
     AVDictionary *optionsCopy = 0;
     av_dict_copy(&optionsCopy, options, 0);
+
+    RtspStreamDecodeThreading threading;
+    if (parameters->codec_type == AVMEDIA_TYPE_VIDEO)
+    {
+        threading = decodeThreading(codec, avctx->width, avctx->height);
+        threading.setOptions(&optionsCopy);
+    }
+
     startInterruptableOperation(5);
     int errorCode = avcodec_open2(avctx, codec, &optionsCopy);
     av_dict_free(&optionsCopy);
 
+    if (errorCode == 0 && parameters->codec_type == AVMEDIA_TYPE_VIDEO)
+    {
+        m_decodeThreading = threading;
+        m_decoderLowLatency = avctx->flags & AV_CODEC_FLAG_LOW_DELAY;
+    }
+
     return 0 == errorCode;
 }
 
+RtspStreamDecodeThreading RtspStreamWorker::decodeThreading(const AVCodec *codec, int width, int height) const
+{
+    if (m_hwaccelEnabled)
+        return RtspStreamDecodeThreading();
+
+    /* Count this stream as well before its decoder is opened */
+    int liveStreams = RtspStreamDecodeThreading::liveStreams() + (m_videoCodecCtx ? 0 : 1);
+    return RtspStreamDecodeThreading::choose(codec->id, codec->capabilities, width, height,
+                                             liveStreams, QThread::idealThreadCount(), m_lowLatency.load());
+}
+
+void RtspStreamWorker::updateDecoder()
+{
+    const AVCodec *codec = m_videoCodecCtx->codec;
+    if (!codec)
+        return;
+
+    bool lowLatency = m_lowLatency.load();
+    if (lowLatency == m_decoderLowLatency
+            && decodeThreading(codec, m_videoCodecCtx->width, m_videoCodecCtx->height) == m_decodeThreading)
+        return;
+
+    /* Threading and low delay are fixed once a decoder is open; starting over on
+     * a keyframe loses nothing. The old decoder stays if the new one can't be
+     * opened. */
+    AVCodecContext *avctx = avcodec_alloc_context3(NULL);
+    if (!avctx)
+        return;
+
+    /* On the decode side; the demuxer may be writing the stream's own parameters */
+    setupHwAccel(m_videoParameters, avctx);
+
+    AVDictionary *options = createOptions();
+    bool opened = openCodec(m_videoParameters, avctx, options);
+    av_dict_free(&options);
+
+    if (!opened)
+    {
+        avcodec_free_context(&avctx);
+        return;
+    }
+
+    qDebug() << "RtspStreamWorker: decoding with" << m_decodeThreading.threadCount() << "threads"
+             << (m_decoderLowLatency ? "in low latency mode" : "");
+
+    avcodec_free_context(&m_videoCodecCtx);
+    m_videoCodecCtx = avctx;
+    m_decodePolicy.decoderReset();
+}
+
 void RtspStreamWorker::startInterruptableOperation(int timeoutInSeconds)
 {
-    m_timeout = QDateTime::currentDateTime().addSecs(timeoutInSeconds);
+    m_timeout = RtspStreamPresentationClock::currentTime() + qint64(timeoutInSeconds) * 1000000;
 }
 
 RtspStreamFrame * RtspStreamWorker::frameToDisplay()
@@ -516,10 +940,11 @@ RtspStreamFrame * RtspStreamWorker::frameToDisplay()
     return m_frameQueue.data()->dequeue();
 }
 
-void RtspStreamWorker::setFrameSizeHint(int width, int height)
+void RtspStreamWorker::setFrameSizeHints(const QList<QSize> &sizeHints)
 {
-    m_frameWidthHint = width;
-    m_frameHeightHint = height;
+    QMutexLocker locker(&m_frameSizeHintsMutex);
+    m_frameSizeHints = sizeHints;
+    m_frameSizeHintsChanged.storeRelease(1);
 }
 
 void RtspStreamWorker::stop()
@@ -541,4 +966,17 @@ void RtspStreamWorker::pause()
     av_read_pause(m_ctx);
     m_threadPause.pause();
     av_read_play(m_ctx);
+
+    /* Whatever follows up to the next keyframe can't be decoded properly */
+    m_skipToKeyFrame = true;
+    if (m_packetRing)
+        m_packetRing->interrupt();
+
+    /* Nothing arrived while paused, which is no stall */
+    m_stallDetector.reset();
+    if (m_stalled)
+    {
+        m_stalled = false;
+        emit stalled(false);
+    }
 }
@@ -18,22 +18,53 @@
 #ifndef RTSPSTREAMWORKER_H
 #define RTSPSTREAMWORKER_H
 
+#include "RtspStreamDecodePolicy.h"
+#include "RtspStreamDecodeThreading.h"
+#include "RtspStreamStallDetector.h"
+#include "core/DecodePool.h"
 #include "core/ThreadPause.h"
-#include <QDateTime>
+#include "utils/SpscRing.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
 #include <QObject>
+#include <QSize>
 #include <QUrl>
 #include <QSharedPointer>
 #include "audio/AudioPlayer.h"
 
+extern "C" {
+#   include "libavutil/rational.h"
+}
+
+struct AVCodecParameters;
 struct AVDictionary;
 struct AVFrame;
+struct AVPacket;
 struct AVStream;
 
 class RtspStreamFrame;
 class RtspStreamFrameFormatter;
 class RtspStreamFrameQueue;
+class RtspStreamPacketRing;
+class RtspStreamTelemetry;
 
-class RtspStreamWorker : public QObject
+/* Reads one stream and, depending on setDecodePool(), decodes it on the same
+ * thread or hands packets over to a shared decode pool. Either way reading never
+ * waits for decoding, and a stream that decodes slower than it arrives drops
+ * packets up to the next keyframe rather than falling behind.
+ *
+ * In low latency mode the decoder doesn't buffer or reorder beyond what the
+ * stream needs, and a decode backlog is cut short at its newest keyframe instead
+ * of being worked through. The decoder follows the mode on the next keyframe;
+ * the demuxer only stops buffering on the next connection, which over TCP
+ * loses little since packets can't arrive out of order.
+ *
+ * A run of decoding errors doesn't end the session: the decoder is flushed and
+ * starts over from the next keyframe. Only if none comes in time, or that keeps
+ * failing, is it a fatal error. */
+class RtspStreamWorker : public QObject, public DecodeTask
 {
     Q_OBJECT
 
@@ -42,16 +73,24 @@ public:
     virtual ~RtspStreamWorker();
 
     void setUrl(const QUrl &url);
+    void setDecodePool(DecodePool *decodePool) { m_decodePool = decodePool; }
+    void setTelemetry(const QSharedPointer<RtspStreamTelemetry> &telemetry) { m_telemetry = telemetry; }
+    /* Every packet read is kept there as well, if given */
+    void setPacketRing(const QSharedPointer<RtspStreamPacketRing> &packetRing) { m_packetRing = packetRing; }
 
     void stop();
     void setPaused(bool paused);
     void setAutoDeinterlacing(bool autoDeinterlacing);
+    /* May be called from any thread; the decoder follows on the next keyframe */
+    void setLowLatency(bool lowLatency);
+    /* An RtspStreamDecodePolicy::Level; may be called from any thread */
+    void setMinimumDecodeLevel(int level);
 
-    bool shouldInterrupt() const;
+    bool shouldInterrupt();
     RtspStreamFrame * frameToDisplay();
 
     void enableAudio(bool enabled) { m_audioEnabled = enabled; }
-    void setFrameSizeHint(int width, int height);
+    void setFrameSizeHints(const QList<QSize> &sizeHints);
 
 public slots:
     void run();
@@ -59,33 +98,81 @@ public slots:
 signals:
     void fatalError(const QString &message);
     void finished();
-    void bytesDownloaded(unsigned int bytes);
     void audioFormat(enum AVSampleFormat fmt, int channelsNum, int sampleRate);
     void audioSamplesAvailable(void *data, int samplesNum, int bytesNum);
     void hwAccelDisabled();
+    void framesQueued();
+    void stalled(bool stalled);
+
+protected:
+    virtual bool runDecodeTask();
 
 private:
     struct AVFormatContext *m_ctx;
     struct AVCodecContext *m_videoCodecCtx;
     struct AVCodecContext *m_audioCodecCtx;
+    /* The video stream's, copied on the reading thread when the stream is opened.
+     * Decoding runs on the decode pool while av_read_frame() may write to the
+     * context's streams, so it only ever looks at these. */
+    struct AVCodecParameters *m_videoParameters;
+    AVRational m_videoTimeBase;
     struct AVFrame *m_frame;
-    QDateTime m_timeout;
+    /* Deadline of the current blocking operation, in RtspStreamPresentationClock time */
+    qint64 m_timeout;
     QUrl m_url;
     bool m_cancelFlag;
     bool m_autoDeinterlacing;
-    mutable bool m_lastCancel;
-    mutable int m_lastSeconds;
     int m_decodeErrorsCnt;
+    int m_decodeRecoveries;
+    bool m_awaitingKeyFrame;
+    QElapsedTimer m_recoveryTimer;
+    bool m_decodeAborted;
     int m_videoStreamIndex;
     int m_audioStreamIndex;
     bool m_audioEnabled;
     bool m_hwaccelEnabled;
-    int m_frameWidthHint;
-    int m_frameHeightHint;
+    QAtomicInt m_lowLatency;
+    QAtomicInt m_minimumDecodeLevel;
+    bool m_decoderLowLatency;
+
+    /* Set when the codecs were opened from cached parameters instead of probing,
+     * until the first decoded frame confirms them */
+    QString m_parametersKey;
+    bool m_usingCachedParameters;
+    bool m_parametersVerified;
+    /* What the first decoded frame turned out to be, when it differs from the cache.
+     * Found on the decode side, saved by the reading thread once the flag is set. */
+    QSize m_decodedSize;
+    int m_decodedFormat;
+    QAtomicInt m_decodedParametersChanged;
+    QElapsedTimer m_connectTimer;
+
+    /* Video arrival, watched from the interrupt callback while reading blocks */
+    RtspStreamStallDetector m_stallDetector;
+    bool m_stalled;
+    bool m_stallInterrupted;
+
+    /* Written from the GUI thread; the worker only takes the lock when the flag says
+     * the hints changed */
+    QMutex m_frameSizeHintsMutex;
+    QList<QSize> m_frameSizeHints;
+    QAtomicInt m_frameSizeHintsChanged;
+    QList<QSize> m_activeFrameSizeHints;
+    RtspStreamDecodePolicy m_decodePolicy;
+    RtspStreamDecodeThreading m_decodeThreading;
+
+    /* Packets read but not decoded yet, only used with a decode pool */
+    DecodePool *m_decodePool;
+    SpscRing<AVPacket> m_packetQueue;
+    QAtomicInt m_decodeFailed;
+    /* Set on the reading side after dropping a packet or pausing */
+    bool m_skipToKeyFrame;
 
     ThreadPause m_threadPause;
     QScopedPointer<RtspStreamFrameFormatter> m_frameFormatter;
     QSharedPointer<RtspStreamFrameQueue> m_frameQueue;
+    QSharedPointer<RtspStreamTelemetry> m_telemetry;
+    QSharedPointer<RtspStreamPacketRing> m_packetRing;
 
 
     bool setup();
@@ -93,23 +180,37 @@ private:
     AVDictionary * createOptions() const;
     bool openInput(AVFormatContext **context, AVDictionary *options);
     bool findStreamInfo(AVFormatContext *context, AVDictionary *options);
+    bool applyCachedParameters(AVFormatContext *context);
+    void verifyCachedParameters(const AVFrame *frame);
+    void saveDecodedParameters();
     AVDictionary ** createStreamsOptions(AVFormatContext *context, AVDictionary *options) const;
     void destroyStreamOptions(AVFormatContext *context, AVDictionary **streamOptions);
     bool openCodecs(AVFormatContext *context, AVDictionary *options);
-    bool openCodec(AVStream *stream, AVCodecContext *avctx, AVDictionary *options);
+    void setupHwAccel(const AVCodecParameters *parameters, AVCodecContext *avctx);
+    bool openCodec(const AVCodecParameters *parameters, AVCodecContext *avctx, AVDictionary *options);
+    RtspStreamDecodeThreading decodeThreading(const AVCodec *codec, int width, int height) const;
+    void updateDecoder();
 
     void pause();
 
     void processStreamLoop();
     bool processStream();
     struct AVPacket readPacket(bool *ok = 0);
+    bool queuePacket(struct AVPacket &packet);
+    void clearPacketQueue();
+    bool decodeFromLatestKeyFrame();
     bool processPacket(struct AVPacket packet);
     AVFrame * extractVideoFrame(struct AVPacket &packet);
+    void recoverFromDecodeErrors(int errorCode);
+    bool skipUntilKeyFrame(const struct AVPacket &packet);
+    void abortDecoding(const QString &message);
     AVFrame * extractAudioFrame(struct AVPacket &packet);
+    void updateDecodePolicy(const struct AVPacket &packet);
     void processVideoFrame(struct AVFrame *frame);
 
     QString errorMessageFromCode(int errorCode);
     void startInterruptableOperation(int timeoutInSeconds);
+    bool checkStall(qint64 now);
 
 };
 
@@ -86,6 +86,12 @@ OptionsGeneralPage::OptionsGeneralPage(QWidget *parent)
     m_deinterlace->setChecked(settings.value(QLatin1String("ui/liveview/autoDeinterlace"), false).toBool());
     layout->addWidget(m_deinterlace);
 
+    m_replay = new QCheckBox(tr("Keep recent live video for instant replay"));
+    m_replay->setChecked(settings.value(QLatin1String("ui/liveview/enableReplay"), false).toBool());
+    m_replay->setToolTip(tr("The last seconds of every live feed are kept in memory, so that they "
+                            "can be replayed or exported right away"));
+    layout->addWidget(m_replay);
+
     m_updateNotifications = new QCheckBox(tr("Disable notifications about available Bluecherry client updates"));
     m_updateNotifications->setChecked(settings.value(QLatin1String("ui/disableUpdateNotifications"), false).toBool());
     layout->addWidget(m_updateNotifications);
@@ -177,6 +183,7 @@ void OptionsGeneralPage::saveChanges()
     settings.setValue(QLatin1String("ui/main/closeToTray"), m_closeToTray->isChecked());
     bcApp->mainWindow->updateTrayIcon();
     settings.setValue(QLatin1String("ui/liveview/autoDeinterlace"), m_deinterlace->isChecked());
+    settings.setValue(QLatin1String("ui/liveview/enableReplay"), m_replay->isChecked());
     settings.setValue(QLatin1String("ui/disableUpdateNotifications"), m_updateNotifications->isChecked());
     settings.setValue(QLatin1String("ui/enableThumbnails"), m_thumbnails->isChecked());
     settings.setValue(QLatin1String("ui/saveSession"), m_session->isChecked());
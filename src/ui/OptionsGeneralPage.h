@@ -40,7 +40,7 @@ private slots:
 
 private:
     QCheckBox *m_eventsPauseLive, *m_closeToTray, *m_vaapiDecodingAcceleration,
-                    *m_deinterlace, *m_updateNotifications, *m_thumbnails,
+                    *m_deinterlace, *m_replay, *m_updateNotifications, *m_thumbnails,
                     *m_session, *m_fullScreen, *m_startup /*,
                     *m_ssFullscreen, *m_ssVideo, *m_ssNever*/;
 
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServerRatesText.h"
+#include "core/BluecherryApp.h"
+#include "server/DVRServer.h"
+#include "server/DVRServerConfiguration.h"
+#include "server/DVRServerRepository.h"
+#include "utils/StringUtils.h"
+#include <QStringList>
+
+QString serverRatesText()
+{
+    QStringList lines;
+    foreach (DVRServer *server, bcApp->serverRepository()->servers())
+    {
+        quint64 rate = bcApp->globalRate->groupRate(server);
+        if (rate)
+            lines.append(QString::fromLatin1("%1: %2").arg(server->configuration().displayName(),
+                                                          byteSizeString(rate, BytesPerSecond)));
+    }
+    return lines.join(QLatin1String("\n"));
+}
@@ -16,6 +16,7 @@
  */
 
 #include "StatusBandwidthWidget.h"
+#include "ServerRatesText.h"
 #include "core/BluecherryApp.h"
 #include "core/LiveViewManager.h"
 #include "utils/StringUtils.h"
@@ -46,14 +47,15 @@ StatusBandwidthWidget::StatusBandwidthWidget(QWidget *parent)
 
     connect(this, SIGNAL(pressed()), SLOT(showMenu()));
 
-    connect(bcApp->globalRate, SIGNAL(rateUpdated(unsigned)), SLOT(rateUpdated(unsigned)));
+    connect(bcApp->globalRate, SIGNAL(rateUpdated(quint64)), SLOT(rateUpdated(quint64)));
     connect(bcApp->liveView, SIGNAL(bandwidthModeChanged(int)), SLOT(bandwidthModeChanged(int)));
     rateUpdated(bcApp->globalRate->currentRate());
 }
 
-void StatusBandwidthWidget::rateUpdated(unsigned currentRate)
+void StatusBandwidthWidget::rateUpdated(quint64 currentRate)
 {
     setText(byteSizeString(currentRate, BytesPerSecond));
+    setToolTip(serverRatesText());
 }
 
 void StatusBandwidthWidget::bandwidthModeChanged(int value)
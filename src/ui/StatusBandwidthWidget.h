@@ -32,7 +32,7 @@ public:
 
 private slots:
     void bandwidthModeChanged(int value);
-    void rateUpdated(unsigned currentRate);
+    void rateUpdated(quint64 currentRate);
 };
 
 #else /* Q_OS_MAC */
@@ -61,7 +61,7 @@ public:
 
 private slots:
     void bandwidthModeChanged(int value);
-    void rateUpdated(unsigned currentRate);
+    void rateUpdated(quint64 currentRate);
 
 private:
     NSPopUpButton *m_button;
@@ -16,6 +16,7 @@
  */
 
 #include "StatusBandwidthWidget.h"
+#include "ServerRatesText.h"
 #include "core/BluecherryApp.h"
 #include "core/LiveViewManager.h"
 #include "utils/StringUtils.h"
@@ -56,14 +57,15 @@ StatusBandwidthWidget::StatusBandwidthWidget(QWidget *parent)
     [m_button release];
     [pool release];
 
-    connect(bcApp->globalRate, SIGNAL(rateUpdated(unsigned)), SLOT(rateUpdated(unsigned)));
+    connect(bcApp->globalRate, SIGNAL(rateUpdated(quint64)), SLOT(rateUpdated(quint64)));
     connect(bcApp->liveView, SIGNAL(bandwidthModeChanged(int)), SLOT(bandwidthModeChanged(int)));
     rateUpdated(bcApp->globalRate->currentRate());
 }
 
-void StatusBandwidthWidget::rateUpdated(unsigned currentRate)
+void StatusBandwidthWidget::rateUpdated(quint64 currentRate)
 {
     m_titleAction->setText(byteSizeString(currentRate, BytesPerSecond));
+    m_titleAction->setToolTip(serverRatesText());
 
     /* Required; otherwise, Qt will add the first item back into the menu after
      * it changes. Cocoa uses this first item as the button. */
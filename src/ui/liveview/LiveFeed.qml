@@ -43,7 +43,7 @@ LiveFeedBase {
 
         PropertyChanges {
             target: statusText
-            text: statusOverlayMessage(stream.state)
+            text: statusOverlayMessage(stream.state, stream.stalled, stream.degradation)
         }
 
         PropertyChanges {
@@ -201,7 +201,14 @@ LiveFeedBase {
                     triggeredOnStart: true
                     running: false
 
-                    onTriggered: parent.text = Math.round(stream.receivedFps) + "<span style='color:#8e8e8e'>fps</span>"
+                    onTriggered: {
+                        /* How far behind live a replay is */
+                        if (stream.timeshift > 0)
+                            parent.text = "<span style='color:#ffdf6e'>-" + Math.round(stream.timeshift / 1000) + "s</span>"
+                        else
+                            parent.text = Math.round(stream.receivedFps) + "<span style='color:#8e8e8e'>fps</span> "
+                                          + Math.round(stream.receivedRate / 1024) + "<span style='color:#8e8e8e'>KB/s</span>"
+                    }
                 }
 
                 states: [
@@ -385,14 +392,17 @@ LiveFeedBase {
         visible: feedItem.activeFocus && (feedItem.parent.rows > 1 || feedItem.parent.columns > 1)
     }
 
-    function statusOverlayMessage(state) {
+    function statusOverlayMessage(state, stalled, degradation) {
         switch (state) {
             case LiveStream.Error: return "<span style='color:#ff0000'>Error<br><font size=10px>"
                                    + stream.errdesc +"</font></span>";
             case LiveStream.StreamOffline: return "<span style='color:#888888'>Offline</span>";
             case LiveStream.NotConnected: return "Disconnected";
             case LiveStream.Connecting: return "Connecting...";
-            default: return "";
+            default:
+                if (stalled)
+                    return "Stalled...";
+                return degradation === LiveStream.DecodingPaused ? "Paused to reduce load" : "";
         }
     }
 
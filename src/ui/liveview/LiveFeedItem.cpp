@@ -22,6 +22,7 @@
 #include "camera/DVRCameraStreamWriter.h"
 #include "core/BluecherryApp.h"
 #include "core/CameraPtzControl.h"
+#include "core/LiveViewGovernor.h"
 #include "core/LiveViewManager.h"
 #include "LiveViewWindow.h"
 #include "ui/MainWindow.h"
@@ -45,10 +46,16 @@
 #include <QApplication>
 #include <QDesktopWidget>
 
+/* Milliseconds one replay step moves, by menu or mouse wheel */
+static const int replayMenuStep = 10000;
+static const int replayWheelStep = 1000;
+
 LiveFeedItem::LiveFeedItem(QQuickItem *parent)
     : QQuickItem(parent), m_streamItem(0), m_serverRepository(0), m_customCursor(DefaultCursor)
 {
     setAcceptedMouseButtons(acceptedMouseButtons() | Qt::RightButton);
+
+    connect(this, SIGNAL(activeFocusChanged(bool)), SLOT(updateFocus()));
 }
 
 void LiveFeedItem::setStreamItem(LiveStreamItem *item)
@@ -92,6 +99,18 @@ void LiveFeedItem::setCamera(DVRCamera *camera)
 
     if (camera && stream())
         connect(stream(), SIGNAL(audioChanged()), SLOT(updateAudioState()));
+
+    updateFocus();
+}
+
+void LiveFeedItem::updateFocus()
+{
+    LiveViewGovernor *governor = bcApp->liveView->governor();
+
+    if (hasActiveFocus() && stream())
+        governor->setFocusedStream(stream());
+    else if (governor->focusedStream() && governor->focusedStream() == stream())
+        governor->setFocusedStream(0);
 }
 
 DVRServerRepository * LiveFeedItem::serverRepository() const
@@ -116,6 +135,7 @@ void LiveFeedItem::cameraDataUpdated()
     emit hasPtzChanged();
 
     m_streamItem->setStream(m_camera.data()->liveStream());
+    updateLowLatency();
 
     emit cameraChanged(m_camera.data());
 }
@@ -241,6 +261,70 @@ void LiveFeedItem::saveSnapshot(const QString &ifile)
     }
 }
 
+void LiveFeedItem::replayBack()
+{
+    if (stream())
+        stream()->setTimeshift(qMin(stream()->timeshift() + replayMenuStep, stream()->replayLength()));
+}
+
+void LiveFeedItem::replayForward()
+{
+    if (stream())
+        stream()->setTimeshift(stream()->timeshift() - replayMenuStep);
+}
+
+void LiveFeedItem::replayLive()
+{
+    if (stream())
+        stream()->setTimeshift(0);
+}
+
+void LiveFeedItem::exportReplay(const QString &ifile)
+{
+    if (!m_camera || !stream() || !stream()->replayLength())
+        return;
+
+    QWidget *window = scene()->views().value(0);
+
+    QString file = ifile;
+
+    if (file.isEmpty())
+    {
+        file = getSaveFileNameExt(window, tr("%1 - Export Recent Video").arg(m_camera.data()->data().displayName()),
+                           QDesktopServices::storageLocation(QDesktopServices::MoviesLocation),
+                           QLatin1String("ui/replayExportLocation"),
+                           QString::fromLatin1("%1 - %2.mkv").arg(m_camera.data()->data().displayName(),
+                                                                  QDateTime::currentDateTime().toString(
+                                                                  QLatin1String("yyyy-MM-dd hh-mm-ss"))),
+                           tr("Matroska Video (*.mkv)"));
+
+        if (file.isEmpty())
+            return;
+        if (!file.endsWith(QLatin1String(".mkv"), Qt::CaseInsensitive))
+            file.append(QLatin1String(".mkv"));
+    }
+
+    /* The stream reports every export; only ours is of interest here */
+    m_exportingReplay = file;
+    connect(stream(), SIGNAL(replayExported(QString,QString)), this, SLOT(replayExported(QString,QString)),
+            Qt::UniqueConnection);
+    stream()->exportReplay(file, stream()->replayLength());
+}
+
+void LiveFeedItem::replayExported(const QString &fileName, const QString &errorMessage)
+{
+    if (fileName != m_exportingReplay)
+        return;
+
+    m_exportingReplay.clear();
+    if (errorMessage.isEmpty() || !scene())
+        return;
+
+    QMessageBox::critical(scene()->views().value(0), tr("Export Error"),
+                          tr("An error occurred while exporting the recent video: %1").arg(errorMessage),
+                          QMessageBox::Ok);
+}
+
 /* contextMenuEvent will arrive after right clicks that were captured within QML.
  * To avoid this, we need a bit of a hack to tell when a context menu event was
  * caused by a right click, and only allow it if we saw the click (i.e. it wasn't
@@ -283,6 +367,9 @@ void LiveFeedItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
         }
     }
 
+    if (stream() && stream()->replayLength() > 0)
+        menu.addMenu(replayMenu(&menu));
+
     menu.addSeparator();
 
     QList<QAction*> bw = bandwidthActions();
@@ -429,11 +516,30 @@ void LiveFeedItem::setPtzEnabled(bool ptzEnabled)
     else
         m_ptz.clear();
 
+    updateLowLatency();
     emit ptzChanged(m_ptz.data());
 }
 
+void LiveFeedItem::updateLowLatency()
+{
+    if (stream())
+        stream()->setLowLatency(m_streamItem, !m_ptz.isNull());
+}
+
 void LiveFeedItem::wheelEvent(QGraphicsSceneWheelEvent *event)
 {
+    /* Scrubs through a replay, forward in time when scrolling up; past the
+     * newest picture is live again */
+    if (!m_ptz && stream() && stream()->timeshift() > 0)
+    {
+        event->accept();
+
+        int steps = event->delta() / 120;
+        if (steps)
+            stream()->setTimeshift(qMin(stream()->timeshift() - steps * replayWheelStep, stream()->replayLength()));
+        return;
+    }
+
     if (!m_ptz)
     {
         event->ignore();
@@ -519,6 +625,20 @@ QPoint LiveFeedItem::globalPosForItem(QQuickItem *item)
     return pos;
 }
 
+QMenu *LiveFeedItem::replayMenu(QWidget *parent)
+{
+    QMenu *menu = new QMenu(tr("Instant replay"), parent);
+    bool replaying = stream()->timeshift() > 0;
+
+    menu->addAction(tr("Back 10 seconds"), this, SLOT(replayBack()));
+    menu->addAction(tr("Forward 10 seconds"), this, SLOT(replayForward()))->setEnabled(replaying);
+    menu->addAction(tr("Back to live"), this, SLOT(replayLive()))->setEnabled(replaying);
+    menu->addSeparator();
+    menu->addAction(tr("Export recent video..."), this, SLOT(exportReplay()));
+
+    return menu;
+}
+
 void LiveFeedItem::showPtzMenu(QQuickItem *sourceItem)
 {
     QPoint pos = globalPosForItem(sourceItem);
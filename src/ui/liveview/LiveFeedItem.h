@@ -109,6 +109,11 @@ public slots:
     void openNewWindow();
     void openFullScreen();
     void saveSnapshot(const QString &file = QString());
+    /* Instant replay of the video the stream keeps locally */
+    void replayBack();
+    void replayForward();
+    void replayLive();
+    void exportReplay(const QString &file = QString());
 
     void setCustomCursor(CustomCursor cursor);
     void setPtzEnabled(bool ptzEnabled);
@@ -141,6 +146,9 @@ private slots:
     void setBandwidthModeFromAction();
     void serverRemoved(DVRServer *server);
     void updateAudioState(enum AudioState state = Load);
+    /* The governor degrades the stream the operator is looking at last */
+    void updateFocus();
+    void replayExported(const QString &fileName, const QString &errorMessage);
 
 private:
     LiveStreamItem *m_streamItem;
@@ -148,10 +156,14 @@ private:
     DVRServerRepository *m_serverRepository;
     QSharedPointer<CameraPtzControl> m_ptz;
     CustomCursor m_customCursor;
+    QString m_exportingReplay;
 
     /* Caller is responsible for deleting */
     QMenu *ptzMenu();
+    QMenu *replayMenu(QWidget *parent);
     QList<QAction*> bandwidthActions();
+    /* The stream runs in low latency mode while PTZ is in use on this feed */
+    void updateLowLatency();
 
     QPoint globalPosForItem(QQuickItem *item);
 };
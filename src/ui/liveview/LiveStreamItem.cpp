@@ -16,6 +16,7 @@
  */
 
 #include "LiveStreamItem.h"
+#include "LiveViewArea.h"
 #include "core/BluecherryApp.h"
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
@@ -41,6 +42,15 @@ LiveStreamItem::LiveStreamItem(QQuickItem *parent)
       m_texDataPtr(0)*/
 {
     this->setFlag(QGraphicsItem::ItemHasNoContents, false);
+
+    connect(this, SIGNAL(visibleChanged()), SLOT(updateVisibility()));
+    connect(this, SIGNAL(xChanged()), SLOT(updateVisibility()));
+    connect(this, SIGNAL(yChanged()), SLOT(updateVisibility()));
+    connect(this, SIGNAL(widthChanged()), SLOT(updateVisibility()));
+    connect(this, SIGNAL(heightChanged()), SLOT(updateVisibility()));
+    connect(this, SIGNAL(windowChanged(QQuickWindow*)), SLOT(updateWindow(QQuickWindow*)));
+    connect(this, SIGNAL(parentChanged(QQuickItem*)), SLOT(updateAncestors()));
+    updateAncestors();
     //updateSettings();
     //connect(bcApp, SIGNAL(settingsChanged()), SLOT(updateSettings()));
 }
@@ -48,7 +58,8 @@ LiveStreamItem::LiveStreamItem(QQuickItem *parent)
 LiveStreamItem::~LiveStreamItem()
 {
     //clearTexture();
-    m_stream.data()->unref();
+    if (m_stream)
+        m_stream.data()->unref(this);
 }
 
 /* This is odd and hackish logic to manage deletion of textures. The problem here is
@@ -99,7 +110,7 @@ void LiveStreamItem::setStream(QSharedPointer<LiveStream> stream)
     if (m_stream)
     {
         m_stream.data()->disconnect(this);
-        m_stream.data()->unref();
+        m_stream.data()->unref(this);
     }
 
     m_stream = stream;
@@ -109,11 +120,76 @@ void LiveStreamItem::setStream(QSharedPointer<LiveStream> stream)
         connect(m_stream.data(), SIGNAL(updated()), SLOT(updateFrame()));
         connect(m_stream.data(), SIGNAL(streamSizeChanged(QSize)), SLOT(updateFrameSize()));
         m_stream.data()->start();
-        m_stream.data()->ref();
+        m_stream.data()->ref(this);
     }
 
     updateFrameSize();
     updateFrame();
+    updateVisibility();
+}
+
+void LiveStreamItem::updateWindow(QQuickWindow *window)
+{
+    if (m_window)
+        m_window.data()->disconnect(this);
+
+    m_window = window;
+
+    if (m_window)
+    {
+        connect(m_window.data(), SIGNAL(widthChanged(int)), SLOT(updateVisibility()));
+        connect(m_window.data(), SIGNAL(heightChanged(int)), SLOT(updateVisibility()));
+        connect(m_window.data(), SIGNAL(visibleChanged(bool)), SLOT(updateVisibility()));
+        if (qobject_cast<LiveViewArea *>(m_window.data()))
+            connect(m_window.data(), SIGNAL(exposedChanged(bool)), SLOT(updateVisibility()));
+    }
+
+    updateVisibility();
+}
+
+/* The item's own visibleChanged() already covers its ancestors being hidden;
+ * their geometry is what moves it, as the live feed lays out again, a tile is
+ * dragged or a flickable is scrolled. */
+void LiveStreamItem::updateAncestors()
+{
+    foreach (const QPointer<QQuickItem> &ancestor, m_ancestors)
+    {
+        if (!ancestor)
+            continue;
+
+        disconnect(ancestor.data(), 0, this, SLOT(updateVisibility()));
+        disconnect(ancestor.data(), SIGNAL(parentChanged(QQuickItem*)), this, SLOT(updateAncestors()));
+    }
+
+    m_ancestors.clear();
+
+    for (QQuickItem *ancestor = parentItem(); ancestor; ancestor = ancestor->parentItem())
+    {
+        connect(ancestor, SIGNAL(xChanged()), SLOT(updateVisibility()));
+        connect(ancestor, SIGNAL(yChanged()), SLOT(updateVisibility()));
+        connect(ancestor, SIGNAL(widthChanged()), SLOT(updateVisibility()));
+        connect(ancestor, SIGNAL(heightChanged()), SLOT(updateVisibility()));
+        connect(ancestor, SIGNAL(parentChanged(QQuickItem*)), SLOT(updateAncestors()));
+        m_ancestors.append(ancestor);
+    }
+
+    updateVisibility();
+}
+
+void LiveStreamItem::updateVisibility()
+{
+    if (!m_stream)
+        return;
+
+    bool visible = isVisible() && m_window && m_window.data()->isExposed() && width() > 0 && height() > 0;
+    if (visible)
+    {
+        /* Any part of the item within the window counts */
+        QRectF area = mapRectToScene(QRectF(0, 0, width(), height()));
+        visible = area.intersects(QRectF(0, 0, m_window.data()->width(), m_window.data()->height()));
+    }
+
+    m_stream.data()->setConsumerVisible(this, visible);
 }
 
 void LiveStreamItem::clear()
@@ -134,7 +210,7 @@ void LiveStreamItem::paint(QPainter *p)
     if (!m_stream)
         return;
 
-    QImage frame = m_stream.data()->currentFrame();
+    QImage frame = m_stream.data()->scaledFrame(this);
 
     if (frame.isNull())
     {
@@ -227,7 +303,7 @@ void LiveStreamItem::paint(QPainter *p)
 
         /* In some cases opt rect width and height may be negative */
         if (opt->rect.width() > 0 && opt->rect.height() > 0)
-            m_stream.data()->setFrameSizeHint(opt->rect.width(), opt->rect.height());
+            m_stream.data()->setFrameSizeHint(this, opt->rect.width(), opt->rect.height());
     }
 
 }
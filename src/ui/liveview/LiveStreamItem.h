@@ -18,6 +18,8 @@
 #ifndef LIVESTREAMITEM_H
 #define LIVESTREAMITEM_H
 
+#include <QList>
+#include <QPointer>
 #include <QQuickItem>
 #include <QSharedPointer>
 #include "core/LiveStream.h"
@@ -55,10 +57,17 @@ private slots:
     }
 
     void updateFrameSize();
+    void updateWindow(QQuickWindow *window);
+    void updateAncestors();
+    /* Reported to the stream, which suspends itself while no one can see it */
+    void updateVisibility();
     //void updateSettings();
 
 private:
     QSharedPointer<LiveStream> m_stream;
+    QPointer<QQuickWindow> m_window;
+    /* Moving any of them moves the item in the scene without it knowing */
+    QList<QPointer<QQuickItem> > m_ancestors;
     /*bool m_useAdvancedGL;
     unsigned m_texId;
     const QGLContext *m_texLastContext;
@@ -38,7 +38,7 @@
 #include <QGraphicsItem>
 
 LiveViewArea::LiveViewArea(DVRServerRepository *serverRepository, QWindow *parent)
-    : QQuickView(parent)
+    : QQuickView(parent), m_exposed(false)
 {
     //connect(bcApp, SIGNAL(settingsChanged()), SLOT(settingsChanged()));
 
@@ -82,6 +82,17 @@ bool LiveViewArea::isHardwareAccelerated() const
     return viewport()->inherits("QGLWidget");
 }*/
 
+void LiveViewArea::exposeEvent(QExposeEvent *event)
+{
+    QQuickView::exposeEvent(event);
+
+    if (isExposed() == m_exposed)
+        return;
+
+    m_exposed = isExposed();
+    emit exposedChanged(m_exposed);
+}
+
 void LiveViewArea::showEvent(QShowEvent *event)
 {
 //    if (!event->spontaneous() && isHardwareAccelerated())
@@ -46,8 +46,11 @@ public slots:
 
 signals:
     void forwardKey(QKeyEvent *event);
+    /* Minimized, hidden, or on another desktop; see QWindow::isExposed() */
+    void exposedChanged(bool exposed);
 
 protected:
+    virtual void exposeEvent(QExposeEvent *event);
     virtual void showEvent(QShowEvent *event);
     virtual void hideEvent(QHideEvent *event);
     virtual void keyPressEvent(QKeyEvent *event);
@@ -58,6 +61,7 @@ private slots:
 private:
     LiveViewLayout *m_layout;
     mutable QSize m_sizeHint;
+    bool m_exposed;
 };
 
 #endif // LIVEVIEWAREA_H
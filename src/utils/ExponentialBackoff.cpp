@@ -0,0 +1,67 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ExponentialBackoff.h"
+#include <QtGlobal>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#else
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QThread>
+#include <QThreadStorage>
+#endif
+
+/* In [0, bound). Jitter only spreads reconnects out if every client draws
+ * different numbers, so qrand() gets a seed of its own in each thread. */
+static int randomBelow(int bound)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    return int(QRandomGenerator::global()->bounded(bound));
+#else
+    static QThreadStorage<bool> seeded;
+    if (!seeded.hasLocalData())
+    {
+        qsrand(uint(QDateTime::currentMSecsSinceEpoch()) ^ uint(QCoreApplication::applicationPid() << 16)
+               ^ uint(quintptr(QThread::currentThreadId())));
+        seeded.setLocalData(true);
+    }
+
+    return qrand() % bound;
+#endif
+}
+
+ExponentialBackoff::ExponentialBackoff(int initialDelay, int maximumDelay)
+    : m_initialDelay(qMax(initialDelay, 1)), m_maximumDelay(qMax(maximumDelay, initialDelay)), m_attempts(0)
+{
+}
+
+int ExponentialBackoff::delayLimit(int attempt) const
+{
+    qint64 delay = m_initialDelay;
+    for (int i = 0; i < attempt && delay < m_maximumDelay; ++i)
+        delay *= 2;
+
+    return int(qMin(delay, qint64(m_maximumDelay)));
+}
+
+int ExponentialBackoff::nextDelay()
+{
+    int limit = delayLimit(m_attempts++);
+    int jitter = limit / 2;
+    return limit - jitter + (jitter ? randomBelow(jitter + 1) : 0);
+}
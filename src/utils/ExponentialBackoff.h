@@ -0,0 +1,45 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXPONENTIAL_BACKOFF_H
+#define EXPONENTIAL_BACKOFF_H
+
+/* Delays between attempts at something that keeps failing, such as connecting.
+ * Each delay doubles up to the maximum, and a random half of it is taken off so
+ * that clients which failed together don't all come back at the same moment. */
+class ExponentialBackoff
+{
+public:
+    ExponentialBackoff(int initialDelay, int maximumDelay);
+
+    int attempts() const { return m_attempts; }
+
+    /* Milliseconds to wait before the next attempt */
+    int nextDelay();
+    /* After a success, start over from the initial delay */
+    void reset() { m_attempts = 0; }
+
+    /* Longest delay for an attempt, before jitter */
+    int delayLimit(int attempt) const;
+
+private:
+    int m_initialDelay;
+    int m_maximumDelay;
+    int m_attempts;
+};
+
+#endif // EXPONENTIAL_BACKOFF_H
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JpegDecoder.h"
+#include <QDebug>
+#include <QMutexLocker>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+QSize JpegDecoder::pictureSize(const char *data, int size)
+{
+    const uchar *p = (const uchar *)data;
+    const uchar *end = p + size;
+
+    if (size < 4 || p[0] != 0xff || p[1] != 0xd8)
+        return QSize();
+
+    for (p += 2; p + 4 <= end; )
+    {
+        if (p[0] != 0xff)
+            return QSize();
+
+        uchar marker = p[1];
+        /* Fill bytes, and markers without a segment */
+        if (marker == 0xff)
+        {
+            ++p;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7))
+        {
+            p += 2;
+            continue;
+        }
+
+        int length = (p[2] << 8) | p[3];
+
+        /* Any start of frame; 0xc4, 0xc8 and 0xcc are other segments */
+        if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+        {
+            if (length < 7 || p + 9 > end)
+                return QSize();
+            return QSize((p[7] << 8) | p[8], (p[5] << 8) | p[6]);
+        }
+
+        /* The frame header comes before the first scan */
+        if (marker == 0xda || length < 2)
+            return QSize();
+
+        p += 2 + length;
+    }
+
+    return QSize();
+}
+
+int JpegDecoder::scaleShift(const QSize &pictureSize, const QSize &sizeHint)
+{
+    if (!pictureSize.isValid() || !sizeHint.isValid() || sizeHint.isEmpty())
+        return 0;
+
+    int shift = 0;
+    while (shift < 3 && (pictureSize.width() >> (shift + 1)) >= sizeHint.width()
+           && (pictureSize.height() >> (shift + 1)) >= sizeHint.height())
+        ++shift;
+
+    return shift;
+}
+
+JpegDecoder::JpegDecoder()
+    : m_frame(0), m_swsContext(0), m_swsFormat(AV_PIX_FMT_NONE), m_swsWidth(0), m_swsHeight(0)
+{
+    for (int i = 0; i < 4; ++i)
+        m_contexts[i] = 0;
+}
+
+JpegDecoder::~JpegDecoder()
+{
+    for (int i = 0; i < 4; ++i)
+        avcodec_free_context(&m_contexts[i]);
+    av_frame_free(&m_frame);
+    sws_freeContext(m_swsContext);
+}
+
+AVCodecContext * JpegDecoder::context(int shift)
+{
+    if (m_contexts[shift])
+        return m_contexts[shift];
+
+    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+    if (!codec)
+        return 0;
+
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    if (!avctx)
+        return 0;
+
+    avctx->lowres = qMin(shift, (int)codec->max_lowres);
+    /* Pictures are independent and come one at a time; threads would only add delay */
+    avctx->thread_count = 1;
+
+    if (avcodec_open2(avctx, codec, NULL) < 0)
+    {
+        avcodec_free_context(&avctx);
+        return 0;
+    }
+
+    m_contexts[shift] = avctx;
+    return avctx;
+}
+
+QImage JpegDecoder::decode(const char *data, int size, const QSize &sizeHint)
+{
+    QMutexLocker locker(&m_mutex);
+
+    int shift = scaleShift(pictureSize(data, size), sizeHint);
+    AVCodecContext *avctx = context(shift);
+    if (!avctx)
+        return QImage();
+
+    if (!m_frame && !(m_frame = av_frame_alloc()))
+        return QImage();
+
+    /* The decoder copies unreferenced data into a padded buffer of its own */
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = (uint8_t *)data;
+    packet.size = size;
+
+    if (avcodec_send_packet(avctx, &packet) < 0)
+        return QImage();
+    if (avcodec_receive_frame(avctx, m_frame) < 0)
+        return QImage();
+
+    QImage result;
+    if (updateSwsContext(m_frame))
+    {
+        int index = reusableImage(m_frame->width, m_frame->height);
+        if (index >= 0)
+        {
+            /* Nobody else refers to the image, so this doesn't detach */
+            QImage &image = m_images[index];
+            uint8_t *dst[1] = { image.bits() };
+            int dstStride[1] = { image.bytesPerLine() };
+            sws_scale(m_swsContext, m_frame->data, m_frame->linesize, 0, m_frame->height, dst, dstStride);
+            result = image;
+        }
+    }
+
+    av_frame_unref(m_frame);
+    return result;
+}
+
+/* JPEG is full range; swscale wants that said rather than the deprecated formats */
+static AVPixelFormat fullRangeFormat(AVPixelFormat format, bool *fullRange)
+{
+    *fullRange = true;
+    switch (format)
+    {
+    case AV_PIX_FMT_YUVJ420P: return AV_PIX_FMT_YUV420P;
+    case AV_PIX_FMT_YUVJ422P: return AV_PIX_FMT_YUV422P;
+    case AV_PIX_FMT_YUVJ440P: return AV_PIX_FMT_YUV440P;
+    case AV_PIX_FMT_YUVJ444P: return AV_PIX_FMT_YUV444P;
+    case AV_PIX_FMT_YUVJ411P: return AV_PIX_FMT_YUV411P;
+    case AV_PIX_FMT_GRAY8: return AV_PIX_FMT_GRAY8;
+    default:
+        *fullRange = false;
+        return format;
+    }
+}
+
+bool JpegDecoder::updateSwsContext(const AVFrame *frame)
+{
+    AVPixelFormat format = (AVPixelFormat)frame->format;
+    if (m_swsContext && format == m_swsFormat && frame->width == m_swsWidth && frame->height == m_swsHeight)
+        return true;
+
+    sws_freeContext(m_swsContext);
+    m_swsFormat = format;
+    m_swsWidth = frame->width;
+    m_swsHeight = frame->height;
+
+    bool fullRange;
+    AVPixelFormat srcFormat = fullRangeFormat(format, &fullRange);
+
+    /* Same size on both sides; the tile does the rest of the scaling */
+    m_swsContext = sws_getContext(frame->width, frame->height, srcFormat,
+                                  frame->width, frame->height, AV_PIX_FMT_BGRA,
+                                  SWS_FAST_BILINEAR, NULL, NULL, NULL);
+    if (!m_swsContext)
+    {
+        qDebug() << "JpegDecoder: cannot convert pixel format" << format;
+        return false;
+    }
+
+    if (fullRange)
+    {
+        int *inverseTable, *table, srcRange, dstRange, brightness, contrast, saturation;
+        sws_getColorspaceDetails(m_swsContext, &inverseTable, &srcRange, &table, &dstRange,
+                                 &brightness, &contrast, &saturation);
+        sws_setColorspaceDetails(m_swsContext, inverseTable, 1, table, dstRange,
+                                 brightness, contrast, saturation);
+    }
+
+    return true;
+}
+
+/* An image of the given size that only this decoder refers to */
+int JpegDecoder::reusableImage(int width, int height)
+{
+    int free = -1;
+    for (int i = 0; i < 2; ++i)
+    {
+        QImage &image = m_images[i];
+        if (image.isNull() || image.isDetached())
+        {
+            if (image.width() == width && image.height() == height)
+                return i;
+            if (free < 0)
+                free = i;
+        }
+    }
+
+    /* Both are still in use; one of them is left to whoever holds it */
+    if (free < 0)
+    {
+        m_images[0] = m_images[1];
+        free = 1;
+    }
+
+    m_images[free] = QImage(width, height, QImage::Format_RGB32);
+    return m_images[free].isNull() ? -1 : free;
+}
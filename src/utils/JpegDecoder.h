@@ -0,0 +1,77 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+
+extern "C" {
+#   include "libavutil/pixfmt.h"
+}
+
+struct AVCodecContext;
+struct AVFrame;
+struct SwsContext;
+
+/* Decodes JPEG pictures, such as those of an MJPEG stream, into RGB32 images.
+ *
+ * Given a size hint, a picture is decoded at 1/2, 1/4 or 1/8 of its size right
+ * in the DCT domain, with the decoder's lowres mode, as long as that still
+ * covers the hint. A 5 MP camera shown in a 640x480 tile decodes a sixteenth of
+ * its pixels. The result is converted into one of two images that are reused
+ * once nobody else holds on to them.
+ *
+ * One picture is decoded at a time; decode() may be called from any thread. */
+class JpegDecoder
+{
+    Q_DISABLE_COPY(JpegDecoder)
+
+public:
+    /* Size from the picture's frame header; invalid if it has none */
+    static QSize pictureSize(const char *data, int size);
+    /* How many times the picture can be halved and still cover sizeHint, 0 to 3;
+     * an invalid hint means full size */
+    static int scaleShift(const QSize &pictureSize, const QSize &sizeHint);
+
+    JpegDecoder();
+    ~JpegDecoder();
+
+    /* A null image if the picture couldn't be decoded */
+    QImage decode(const char *data, int size, const QSize &sizeHint = QSize());
+
+private:
+    QMutex m_mutex;
+    /* One per scale, as the decoder picks its transform when it's opened */
+    AVCodecContext *m_contexts[4];
+    AVFrame *m_frame;
+
+    SwsContext *m_swsContext;
+    AVPixelFormat m_swsFormat;
+    int m_swsWidth;
+    int m_swsHeight;
+
+    QImage m_images[2];
+
+    AVCodecContext * context(int shift);
+    bool updateSwsContext(const AVFrame *frame);
+    int reusableImage(int width, int height);
+};
+
+#endif // JPEG_DECODER_H
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LatencyHistogram.h"
+
+LatencySummary::LatencySummary()
+    : m_count(0), m_total(0), m_max(0), m_buckets(LatencyHistogram::BucketCount, 0)
+{
+}
+
+qint64 LatencySummary::percentile(int percent) const
+{
+    if (!m_count)
+        return 0;
+
+    /* Rank of the sample, rounded up, so that the 100th percentile is the last one */
+    qint64 rank = (qint64(m_count) * qBound(0, percent, 100) + 99) / 100;
+    qint64 seen = 0;
+    for (int i = 0; i < m_buckets.size(); ++i)
+    {
+        seen += m_buckets.at(i);
+        if (seen >= qMax(rank, qint64(1)))
+            return qMin(LatencyHistogram::bucketLimit(i), m_max);
+    }
+
+    return m_max;
+}
+
+LatencyHistogram::LatencyHistogram()
+    : m_count(0), m_total(0), m_max(0)
+{
+    for (int i = 0; i < BucketCount; ++i)
+        m_buckets[i].store(0);
+}
+
+qint64 LatencyHistogram::bucketLimit(int bucket)
+{
+    return Q_INT64_C(1) << bucket;
+}
+
+int LatencyHistogram::bucketForDuration(qint64 microseconds)
+{
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && microseconds >= bucketLimit(bucket))
+        bucket++;
+    return bucket;
+}
+
+void LatencyHistogram::record(qint64 microseconds)
+{
+    if (microseconds < 0)
+        microseconds = 0;
+
+    QAtomicInteger<int> &bucket = m_buckets[bucketForDuration(microseconds)];
+    bucket.store(bucket.load() + 1);
+    m_total.store(m_total.load() + microseconds);
+    if (microseconds > m_max.load())
+        m_max.store(microseconds);
+    /* Last, so that a reader never sees more samples than buckets hold */
+    m_count.storeRelease(m_count.load() + 1);
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    LatencySummary result;
+    result.m_count = m_count.loadAcquire();
+    result.m_total = m_total.load();
+    result.m_max = m_max.load();
+
+    for (int i = 0; i < BucketCount; ++i)
+        result.m_buckets[i] = m_buckets[i].load();
+
+    return result;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <QAtomicInteger>
+#include <QVector>
+
+/* Copy of a LatencyHistogram's counts at one point in time. Durations are in
+ * microseconds; percentiles are only as precise as the histogram's power of two
+ * buckets, and report the upper limit of the bucket they fall in. */
+class LatencySummary
+{
+public:
+    LatencySummary();
+
+    int count() const { return m_count; }
+    qint64 total() const { return m_total; }
+    qint64 mean() const { return m_count ? m_total / m_count : 0; }
+    qint64 max() const { return m_max; }
+    qint64 percentile(int percent) const;
+
+    int bucketCount() const { return m_buckets.size(); }
+    int bucket(int index) const { return m_buckets.at(index); }
+
+private:
+    friend class LatencyHistogram;
+
+    int m_count;
+    qint64 m_total;
+    qint64 m_max;
+    QVector<int> m_buckets;
+};
+
+/* Histogram of durations for exactly one writer thread, readable from any thread
+ * without locking. Bucket i counts durations below 2^i microseconds that did not
+ * fit in the bucket before it; the last bucket takes anything longer.
+ *
+ * With a single writer every update is a plain load and store, so recording
+ * costs no more than incrementing a few integers. A reader may see a sample in
+ * its bucket or the total before it is counted, which is fine for statistics. */
+class LatencyHistogram
+{
+    Q_DISABLE_COPY(LatencyHistogram)
+
+public:
+    enum { BucketCount = 24 };
+
+    LatencyHistogram();
+
+    /* Upper limit, exclusive, of durations counted in bucket */
+    static qint64 bucketLimit(int bucket);
+    static int bucketForDuration(qint64 microseconds);
+
+    /* Writer side */
+    void record(qint64 microseconds);
+
+    LatencySummary summary() const;
+
+private:
+    QAtomicInteger<int> m_buckets[BucketCount];
+    QAtomicInteger<int> m_count;
+    QAtomicInteger<qint64> m_total;
+    QAtomicInteger<qint64> m_max;
+};
+
+#endif // LATENCY_HISTOGRAM_H
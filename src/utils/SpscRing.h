@@ -0,0 +1,129 @@
+/*
+ * Copyright 2010-2019 Bluecherry, LLC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+
+/* Bounded lock-free ring of pointers for exactly one producer thread and one
+ * consumer thread. Items are never owned by the ring; whoever takes a pointer out
+ * is responsible for it, and pointers still queued on destruction are leaked unless
+ * the owner drains the ring first.
+ *
+ * push() and pushOverwrite() may only be called from the producer thread, pop()
+ * only from the consumer thread. size() is safe anywhere but is only a
+ * snapshot.
+ *
+ * Indexes are free-running 32-bit counters; the slot array is rounded up to a
+ * power of two so that wrapping around stays consistent, while capacity() keeps
+ * the exact limit asked for. */
+
+template <typename T>
+class SpscRing
+{
+    Q_DISABLE_COPY(SpscRing)
+
+public:
+    explicit SpscRing(int capacity)
+        : m_capacity(qMax(capacity, 1)), m_head(0), m_tail(0)
+    {
+        quint32 slots = 1;
+        while (slots < m_capacity)
+            slots <<= 1;
+
+        m_mask = slots - 1;
+        m_slots = new QAtomicPointer<T>[slots];
+    }
+
+    ~SpscRing()
+    {
+        delete[] m_slots;
+    }
+
+    int capacity() const { return m_capacity; }
+
+    int size() const
+    {
+        quint32 tail = m_tail.loadAcquire();
+        quint32 head = m_head.loadAcquire();
+        return int(tail - head);
+    }
+
+    bool isEmpty() const { return size() == 0; }
+
+    /* Producer side. Returns false and leaves the item with the caller when full. */
+    bool push(T *item)
+    {
+        quint32 tail = m_tail.load();
+        if (tail - m_head.loadAcquire() >= m_capacity)
+            return false;
+
+        m_slots[tail & m_mask].storeRelease(item);
+        m_tail.storeRelease(tail + 1);
+        return true;
+    }
+
+    /* Producer side. Always queues the item; when the ring is full the oldest item
+     * is taken away from the consumer and returned, otherwise returns 0. */
+    T * pushOverwrite(T *item)
+    {
+        quint32 tail = m_tail.load();
+        quint32 head = m_head.loadAcquire();
+        T *displaced = 0;
+
+        if (tail - head >= m_capacity)
+        {
+            /* Only the producer writes slots, so the oldest item can be read before
+             * claiming it. If the consumer wins the race, a slot was freed anyway. */
+            displaced = m_slots[head & m_mask].loadAcquire();
+            if (!m_head.testAndSetOrdered(head, head + 1))
+                displaced = 0;
+        }
+
+        m_slots[tail & m_mask].storeRelease(item);
+        m_tail.storeRelease(tail + 1);
+        return displaced;
+    }
+
+    /* Consumer side. Returns 0 when empty. */
+    T * pop()
+    {
+        for (;;)
+        {
+            quint32 head = m_head.loadAcquire();
+            if (head == m_tail.loadAcquire())
+                return 0;
+
+            /* The item is only ours once head has moved past it; the producer may
+             * have claimed it in pushOverwrite() in the meantime. */
+            T *item = m_slots[head & m_mask].loadAcquire();
+            if (m_head.testAndSetOrdered(head, head + 1))
+                return item;
+        }
+    }
+
+private:
+    QAtomicPointer<T> *m_slots;
+    quint32 m_capacity;
+    quint32 m_mask;
+    QAtomicInteger<quint32> m_head;
+    QAtomicInteger<quint32> m_tail;
+};
+
+#endif // SPSC_RING_H
@@ -240,7 +240,6 @@ void MediaDownload::startRequest(unsigned position, unsigned size)
             Qt::DirectConnection);
     connect(m_task, SIGNAL(finished()), SLOT(taskFinished()), Qt::DirectConnection);
     connect(m_task, SIGNAL(error(QString)), SLOT(taskError(QString)), Qt::DirectConnection);
-    connect(m_task, SIGNAL(bytesDownloaded(uint)), bcApp->globalRate, SLOT(addSampleValue(uint)));
 
     /* If size will reach the end of what we believe the file size to be, make it infinite instead,
      * to ease behavior with still active files */
@@ -381,7 +380,8 @@ void MediaDownload::taskFinished()
 }
 
 MediaDownloadTask::MediaDownloadTask(QObject *parent)
-    : QObject(parent), m_reply(0), m_writePos(0), m_lock(QMutex::Recursive)
+    : QObject(parent), m_reply(0), m_transfer(bcApp->globalRate->createCounter()), m_writePos(0),
+      m_lock(QMutex::Recursive)
 {
 }
 
@@ -487,7 +487,7 @@ void MediaDownloadTask::read()
     emit dataRead(data, m_writePos);
     m_writePos += data.size();
 
-    emit bytesDownloaded(data.size());
+    m_transfer->add(data.size());
 }
 
 void MediaDownloadTask::requestFinished()
@@ -22,6 +22,8 @@
 #include <QUrl>
 #include <QThreadStorage>
 #include <QMutex>
+#include <QSharedPointer>
+#include "core/TransferRateCalculator.h"
 
 class QNetworkAccessManager;
 class QNetworkReply;
@@ -55,7 +57,6 @@ signals:
     void dataRead(const QByteArray &data, unsigned position);
     void error(const QString &errorMessage);
     void finished();
-    void bytesDownloaded(unsigned int bytes);
 
 private slots:
     void metaDataReady();
@@ -66,6 +67,7 @@ private:
     friend class MediaDownload;
     static QThreadStorage<QNetworkAccessManager*> threadNAM;
     QNetworkReply *m_reply;
+    QSharedPointer<TransferRateCalculator::Counter> m_transfer;
     unsigned m_writePos;
     QMutex m_lock;
 };
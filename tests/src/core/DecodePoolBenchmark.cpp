@@ -0,0 +1,327 @@
+#include "core/DecodePool.h"
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QThread>
+#include <ctime>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Compares decoding every stream on its own thread with the shared decode pool.
+ * Streams are simulated: frames arrive at 25 fps from a single arrival thread
+ * (standing in for the socket readers) and "decoding" one is a fixed amount of
+ * work over a per-stream buffer, so cache effects of many threads show as well.
+ * Reports process CPU use and arrival-to-decoded latency for 16, 64 and 128
+ * streams. */
+
+static const int framesPerSecond = 25;
+static const int runTime = 1000;
+static const int frameBufferSize = 256 * 1024;
+
+class SimulatedStream : public DecodeTask
+{
+public:
+    SimulatedStream()
+        : m_buffer(frameBufferSize, 1), m_decodedFrames(0), m_totalLatency(0), m_maxLatency(0),
+          m_running(0), m_concurrentRuns(0)
+    {
+    }
+
+    void frameArrived(qint64 arrivalTime)
+    {
+        QMutexLocker locker(&m_arrivalsMutex);
+        m_arrivals.append(arrivalTime);
+    }
+
+    /* Decodes everything that arrived, at most batchSize frames */
+    bool decode(const QElapsedTimer &clock, int batchSize)
+    {
+        if (m_running.fetchAndAddOrdered(1))
+            m_concurrentRuns.fetchAndAddOrdered(1);
+
+        for (int i = 0; i < batchSize; ++i)
+        {
+            m_arrivalsMutex.lock();
+            if (m_arrivals.isEmpty())
+            {
+                m_arrivalsMutex.unlock();
+                break;
+            }
+            qint64 arrivalTime = m_arrivals.takeFirst();
+            m_arrivalsMutex.unlock();
+
+            char *data = m_buffer.data();
+            for (int pass = 0; pass < 4; ++pass)
+                for (int j = 0; j < frameBufferSize; j += 64)
+                    data[j] = char(data[j] * 31 + pass);
+
+            qint64 latency = clock.nsecsElapsed() / 1000 - arrivalTime;
+            m_decodedFrames.fetchAndAddOrdered(1);
+            m_totalLatency.fetchAndAddOrdered(latency);
+            qint64 max;
+            while ((max = m_maxLatency.load()) < latency && !m_maxLatency.testAndSetOrdered(max, latency))
+                ;
+        }
+
+        m_running.fetchAndAddOrdered(-1);
+
+        QMutexLocker locker(&m_arrivalsMutex);
+        return !m_arrivals.isEmpty();
+    }
+
+    const QElapsedTimer *m_clock;
+    QByteArray m_buffer;
+    QMutex m_arrivalsMutex;
+    QList<qint64> m_arrivals;
+    QAtomicInt m_decodedFrames;
+    QAtomicInteger<qint64> m_totalLatency;
+    QAtomicInteger<qint64> m_maxLatency;
+    QAtomicInt m_running;
+    QAtomicInt m_concurrentRuns;
+
+protected:
+    virtual bool runDecodeTask()
+    {
+        return decode(*m_clock, 4);
+    }
+};
+
+class StreamDecodeThread : public QThread
+{
+public:
+    StreamDecodeThread(SimulatedStream *stream, const QElapsedTimer *clock)
+        : m_stream(stream), m_clock(clock), m_quit(0)
+    {
+    }
+
+    void wake() { m_frames.release(); }
+    void quit() { m_quit.storeRelease(1); m_frames.release(); }
+
+protected:
+    virtual void run()
+    {
+        for (;;)
+        {
+            m_frames.acquire();
+            if (m_quit.loadAcquire())
+                return;
+            m_stream->decode(*m_clock, 1);
+        }
+    }
+
+private:
+    SimulatedStream *m_stream;
+    const QElapsedTimer *m_clock;
+    QSemaphore m_frames;
+    QAtomicInt m_quit;
+};
+
+class CountingTask : public DecodeTask
+{
+public:
+    CountingTask() : m_pending(0), m_runs(0), m_running(0), m_concurrentRuns(0) { }
+
+    QAtomicInt m_pending;
+    QAtomicInt m_runs;
+    QAtomicInt m_running;
+    QAtomicInt m_concurrentRuns;
+
+protected:
+    virtual bool runDecodeTask()
+    {
+        if (m_running.fetchAndAddOrdered(1))
+            m_concurrentRuns.fetchAndAddOrdered(1);
+
+        for (int i = 0; i < 4 && m_pending.load() > 0; ++i)
+        {
+            m_pending.fetchAndAddOrdered(-1);
+            m_runs.fetchAndAddOrdered(1);
+        }
+
+        m_running.fetchAndAddOrdered(-1);
+        return m_pending.load() > 0;
+    }
+};
+
+class DecodePoolBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkStreams_data();
+    void benchmarkStreams();
+    void testAllWorkDone();
+    void testCancel();
+};
+
+void DecodePoolBenchmark::benchmarkStreams_data()
+{
+    QTest::addColumn<int>("streamCount");
+    QTest::addColumn<bool>("useDecodePool");
+
+    foreach (int streamCount, QList<int>() << 16 << 64 << 128)
+    {
+        QTest::newRow(qPrintable(QString::fromLatin1("%1 streams, thread per stream").arg(streamCount)))
+                << streamCount << false;
+        QTest::newRow(qPrintable(QString::fromLatin1("%1 streams, decode pool").arg(streamCount)))
+                << streamCount << true;
+    }
+}
+
+void DecodePoolBenchmark::benchmarkStreams()
+{
+    QFETCH(int, streamCount);
+    QFETCH(bool, useDecodePool);
+
+    QElapsedTimer clock;
+    clock.start();
+
+    QScopedPointer<DecodePool> pool;
+    QList<SimulatedStream *> streams;
+    QList<StreamDecodeThread *> threads;
+
+    if (useDecodePool)
+        pool.reset(new DecodePool);
+
+    for (int i = 0; i < streamCount; ++i)
+    {
+        SimulatedStream *stream = new SimulatedStream;
+        stream->m_clock = &clock;
+        streams.append(stream);
+
+        if (!useDecodePool)
+        {
+            StreamDecodeThread *thread = new StreamDecodeThread(stream, &clock);
+            threads.append(thread);
+            thread->start();
+        }
+    }
+
+    /* Arrival times of all streams are spread evenly over a frame interval */
+    const qint64 frameInterval = 1000000 / framesPerSecond;
+    const qint64 startTime = clock.nsecsElapsed() / 1000;
+    const qint64 endTime = startTime + runTime * 1000;
+    int arrivedFrames = 0;
+    clock_t startCpu = ::clock();
+
+    for (qint64 tick = 0; ; ++tick)
+    {
+        qint64 due = startTime + tick * frameInterval / streamCount;
+        if (due >= endTime)
+            break;
+
+        qint64 now = clock.nsecsElapsed() / 1000;
+        if (due > now)
+            QThread::usleep(due - now);
+
+        int index = tick % streamCount;
+        streams[index]->frameArrived(due);
+        arrivedFrames++;
+
+        if (useDecodePool)
+            pool->schedule(streams[index]);
+        else
+            threads[index]->wake();
+    }
+
+    /* Let the backlog drain before measuring */
+    int decodedFrames = 0;
+    for (int wait = 0; wait < 5000; wait += 10)
+    {
+        decodedFrames = 0;
+        foreach (SimulatedStream *stream, streams)
+            decodedFrames += stream->m_decodedFrames.load();
+        if (decodedFrames == arrivedFrames)
+            break;
+        QThread::msleep(10);
+    }
+
+    qint64 wallTime = clock.nsecsElapsed() / 1000 - startTime;
+    double cpuTime = double(::clock() - startCpu) / CLOCKS_PER_SEC * 1000000;
+
+    qint64 totalLatency = 0;
+    qint64 maxLatency = 0;
+    int concurrentRuns = 0;
+    foreach (SimulatedStream *stream, streams)
+    {
+        totalLatency += stream->m_totalLatency.load();
+        maxLatency = qMax(maxLatency, stream->m_maxLatency.load());
+        concurrentRuns += stream->m_concurrentRuns.load();
+    }
+
+    qDebug("%d streams, %s: cpu %.0f%%, latency mean %lld us, max %lld us%s",
+           streamCount, useDecodePool ? "decode pool" : "thread per stream",
+           cpuTime * 100 / wallTime, decodedFrames ? totalLatency / decodedFrames : 0, maxLatency,
+           pool ? qPrintable(QString::fromLatin1(", %1 steals").arg(pool->stolenTasks())) : "");
+
+    foreach (StreamDecodeThread *thread, threads)
+    {
+        thread->quit();
+        thread->wait();
+    }
+    qDeleteAll(threads);
+
+    if (pool)
+    {
+        foreach (SimulatedStream *stream, streams)
+            pool->cancel(stream);
+    }
+    qDeleteAll(streams);
+
+    QCOMPARE(decodedFrames, arrivedFrames);
+    QCOMPARE(concurrentRuns, 0);
+}
+
+void DecodePoolBenchmark::testAllWorkDone()
+{
+    DecodePool pool(4);
+    QCOMPARE(pool.threadCount(), 4);
+
+    CountingTask tasks[32];
+    for (int i = 0; i < 20000; ++i)
+    {
+        CountingTask &task = tasks[(i * 7) % 32];
+        task.m_pending.fetchAndAddOrdered(1);
+        pool.schedule(&task);
+    }
+
+    int runs = 0;
+    for (int wait = 0; wait < 5000 && runs < 20000; wait += 10)
+    {
+        QThread::msleep(10);
+        runs = 0;
+        for (int i = 0; i < 32; ++i)
+            runs += tasks[i].m_runs.load();
+    }
+
+    QCOMPARE(runs, 20000);
+    for (int i = 0; i < 32; ++i)
+    {
+        QCOMPARE(tasks[i].m_concurrentRuns.load(), 0);
+        pool.cancel(&tasks[i]);
+    }
+}
+
+void DecodePoolBenchmark::testCancel()
+{
+    DecodePool pool(2);
+    CountingTask task;
+
+    task.m_pending.store(1000000);
+    pool.schedule(&task);
+    QThread::msleep(10);
+    pool.cancel(&task);
+
+    int runs = task.m_runs.load();
+    QVERIFY(runs > 0);
+    QCOMPARE(task.m_running.load(), 0);
+
+    /* Cancelled tasks are never run again, even when scheduled */
+    pool.schedule(&task);
+    QThread::msleep(10);
+    QCOMPARE(task.m_runs.load(), runs);
+}
+
+QTEST_MAIN(DecodePoolBenchmark)
+
+#include "DecodePoolBenchmark.moc"
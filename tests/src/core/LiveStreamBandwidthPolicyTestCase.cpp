@@ -0,0 +1,103 @@
+#include "core/LiveStreamBandwidthPolicy.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class LiveStreamBandwidthPolicyTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testTileSizeHysteresis();
+    void testNativeSize();
+    void testHoldTime();
+    void testServerBudget();
+    void testBudgetHeadroom();
+};
+
+void LiveStreamBandwidthPolicyTestCase::testTileSizeHysteresis()
+{
+    LiveStreamBandwidthPolicy policy;
+    policy.setTileThresholds(10000, 20000);
+    policy.setHoldTime(0);
+
+    QVERIFY(!policy.update(QSize(120, 100), 0, 0, 0));
+    QCOMPARE(policy.mode(), LiveViewManager::FullBandwidth);
+
+    QVERIFY(policy.update(QSize(90, 100), 0, 0, 1));
+    QCOMPARE(policy.mode(), LiveViewManager::LowBandwidth);
+
+    /* Between the thresholds nothing changes either way */
+    QVERIFY(!policy.update(QSize(150, 100), 0, 0, 2));
+    QCOMPARE(policy.mode(), LiveViewManager::LowBandwidth);
+
+    QVERIFY(policy.update(QSize(200, 100), 0, 0, 3));
+    QCOMPARE(policy.mode(), LiveViewManager::FullBandwidth);
+
+    QVERIFY(!policy.update(QSize(150, 100), 0, 0, 4));
+    QCOMPARE(policy.mode(), LiveViewManager::FullBandwidth);
+}
+
+void LiveStreamBandwidthPolicyTestCase::testNativeSize()
+{
+    LiveStreamBandwidthPolicy policy;
+    policy.setHoldTime(0);
+    policy.reset(LiveViewManager::LowBandwidth);
+
+    QVERIFY(policy.update(QSize(), 0, 0, 0));
+    QCOMPARE(policy.mode(), LiveViewManager::FullBandwidth);
+}
+
+void LiveStreamBandwidthPolicyTestCase::testHoldTime()
+{
+    LiveStreamBandwidthPolicy policy;
+    policy.setTileThresholds(10000, 20000);
+    policy.setHoldTime(1000);
+
+    QVERIFY(policy.update(QSize(10, 10), 0, 0, 5000));
+    QVERIFY(!policy.update(QSize(500, 500), 0, 0, 5999));
+    QCOMPARE(policy.mode(), LiveViewManager::LowBandwidth);
+    QVERIFY(policy.update(QSize(500, 500), 0, 0, 6000));
+    QCOMPARE(policy.mode(), LiveViewManager::FullBandwidth);
+
+    /* A reset may change the mode right away */
+    policy.reset(LiveViewManager::FullBandwidth);
+    QVERIFY(policy.update(QSize(10, 10), 0, 0, 6001));
+}
+
+void LiveStreamBandwidthPolicyTestCase::testServerBudget()
+{
+    LiveStreamBandwidthPolicy policy;
+    policy.setHoldTime(0);
+    policy.setServerBudget(10000000);
+
+    QVERIFY(!policy.update(QSize(), 4000000, 5000000, 0));
+    QCOMPARE(policy.expectedBitrate(), Q_INT64_C(4000000));
+
+    QVERIFY(policy.update(QSize(), 4000000, 7000000, 1));
+    QCOMPARE(policy.mode(), LiveViewManager::LowBandwidth);
+
+    policy.update(QSize(), 200000, 7000000, 2);
+    QCOMPARE(policy.mode(), LiveViewManager::LowBandwidth);
+    QCOMPARE(policy.expectedBitrate(), Q_INT64_C(200000));
+}
+
+void LiveStreamBandwidthPolicyTestCase::testBudgetHeadroom()
+{
+    LiveStreamBandwidthPolicy policy;
+    policy.setHoldTime(0);
+    policy.setServerBudget(10000000);
+
+    QVERIFY(policy.update(QSize(), 4000000, 7000000, 0));
+
+    /* Full video would fit, but without a quarter of the budget to spare */
+    QVERIFY(!policy.update(QSize(), 200000, 5000000, 1));
+    QCOMPARE(policy.mode(), LiveViewManager::LowBandwidth);
+
+    QVERIFY(policy.update(QSize(), 200000, 3500000, 2));
+    QCOMPARE(policy.mode(), LiveViewManager::FullBandwidth);
+    QCOMPARE(policy.expectedBitrate(), Q_INT64_C(4000000));
+}
+
+QTEST_MAIN(LiveStreamBandwidthPolicyTestCase)
+#include "LiveStreamBandwidthPolicyTestCase.moc"
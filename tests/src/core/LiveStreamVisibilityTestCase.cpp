@@ -0,0 +1,97 @@
+#include "core/LiveStreamVisibility.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class LiveStreamVisibilityTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testWithoutConsumers();
+    void testSuspension();
+    void testAnyConsumerVisible();
+    void testVisibleAgain();
+    void testRemoveHiddenConsumer();
+};
+
+void LiveStreamVisibilityTestCase::testWithoutConsumers()
+{
+    LiveStreamVisibility visibility;
+    QObject consumer;
+
+    QVERIFY(visibility.isVisible());
+    visibility.setConsumerVisible(&consumer, false);
+    QVERIFY(visibility.isVisible());
+}
+
+void LiveStreamVisibilityTestCase::testSuspension()
+{
+    LiveStreamVisibility visibility;
+    visibility.setSuspendDelays(50, 150);
+    QSignalSpy spy(&visibility, SIGNAL(suspensionChanged(int)));
+    QObject consumer;
+
+    visibility.addConsumer(&consumer);
+    QVERIFY(visibility.isVisible());
+
+    visibility.setConsumerVisible(&consumer, false);
+    QVERIFY(!visibility.isVisible());
+    QCOMPARE(visibility.suspension(), LiveStreamVisibility::NotSuspended);
+
+    QTRY_COMPARE(visibility.suspension(), LiveStreamVisibility::DecodingSuspended);
+    QTRY_COMPARE(visibility.suspension(), LiveStreamVisibility::ConnectionSuspended);
+    QCOMPARE(spy.count(), 2);
+}
+
+void LiveStreamVisibilityTestCase::testAnyConsumerVisible()
+{
+    LiveStreamVisibility visibility;
+    visibility.setSuspendDelays(10, 20);
+    QObject hidden, shown;
+
+    visibility.addConsumer(&hidden);
+    visibility.addConsumer(&shown);
+    visibility.setConsumerVisible(&hidden, false);
+    QVERIFY(visibility.isVisible());
+
+    QTest::qWait(50);
+    QCOMPARE(visibility.suspension(), LiveStreamVisibility::NotSuspended);
+}
+
+void LiveStreamVisibilityTestCase::testVisibleAgain()
+{
+    LiveStreamVisibility visibility;
+    visibility.setSuspendDelays(10, 1000);
+    QObject consumer;
+
+    visibility.addConsumer(&consumer);
+    visibility.setConsumerVisible(&consumer, false);
+    QTRY_COMPARE(visibility.suspension(), LiveStreamVisibility::DecodingSuspended);
+
+    visibility.setConsumerVisible(&consumer, true);
+    QCOMPARE(visibility.suspension(), LiveStreamVisibility::NotSuspended);
+
+    /* Hiding again starts the grace period over */
+    visibility.setConsumerVisible(&consumer, false);
+    QCOMPARE(visibility.suspension(), LiveStreamVisibility::NotSuspended);
+    QTRY_COMPARE(visibility.suspension(), LiveStreamVisibility::DecodingSuspended);
+}
+
+void LiveStreamVisibilityTestCase::testRemoveHiddenConsumer()
+{
+    LiveStreamVisibility visibility;
+    visibility.setSuspendDelays(10, 1000);
+    QObject consumer;
+
+    visibility.addConsumer(&consumer);
+    visibility.setConsumerVisible(&consumer, false);
+    QTRY_COMPARE(visibility.suspension(), LiveStreamVisibility::DecodingSuspended);
+
+    visibility.removeConsumer(&consumer);
+    QVERIFY(visibility.isVisible());
+    QCOMPARE(visibility.suspension(), LiveStreamVisibility::NotSuspended);
+}
+
+QTEST_MAIN(LiveStreamVisibilityTestCase)
+#include "LiveStreamVisibilityTestCase.moc"
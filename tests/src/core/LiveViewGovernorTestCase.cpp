@@ -0,0 +1,119 @@
+#include "core/LiveStream.h"
+#include "core/LiveViewGovernor.h"
+#include "core/LiveViewManager.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class LiveViewGovernorTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testPressure();
+    void testBitrateBudget();
+    void testDegradeOrder();
+    void testRestoreOrder();
+    void testMaximumDegradation();
+};
+
+static LiveViewGovernor::Load load(double cpu, int eventLoopLatency, qint64 bitrate = 0)
+{
+    LiveViewGovernor::Load result;
+    result.cpu = cpu;
+    result.eventLoopLatency = eventLoopLatency;
+    result.bitrate = bitrate;
+    return result;
+}
+
+static LiveViewGovernor::Candidate candidate(int priority, int degradation,
+                                             int maximumDegradation = LiveStream::DecodingPaused)
+{
+    LiveViewGovernor::Candidate result;
+    result.priority = priority;
+    result.degradation = degradation;
+    result.maximumDegradation = maximumDegradation;
+    return result;
+}
+
+void LiveViewGovernorTestCase::testPressure()
+{
+    LiveViewManager liveView;
+    LiveViewGovernor governor(&liveView);
+    governor.setBudget(0.8, 100, 0);
+
+    QCOMPARE(governor.pressure(load(0.1, 5)), LiveViewGovernor::Headroom);
+    QCOMPARE(governor.pressure(load(0.6, 5)), LiveViewGovernor::Comfortable);
+    QCOMPARE(governor.pressure(load(0.1, 80)), LiveViewGovernor::Comfortable);
+    QCOMPARE(governor.pressure(load(0.9, 5)), LiveViewGovernor::Overloaded);
+    QCOMPARE(governor.pressure(load(0.1, 150)), LiveViewGovernor::Overloaded);
+    /* Without a bitrate budget any bitrate will do */
+    QCOMPARE(governor.pressure(load(0.1, 5, Q_INT64_C(1) << 40)), LiveViewGovernor::Headroom);
+}
+
+void LiveViewGovernorTestCase::testBitrateBudget()
+{
+    LiveViewManager liveView;
+    LiveViewGovernor governor(&liveView);
+    governor.setBudget(0.8, 100, 10000000);
+
+    QCOMPARE(governor.pressure(load(0.1, 5, 1000000)), LiveViewGovernor::Headroom);
+    QCOMPARE(governor.pressure(load(0.1, 5, 8000000)), LiveViewGovernor::Comfortable);
+    QCOMPARE(governor.pressure(load(0.1, 5, 12000000)), LiveViewGovernor::Overloaded);
+}
+
+void LiveViewGovernorTestCase::testDegradeOrder()
+{
+    QList<LiveViewGovernor::Candidate> candidates;
+    candidates << candidate(300, LiveStream::NotDegraded)
+               << candidate(100, LiveStream::NotDegraded)
+               << candidate(200, LiveStream::NotDegraded);
+
+    /* Smallest first, and every stream gets capped before any gets keyframes only */
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), 1);
+    candidates[1].degradation = LiveStream::FrameRateCapped;
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), 2);
+    candidates[2].degradation = LiveStream::FrameRateCapped;
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), 0);
+    candidates[0].degradation = LiveStream::FrameRateCapped;
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), 1);
+
+    for (int i = 0; i < candidates.size(); ++i)
+        candidates[i].degradation = LiveStream::DecodingPaused;
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), -1);
+}
+
+void LiveViewGovernorTestCase::testRestoreOrder()
+{
+    QList<LiveViewGovernor::Candidate> candidates;
+    candidates << candidate(300, LiveStream::KeyframesOnly)
+               << candidate(100, LiveStream::DecodingPaused)
+               << candidate(200, LiveStream::KeyframesOnly);
+
+    QCOMPARE(LiveViewGovernor::nextToRestore(candidates), 1);
+    candidates[1].degradation = LiveStream::KeyframesOnly;
+    /* The most important stream comes back first */
+    QCOMPARE(LiveViewGovernor::nextToRestore(candidates), 0);
+    candidates[0].degradation = LiveStream::FrameRateCapped;
+    QCOMPARE(LiveViewGovernor::nextToRestore(candidates), 2);
+
+    for (int i = 0; i < candidates.size(); ++i)
+        candidates[i].degradation = LiveStream::NotDegraded;
+    QCOMPARE(LiveViewGovernor::nextToRestore(candidates), -1);
+}
+
+void LiveViewGovernorTestCase::testMaximumDegradation()
+{
+    QList<LiveViewGovernor::Candidate> candidates;
+    candidates << candidate(5000, LiveStream::NotDegraded, LiveStream::FrameRateCapped)
+               << candidate(100, LiveStream::FrameRateCapped);
+
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), 0);
+    candidates[0].degradation = LiveStream::FrameRateCapped;
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), 1);
+    candidates[1].degradation = LiveStream::DecodingPaused;
+    QCOMPARE(LiveViewGovernor::nextToDegrade(candidates), -1);
+}
+
+QTEST_MAIN(LiveViewGovernorTestCase)
+#include "LiveViewGovernorTestCase.moc"
@@ -0,0 +1,214 @@
+#include "core/MJpegMultipartParser.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Throughput of splitting a feed of 5 MP frames, read the way QNetworkReply
+ * hands it over, next to the indexOf() and remove() parsing MJpegStream used
+ * before. The old parser moved the rest of a buffer of up to 2 MB after every
+ * boundary, header block and body, and searched bodies from their start again
+ * on every read. */
+class MJpegMultipartParserBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkParse_data();
+    void benchmarkParse();
+};
+
+static const int frameCount = 8;
+static const int frameSize = 600 * 1024;
+
+static QByteArray createFeed(bool contentLength)
+{
+    QByteArray frame(frameSize, 'x');
+    for (int i = 0; i < frame.size(); ++i)
+        frame[i] = char(qrand() % 200);
+    frame[0] = '\xff';
+    frame[1] = '\xd8';
+    frame[frameSize - 2] = '\xff';
+    frame[frameSize - 1] = '\xd9';
+
+    QByteArray feed;
+    for (int i = 0; i < frameCount; ++i)
+    {
+        feed.append("--myboundary\r\nContent-Type: image/jpeg\r\n");
+        if (contentLength)
+            feed.append("Content-Length: " + QByteArray::number(frame.size()) + "\r\n");
+        feed.append("\r\n");
+        feed.append(frame);
+        feed.append("\r\n");
+    }
+    feed.append("--myboundary\r\n");
+
+    return feed;
+}
+
+/* MJpegStream::parseBuffer() as it was, down to the copy of each body */
+static int parseLegacy(const QByteArray &boundaryText, const QByteArray &feed, int chunkSize)
+{
+    QByteArray buffer;
+    int state = 0;
+    int bodyLength = 0;
+    int parts = 0;
+
+    for (int pos = 0; pos < feed.size(); pos += chunkSize)
+    {
+        buffer.append(feed.constData() + pos, qMin(chunkSize, feed.size() - pos));
+
+        bool again = true;
+        while (again)
+        {
+            again = false;
+
+            if (state == 0)
+            {
+                int boundary = buffer.indexOf(boundaryText);
+                if (boundary < 0)
+                {
+                    buffer.remove(0, buffer.size() - (boundaryText.size() - 2));
+                    break;
+                }
+
+                int boundaryStart = boundary;
+                if (boundaryStart && buffer[boundaryStart-1] == '\r')
+                    --boundaryStart;
+
+                boundary += boundaryText.size();
+                int sz = buffer.size() - boundary;
+                if (sz >= 2 && buffer[boundary] == '-' && buffer[boundary+1] == '-')
+                {
+                    boundary += 2;
+                    sz -= 2;
+                }
+
+                if (sz && buffer[boundary] == '\n')
+                    boundary++;
+                else if (sz >= 2 && buffer[boundary] == '\r' && buffer[boundary+1] == '\n')
+                    boundary += 2;
+                else if (sz < 2)
+                {
+                    buffer.remove(0, boundaryStart);
+                    break;
+                }
+                else
+                {
+                    buffer.remove(0, boundaryStart + boundaryText.size());
+                    break;
+                }
+
+                buffer.remove(0, boundary);
+                state = 1;
+                bodyLength = 0;
+            }
+
+            if (state == 1)
+            {
+                int lnStart = 0, lnEnd = 0;
+                for (; (lnEnd = buffer.indexOf('\n', lnStart)) >= 0; lnStart = lnEnd+1)
+                {
+                    if (lnStart == lnEnd || ((lnEnd-lnStart) == 1 && buffer[lnStart] == '\r'))
+                    {
+                        state = 2;
+                        lnStart = lnEnd+1;
+                        break;
+                    }
+
+                    if ((lnEnd - lnStart) > 15 && qstrnicmp(buffer.constData()+lnStart, "Content-Length:", 15) == 0)
+                        bodyLength = buffer.mid(lnStart+15, lnEnd-lnStart-15).trimmed().toUInt();
+                }
+
+                buffer.remove(0, lnStart);
+            }
+
+            if (state == 2)
+            {
+                if (bodyLength)
+                {
+                    if (buffer.size() < bodyLength)
+                        break;
+                }
+                else
+                {
+                    int boundary = buffer.indexOf(boundaryText);
+                    if (boundary < 0)
+                        break;
+                    bodyLength = boundary;
+                }
+
+                QByteArray body(buffer.constData(), bodyLength);
+                parts += !body.isEmpty();
+
+                buffer.remove(0, bodyLength);
+                state = 0;
+                again = !buffer.isEmpty();
+            }
+        }
+    }
+
+    return parts;
+}
+
+static int parse(const QByteArray &boundary, const QByteArray &feed, int chunkSize)
+{
+    MJpegMultipartParser parser;
+    parser.setBoundary(boundary);
+    int parts = 0;
+
+    for (int pos = 0; pos < feed.size(); pos += chunkSize)
+    {
+        int size = qMin(chunkSize, feed.size() - pos);
+        memcpy(parser.reserve(size), feed.constData() + pos, size);
+        parser.commit(size);
+
+        MJpegPart part;
+        while (parser.takePart(&part))
+            ++parts;
+    }
+
+    return parts;
+}
+
+void MJpegMultipartParserBenchmark::benchmarkParse_data()
+{
+    QTest::addColumn<bool>("contentLength");
+    QTest::addColumn<int>("chunkSize");
+    QTest::addColumn<bool>("legacy");
+
+    QList<int> chunkSizes;
+    chunkSizes << 1460 << 16 * 1024 << 64 * 1024;
+
+    foreach (int chunkSize, chunkSizes)
+    {
+        for (int contentLength = 1; contentLength >= 0; --contentLength)
+        {
+            QString name = QString::fromLatin1("%1 byte reads, %2").arg(chunkSize)
+                    .arg(QLatin1String(contentLength ? "Content-Length" : "no Content-Length"));
+            QTest::newRow(qPrintable(name + QLatin1String(", parser"))) << bool(contentLength) << chunkSize << false;
+            QTest::newRow(qPrintable(name + QLatin1String(", legacy"))) << bool(contentLength) << chunkSize << true;
+        }
+    }
+}
+
+void MJpegMultipartParserBenchmark::benchmarkParse()
+{
+    QFETCH(bool, contentLength);
+    QFETCH(int, chunkSize);
+    QFETCH(bool, legacy);
+
+    qsrand(473);
+    QByteArray feed = createFeed(contentLength);
+    int parts = 0;
+
+    QBENCHMARK
+    {
+        parts = legacy ? parseLegacy("myboundary", feed, chunkSize) : parse("myboundary", feed, chunkSize);
+    }
+
+    QCOMPARE(parts, frameCount);
+}
+
+QTEST_MAIN(MJpegMultipartParserBenchmark)
+
+#include "MJpegMultipartParserBenchmark.moc"
@@ -0,0 +1,217 @@
+#include "bluecherry-config.h"
+#include "core/MJpegMultipartParser.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Feeds from tests/data/mjpeg, well-formed and not, read in pieces of every
+ * size; whatever the pieces, the parser has to find the same parts. */
+class MJpegMultipartParserTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testBoundaryFromContentType_data();
+    void testBoundaryFromContentType();
+    void testCorpus_data();
+    void testCorpus();
+    void testMutatedCorpus();
+    void testPartsKeepTheirData();
+    void testMaximumBufferSize();
+
+private:
+    QByteArray readFeed(const QString &fileName);
+    QList<QByteArray> parse(const QByteArray &boundary, const QByteArray &feed, int chunkSize);
+};
+
+static bool isIntactJpeg(const QByteArray &data)
+{
+    return data.size() >= 4 && data.startsWith("\xff\xd8") && data.endsWith("\xff\xd9");
+}
+
+QByteArray MJpegMultipartParserTestCase::readFeed(const QString &fileName)
+{
+    QFile file(QString::fromLatin1("%1/mjpeg/%2").arg(QString::fromLatin1(TEST_DATA_DIR)).arg(fileName));
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    return file.readAll();
+}
+
+/* A chunkSize of 0 reads pieces of random size */
+QList<QByteArray> MJpegMultipartParserTestCase::parse(const QByteArray &boundary, const QByteArray &feed, int chunkSize)
+{
+    MJpegMultipartParser parser;
+    parser.setBoundary(boundary);
+
+    QList<QByteArray> result;
+    for (int pos = 0; pos < feed.size(); )
+    {
+        int size = qMin(chunkSize ? chunkSize : 1 + qrand() % 700, feed.size() - pos);
+        char *data = parser.reserve(size);
+        if (!data)
+            break;
+
+        memcpy(data, feed.constData() + pos, size);
+        parser.commit(size);
+        pos += size;
+
+        MJpegPart part;
+        while (parser.takePart(&part))
+        {
+            if (part.offset < 0 || part.offset + part.size > part.buffer.size())
+                return QList<QByteArray>();
+            result.append(QByteArray(part.data().constData(), part.size));
+        }
+    }
+
+    return result;
+}
+
+void MJpegMultipartParserTestCase::testBoundaryFromContentType_data()
+{
+    QTest::addColumn<QByteArray>("contentType");
+    QTest::addColumn<QByteArray>("boundary");
+
+    QTest::newRow("Plain") << QByteArray("multipart/x-mixed-replace; boundary=myboundary") << QByteArray("myboundary");
+    QTest::newRow("Axis") << QByteArray("multipart/x-mixed-replace;boundary=--myboundary") << QByteArray("--myboundary");
+    QTest::newRow("Case") << QByteArray("Multipart/X-Mixed-Replace; Boundary=MyBoundary") << QByteArray("MyBoundary");
+    QTest::newRow("Quoted") << QByteArray("multipart/x-mixed-replace; boundary=\"my; boundary\"") << QByteArray("my; boundary");
+    QTest::newRow("More parameters") << QByteArray("multipart/x-mixed-replace; boundary=myboundary; charset=binary") << QByteArray("myboundary");
+    QTest::newRow("No boundary") << QByteArray("multipart/x-mixed-replace") << QByteArray();
+    QTest::newRow("Empty boundary") << QByteArray("multipart/x-mixed-replace; boundary=") << QByteArray();
+    QTest::newRow("Other type") << QByteArray("image/jpeg; boundary=myboundary") << QByteArray();
+}
+
+void MJpegMultipartParserTestCase::testBoundaryFromContentType()
+{
+    QFETCH(QByteArray, contentType);
+    QFETCH(QByteArray, boundary);
+
+    QCOMPARE(MJpegMultipartParser::boundaryFromContentType(contentType), boundary);
+}
+
+void MJpegMultipartParserTestCase::testCorpus_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<QByteArray>("boundary");
+    QTest::addColumn<int>("partCount");
+    QTest::addColumn<int>("intactCount");
+
+    QTest::newRow("Content-Length") << QString::fromLatin1("content-length.mjpeg") << QByteArray("myboundary") << 3 << 3;
+    QTest::newRow("No Content-Length") << QString::fromLatin1("no-content-length.mjpeg") << QByteArray("myboundary") << 3 << 3;
+    QTest::newRow("Axis dashes") << QString::fromLatin1("axis-dashes.mjpeg") << QByteArray("--myboundary") << 3 << 3;
+    QTest::newRow("LF only") << QString::fromLatin1("lf-only.mjpeg") << QByteArray("myboundary") << 3 << 3;
+    QTest::newRow("Preamble and epilogue") << QString::fromLatin1("preamble-epilogue.mjpeg") << QByteArray("myboundary") << 2 << 2;
+    /* The first body swallows the second boundary */
+    QTest::newRow("Content-Length too long") << QString::fromLatin1("content-length-too-long.mjpeg") << QByteArray("myboundary") << 2 << 1;
+    QTest::newRow("Garbage headers") << QString::fromLatin1("garbage-headers.mjpeg") << QByteArray("myboundary") << 2 << 2;
+    QTest::newRow("Empty body") << QString::fromLatin1("empty-body.mjpeg") << QByteArray("myboundary") << 2 << 2;
+    QTest::newRow("Truncated") << QString::fromLatin1("truncated.mjpeg") << QByteArray("myboundary") << 2 << 2;
+    QTest::newRow("Missing line break") << QString::fromLatin1("missing-line-break.mjpeg") << QByteArray("myboundary") << 2 << 2;
+    QTest::newRow("False boundaries") << QString::fromLatin1("false-boundaries.mjpeg") << QByteArray("myboundary") << 2 << 2;
+    QTest::newRow("Binary junk") << QString::fromLatin1("binary-junk.mjpeg") << QByteArray("myboundary") << 0 << 0;
+}
+
+void MJpegMultipartParserTestCase::testCorpus()
+{
+    QFETCH(QString, fileName);
+    QFETCH(QByteArray, boundary);
+    QFETCH(int, partCount);
+    QFETCH(int, intactCount);
+
+    QByteArray feed = readFeed(fileName);
+    QVERIFY(!feed.isEmpty());
+
+    QList<QByteArray> expected = parse(boundary, feed, feed.size());
+    QCOMPARE(expected.size(), partCount);
+
+    int intact = 0;
+    foreach (const QByteArray &part, expected)
+        intact += isIntactJpeg(part);
+    QCOMPARE(intact, intactCount);
+
+    for (int chunkSize = 1; chunkSize <= 17; ++chunkSize)
+        QCOMPARE(parse(boundary, feed, chunkSize), expected);
+
+    qsrand(473);
+    for (int i = 0; i < 20; ++i)
+        QCOMPARE(parse(boundary, feed, 0), expected);
+}
+
+/* Nothing in particular is expected of broken feeds, other than that the parser
+ * gets through them and only hands out what it was given */
+void MJpegMultipartParserTestCase::testMutatedCorpus()
+{
+    QStringList fileNames = QDir(QString::fromLatin1("%1/mjpeg").arg(QString::fromLatin1(TEST_DATA_DIR)))
+            .entryList(QStringList() << QLatin1String("*.mjpeg"));
+    QVERIFY(!fileNames.isEmpty());
+
+    qsrand(1234);
+    for (int i = 0; i < 5000; ++i)
+    {
+        QByteArray feed = readFeed(fileNames.at(i % fileNames.size()));
+        for (int j = 0; j <= i % 5; ++j)
+            feed[qrand() % feed.size()] = char(qrand());
+        if (i % 3 == 0)
+            feed.truncate(qrand() % feed.size());
+
+        foreach (const QByteArray &part, parse("myboundary", feed, i % 9))
+            QVERIFY(part.size() <= feed.size());
+    }
+}
+
+void MJpegMultipartParserTestCase::testPartsKeepTheirData()
+{
+    QByteArray feed = readFeed(QLatin1String("no-content-length.mjpeg"));
+    QList<QByteArray> expected = parse("myboundary", feed, feed.size());
+
+    MJpegMultipartParser parser;
+    parser.setBoundary("myboundary");
+
+    QList<MJpegPart> parts;
+    for (int pos = 0; pos < feed.size(); ++pos)
+    {
+        parser.append(feed.constData() + pos, 1);
+
+        MJpegPart part;
+        while (parser.takePart(&part))
+            parts.append(part);
+    }
+
+    QCOMPARE(parts.size(), expected.size());
+    for (int i = 0; i < parts.size(); ++i)
+        QCOMPARE(QByteArray(parts.at(i).data().constData(), parts.at(i).size), expected.at(i));
+}
+
+void MJpegMultipartParserTestCase::testMaximumBufferSize()
+{
+    MJpegMultipartParser parser(1024);
+    parser.setBoundary("myboundary");
+
+    /* A body that never ends */
+    parser.append("--myboundary\r\n\r\n", 16);
+    QByteArray body(4096, 'x');
+    MJpegPart part;
+    for (int pos = 0; pos < body.size() && !parser.hasError(); pos += 100)
+    {
+        parser.append(body.constData() + pos, 100);
+        QVERIFY(!parser.takePart(&part));
+    }
+
+    QVERIFY(parser.hasError());
+
+    /* Junk before the first boundary isn't kept at all */
+    parser.setBoundary("myboundary");
+    for (int pos = 0; pos < body.size(); pos += 100)
+    {
+        parser.append(body.constData() + pos, 100);
+        QVERIFY(!parser.takePart(&part));
+    }
+
+    QVERIFY(!parser.hasError());
+    QVERIFY(parser.bufferedSize() < 16);
+}
+
+QTEST_MAIN(MJpegMultipartParserTestCase)
+#include "MJpegMultipartParserTestCase.moc"
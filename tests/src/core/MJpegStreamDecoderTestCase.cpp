@@ -0,0 +1,170 @@
+#include "core/MJpegStreamDecoder.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavcodec/avcodec.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Keeps the pool's only thread busy until released */
+class BlockingTask : public DecodeTask
+{
+public:
+    QSemaphore started;
+    QSemaphore release;
+
+protected:
+    virtual bool runDecodeTask()
+    {
+        started.release();
+        release.acquire();
+        return false;
+    }
+};
+
+class MJpegStreamDecoderTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testDecode();
+    void testDropsWaitingPicture();
+    void testSingleNotification();
+    void testUndecodablePicture();
+    void testDeleteWhileQueued();
+
+private:
+    QByteArray m_picture;
+
+    MJpegPart part(const QByteArray &data) const;
+};
+
+void MJpegStreamDecoderTestCase::initTestCase()
+{
+    avcodec_register_all();
+
+    QImage image(QSize(640, 480), QImage::Format_RGB32);
+    image.fill(qRgb(200, 120, 40));
+
+    QBuffer buffer(&m_picture);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "JPEG", 80))
+        QSKIP("no JPEG encoder available");
+}
+
+MJpegPart MJpegStreamDecoderTestCase::part(const QByteArray &data) const
+{
+    MJpegPart result;
+    result.buffer = data;
+    result.offset = 0;
+    result.size = data.size();
+    return result;
+}
+
+void MJpegStreamDecoderTestCase::testDecode()
+{
+    DecodePool pool(1);
+    MJpegStreamDecoder decoder(&pool);
+    QSignalSpy spy(&decoder, SIGNAL(frameDecoded()));
+
+    QVERIFY(decoder.queuePicture(1, part(m_picture), QSize(320, 240)));
+    QTRY_COMPARE(spy.count(), 1);
+
+    MJpegStreamDecoder::Frame frame;
+    QVERIFY(decoder.takeFrame(&frame));
+    QCOMPARE(frame.id, quint64(1));
+    QCOMPARE(frame.pictureSize, QSize(640, 480));
+    QCOMPARE(frame.image.size(), QSize(320, 240));
+
+    QVERIFY(!decoder.takeFrame(&frame));
+}
+
+void MJpegStreamDecoderTestCase::testDropsWaitingPicture()
+{
+    DecodePool pool(1);
+    BlockingTask blocker;
+    pool.schedule(&blocker);
+    QVERIFY(blocker.started.tryAcquire(1, 5000));
+
+    MJpegStreamDecoder decoder(&pool);
+    QSignalSpy spy(&decoder, SIGNAL(frameDecoded()));
+
+    /* Nothing runs yet, so every picture but the last is dropped */
+    QVERIFY(decoder.queuePicture(1, part(m_picture), QSize()));
+    QVERIFY(!decoder.queuePicture(2, part(m_picture), QSize()));
+    QVERIFY(!decoder.queuePicture(3, part(m_picture), QSize()));
+    QCOMPARE(decoder.droppedPictures(), 2);
+
+    blocker.release.release();
+    QTRY_COMPARE(spy.count(), 1);
+
+    MJpegStreamDecoder::Frame frame;
+    QVERIFY(decoder.takeFrame(&frame));
+    QCOMPARE(frame.id, quint64(3));
+    QCOMPARE(frame.image.size(), QSize(640, 480));
+
+    pool.cancel(&blocker);
+}
+
+void MJpegStreamDecoderTestCase::testSingleNotification()
+{
+    DecodePool pool(1);
+    MJpegStreamDecoder decoder(&pool);
+    QSignalSpy spy(&decoder, SIGNAL(frameDecoded()));
+
+    /* Frames that aren't taken replace each other without another signal */
+    for (quint64 id = 1; id <= 5; ++id)
+    {
+        decoder.queuePicture(id, part(m_picture), QSize(160, 120));
+        QTRY_COMPARE(spy.count(), 1);
+        QTest::qWait(20);
+    }
+    QCOMPARE(spy.count(), 1);
+
+    MJpegStreamDecoder::Frame frame;
+    QVERIFY(decoder.takeFrame(&frame));
+    QCOMPARE(frame.id, quint64(5));
+
+    /* Once taken, the next frame is announced again */
+    decoder.queuePicture(6, part(m_picture), QSize(160, 120));
+    QTRY_COMPARE(spy.count(), 2);
+    QVERIFY(decoder.takeFrame(&frame));
+    QCOMPARE(frame.id, quint64(6));
+}
+
+void MJpegStreamDecoderTestCase::testUndecodablePicture()
+{
+    DecodePool pool(1);
+    MJpegStreamDecoder decoder(&pool);
+    QSignalSpy spy(&decoder, SIGNAL(frameDecoded()));
+
+    decoder.queuePicture(1, part(m_picture.left(m_picture.size() / 8)), QSize());
+    decoder.queuePicture(2, part(QByteArray("not a picture")), QSize());
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 0);
+
+    MJpegStreamDecoder::Frame frame;
+    QVERIFY(!decoder.takeFrame(&frame));
+}
+
+void MJpegStreamDecoderTestCase::testDeleteWhileQueued()
+{
+    DecodePool pool(1);
+    BlockingTask blocker;
+    pool.schedule(&blocker);
+    QVERIFY(blocker.started.tryAcquire(1, 5000));
+
+    /* Cancelled before it ever ran, taking its waiting picture with it */
+    MJpegStreamDecoder *decoder = new MJpegStreamDecoder(&pool);
+    decoder->queuePicture(1, part(m_picture), QSize());
+    delete decoder;
+
+    blocker.release.release();
+    pool.cancel(&blocker);
+}
+
+QTEST_MAIN(MJpegStreamDecoderTestCase)
+
+#include "MJpegStreamDecoderTestCase.moc"
@@ -0,0 +1,244 @@
+#include "core/MJpegStreamDecoder.h"
+#include "core/MJpegStreamNetwork.h"
+#include "core/MJpegStreamReader.h"
+#include "utils/LatencyHistogram.h"
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+
+extern "C" {
+#   include "libavcodec/avcodec.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* How late the GUI thread's event loop runs timers while 50 MJPEG streams are
+ * read from a local server, with the streams read and parsed on the GUI thread
+ * as they used to be and on network threads. Pictures are decoded on the MJPEG
+ * decode pool in both cases, and decoded frames are taken on the GUI thread as
+ * MJpegStream does. */
+
+static const int framesPerSecond = 15;
+static const int runTime = 3000;
+static const int timerInterval = 10;
+
+/* Serves the same picture as multipart MJPEG to every client, from its own
+ * thread. Clients that can't keep up miss pictures, as they would from a DVR. */
+class MJpegTestServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MJpegTestServer(const QByteArray &picture)
+        : m_picture(picture), m_server(this), m_timer(this)
+    {
+        connect(&m_server, SIGNAL(newConnection()), SLOT(newConnection()));
+        connect(&m_timer, SIGNAL(timeout()), SLOT(sendPicture()));
+    }
+
+    quint16 port() const { return m_server.serverPort(); }
+
+public slots:
+    void listen()
+    {
+        m_server.listen(QHostAddress::LocalHost);
+        m_timer.start(1000 / framesPerSecond);
+    }
+
+    void close()
+    {
+        m_timer.stop();
+        m_server.close();
+        qDeleteAll(m_clients);
+        m_clients.clear();
+    }
+
+private slots:
+    void newConnection()
+    {
+        while (QTcpSocket *client = m_server.nextPendingConnection())
+        {
+            client->write("HTTP/1.0 200 OK\r\n"
+                          "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n\r\n");
+            m_clients.append(client);
+        }
+    }
+
+    void sendPicture()
+    {
+        QByteArray part = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: "
+                + QByteArray::number(m_picture.size()) + "\r\n\r\n" + m_picture + "\r\n";
+
+        foreach (QTcpSocket *client, m_clients)
+        {
+            if (client->bytesToWrite() < 4 * part.size())
+                client->write(part);
+        }
+    }
+
+private:
+    QByteArray m_picture;
+    QTcpServer m_server;
+    QTimer m_timer;
+    QList<QTcpSocket *> m_clients;
+};
+
+/* Takes decoded frames on the GUI thread, until the readers are stopped */
+class FrameCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    FrameCounter() : frames(0), active(true) { }
+
+    int frames;
+    bool active;
+
+public slots:
+    void frameDecoded()
+    {
+        if (!active)
+            return;
+
+        MJpegStreamDecoder::Frame frame;
+        if (static_cast<MJpegStreamDecoder *>(sender())->takeFrame(&frame))
+            ++frames;
+    }
+};
+
+class MJpegStreamReaderBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchmarkEventLoopLatency_data();
+    void benchmarkEventLoopLatency();
+
+private:
+    QThread m_serverThread;
+    MJpegTestServer *m_server;
+};
+
+void MJpegStreamReaderBenchmark::initTestCase()
+{
+    avcodec_register_all();
+
+    QImage image(QSize(640, 480), QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            line[x] = qRgb((x * 7) & 0xff, (y * 3) & 0xff, ((x ^ y) >> 2) & 0xff);
+    }
+
+    QByteArray picture;
+    QBuffer buffer(&picture);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "JPEG", 80))
+        QSKIP("no JPEG encoder available");
+
+    m_server = new MJpegTestServer(picture);
+    m_server->moveToThread(&m_serverThread);
+    m_serverThread.start();
+    QMetaObject::invokeMethod(m_server, "listen", Qt::BlockingQueuedConnection);
+    QVERIFY(m_server->port());
+}
+
+void MJpegStreamReaderBenchmark::cleanupTestCase()
+{
+    if (!m_serverThread.isRunning())
+        return;
+
+    QMetaObject::invokeMethod(m_server, "close", Qt::BlockingQueuedConnection);
+    m_serverThread.quit();
+    m_serverThread.wait();
+    delete m_server;
+}
+
+void MJpegStreamReaderBenchmark::benchmarkEventLoopLatency_data()
+{
+    QTest::addColumn<int>("streamCount");
+    QTest::addColumn<int>("threadCount");
+
+    QTest::newRow("50 streams, GUI thread") << 50 << 0;
+    QTest::newRow("50 streams, network threads") << 50 << 2;
+}
+
+void MJpegStreamReaderBenchmark::benchmarkEventLoopLatency()
+{
+    QFETCH(int, streamCount);
+    QFETCH(int, threadCount);
+
+    MJpegStreamNetwork network(threadCount);
+    FrameCounter counter;
+    QList<QPointer<MJpegStreamReader> > readers;
+
+    QUrl url(QString::fromLatin1("http://127.0.0.1:%1/media/mjpeg.php").arg(m_server->port()));
+    for (int i = 0; i < streamCount; ++i)
+    {
+        QSharedPointer<TransferRateCalculator::Counter> transfer(new TransferRateCalculator::Counter);
+        MJpegStreamReader *reader = new MJpegStreamReader(url, transfer);
+        reader->setFrameSizeHint(QSize(320, 240));
+        connect(reader->decoder(), SIGNAL(frameDecoded()), &counter, SLOT(frameDecoded()),
+                Qt::QueuedConnection);
+        network.addReader(reader);
+        readers.append(reader);
+    }
+
+    /* Let every stream connect before measuring */
+    QTest::qWait(500);
+    int firstFrames = counter.frames;
+
+    LatencyHistogram lateness;
+    QElapsedTimer clock;
+    clock.start();
+    qint64 due = timerInterval * 1000;
+
+    QTimer timer;
+    timer.setTimerType(Qt::PreciseTimer);
+    timer.start(timerInterval);
+    QEventLoop loop;
+    connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+
+    while (clock.elapsed() < runTime)
+    {
+        loop.exec();
+        qint64 now = clock.nsecsElapsed() / 1000;
+        lateness.record(qMax(qint64(0), now - due));
+        due = now + timerInterval * 1000;
+    }
+
+    LatencySummary summary = lateness.summary();
+    int frames = counter.frames - firstFrames;
+    qDebug("%d streams, %s: timer lateness mean %lld us, 99th percentile %lld us, max %lld us; %.1f fps per stream",
+           streamCount, threadCount ? "network threads" : "GUI thread",
+           summary.mean(), summary.percentile(99), summary.max(),
+           frames * 1000.0 / runTime / streamCount);
+
+    /* Frames announced from here on may come from decoders already deleted */
+    counter.active = false;
+    foreach (MJpegStreamReader *reader, readers)
+        QMetaObject::invokeMethod(reader, "stop", Qt::QueuedConnection);
+
+    /* They delete themselves on their own threads */
+    int remaining = readers.size();
+    for (int wait = 0; wait < 5000 && remaining; wait += 10)
+    {
+        QTest::qWait(10);
+        remaining = 0;
+        foreach (const QPointer<MJpegStreamReader> &reader, readers)
+            remaining += reader ? 1 : 0;
+    }
+
+    QCOMPARE(remaining, 0);
+    QVERIFY(frames > 0);
+}
+
+QTEST_MAIN(MJpegStreamReaderBenchmark)
+
+#include "MJpegStreamReaderBenchmark.moc"
@@ -0,0 +1,74 @@
+#include "core/TransferRateCalculator.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class TransferRateCalculatorTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testCounterRate();
+    void testGroupRate();
+    void testReleasedCounter();
+};
+
+/* Rates are averaged over three samples of 750ms */
+static const int sampleWait = 900;
+static const quint64 sampleBytes = 3 * 750;
+
+void TransferRateCalculatorTestCase::testCounterRate()
+{
+    TransferRateCalculator calculator;
+    QSharedPointer<TransferRateCalculator::Counter> counter = calculator.createCounter();
+    QSignalSpy updated(&calculator, SIGNAL(rateUpdated(quint64)));
+
+    counter->add(sampleBytes);
+    QCOMPARE(counter->bytes(), sampleBytes);
+    QTest::qWait(sampleWait);
+
+    QVERIFY(updated.count() >= 1);
+    QCOMPARE(calculator.counterRate(counter.data()), quint64(1000));
+    QCOMPARE(calculator.currentRate(), quint64(1000));
+}
+
+void TransferRateCalculatorTestCase::testGroupRate()
+{
+    TransferRateCalculator calculator;
+    QObject server1, server2;
+    QSharedPointer<TransferRateCalculator::Counter> a = calculator.createCounter(&server1);
+    QSharedPointer<TransferRateCalculator::Counter> b = calculator.createCounter(&server1);
+    QSharedPointer<TransferRateCalculator::Counter> c = calculator.createCounter(&server2);
+
+    a->add(sampleBytes);
+    b->add(sampleBytes);
+    c->add(sampleBytes * 4);
+    QTest::qWait(sampleWait);
+
+    QCOMPARE(calculator.groupRate(&server1), quint64(2000));
+    QCOMPARE(calculator.groupRate(&server2), quint64(4000));
+    QCOMPARE(calculator.currentRate(), quint64(6000));
+}
+
+void TransferRateCalculatorTestCase::testReleasedCounter()
+{
+    TransferRateCalculator calculator;
+    QObject server;
+    QSharedPointer<TransferRateCalculator::Counter> counter = calculator.createCounter(&server);
+    const TransferRateCalculator::Counter *released = counter.data();
+
+    counter->add(sampleBytes);
+    QTest::qWait(sampleWait);
+    QCOMPARE(calculator.groupRate(&server), quint64(1000));
+
+    counter.clear();
+    QTest::qWait(sampleWait);
+
+    QCOMPARE(calculator.groupRate(&server), quint64(0));
+    QCOMPARE(calculator.counterRate(released), quint64(0));
+    /* The total keeps what was sampled before the counter went away */
+    QCOMPARE(calculator.currentRate(), quint64(1000));
+}
+
+QTEST_MAIN(TransferRateCalculatorTestCase)
+#include "TransferRateCalculatorTestCase.moc"
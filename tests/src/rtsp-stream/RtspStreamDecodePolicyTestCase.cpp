@@ -0,0 +1,149 @@
+#include "rtsp-stream/RtspStreamDecodePolicy.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavcodec/avcodec.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+Q_DECLARE_METATYPE(RtspStreamDecodePolicy::Level)
+
+class RtspStreamDecodePolicyTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testLevelForScale_data();
+    void testLevelForScale();
+    void testTileSizes();
+    void testMinimumLevel();
+    void testKeyframeWaitsForKeyframe();
+    void testFrameRateCap();
+};
+
+void RtspStreamDecodePolicyTestCase::testLevelForScale_data()
+{
+    QTest::addColumn<double>("scale");
+    QTest::addColumn<RtspStreamDecodePolicy::Level>("currentLevel");
+    QTest::addColumn<RtspStreamDecodePolicy::Level>("level");
+
+    QTest::newRow("native") << 1.0 << RtspStreamDecodePolicy::FullDecode << RtspStreamDecodePolicy::FullDecode;
+    QTest::newRow("half") << 0.5 << RtspStreamDecodePolicy::FullDecode << RtspStreamDecodePolicy::FullDecode;
+    QTest::newRow("quarter area") << 0.2 << RtspStreamDecodePolicy::FullDecode << RtspStreamDecodePolicy::ReducedDecode;
+    QTest::newRow("small") << 0.05 << RtspStreamDecodePolicy::FullDecode << RtspStreamDecodePolicy::MinimalDecode;
+    QTest::newRow("tiny") << 0.005 << RtspStreamDecodePolicy::FullDecode << RtspStreamDecodePolicy::KeyframeDecode;
+
+    /* Just above a threshold keeps the current level, further up leaves it */
+    QTest::newRow("stay reduced") << 0.3 << RtspStreamDecodePolicy::ReducedDecode << RtspStreamDecodePolicy::ReducedDecode;
+    QTest::newRow("leave reduced") << 0.4 << RtspStreamDecodePolicy::ReducedDecode << RtspStreamDecodePolicy::FullDecode;
+    QTest::newRow("stay keyframes") << 0.012 << RtspStreamDecodePolicy::KeyframeDecode << RtspStreamDecodePolicy::KeyframeDecode;
+    QTest::newRow("leave keyframes") << 0.02 << RtspStreamDecodePolicy::KeyframeDecode << RtspStreamDecodePolicy::MinimalDecode;
+    QTest::newRow("no hysteresis downwards") << 0.3 << RtspStreamDecodePolicy::FullDecode << RtspStreamDecodePolicy::FullDecode;
+}
+
+void RtspStreamDecodePolicyTestCase::testLevelForScale()
+{
+    QFETCH(double, scale);
+    QFETCH(RtspStreamDecodePolicy::Level, currentLevel);
+    QFETCH(RtspStreamDecodePolicy::Level, level);
+
+    QCOMPARE(RtspStreamDecodePolicy::levelForScale(scale, currentLevel), level);
+}
+
+void RtspStreamDecodePolicyTestCase::testTileSizes()
+{
+    RtspStreamDecodePolicy policy;
+    QSize streamSize(1920, 1080);
+
+    policy.update(QList<QSize>() << QSize(160, 90), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::KeyframeDecode);
+
+    /* The largest consumer decides */
+    policy.update(QList<QSize>() << QSize(160, 90) << QSize(1280, 720), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::FullDecode);
+
+    policy.update(QList<QSize>() << QSize(400, 225), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::MinimalDecode);
+
+    /* A consumer without a hint wants native size */
+    policy.update(QList<QSize>() << QSize(160, 90) << QSize(), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::FullDecode);
+
+    policy.update(QList<QSize>(), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::FullDecode);
+}
+
+void RtspStreamDecodePolicyTestCase::testMinimumLevel()
+{
+    RtspStreamDecodePolicy policy;
+    QSize streamSize(1920, 1080);
+
+    policy.setMinimumLevel(RtspStreamDecodePolicy::MinimalDecode);
+    policy.update(QList<QSize>() << QSize(), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::MinimalDecode);
+
+    /* Smaller tiles still go lower */
+    policy.update(QList<QSize>() << QSize(160, 90), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::KeyframeDecode);
+
+    /* Lifting the minimum leaves the level to the tile size again */
+    policy.setMinimumLevel(RtspStreamDecodePolicy::FullDecode);
+    policy.update(QList<QSize>() << QSize(1280, 720), streamSize);
+    QCOMPARE(policy.level(), RtspStreamDecodePolicy::FullDecode);
+}
+
+void RtspStreamDecodePolicyTestCase::testKeyframeWaitsForKeyframe()
+{
+    AVCodecContext *codecContext = avcodec_alloc_context3(NULL);
+    RtspStreamDecodePolicy policy;
+    QSize streamSize(1920, 1080);
+
+    policy.update(QList<QSize>() << QSize(160, 90), streamSize);
+    policy.apply(codecContext, false);
+    QCOMPARE(policy.appliedLevel(), RtspStreamDecodePolicy::KeyframeDecode);
+    QCOMPARE(codecContext->skip_frame, AVDISCARD_NONKEY);
+    QCOMPARE(codecContext->skip_loop_filter, AVDISCARD_ALL);
+
+    policy.update(QList<QSize>() << QSize(1920, 1080), streamSize);
+    policy.apply(codecContext, false);
+    QCOMPARE(policy.appliedLevel(), RtspStreamDecodePolicy::KeyframeDecode);
+    QCOMPARE(codecContext->skip_frame, AVDISCARD_NONKEY);
+
+    policy.apply(codecContext, true);
+    QCOMPARE(policy.appliedLevel(), RtspStreamDecodePolicy::FullDecode);
+    QCOMPARE(codecContext->skip_frame, AVDISCARD_DEFAULT);
+    QCOMPARE(codecContext->skip_loop_filter, AVDISCARD_DEFAULT);
+
+    avcodec_free_context(&codecContext);
+}
+
+void RtspStreamDecodePolicyTestCase::testFrameRateCap()
+{
+    AVCodecContext *codecContext = avcodec_alloc_context3(NULL);
+    RtspStreamDecodePolicy policy;
+
+    /* Uncapped at full level */
+    for (int i = 0; i < 25; ++i)
+        QVERIFY(policy.acceptFrame(i * 40000));
+
+    policy.update(QList<QSize>() << QSize(800, 450), QSize(1920, 1080));
+    policy.apply(codecContext, false);
+    QCOMPARE(policy.appliedLevel(), RtspStreamDecodePolicy::ReducedDecode);
+
+    int accepted = 0;
+    for (int i = 25; i < 75; ++i)
+        if (policy.acceptFrame(i * 40000))
+            accepted++;
+    QCOMPARE(accepted, 25);
+
+    /* Timestamps restarting are not held back */
+    QVERIFY(policy.acceptFrame(0));
+    QVERIFY(policy.acceptFrame(AV_NOPTS_VALUE));
+
+    avcodec_free_context(&codecContext);
+}
+
+QTEST_MAIN(RtspStreamDecodePolicyTestCase)
+
+#include "RtspStreamDecodePolicyTestCase.moc"
@@ -0,0 +1,203 @@
+#include "rtsp-stream/RtspStreamDecodeThreading.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavcodec/avcodec.h"
+#   include "libavutil/frame.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Decodes one second of video at a range of resolutions with each threading
+ * mode, to find where extra threads start paying off. The clip is encoded with
+ * the mpeg4 encoder bundled with the client's FFmpeg, so absolute numbers are
+ * lower than for H.264 or HEVC but the crossover points show the same way. */
+
+static const int clipFrames = 25;
+
+class RtspStreamDecodeThreadingBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkDecode_data();
+    void benchmarkDecode();
+    void testChoose();
+
+private:
+    QList<AVPacket *> encodeClip(int width, int height);
+};
+
+QList<AVPacket *> RtspStreamDecodeThreadingBenchmark::encodeClip(int width, int height)
+{
+    QList<AVPacket *> packets;
+
+    AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    if (!codec)
+        return packets;
+
+    AVCodecContext *encoder = avcodec_alloc_context3(codec);
+    encoder->width = width;
+    encoder->height = height;
+    encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoder->time_base.num = 1;
+    encoder->time_base.den = clipFrames;
+    encoder->gop_size = clipFrames;
+    encoder->bit_rate = qint64(width) * height * 2;
+
+    if (avcodec_open2(encoder, codec, NULL) < 0)
+    {
+        avcodec_free_context(&encoder);
+        return packets;
+    }
+
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    av_frame_get_buffer(frame, 32);
+
+    for (int i = 0; i <= clipFrames; ++i)
+    {
+        if (i < clipFrames)
+        {
+            av_frame_make_writable(frame);
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x)
+                    frame->data[0][y * frame->linesize[0] + x] = uint8_t(x + y * 2 + i * 8);
+            for (int y = 0; y < height / 2; ++y)
+            {
+                memset(frame->data[1] + y * frame->linesize[1], 128 + i, width / 2);
+                memset(frame->data[2] + y * frame->linesize[2], 128 - i, width / 2);
+            }
+            frame->pts = i;
+        }
+
+        avcodec_send_frame(encoder, i < clipFrames ? frame : NULL);
+
+        AVPacket *packet = av_packet_alloc();
+        while (avcodec_receive_packet(encoder, packet) == 0)
+        {
+            packets.append(packet);
+            packet = av_packet_alloc();
+        }
+        av_packet_free(&packet);
+    }
+
+    av_frame_free(&frame);
+    avcodec_free_context(&encoder);
+    return packets;
+}
+
+void RtspStreamDecodeThreadingBenchmark::benchmarkDecode_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("threads");
+
+    QList<QSize> sizes;
+    sizes << QSize(704, 480) << QSize(1280, 720) << QSize(1920, 1080) << QSize(3840, 2160);
+
+    foreach (const QSize &size, sizes)
+    {
+        foreach (int threads, QList<int>() << 1 << 2 << 4 << 8)
+        {
+            QTest::newRow(qPrintable(QString::fromLatin1("%1x%2, %3 threads").arg(size.width()).arg(size.height()).arg(threads)))
+                    << size.width() << size.height() << threads;
+        }
+    }
+}
+
+void RtspStreamDecodeThreadingBenchmark::benchmarkDecode()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, threads);
+
+    QList<AVPacket *> packets = encodeClip(width, height);
+    if (packets.isEmpty())
+        QSKIP("mpeg4 encoder not available");
+
+    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_MPEG4);
+    QVERIFY(codec);
+    AVFrame *frame = av_frame_alloc();
+
+    QBENCHMARK
+    {
+        AVCodecContext *decoder = avcodec_alloc_context3(codec);
+        decoder->thread_count = threads;
+        decoder->thread_type = FF_THREAD_FRAME;
+        QCOMPARE(avcodec_open2(decoder, codec, NULL), 0);
+
+        int decodedFrames = 0;
+        foreach (AVPacket *packet, packets)
+        {
+            avcodec_send_packet(decoder, packet);
+            while (avcodec_receive_frame(decoder, frame) == 0)
+                decodedFrames++;
+        }
+
+        avcodec_send_packet(decoder, NULL);
+        while (avcodec_receive_frame(decoder, frame) == 0)
+            decodedFrames++;
+
+        QCOMPARE(decodedFrames, clipFrames);
+        avcodec_free_context(&decoder);
+    }
+
+    av_frame_free(&frame);
+    foreach (AVPacket *packet, packets)
+        av_packet_free(&packet);
+}
+
+void RtspStreamDecodeThreadingBenchmark::testChoose()
+{
+    int bothThreadings = AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS;
+    RtspStreamDecodeThreading threading;
+
+    /* D1 and 1080p H.264 fit on one core */
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 704, 480, 1, 8);
+    QCOMPARE(threading.threadCount(), 1);
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 1920, 1080, 1, 8);
+    QCOMPARE(threading.threadCount(), 1);
+
+    /* 1080p HEVC takes two, without frame delay */
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_HEVC, bothThreadings, 1920, 1080, 1, 8);
+    QCOMPARE(threading.threadCount(), 2);
+    QCOMPARE(threading.threadType(), FF_THREAD_SLICE);
+
+    /* 4K needs frame threading */
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 3840, 2160, 1, 8);
+    QCOMPARE(threading.threadCount(), 4);
+    QCOMPARE(threading.threadType(), FF_THREAD_FRAME);
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_HEVC, bothThreadings, 3840, 2160, 1, 16);
+    QCOMPARE(threading.threadCount(), 8);
+
+    /* Cores are shared between live streams */
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 3840, 2160, 3, 8);
+    QCOMPARE(threading.threadCount(), 2);
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 3840, 2160, 8, 8);
+    QCOMPARE(threading.threadCount(), 1);
+
+    /* Frame threading only codecs and unknown sizes */
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_MPEG4, AV_CODEC_CAP_FRAME_THREADS, 3840, 2160, 1, 2);
+    QCOMPARE(threading.threadCount(), 2);
+    QCOMPARE(threading.threadType(), FF_THREAD_FRAME);
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 0, 0, 1, 8);
+    QCOMPARE(threading.threadCount(), 1);
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_MJPEG, 0, 3840, 2160, 1, 8);
+    QCOMPARE(threading.threadCount(), 1);
+
+    /* Low delay streams never wait for frame threads */
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 3840, 2160, 1, 8, true);
+    QCOMPARE(threading.threadCount(), 4);
+    QCOMPARE(threading.threadType(), FF_THREAD_SLICE);
+    threading = RtspStreamDecodeThreading::choose(AV_CODEC_ID_MPEG4, AV_CODEC_CAP_FRAME_THREADS, 3840, 2160, 1, 2, true);
+    QCOMPARE(threading.threadCount(), 1);
+
+    QVERIFY(RtspStreamDecodeThreading() == RtspStreamDecodeThreading::choose(AV_CODEC_ID_H264, bothThreadings, 704, 480, 1, 8));
+}
+
+QTEST_MAIN(RtspStreamDecodeThreadingBenchmark)
+
+#include "RtspStreamDecodeThreadingBenchmark.moc"
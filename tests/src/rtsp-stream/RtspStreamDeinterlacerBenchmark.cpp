@@ -0,0 +1,195 @@
+#include "rtsp-stream/RtspStreamDeinterlacer.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavfilter/avfilter.h"
+#   include "libavutil/frame.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Per-frame cost of each deinterlacing mode at the resolutions of interlaced
+ * cameras and capture cards. Field deinterlacing should cost next to nothing;
+ * the filter is what an interlaced stream shown larger than a field pays. */
+class RtspStreamDeinterlacerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkDeinterlace_data();
+    void benchmarkDeinterlace();
+    void testField();
+    void testFilter();
+    void testSizeChange();
+
+private:
+    AVFrame * createInterlacedFrame(int width, int height, int pts);
+};
+
+static AVRational timeBase()
+{
+    AVRational result = { 1, 90000 };
+    return result;
+}
+
+static AVRational squarePixels()
+{
+    AVRational result = { 1, 1 };
+    return result;
+}
+
+void RtspStreamDeinterlacerBenchmark::initTestCase()
+{
+    avfilter_register_all();
+}
+
+AVFrame * RtspStreamDeinterlacerBenchmark::createInterlacedFrame(int width, int height, int pts)
+{
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    frame->pts = pts;
+    frame->interlaced_frame = 1;
+    frame->top_field_first = 1;
+    av_frame_get_buffer(frame, 32);
+
+    /* A moving edge, with the fields caught half a step apart */
+    for (int y = 0; y < height; ++y)
+    {
+        int edge = (pts * 8 + (y & 1) * 4) % width;
+        for (int x = 0; x < width; ++x)
+            frame->data[0][y * frame->linesize[0] + x] = x < edge ? 235 : 16;
+    }
+
+    for (int y = 0; y < (height + 1) / 2; ++y)
+    {
+        memset(frame->data[1] + y * frame->linesize[1], 128, (width + 1) / 2);
+        memset(frame->data[2] + y * frame->linesize[2], 128, (width + 1) / 2);
+    }
+
+    return frame;
+}
+
+void RtspStreamDeinterlacerBenchmark::benchmarkDeinterlace_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("mode");
+
+    QList<QSize> sizes;
+    sizes << QSize(704, 480) << QSize(720, 576) << QSize(1920, 1080);
+
+    foreach (const QSize &size, sizes)
+    {
+        QString name = QString::fromLatin1("%1x%2").arg(size.width()).arg(size.height());
+        QTest::newRow(qPrintable(name + QLatin1String(", field"))) << size << int(RtspStreamDeinterlacer::FieldDeinterlacing);
+        QTest::newRow(qPrintable(name + QLatin1String(", filter"))) << size << int(RtspStreamDeinterlacer::FilterDeinterlacing);
+    }
+}
+
+void RtspStreamDeinterlacerBenchmark::benchmarkDeinterlace()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, mode);
+
+    if (mode == RtspStreamDeinterlacer::FilterDeinterlacing && !RtspStreamDeinterlacer::filterName())
+        QSKIP("no deinterlacing filter available");
+
+    QList<AVFrame *> frames;
+    for (int i = 0; i < 8; ++i)
+        frames.append(createInterlacedFrame(size.width(), size.height(), i));
+
+    RtspStreamDeinterlacer deinterlacer(timeBase(), squarePixels());
+    int pts = 0;
+
+    QBENCHMARK
+    {
+        AVFrame *frame = frames.at(pts % frames.size());
+        frame->pts = pts++;
+        QVERIFY(deinterlacer.deinterlace(frame, RtspStreamDeinterlacer::Mode(mode)));
+    }
+
+    foreach (AVFrame *frame, frames)
+        av_frame_free(&frame);
+}
+
+void RtspStreamDeinterlacerBenchmark::testField()
+{
+    AVFrame *frame = createInterlacedFrame(704, 480, 3);
+    RtspStreamDeinterlacer deinterlacer(timeBase(), squarePixels());
+
+    AVFrame *field = deinterlacer.deinterlace(frame, RtspStreamDeinterlacer::FieldDeinterlacing);
+    QVERIFY(field);
+    QVERIFY(field != frame);
+    QCOMPARE(field->width, 704);
+    QCOMPARE(field->height, 240);
+    QCOMPARE(field->pts, frame->pts);
+    for (int i = 0; i < 3; ++i)
+    {
+        QCOMPARE(field->data[i], frame->data[i]);
+        QCOMPARE(field->linesize[i], frame->linesize[i] * 2);
+    }
+
+    /* The decoded frame is left as it was */
+    QCOMPARE(frame->height, 480);
+
+    av_frame_free(&frame);
+}
+
+void RtspStreamDeinterlacerBenchmark::testFilter()
+{
+    if (!RtspStreamDeinterlacer::filterName())
+        QSKIP("no deinterlacing filter available");
+
+    RtspStreamDeinterlacer deinterlacer(timeBase(), squarePixels());
+
+    /* The filter waits for the next frame; the first is shown as a field */
+    AVFrame *first = createInterlacedFrame(720, 576, 0);
+    AVFrame *result = deinterlacer.deinterlace(first, RtspStreamDeinterlacer::FilterDeinterlacing);
+    QVERIFY(result);
+    QCOMPARE(result->height, 288);
+
+    for (int i = 1; i < 5; ++i)
+    {
+        AVFrame *frame = createInterlacedFrame(720, 576, i);
+        result = deinterlacer.deinterlace(frame, RtspStreamDeinterlacer::FilterDeinterlacing);
+        QVERIFY(result);
+        QCOMPARE(result->width, 720);
+        QCOMPARE(result->height, 576);
+        QCOMPARE(result->pts, frame->pts);
+        QVERIFY(!result->interlaced_frame);
+        QVERIFY(result->data[0] != frame->data[0]);
+        av_frame_free(&frame);
+    }
+
+    av_frame_free(&first);
+}
+
+void RtspStreamDeinterlacerBenchmark::testSizeChange()
+{
+    if (!RtspStreamDeinterlacer::filterName())
+        QSKIP("no deinterlacing filter available");
+
+    RtspStreamDeinterlacer deinterlacer(timeBase(), squarePixels());
+    QList<AVFrame *> frames;
+    frames << createInterlacedFrame(704, 480, 0) << createInterlacedFrame(704, 480, 1)
+           << createInterlacedFrame(720, 576, 2) << createInterlacedFrame(720, 576, 3);
+
+    QCOMPARE(deinterlacer.deinterlace(frames.at(0), RtspStreamDeinterlacer::FilterDeinterlacing)->height, 240);
+    QCOMPARE(deinterlacer.deinterlace(frames.at(1), RtspStreamDeinterlacer::FilterDeinterlacing)->height, 480);
+    /* A new graph is built for the new size */
+    QCOMPARE(deinterlacer.deinterlace(frames.at(2), RtspStreamDeinterlacer::FilterDeinterlacing)->height, 288);
+    QCOMPARE(deinterlacer.deinterlace(frames.at(3), RtspStreamDeinterlacer::FilterDeinterlacing)->height, 576);
+
+    /* Switching to fields and back starts the filter over */
+    QCOMPARE(deinterlacer.deinterlace(frames.at(2), RtspStreamDeinterlacer::FieldDeinterlacing)->height, 288);
+    QCOMPARE(deinterlacer.deinterlace(frames.at(3), RtspStreamDeinterlacer::FilterDeinterlacing)->height, 288);
+
+    foreach (AVFrame *frame, frames)
+        av_frame_free(&frame);
+}
+
+QTEST_MAIN(RtspStreamDeinterlacerBenchmark)
+
+#include "RtspStreamDeinterlacerBenchmark.moc"
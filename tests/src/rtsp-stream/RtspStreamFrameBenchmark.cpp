@@ -0,0 +1,162 @@
+#include "rtsp-stream/RtspStreamFrame.h"
+#include "rtsp-stream/RtspStreamFrameFormatter.h"
+#include <QtTest/QtTest>
+#include <cstring>
+
+extern "C" {
+#   include "libavutil/buffer.h"
+#   include "libavutil/frame.h"
+#   include "libavutil/imgutils.h"
+#   include "libavutil/mem.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Compares the per-frame cost of allocating scaled output frames the way
+ * RtspStreamFrameFormatter used to (av_malloc + av_frame_alloc for each frame)
+ * with taking them from an AVBufferPool. Buffers are filled like sws_scale
+ * would, so page faults on freshly mapped memory are part of the measurement. */
+class RtspStreamFrameBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkMallocPerFrame_data();
+    void benchmarkMallocPerFrame();
+    void benchmarkPooledFrame_data();
+    void benchmarkPooledFrame();
+    void testPooledFrameReuse();
+    void testSharedImageKeepsBuffer();
+    void testOutputSize();
+
+private:
+    void resolutions();
+};
+
+void RtspStreamFrameBenchmark::resolutions()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+
+    QTest::newRow("D1") << 704 << 480;
+    QTest::newRow("720p") << 1280 << 720;
+    QTest::newRow("1080p") << 1920 << 1080;
+    QTest::newRow("4K") << 3840 << 2160;
+}
+
+void RtspStreamFrameBenchmark::benchmarkMallocPerFrame_data()
+{
+    resolutions();
+}
+
+void RtspStreamFrameBenchmark::benchmarkMallocPerFrame()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+
+    int bufSize = av_image_get_buffer_size(AV_PIX_FMT_BGRA, width, height, 4);
+
+    QBENCHMARK
+    {
+        uint8_t *buf = (uint8_t*) av_malloc(bufSize);
+        AVFrame *frame = av_frame_alloc();
+        av_image_fill_arrays(frame->data, frame->linesize, buf, AV_PIX_FMT_BGRA, width, height, 4);
+        memset(frame->data[0], 0, bufSize);
+
+        av_free(frame->data[0]);
+        av_frame_free(&frame);
+    }
+}
+
+void RtspStreamFrameBenchmark::benchmarkPooledFrame_data()
+{
+    resolutions();
+}
+
+void RtspStreamFrameBenchmark::benchmarkPooledFrame()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+
+    int bufSize = av_image_get_buffer_size(AV_PIX_FMT_BGRA, width, height, 4);
+    AVBufferPool *pool = av_buffer_pool_init(bufSize, NULL);
+    QVERIFY(pool);
+
+    QBENCHMARK
+    {
+        RtspStreamFrame frame;
+        QVERIFY(frame.prepare(0, pool, AV_PIX_FMT_BGRA, width, height));
+        memset(frame.avFrame()->data[0], 0, bufSize);
+    }
+
+    av_buffer_pool_uninit(&pool);
+}
+
+void RtspStreamFrameBenchmark::testPooledFrameReuse()
+{
+    int bufSize = av_image_get_buffer_size(AV_PIX_FMT_BGRA, 640, 480, 4);
+    AVBufferPool *pool = av_buffer_pool_init(bufSize, NULL);
+
+    RtspStreamFrame frame;
+    QVERIFY(frame.prepare(0, pool, AV_PIX_FMT_BGRA, 640, 480));
+    uint8_t *data = frame.avFrame()->data[0];
+    QCOMPARE(frame.avFrame()->width, 640);
+    QCOMPARE(frame.avFrame()->linesize[0], 640 * 4);
+
+    /* Same geometry keeps the buffer */
+    QVERIFY(frame.prepare(0, pool, AV_PIX_FMT_BGRA, 640, 480));
+    QCOMPARE(frame.avFrame()->data[0], data);
+
+    /* Frames released to the pool hand their buffer to the next one */
+    {
+        RtspStreamFrame other;
+        QVERIFY(other.prepare(0, pool, AV_PIX_FMT_BGRA, 640, 480));
+        QVERIFY(other.avFrame()->data[0] != data);
+    }
+
+    /* Uninit only frees the pool once the last buffer is returned */
+    av_buffer_pool_uninit(&pool);
+    QCOMPARE(frame.avFrame()->data[0], data);
+    memset(frame.avFrame()->data[0], 0, bufSize);
+}
+
+void RtspStreamFrameBenchmark::testSharedImageKeepsBuffer()
+{
+    int bufSize = av_image_get_buffer_size(AV_PIX_FMT_BGRA, 320, 240, 4);
+    AVBufferPool *pool = av_buffer_pool_init(bufSize, NULL);
+
+    RtspStreamFrame frame;
+    frame.setOutputCount(2);
+    QCOMPARE(frame.outputCount(), 2);
+    QVERIFY(frame.prepare(0, pool, AV_PIX_FMT_BGRA, 320, 240));
+    QVERIFY(frame.prepare(1, pool, AV_PIX_FMT_BGRA, 320, 240));
+    QVERIFY(frame.avFrame(0)->data[0] != frame.avFrame(1)->data[0]);
+
+    uint8_t *data = frame.avFrame(0)->data[0];
+    QImage image = frame.image(0);
+    QCOMPARE(image.size(), QSize(320, 240));
+    QCOMPARE(image.constBits(), (const uchar *)data);
+
+    /* While the image is referenced, the frame must not write into its buffer */
+    QVERIFY(frame.prepare(0, pool, AV_PIX_FMT_BGRA, 320, 240));
+    QVERIFY(frame.avFrame(0)->data[0] != data);
+    QCOMPARE(image.constBits(), (const uchar *)data);
+
+    av_buffer_pool_uninit(&pool);
+}
+
+void RtspStreamFrameBenchmark::testOutputSize()
+{
+    QSize streamSize(1920, 1080);
+
+    QCOMPARE(RtspStreamFrameFormatter::outputSize(QSize(), streamSize), streamSize);
+    QCOMPARE(RtspStreamFrameFormatter::outputSize(QSize(-1, -1), streamSize), streamSize);
+    QCOMPARE(RtspStreamFrameFormatter::outputSize(QSize(320, 180), streamSize), QSize(320, 180));
+    QCOMPARE(RtspStreamFrameFormatter::outputSize(QSize(1920, 1080), streamSize), streamSize);
+    QCOMPARE(RtspStreamFrameFormatter::outputSize(QSize(2560, 1440), streamSize), streamSize);
+    QCOMPARE(RtspStreamFrameFormatter::outputSize(QSize(800, 1200), streamSize), streamSize);
+}
+
+QTEST_MAIN(RtspStreamFrameBenchmark)
+
+#include "RtspStreamFrameBenchmark.moc"
@@ -0,0 +1,254 @@
+#include "rtsp-stream/RtspStreamFrameScaler.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavutil/frame.h"
+#   include "libavutil/imgutils.h"
+#   include "libswscale/swscale.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Compares RtspStreamFrameScaler with swscale (SWS_FAST_BILINEAR, which the
+ * formatter used for everything before) converting common camera resolutions
+ * to BGRA at native size and at typical live view tile sizes. */
+class RtspStreamFrameScalerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkSwscale_data();
+    void benchmarkSwscale();
+    void benchmarkFrameScaler_data();
+    void benchmarkFrameScaler();
+    void testMatchesSwscale_data();
+    void testMatchesSwscale();
+    void testFlatColor();
+
+private:
+    void sizes();
+    AVFrame * createPicture(AVPixelFormat format, int width, int height);
+    AVFrame * createOutput(int width, int height);
+};
+
+void RtspStreamFrameScalerBenchmark::sizes()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QSize>("sourceSize");
+    QTest::addColumn<QSize>("outputSize");
+
+    QList<QSize> sources;
+    sources << QSize(704, 480) << QSize(1280, 720) << QSize(1920, 1080) << QSize(3840, 2160);
+    QList<QSize> tiles;
+    tiles << QSize() << QSize(960, 540) << QSize(480, 270) << QSize(160, 90);
+
+    foreach (const QSize &source, sources)
+    {
+        foreach (const QSize &tile, tiles)
+        {
+            if (!tile.isEmpty() && tile.width() >= source.width())
+                continue;
+            QSize output = tile.isEmpty() ? source : tile;
+
+            QString name = QString::fromLatin1("%1x%2 to %3x%4").arg(source.width()).arg(source.height())
+                    .arg(output.width()).arg(output.height());
+            QTest::newRow(qPrintable(name + QLatin1String(", yuv420p"))) << int(AV_PIX_FMT_YUV420P) << source << output;
+            QTest::newRow(qPrintable(name + QLatin1String(", nv12"))) << int(AV_PIX_FMT_NV12) << source << output;
+        }
+    }
+}
+
+AVFrame * RtspStreamFrameScalerBenchmark::createPicture(AVPixelFormat format, int width, int height)
+{
+    AVFrame *frame = av_frame_alloc();
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    av_frame_get_buffer(frame, 32);
+
+    /* Smooth gradients, so that differences in filtering barely show */
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            frame->data[0][y * frame->linesize[0] + x] = uint8_t(16 + (x + y) * 219 / (width + height));
+
+    for (int y = 0; y < (height + 1) / 2; ++y)
+    {
+        for (int x = 0; x < (width + 1) / 2; ++x)
+        {
+            uint8_t u = uint8_t(64 + x * 128 / width);
+            uint8_t v = uint8_t(192 - y * 128 / height);
+            if (format == AV_PIX_FMT_NV12)
+            {
+                frame->data[1][y * frame->linesize[1] + 2 * x] = u;
+                frame->data[1][y * frame->linesize[1] + 2 * x + 1] = v;
+            }
+            else
+            {
+                frame->data[1][y * frame->linesize[1] + x] = u;
+                frame->data[2][y * frame->linesize[2] + x] = v;
+            }
+        }
+    }
+
+    return frame;
+}
+
+AVFrame * RtspStreamFrameScalerBenchmark::createOutput(int width, int height)
+{
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_BGRA;
+    frame->width = width;
+    frame->height = height;
+    av_frame_get_buffer(frame, 32);
+    return frame;
+}
+
+void RtspStreamFrameScalerBenchmark::benchmarkSwscale_data()
+{
+    sizes();
+}
+
+void RtspStreamFrameScalerBenchmark::benchmarkSwscale()
+{
+    QFETCH(int, format);
+    QFETCH(QSize, sourceSize);
+    QFETCH(QSize, outputSize);
+
+    AVFrame *picture = createPicture(AVPixelFormat(format), sourceSize.width(), sourceSize.height());
+    AVFrame *output = createOutput(outputSize.width(), outputSize.height());
+    SwsContext *context = sws_getContext(sourceSize.width(), sourceSize.height(), AVPixelFormat(format),
+                                         outputSize.width(), outputSize.height(), AV_PIX_FMT_BGRA,
+                                         SWS_FAST_BILINEAR, NULL, NULL, NULL);
+    QVERIFY(context);
+
+    QBENCHMARK
+    {
+        sws_scale(context, (const uint8_t **)picture->data, picture->linesize, 0, sourceSize.height(),
+                  output->data, output->linesize);
+    }
+
+    sws_freeContext(context);
+    av_frame_free(&output);
+    av_frame_free(&picture);
+}
+
+void RtspStreamFrameScalerBenchmark::benchmarkFrameScaler_data()
+{
+    sizes();
+}
+
+void RtspStreamFrameScalerBenchmark::benchmarkFrameScaler()
+{
+    QFETCH(int, format);
+    QFETCH(QSize, sourceSize);
+    QFETCH(QSize, outputSize);
+
+    AVFrame *picture = createPicture(AVPixelFormat(format), sourceSize.width(), sourceSize.height());
+    AVFrame *output = createOutput(outputSize.width(), outputSize.height());
+    RtspStreamFrameScaler scaler;
+
+    QBENCHMARK
+    {
+        scaler.scale(picture->data, picture->linesize, AVPixelFormat(format), sourceSize.width(), sourceSize.height(),
+                     output->data[0], output->linesize[0], outputSize.width(), outputSize.height());
+    }
+
+    av_frame_free(&output);
+    av_frame_free(&picture);
+}
+
+void RtspStreamFrameScalerBenchmark::testMatchesSwscale_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QSize>("sourceSize");
+    QTest::addColumn<QSize>("outputSize");
+
+    QTest::newRow("native") << int(AV_PIX_FMT_YUV420P) << QSize(704, 480) << QSize(704, 480);
+    QTest::newRow("native nv12") << int(AV_PIX_FMT_NV12) << QSize(704, 480) << QSize(704, 480);
+    QTest::newRow("half") << int(AV_PIX_FMT_YUV420P) << QSize(1280, 720) << QSize(640, 360);
+    QTest::newRow("fractional") << int(AV_PIX_FMT_YUV420P) << QSize(1920, 1080) << QSize(333, 187);
+    QTest::newRow("fractional nv12") << int(AV_PIX_FMT_NV12) << QSize(1920, 1080) << QSize(333, 187);
+    QTest::newRow("odd size") << int(AV_PIX_FMT_YUV420P) << QSize(641, 361) << QSize(101, 57);
+}
+
+void RtspStreamFrameScalerBenchmark::testMatchesSwscale()
+{
+    QFETCH(int, format);
+    QFETCH(QSize, sourceSize);
+    QFETCH(QSize, outputSize);
+
+    QVERIFY(RtspStreamFrameScaler::isSupported(AVPixelFormat(format)));
+
+    AVFrame *picture = createPicture(AVPixelFormat(format), sourceSize.width(), sourceSize.height());
+    AVFrame *expected = createOutput(outputSize.width(), outputSize.height());
+    AVFrame *actual = createOutput(outputSize.width(), outputSize.height());
+
+    SwsContext *context = sws_getContext(sourceSize.width(), sourceSize.height(), AVPixelFormat(format),
+                                         outputSize.width(), outputSize.height(), AV_PIX_FMT_BGRA,
+                                         SWS_BILINEAR, NULL, NULL, NULL);
+    sws_scale(context, (const uint8_t **)picture->data, picture->linesize, 0, sourceSize.height(),
+              expected->data, expected->linesize);
+    sws_freeContext(context);
+
+    RtspStreamFrameScaler scaler;
+    scaler.scale(picture->data, picture->linesize, AVPixelFormat(format), sourceSize.width(), sourceSize.height(),
+                 actual->data[0], actual->linesize[0], outputSize.width(), outputSize.height());
+
+    qint64 totalDifference = 0;
+    int maxDifference = 0;
+    for (int y = 0; y < outputSize.height(); ++y)
+    {
+        for (int x = 0; x < outputSize.width() * 4; ++x)
+        {
+            int difference = qAbs(expected->data[0][y * expected->linesize[0] + x] - actual->data[0][y * actual->linesize[0] + x]);
+            totalDifference += difference;
+            maxDifference = qMax(maxDifference, difference);
+        }
+    }
+
+    double meanDifference = double(totalDifference) / (outputSize.width() * outputSize.height() * 4);
+    QVERIFY2(meanDifference < 2, qPrintable(QString::number(meanDifference)));
+    QVERIFY2(maxDifference < 12, qPrintable(QString::number(maxDifference)));
+
+    av_frame_free(&actual);
+    av_frame_free(&expected);
+    av_frame_free(&picture);
+}
+
+void RtspStreamFrameScalerBenchmark::testFlatColor()
+{
+    AVFrame *picture = av_frame_alloc();
+    picture->format = AV_PIX_FMT_YUV420P;
+    picture->width = 99;
+    picture->height = 51;
+    av_frame_get_buffer(picture, 32);
+    memset(picture->data[0], 81, picture->linesize[0] * picture->height);
+    memset(picture->data[1], 90, picture->linesize[1] * ((picture->height + 1) / 2));
+    memset(picture->data[2], 240, picture->linesize[2] * ((picture->height + 1) / 2));
+
+    /* Y 81, U 90, V 240 is studio range red */
+    RtspStreamFrameScaler scaler;
+    QList<QSize> outputSizes;
+    outputSizes << QSize(99, 51) << QSize(37, 20) << QSize(1, 1);
+
+    foreach (const QSize &size, outputSizes)
+    {
+        QVector<uint8_t> output(size.width() * size.height() * 4);
+        scaler.scale(picture->data, picture->linesize, AV_PIX_FMT_YUV420P, picture->width, picture->height,
+                     output.data(), size.width() * 4, size.width(), size.height());
+
+        for (int i = 0; i < output.size(); i += 4)
+        {
+            QVERIFY(output[i] <= 1);
+            QVERIFY(output[i + 1] <= 1);
+            QVERIFY(output[i + 2] >= 254);
+            QCOMPARE(int(output[i + 3]), 255);
+        }
+    }
+
+    av_frame_free(&picture);
+}
+
+QTEST_MAIN(RtspStreamFrameScalerBenchmark)
+
+#include "RtspStreamFrameScalerBenchmark.moc"
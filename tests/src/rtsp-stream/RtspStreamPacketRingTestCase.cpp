@@ -0,0 +1,189 @@
+#include "rtsp-stream/RtspStreamPacketRing.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavcodec/avcodec.h"
+#   include "libavformat/avformat.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class RtspStreamPacketRingTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testStartsOnKeyFrame();
+    void testLength();
+    void testMemoryLimit();
+    void testClip();
+    void testInterrupt();
+
+private:
+    AVFormatContext *m_context;
+    qint64 m_memoryLimit;
+
+    /* Video at 10 fps with a keyframe every second, on a microsecond clock */
+    void appendVideo(RtspStreamPacketRing &ring, int frame, int size = 1000);
+    void appendAudio(RtspStreamPacketRing &ring);
+};
+
+void RtspStreamPacketRingTestCase::init()
+{
+    m_memoryLimit = RtspStreamPacketRing::memoryLimit();
+
+    m_context = avformat_alloc_context();
+    AVStream *video = avformat_new_stream(m_context, NULL);
+    video->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    video->codecpar->codec_id = AV_CODEC_ID_H264;
+    video->time_base.num = 1;
+    video->time_base.den = 1000000;
+
+    AVStream *audio = avformat_new_stream(m_context, NULL);
+    audio->codecpar->codec_type = AVMEDIA_TYPE_AUDIO;
+    audio->codecpar->codec_id = AV_CODEC_ID_PCM_MULAW;
+    audio->time_base.num = 1;
+    audio->time_base.den = 8000;
+}
+
+void RtspStreamPacketRingTestCase::cleanup()
+{
+    avformat_free_context(m_context);
+    RtspStreamPacketRing::setMemoryLimit(m_memoryLimit);
+}
+
+void RtspStreamPacketRingTestCase::appendVideo(RtspStreamPacketRing &ring, int frame, int size)
+{
+    AVPacket packet;
+    av_new_packet(&packet, size);
+    packet.stream_index = 0;
+    packet.pts = packet.dts = qint64(frame) * 100000;
+    if (frame % 10 == 0)
+        packet.flags |= AV_PKT_FLAG_KEY;
+
+    ring.append(&packet);
+    av_packet_unref(&packet);
+}
+
+void RtspStreamPacketRingTestCase::appendAudio(RtspStreamPacketRing &ring)
+{
+    AVPacket packet;
+    av_new_packet(&packet, 160);
+    packet.stream_index = 1;
+    packet.flags |= AV_PKT_FLAG_KEY;
+
+    ring.append(&packet);
+    av_packet_unref(&packet);
+}
+
+void RtspStreamPacketRingTestCase::testStartsOnKeyFrame()
+{
+    RtspStreamPacketRing ring(5000000);
+    ring.setStreams(m_context, 0, 1);
+
+    appendAudio(ring);
+    for (int i = 5; i < 10; ++i)
+        appendVideo(ring, i);
+    QCOMPARE(ring.bytes(), qint64(0));
+
+    appendVideo(ring, 10);
+    appendAudio(ring);
+    QCOMPARE(ring.bytes(), qint64(1160));
+    QCOMPARE(ring.startTime(), qint64(1000000));
+    QCOMPARE(ring.endTime(), qint64(1000000));
+    QCOMPARE(RtspStreamPacketRing::memoryUsed(), qint64(1160));
+}
+
+void RtspStreamPacketRingTestCase::testLength()
+{
+    RtspStreamPacketRing ring(2000000);
+    ring.setStreams(m_context, 0, 1);
+
+    for (int i = 0; i < 50; ++i)
+        appendVideo(ring, i);
+
+    /* Whole seconds from a keyframe, at least as long as asked for */
+    QCOMPARE(ring.startTime(), qint64(2000000));
+    QCOMPARE(ring.endTime(), qint64(4900000));
+    QCOMPARE(ring.bytes(), qint64(30 * 1000));
+}
+
+void RtspStreamPacketRingTestCase::testMemoryLimit()
+{
+    RtspStreamPacketRing::setMemoryLimit(25 * 1000);
+
+    RtspStreamPacketRing first(30000000);
+    first.setStreams(m_context, 0, 1);
+    RtspStreamPacketRing second(30000000);
+    second.setStreams(m_context, 0, 1);
+
+    for (int i = 0; i < 20; ++i)
+        appendVideo(first, i);
+    QCOMPARE(first.bytes(), qint64(20 * 1000));
+
+    /* Over the limit, the ring that grows drops its own oldest video */
+    for (int i = 0; i < 10; ++i)
+        appendVideo(second, i);
+    QCOMPARE(second.bytes(), qint64(0));
+    QCOMPARE(first.bytes(), qint64(20 * 1000));
+
+    for (int i = 20; i < 30; ++i)
+        appendVideo(first, i);
+    QCOMPARE(first.startTime(), qint64(1000000));
+    QCOMPARE(first.bytes(), qint64(20 * 1000));
+    QVERIFY(RtspStreamPacketRing::memoryUsed() <= 25 * 1000);
+}
+
+void RtspStreamPacketRingTestCase::testClip()
+{
+    RtspStreamPacketRing ring(30000000);
+    ring.setStreams(m_context, 0, 1);
+
+    for (int i = 0; i < 30; ++i)
+    {
+        appendVideo(ring, i);
+        appendAudio(ring);
+    }
+
+    RtspStreamPacketClip clip = ring.clip(1500000, 2200000);
+    QVERIFY(!clip.isEmpty());
+    QCOMPARE(clip.startTime(), qint64(1000000));
+    QCOMPARE(clip.endTime(), qint64(2200000));
+    QCOMPARE(clip.packetCount(), 13 * 2);
+    QCOMPARE(clip.packet(0)->stream_index, 0);
+    QVERIFY(clip.packet(0)->flags & AV_PKT_FLAG_KEY);
+    QCOMPARE(clip.packet(1)->stream_index, 1);
+    QCOMPARE(clip.videoParameters()->codec_id, AV_CODEC_ID_H264);
+
+    /* Before the ring starts, the clip does too */
+    clip = ring.clip(-1, 100000);
+    QCOMPARE(clip.startTime(), qint64(0));
+    QCOMPARE(clip.packetCount(), 2 * 2);
+
+    /* The clip keeps its packets when the ring lets go of them */
+    ring.setStreams(m_context, 0, 1);
+    QCOMPARE(ring.bytes(), qint64(0));
+    QCOMPARE(clip.packet(3)->size, 160);
+}
+
+void RtspStreamPacketRingTestCase::testInterrupt()
+{
+    RtspStreamPacketRing ring(30000000);
+    ring.setStreams(m_context, 0, 1);
+
+    for (int i = 0; i < 15; ++i)
+        appendVideo(ring, i);
+    ring.interrupt();
+    for (int i = 15; i < 25; ++i)
+        appendVideo(ring, i);
+
+    QCOMPARE(ring.startTime(), qint64(0));
+    QCOMPARE(ring.endTime(), qint64(2400000));
+    QCOMPARE(ring.bytes(), qint64((15 + 5) * 1000));
+}
+
+QTEST_MAIN(RtspStreamPacketRingTestCase)
+#include "RtspStreamPacketRingTestCase.moc"
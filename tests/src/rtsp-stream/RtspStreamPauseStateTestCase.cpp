@@ -0,0 +1,99 @@
+#include "rtsp-stream/RtspStreamPauseState.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class RtspStreamPauseStateTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testUserPause();
+    void testSuspension();
+    void testPausedWhileSuspended();
+    void testUnpausedWhileSuspended();
+    void testSuspendedWhilePaused();
+    void testReset();
+};
+
+void RtspStreamPauseStateTestCase::testUserPause()
+{
+    RtspStreamPauseState state;
+    QVERIFY(!state.isWorkerPaused());
+
+    QVERIFY(state.setUserPaused(true));
+    QVERIFY(state.isWorkerPaused());
+    QVERIFY(!state.setUserPaused(true));
+
+    QVERIFY(state.setUserPaused(false));
+    QVERIFY(!state.isWorkerPaused());
+}
+
+void RtspStreamPauseStateTestCase::testSuspension()
+{
+    RtspStreamPauseState state;
+
+    QVERIFY(state.setSuspended(true));
+    QVERIFY(state.isWorkerPaused());
+    QVERIFY(!state.isUserPaused());
+
+    QVERIFY(state.setSuspended(false));
+    QVERIFY(!state.isWorkerPaused());
+}
+
+/* Paused by the user while hidden, then visible again: stays paused */
+void RtspStreamPauseStateTestCase::testPausedWhileSuspended()
+{
+    RtspStreamPauseState state;
+
+    QVERIFY(state.setSuspended(true));
+    QVERIFY(!state.setUserPaused(true));
+    QVERIFY(!state.setSuspended(false));
+    QVERIFY(state.isWorkerPaused());
+    QVERIFY(state.isUserPaused());
+
+    QVERIFY(state.setUserPaused(false));
+    QVERIFY(!state.isWorkerPaused());
+}
+
+/* Unpaused by the user while hidden or paused by the governor: decoding only
+ * resumes once the suspension is lifted too */
+void RtspStreamPauseStateTestCase::testUnpausedWhileSuspended()
+{
+    RtspStreamPauseState state;
+
+    QVERIFY(state.setUserPaused(true));
+    QVERIFY(!state.setSuspended(true));
+    QVERIFY(!state.setUserPaused(false));
+    QVERIFY(state.isWorkerPaused());
+    QVERIFY(state.isSuspended());
+
+    QVERIFY(state.setSuspended(false));
+    QVERIFY(!state.isWorkerPaused());
+}
+
+/* Hidden and visible again while paused by the user: stays paused */
+void RtspStreamPauseStateTestCase::testSuspendedWhilePaused()
+{
+    RtspStreamPauseState state;
+
+    QVERIFY(state.setUserPaused(true));
+    QVERIFY(!state.setSuspended(true));
+    QVERIFY(!state.setSuspended(false));
+    QVERIFY(state.isWorkerPaused());
+}
+
+void RtspStreamPauseStateTestCase::testReset()
+{
+    RtspStreamPauseState state;
+    state.setUserPaused(true);
+    state.setSuspended(true);
+
+    state.reset();
+    QVERIFY(!state.isWorkerPaused());
+    QVERIFY(!state.isUserPaused());
+    QVERIFY(!state.isSuspended());
+}
+
+QTEST_MAIN(RtspStreamPauseStateTestCase)
+#include "RtspStreamPauseStateTestCase.moc"
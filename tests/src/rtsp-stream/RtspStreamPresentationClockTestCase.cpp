@@ -0,0 +1,102 @@
+#include "rtsp-stream/RtspStreamPresentationClock.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavutil/avutil.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+static const qint64 frameInterval = 40000;
+static const qint64 networkDelay = 50000;
+
+class RtspStreamPresentationClockTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testSteadyStream();
+    void testJitterAddsPlayoutDelay();
+    void testResyncOnDiscontinuity();
+    void testMonotonicPresentation();
+    void testMissingTimestamp();
+};
+
+void RtspStreamPresentationClockTestCase::testSteadyStream()
+{
+    RtspStreamPresentationClock clock;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        qint64 pts = i * frameInterval;
+        QCOMPARE(clock.presentationTime(pts, pts + networkDelay), pts + networkDelay);
+    }
+
+    QCOMPARE(clock.jitter(), 0);
+    QCOMPARE(clock.playoutDelay(), 0);
+}
+
+void RtspStreamPresentationClockTestCase::testJitterAddsPlayoutDelay()
+{
+    RtspStreamPresentationClock clock;
+    qint64 last = 0;
+
+    /* Every other frame arrives 20ms late */
+    for (int i = 0; i < 200; ++i)
+    {
+        qint64 pts = i * frameInterval;
+        qint64 arrival = pts + networkDelay + (i % 2 ? 20000 : 0);
+        qint64 presentation = clock.presentationTime(pts, arrival);
+
+        /* Once the delay settled, late frames no longer show up on screen */
+        if (i > 100)
+            QVERIFY(qAbs(presentation - last - frameInterval) < 1000);
+        last = presentation;
+    }
+
+    QVERIFY(clock.jitter() > 15000);
+    QVERIFY(clock.jitter() <= 20000);
+    QCOMPARE(clock.playoutDelay(), 2 * clock.jitter());
+}
+
+void RtspStreamPresentationClockTestCase::testResyncOnDiscontinuity()
+{
+    RtspStreamPresentationClock clock;
+
+    for (int i = 0; i < 10; ++i)
+        clock.presentationTime(i * frameInterval, i * frameInterval + networkDelay);
+
+    /* Camera restarted its timestamps */
+    qint64 arrival = 10 * frameInterval + networkDelay;
+    qint64 presentation = clock.presentationTime(0, arrival);
+    QCOMPARE(presentation, arrival);
+    QCOMPARE(clock.presentationTime(frameInterval, arrival + frameInterval), arrival + frameInterval);
+}
+
+void RtspStreamPresentationClockTestCase::testMonotonicPresentation()
+{
+    RtspStreamPresentationClock clock;
+    qint64 last = 0;
+
+    for (int i = 0; i < 500; ++i)
+    {
+        qint64 pts = i * frameInterval;
+        qint64 arrival = pts + networkDelay + (qrand() % 80000);
+        qint64 presentation = clock.presentationTime(pts, arrival);
+
+        QVERIFY(presentation >= last);
+        QVERIFY(clock.playoutDelay() <= 200000);
+        last = presentation;
+    }
+}
+
+void RtspStreamPresentationClockTestCase::testMissingTimestamp()
+{
+    RtspStreamPresentationClock clock;
+
+    QCOMPARE(clock.presentationTime(AV_NOPTS_VALUE, 12345), qint64(12345));
+}
+
+QTEST_MAIN(RtspStreamPresentationClockTestCase)
+
+#include "RtspStreamPresentationClockTestCase.moc"
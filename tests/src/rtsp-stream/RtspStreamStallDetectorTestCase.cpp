@@ -0,0 +1,150 @@
+#include "rtsp-stream/RtspStreamStallDetector.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+static const qint64 frameInterval = 40000;
+
+class RtspStreamStallDetectorTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testInactive();
+    void testLearnsInterval();
+    void testStall();
+    void testSlowStream();
+    void testBurstThenSlowStream();
+    void testKeyframeOnlyStream();
+    void testStallBarelyLearned();
+    void testReset();
+
+private:
+    qint64 feed(RtspStreamStallDetector &detector, qint64 start, qint64 interval, int packets);
+};
+
+qint64 RtspStreamStallDetectorTestCase::feed(RtspStreamStallDetector &detector, qint64 start, qint64 interval, int packets)
+{
+    qint64 now = start;
+    for (int i = 0; i < packets; ++i, now += interval)
+        detector.packetArrived(now);
+    return now - interval;
+}
+
+void RtspStreamStallDetectorTestCase::testInactive()
+{
+    RtspStreamStallDetector detector;
+    QVERIFY(!detector.isActive());
+    QVERIFY(!detector.isStalled(Q_INT64_C(100000000)));
+    QVERIFY(!detector.needsRecovery(Q_INT64_C(100000000)));
+}
+
+void RtspStreamStallDetectorTestCase::testLearnsInterval()
+{
+    RtspStreamStallDetector detector;
+    feed(detector, 0, frameInterval, 100);
+
+    QVERIFY(detector.isActive());
+    QCOMPARE(detector.frameInterval(), frameInterval);
+
+    /* Drifts towards a new frame rate */
+    qint64 last = feed(detector, 100 * frameInterval, 2 * frameInterval, 100);
+    QVERIFY(detector.frameInterval() > frameInterval * 19 / 10);
+    QVERIFY(!detector.isStalled(last + 2 * frameInterval));
+}
+
+void RtspStreamStallDetectorTestCase::testStall()
+{
+    RtspStreamStallDetector detector;
+    qint64 last = feed(detector, 0, frameInterval, 50);
+
+    /* 25 fps would stall after 160 ms, which is below the minimum */
+    QCOMPARE(detector.stallTime(), Q_INT64_C(400000));
+    QVERIFY(!detector.isStalled(last + 300000));
+    QVERIFY(detector.isStalled(last + 500000));
+    QVERIFY(!detector.needsRecovery(last + 500000));
+    QVERIFY(detector.needsRecovery(last + 2500000));
+
+    detector.packetArrived(last + 600000);
+    QVERIFY(!detector.isStalled(last + 700000));
+}
+
+void RtspStreamStallDetectorTestCase::testSlowStream()
+{
+    RtspStreamStallDetector detector;
+    qint64 last = feed(detector, 0, 500000, 20);
+
+    QCOMPARE(detector.stallTime(), Q_INT64_C(2000000));
+    QVERIFY(!detector.isStalled(last + 1500000));
+    QVERIFY(detector.isStalled(last + 2500000));
+    QCOMPARE(detector.recoveryTime(), Q_INT64_C(8000000));
+}
+
+void RtspStreamStallDetectorTestCase::testBurstThenSlowStream()
+{
+    RtspStreamStallDetector detector;
+    qint64 now = feed(detector, 0, 5000, 10);
+
+    /* The burst after PLAY looks like a fast stream at first */
+    QVERIFY(detector.frameInterval() < 100000);
+
+    /* 1 fps shows as stalled for a few frames, but is never reconnected over */
+    for (int i = 0; i < 30; ++i)
+    {
+        now += 1000000;
+        QVERIFY(!detector.needsRecovery(now));
+        detector.packetArrived(now);
+    }
+
+    QVERIFY(detector.frameInterval() > 900000);
+    QVERIFY(!detector.isStalled(now + 1500000));
+    QVERIFY(detector.isStalled(now + 4500000));
+}
+
+void RtspStreamStallDetectorTestCase::testKeyframeOnlyStream()
+{
+    RtspStreamStallDetector detector;
+    qint64 now = feed(detector, 0, 10000, 2);
+
+    /* A keyframe every 2 seconds is never a stall, not even before it is learned */
+    for (int i = 0; i < 30; ++i)
+    {
+        now += 2000000;
+        QVERIFY(!detector.isStalled(now));
+        QVERIFY(!detector.needsRecovery(now));
+        detector.packetArrived(now);
+    }
+
+    QCOMPARE(detector.frameInterval(), Q_INT64_C(2000000));
+    QCOMPARE(detector.stallTime(), Q_INT64_C(5000000));
+    QVERIFY(!detector.isStalled(now + 4000000));
+    QVERIFY(detector.isStalled(now + 6000000));
+}
+
+void RtspStreamStallDetectorTestCase::testStallBarelyLearned()
+{
+    RtspStreamStallDetector detector;
+    qint64 last = feed(detector, 0, frameInterval, 50);
+
+    detector.packetArrived(last + 3000000);
+    QVERIFY(detector.frameInterval() < 3 * frameInterval);
+    QCOMPARE(detector.stallTime(), Q_INT64_C(400000));
+}
+
+void RtspStreamStallDetectorTestCase::testReset()
+{
+    RtspStreamStallDetector detector;
+    qint64 last = feed(detector, 0, frameInterval, 50);
+
+    detector.reset();
+    QVERIFY(!detector.isActive());
+    QVERIFY(!detector.isStalled(last + 10000000));
+
+    /* The pause is not taken for an interval */
+    detector.packetArrived(last + 10000000);
+    detector.packetArrived(last + 10000000 + frameInterval);
+    QCOMPARE(detector.frameInterval(), frameInterval);
+}
+
+QTEST_MAIN(RtspStreamStallDetectorTestCase)
+#include "RtspStreamStallDetectorTestCase.moc"
@@ -0,0 +1,57 @@
+#include "utils/ExponentialBackoff.h"
+#include <QtTest/QtTest>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class ExponentialBackoffTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testDelayLimit();
+    void testNextDelay();
+    void testReset();
+};
+
+void ExponentialBackoffTestCase::testDelayLimit()
+{
+    ExponentialBackoff backoff(500, 16000);
+
+    QCOMPARE(backoff.delayLimit(0), 500);
+    QCOMPARE(backoff.delayLimit(1), 1000);
+    QCOMPARE(backoff.delayLimit(5), 16000);
+    QCOMPARE(backoff.delayLimit(6), 16000);
+    QCOMPARE(backoff.delayLimit(1000), 16000);
+}
+
+void ExponentialBackoffTestCase::testNextDelay()
+{
+    ExponentialBackoff backoff(500, 16000);
+    bool jittered = false;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int limit = backoff.delayLimit(i);
+        int delay = backoff.nextDelay();
+        QVERIFY(delay >= limit / 2);
+        QVERIFY(delay <= limit);
+        jittered = jittered || delay != limit;
+    }
+
+    QCOMPARE(backoff.attempts(), 20);
+    QVERIFY(jittered);
+}
+
+void ExponentialBackoffTestCase::testReset()
+{
+    ExponentialBackoff backoff(100, 1000);
+    for (int i = 0; i < 5; ++i)
+        backoff.nextDelay();
+
+    backoff.reset();
+    QCOMPARE(backoff.attempts(), 0);
+    QVERIFY(backoff.nextDelay() <= 100);
+}
+
+QTEST_MAIN(ExponentialBackoffTestCase)
+#include "ExponentialBackoffTestCase.moc"
@@ -0,0 +1,186 @@
+#include "utils/JpegDecoder.h"
+#include <QtTest/QtTest>
+
+extern "C" {
+#   include "libavcodec/avcodec.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Cost of decoding a 5 MP MJPEG picture for tiles of various sizes, next to
+ * decoding it at full size through QImageReader as MJpegStream used to. Each
+ * halving of the scale should cut the cost to about a quarter. */
+class JpegDecoderBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkDecode_data();
+    void benchmarkDecode();
+    void testPictureSize();
+    void testScaleShift_data();
+    void testScaleShift();
+    void testDecodedSize_data();
+    void testDecodedSize();
+    void testImageReuse();
+
+private:
+    QByteArray m_picture;
+};
+
+static const QSize pictureSize(2560, 1920);
+
+void JpegDecoderBenchmark::initTestCase()
+{
+    avcodec_register_all();
+
+    /* Something with edges and color, for the encoder to work with */
+    QImage image(pictureSize, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            line[x] = qRgb((x * 7) & 0xff, (y * 3) & 0xff, ((x ^ y) >> 2) & 0xff);
+    }
+
+    QBuffer buffer(&m_picture);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "JPEG", 80))
+        QSKIP("no JPEG encoder available");
+}
+
+void JpegDecoderBenchmark::benchmarkDecode_data()
+{
+    QTest::addColumn<QSize>("sizeHint");
+    QTest::addColumn<bool>("reader");
+
+    QTest::newRow("QImageReader, full size") << QSize() << true;
+    QTest::newRow("JpegDecoder, full size") << QSize() << false;
+    QTest::newRow("JpegDecoder, 1280x960 tile") << QSize(1280, 960) << false;
+    QTest::newRow("JpegDecoder, 640x480 tile") << QSize(640, 480) << false;
+    QTest::newRow("JpegDecoder, 320x240 tile") << QSize(320, 240) << false;
+}
+
+void JpegDecoderBenchmark::benchmarkDecode()
+{
+    QFETCH(QSize, sizeHint);
+    QFETCH(bool, reader);
+
+    JpegDecoder decoder;
+    QImage image;
+
+    if (reader)
+    {
+        QBENCHMARK
+        {
+            QBuffer buffer(&m_picture);
+            buffer.open(QIODevice::ReadOnly);
+            QImageReader imageReader(&buffer, jpegFormatName);
+            QVERIFY(imageReader.read(&image));
+        }
+    }
+    else
+    {
+        QBENCHMARK
+        {
+            /* Dropped before the next picture, as the stream drops the frame it showed */
+            image = QImage();
+            image = decoder.decode(m_picture.constData(), m_picture.size(), sizeHint);
+            QVERIFY(!image.isNull());
+        }
+    }
+}
+
+void JpegDecoderBenchmark::testPictureSize()
+{
+    QCOMPARE(JpegDecoder::pictureSize(m_picture.constData(), m_picture.size()), pictureSize);
+
+    /* Cut off before the frame header, or not JPEG at all */
+    QVERIFY(!JpegDecoder::pictureSize(m_picture.constData(), 20).isValid());
+    QByteArray junk(4096, '\xff');
+    QVERIFY(!JpegDecoder::pictureSize(junk.constData(), junk.size()).isValid());
+    junk[1] = '\xd8';
+    QVERIFY(!JpegDecoder::pictureSize(junk.constData(), junk.size()).isValid());
+}
+
+void JpegDecoderBenchmark::testScaleShift_data()
+{
+    QTest::addColumn<QSize>("pictureSize");
+    QTest::addColumn<QSize>("sizeHint");
+    QTest::addColumn<int>("shift");
+
+    QTest::newRow("No hint") << QSize(2560, 1920) << QSize() << 0;
+    QTest::newRow("Larger tile") << QSize(640, 480) << QSize(1280, 960) << 0;
+    QTest::newRow("Same size") << QSize(1280, 960) << QSize(1280, 960) << 0;
+    QTest::newRow("Half") << QSize(2560, 1920) << QSize(1280, 960) << 1;
+    QTest::newRow("Just over a half") << QSize(2560, 1920) << QSize(1281, 960) << 0;
+    QTest::newRow("Quarter") << QSize(2560, 1920) << QSize(640, 480) << 2;
+    QTest::newRow("Eighth") << QSize(2560, 1920) << QSize(320, 240) << 3;
+    QTest::newRow("No further than an eighth") << QSize(2560, 1920) << QSize(100, 75) << 3;
+    QTest::newRow("Other aspect ratio") << QSize(2560, 1920) << QSize(640, 960) << 1;
+    QTest::newRow("Unknown picture") << QSize() << QSize(320, 240) << 0;
+}
+
+void JpegDecoderBenchmark::testScaleShift()
+{
+    QFETCH(QSize, pictureSize);
+    QFETCH(QSize, sizeHint);
+    QFETCH(int, shift);
+
+    QCOMPARE(JpegDecoder::scaleShift(pictureSize, sizeHint), shift);
+}
+
+void JpegDecoderBenchmark::testDecodedSize_data()
+{
+    QTest::addColumn<QSize>("sizeHint");
+    QTest::addColumn<QSize>("decodedSize");
+
+    QTest::newRow("Full size") << QSize() << QSize(2560, 1920);
+    QTest::newRow("Half") << QSize(1000, 800) << QSize(1280, 960);
+    QTest::newRow("Quarter") << QSize(640, 480) << QSize(640, 480);
+    QTest::newRow("Eighth") << QSize(200, 150) << QSize(320, 240);
+}
+
+void JpegDecoderBenchmark::testDecodedSize()
+{
+    QFETCH(QSize, sizeHint);
+    QFETCH(QSize, decodedSize);
+
+    JpegDecoder decoder;
+    QImage image = decoder.decode(m_picture.constData(), m_picture.size(), sizeHint);
+    QCOMPARE(image.size(), decodedSize);
+    QCOMPARE(image.format(), QImage::Format_RGB32);
+
+    /* Not just black */
+    QVERIFY(qGray(image.pixel(image.width() / 2, image.height() / 2)) > 16);
+
+    QVERIFY(decoder.decode("\xff\xd8\xff\xd9", 4, sizeHint).isNull());
+}
+
+void JpegDecoderBenchmark::testImageReuse()
+{
+    JpegDecoder decoder;
+
+    QImage first = decoder.decode(m_picture.constData(), m_picture.size(), QSize(640, 480));
+    const uchar *firstBits = first.constBits();
+
+    /* Still held, so the next picture goes elsewhere */
+    QImage second = decoder.decode(m_picture.constData(), m_picture.size(), QSize(640, 480));
+    QVERIFY(second.constBits() != firstBits);
+
+    /* Once let go of, it's used again */
+    first = QImage();
+    QImage third = decoder.decode(m_picture.constData(), m_picture.size(), QSize(640, 480));
+    QCOMPARE(third.constBits(), firstBits);
+
+    /* Held images are never written to */
+    QImage copy = second.copy();
+    QImage fourth = decoder.decode(m_picture.constData(), m_picture.size(), QSize(320, 240));
+    QCOMPARE(fourth.size(), QSize(320, 240));
+    QCOMPARE(second, copy);
+}
+
+QTEST_MAIN(JpegDecoderBenchmark)
+
+#include "JpegDecoderBenchmark.moc"
@@ -0,0 +1,115 @@
+#include "utils/LatencyHistogram.h"
+#include <QtTest/QtTest>
+#include <QThread>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class LatencyHistogramTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testBuckets();
+    void testSummary();
+    void testPercentiles();
+    void testConcurrentSummary();
+};
+
+void LatencyHistogramTestCase::testBuckets()
+{
+    QCOMPARE(LatencyHistogram::bucketForDuration(0), 0);
+    QCOMPARE(LatencyHistogram::bucketForDuration(1), 1);
+    QCOMPARE(LatencyHistogram::bucketForDuration(2), 2);
+    QCOMPARE(LatencyHistogram::bucketForDuration(3), 2);
+    QCOMPARE(LatencyHistogram::bucketForDuration(1000), 10);
+    QCOMPARE(LatencyHistogram::bucketForDuration(1024), 11);
+    QCOMPARE(LatencyHistogram::bucketForDuration(Q_INT64_C(1) << 40), int(LatencyHistogram::BucketCount) - 1);
+
+    for (int i = 1; i < LatencyHistogram::BucketCount; ++i)
+        QCOMPARE(LatencyHistogram::bucketForDuration(LatencyHistogram::bucketLimit(i) - 1), i);
+}
+
+void LatencyHistogramTestCase::testSummary()
+{
+    LatencyHistogram histogram;
+    LatencySummary empty = histogram.summary();
+    QCOMPARE(empty.count(), 0);
+    QCOMPARE(empty.mean(), Q_INT64_C(0));
+    QCOMPARE(empty.percentile(50), Q_INT64_C(0));
+
+    histogram.record(100);
+    histogram.record(300);
+    histogram.record(-5);
+
+    LatencySummary summary = histogram.summary();
+    QCOMPARE(summary.count(), 3);
+    QCOMPARE(summary.total(), Q_INT64_C(400));
+    QCOMPARE(summary.mean(), Q_INT64_C(133));
+    QCOMPARE(summary.max(), Q_INT64_C(300));
+    QCOMPARE(summary.bucketCount(), int(LatencyHistogram::BucketCount));
+    QCOMPARE(summary.bucket(0), 1);
+    QCOMPARE(summary.bucket(7), 1);
+    QCOMPARE(summary.bucket(9), 1);
+}
+
+void LatencyHistogramTestCase::testPercentiles()
+{
+    LatencyHistogram histogram;
+    for (int i = 0; i < 99; ++i)
+        histogram.record(1000);
+    histogram.record(50000);
+
+    LatencySummary summary = histogram.summary();
+    QCOMPARE(summary.percentile(0), Q_INT64_C(1024));
+    QCOMPARE(summary.percentile(50), Q_INT64_C(1024));
+    QCOMPARE(summary.percentile(99), Q_INT64_C(1024));
+    /* Capped by the largest sample rather than its bucket's limit */
+    QCOMPARE(summary.percentile(100), Q_INT64_C(50000));
+}
+
+class HistogramWriter : public QThread
+{
+public:
+    HistogramWriter(LatencyHistogram &histogram, int samples)
+        : m_histogram(histogram), m_samples(samples)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        for (int i = 0; i < m_samples; ++i)
+            m_histogram.record(i % 5000);
+    }
+
+private:
+    LatencyHistogram &m_histogram;
+    int m_samples;
+};
+
+void LatencyHistogramTestCase::testConcurrentSummary()
+{
+    const int samples = 1000000;
+    LatencyHistogram histogram;
+    HistogramWriter writer(histogram, samples);
+
+    writer.start();
+    while (!writer.isFinished())
+    {
+        LatencySummary summary = histogram.summary();
+        int bucketed = 0;
+        for (int i = 0; i < summary.bucketCount(); ++i)
+            bucketed += summary.bucket(i);
+
+        QVERIFY(bucketed >= summary.count());
+        QVERIFY(summary.max() < 5000);
+    }
+    writer.wait();
+
+    LatencySummary summary = histogram.summary();
+    QCOMPARE(summary.count(), samples);
+    QCOMPARE(summary.max(), Q_INT64_C(4999));
+}
+
+QTEST_MAIN(LatencyHistogramTestCase)
+#include "LatencyHistogramTestCase.moc"
@@ -0,0 +1,126 @@
+#include "utils/SpscRing.h"
+#include <QtTest/QtTest>
+#include <QThread>
+#include <QVector>
+
+const char *jpegFormatName = "jpeg"; // hack
+
+class SpscRingTestCase : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testPushPop();
+    void testCapacity();
+    void testPushOverwrite();
+    void testConcurrentOverwrite();
+};
+
+void SpscRingTestCase::testPushPop()
+{
+    int values[3] = { 1, 2, 3 };
+    SpscRing<int> ring(3);
+
+    QVERIFY(ring.isEmpty());
+    QVERIFY(ring.pop() == 0);
+
+    QVERIFY(ring.push(&values[0]));
+    QVERIFY(ring.push(&values[1]));
+    QCOMPARE(ring.size(), 2);
+
+    QCOMPARE(ring.pop(), &values[0]);
+    QVERIFY(ring.push(&values[2]));
+    QCOMPARE(ring.pop(), &values[1]);
+    QCOMPARE(ring.pop(), &values[2]);
+    QVERIFY(ring.pop() == 0);
+    QVERIFY(ring.isEmpty());
+}
+
+void SpscRingTestCase::testCapacity()
+{
+    int values[6];
+    SpscRing<int> ring(5);
+
+    QCOMPARE(ring.capacity(), 5);
+    for (int i = 0; i < 5; ++i)
+        QVERIFY(ring.push(&values[i]));
+
+    QVERIFY(!ring.push(&values[5]));
+    QCOMPARE(ring.size(), 5);
+}
+
+void SpscRingTestCase::testPushOverwrite()
+{
+    int values[4];
+    SpscRing<int> ring(2);
+
+    QVERIFY(ring.pushOverwrite(&values[0]) == 0);
+    QVERIFY(ring.pushOverwrite(&values[1]) == 0);
+    QCOMPARE(ring.pushOverwrite(&values[2]), &values[0]);
+    QCOMPARE(ring.pushOverwrite(&values[3]), &values[1]);
+    QCOMPARE(ring.size(), 2);
+
+    QCOMPARE(ring.pop(), &values[2]);
+    QCOMPARE(ring.pop(), &values[3]);
+    QVERIFY(ring.pop() == 0);
+}
+
+class OverwriteProducer : public QThread
+{
+public:
+    OverwriteProducer(SpscRing<int> &ring, QVector<int> &values)
+        : dropped(0), m_ring(ring), m_values(values)
+    {
+    }
+
+    int dropped;
+
+protected:
+    virtual void run()
+    {
+        for (int i = 0; i < m_values.size(); ++i)
+        {
+            if (m_ring.pushOverwrite(&m_values[i]))
+                ++dropped;
+        }
+    }
+
+private:
+    SpscRing<int> &m_ring;
+    QVector<int> &m_values;
+};
+
+void SpscRingTestCase::testConcurrentOverwrite()
+{
+    static const int count = 200000;
+
+    QVector<int> values(count);
+    for (int i = 0; i < count; ++i)
+        values[i] = i;
+
+    SpscRing<int> ring(4);
+    OverwriteProducer producer(ring, values);
+    producer.start();
+
+    int received = 0;
+    int last = -1;
+    bool ordered = true;
+    while (producer.isRunning() || !ring.isEmpty())
+    {
+        int *value = ring.pop();
+        if (!value)
+            continue;
+
+        ordered = ordered && *value > last;
+        last = *value;
+        ++received;
+    }
+
+    producer.wait();
+    QVERIFY(ordered);
+    QCOMPARE(received + producer.dropped, count);
+}
+
+QTEST_MAIN(SpscRingTestCase)
+
+#include "SpscRingTestCase.moc"
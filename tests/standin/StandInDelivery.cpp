@@ -0,0 +1,60 @@
+#include "StandInDelivery.h"
+
+StandInStats::StandInStats()
+    : m_sentUnits(0), m_droppedUnits(0), m_latency(new LatencyHistogram)
+{
+}
+
+void StandInStats::reset()
+{
+    m_sentUnits = 0;
+    m_droppedUnits = 0;
+    m_latency.reset(new LatencyHistogram);
+}
+
+StandInDelivery::StandInDelivery(StandInStats *stats)
+    : m_stats(stats), m_maximumBacklog(1024 * 1024), m_sentBytes(0), m_writtenBytes(0),
+      m_encryptedWrittenBytes(0)
+{
+    m_clock.start();
+}
+
+void StandInDelivery::unitSent(qint64 bytes)
+{
+    m_sentBytes += bytes;
+    m_pending.enqueue(qMakePair(m_sentBytes, m_clock.nsecsElapsed() / 1000));
+    m_stats->m_sentUnits++;
+}
+
+void StandInDelivery::unitDropped()
+{
+    m_stats->m_droppedUnits++;
+}
+
+void StandInDelivery::bytesWritten(qint64 bytes)
+{
+    m_writtenBytes += bytes;
+    recordWritten(m_pending, m_writtenBytes, m_stats->m_latency.data(), m_clock.nsecsElapsed() / 1000);
+}
+
+void StandInDelivery::bytesEncrypted(qint64 bytes, qint64 encryptedBytesToWrite)
+{
+    m_writtenBytes += bytes;
+
+    qint64 encryptedEnd = m_encryptedWrittenBytes + encryptedBytesToWrite;
+    while (!m_pending.isEmpty() && m_pending.head().first <= m_writtenBytes)
+        m_encryptedPending.enqueue(qMakePair(encryptedEnd, m_pending.dequeue().second));
+}
+
+void StandInDelivery::encryptedBytesWritten(qint64 bytes)
+{
+    m_encryptedWrittenBytes += bytes;
+    recordWritten(m_encryptedPending, m_encryptedWrittenBytes, m_stats->m_latency.data(), m_clock.nsecsElapsed() / 1000);
+}
+
+void StandInDelivery::recordWritten(QQueue<QPair<qint64, qint64> > &pending, qint64 writtenBytes,
+                                    LatencyHistogram *latency, qint64 now)
+{
+    while (!pending.isEmpty() && pending.head().first <= writtenBytes)
+        latency->record(now - pending.dequeue().second);
+}
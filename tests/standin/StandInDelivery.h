@@ -0,0 +1,77 @@
+#ifndef STAND_IN_DELIVERY_H
+#define STAND_IN_DELIVERY_H
+
+#include "utils/LatencyHistogram.h"
+#include <QElapsedTimer>
+#include <QPair>
+#include <QQueue>
+#include <QScopedPointer>
+
+/* What clients got of everything the stand-in servers sent during one scale
+ * step. Units are pictures for MJPEG and frames for RTSP. */
+class StandInStats
+{
+public:
+    StandInStats();
+
+    void reset();
+
+    int sentUnits() const { return m_sentUnits; }
+    int droppedUnits() const { return m_droppedUnits; }
+    LatencySummary latency() const { return m_latency->summary(); }
+
+private:
+    friend class StandInDelivery;
+
+    int m_sentUnits;
+    int m_droppedUnits;
+    QScopedPointer<LatencyHistogram> m_latency;
+};
+
+/* Delivery of units over one client connection.
+ *
+ * A client that doesn't read fast enough leaves its data queued in the socket;
+ * once more than a backlog is queued, units are dropped rather than queued as
+ * well, as a DVR would. The latency of a unit is the time from it being sent
+ * to its last byte being handed to the kernel, which only happens as the client
+ * reads what was sent before it.
+ *
+ * Over TLS, bytesWritten() only means the data was encrypted. A unit then ends
+ * wherever the encrypted stream had got to when it was encrypted, and counts as
+ * delivered once encryptedBytesWritten() passes that. */
+class StandInDelivery
+{
+public:
+    explicit StandInDelivery(StandInStats *stats);
+
+    void setMaximumBacklog(qint64 bytes) { m_maximumBacklog = bytes; }
+    bool isBehind(qint64 bytesToWrite) const { return bytesToWrite > m_maximumBacklog; }
+
+    /* Everything written to the socket is either a unit or other data */
+    void unitSent(qint64 bytes);
+    void otherDataSent(qint64 bytes) { m_sentBytes += bytes; }
+    void unitDropped();
+    /* From the socket's bytesWritten() */
+    void bytesWritten(qint64 bytes);
+    /* From a QSslSocket's bytesWritten(), with its encryptedBytesToWrite() at the time */
+    void bytesEncrypted(qint64 bytes, qint64 encryptedBytesToWrite);
+    /* From a QSslSocket's encryptedBytesWritten() */
+    void encryptedBytesWritten(qint64 bytes);
+
+private:
+    StandInStats *m_stats;
+    QElapsedTimer m_clock;
+    qint64 m_maximumBacklog;
+    qint64 m_sentBytes;
+    qint64 m_writtenBytes;
+    qint64 m_encryptedWrittenBytes;
+    /* End offset and time sent, in microseconds, of every unit not written yet */
+    QQueue<QPair<qint64, qint64> > m_pending;
+    /* The same in the encrypted stream, for units encrypted but not written yet */
+    QQueue<QPair<qint64, qint64> > m_encryptedPending;
+
+    static void recordWritten(QQueue<QPair<qint64, qint64> > &pending, qint64 writtenBytes,
+                              LatencyHistogram *latency, qint64 now);
+};
+
+#endif // STAND_IN_DELIVERY_H
@@ -0,0 +1,208 @@
+#include "StandInH264Source.h"
+#include "StandInRtspSession.h"
+
+StandInH264Source::StandInH264Source(QObject *parent)
+    : QObject(parent), m_context(0), m_streamIndex(-1), m_parameters(0), m_havePacket(false), m_timer(this),
+      m_loopStart(0), m_loopFirstDts(AV_NOPTS_VALUE), m_endDts(0), m_frameDuration(0)
+{
+    av_init_packet(&m_packet);
+    m_packet.data = 0;
+    m_packet.size = 0;
+    m_timeBase = av_make_q(1, 90000);
+
+    connect(&m_timer, SIGNAL(timeout()), SLOT(sendPackets()));
+}
+
+StandInH264Source::~StandInH264Source()
+{
+    av_packet_unref(&m_packet);
+    closeFile();
+    avcodec_parameters_free(&m_parameters);
+}
+
+bool StandInH264Source::open(const QString &fileName, QString *errorMessage)
+{
+    m_fileName = fileName;
+    if (!openFile(errorMessage))
+        return false;
+
+    AVStream *stream = m_context->streams[m_streamIndex];
+    m_parameters = avcodec_parameters_alloc();
+    if (!m_parameters || avcodec_parameters_copy(m_parameters, stream->codecpar) < 0)
+    {
+        *errorMessage = QLatin1String("Out of memory");
+        avcodec_parameters_free(&m_parameters);
+        closeFile();
+        return false;
+    }
+    m_timeBase = stream->time_base;
+
+    m_havePacket = readPacket();
+    if (!m_havePacket)
+    {
+        *errorMessage = QLatin1String("No video in file");
+        avcodec_parameters_free(&m_parameters);
+        closeFile();
+        return false;
+    }
+
+    return true;
+}
+
+bool StandInH264Source::openFile(QString *errorMessage)
+{
+    QByteArray fileName = m_fileName.toLocal8Bit();
+
+    int re = avformat_open_input(&m_context, fileName.constData(), NULL, NULL);
+    if (re < 0)
+    {
+        char error[512];
+        av_strerror(re, error, sizeof(error));
+        *errorMessage = QString::fromLocal8Bit(error);
+        return false;
+    }
+
+    if (avformat_find_stream_info(m_context, NULL) < 0)
+    {
+        *errorMessage = QLatin1String("Cannot read stream information");
+        closeFile();
+        return false;
+    }
+
+    m_streamIndex = av_find_best_stream(m_context, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (m_streamIndex < 0 || m_context->streams[m_streamIndex]->codecpar->codec_id != AV_CODEC_ID_H264)
+    {
+        *errorMessage = QLatin1String("No H.264 video in file");
+        closeFile();
+        return false;
+    }
+
+    AVStream *stream = m_context->streams[m_streamIndex];
+    AVRational frameRate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+    if (!frameRate.num || !frameRate.den)
+        frameRate = av_make_q(25, 1);
+    m_frameDuration = qMax(qint64(1), qint64(av_rescale_q(1, av_inv_q(frameRate), stream->time_base)));
+
+    return true;
+}
+
+void StandInH264Source::closeFile()
+{
+    if (m_context)
+        avformat_close_input(&m_context);
+    m_context = 0;
+}
+
+QByteArray StandInH264Source::sdp() const
+{
+    /* Only to describe the stream; sessions have muxers of their own */
+    AVFormatContext *rtp = 0;
+    if (avformat_alloc_output_context2(&rtp, NULL, "rtp", NULL) < 0)
+        return QByteArray();
+
+    AVStream *stream = avformat_new_stream(rtp, NULL);
+    char buffer[4096];
+    buffer[0] = 0;
+    if (stream && avcodec_parameters_copy(stream->codecpar, codecParameters()) >= 0)
+        av_sdp_create(&rtp, 1, buffer, sizeof(buffer));
+    avformat_free_context(rtp);
+
+    QByteArray result(buffer);
+    if (result.isEmpty())
+        return result;
+
+    if (!result.endsWith("\r\n"))
+        result += "\r\n";
+    return result + "a=control:streamid=0\r\n";
+}
+
+void StandInH264Source::start()
+{
+    m_clock.start();
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.start(5);
+}
+
+void StandInH264Source::addSession(StandInRtspSession *session)
+{
+    if (!m_sessions.contains(session))
+        m_sessions.append(session);
+}
+
+void StandInH264Source::removeSession(StandInRtspSession *session)
+{
+    m_sessions.removeAll(session);
+}
+
+bool StandInH264Source::readPacket()
+{
+    /* A file without a single packet would loop forever */
+    for (int loops = 0; loops < 2; )
+    {
+        if (!m_context)
+        {
+            QString errorMessage;
+            if (!openFile(&errorMessage))
+            {
+                qWarning("stand-in: cannot reopen %s: %s", qPrintable(m_fileName), qPrintable(errorMessage));
+                return false;
+            }
+        }
+
+        if (av_read_frame(m_context, &m_packet) < 0)
+        {
+            /* From the top, carrying on where this loop ended */
+            closeFile();
+            m_loopStart = m_endDts;
+            m_loopFirstDts = AV_NOPTS_VALUE;
+            ++loops;
+            continue;
+        }
+
+        if (m_packet.stream_index != m_streamIndex)
+        {
+            av_packet_unref(&m_packet);
+            continue;
+        }
+
+        qint64 streamDts;
+        if (m_packet.dts == AV_NOPTS_VALUE)
+            streamDts = m_endDts;
+        else
+        {
+            if (m_loopFirstDts == AV_NOPTS_VALUE)
+                m_loopFirstDts = m_packet.dts;
+            streamDts = m_loopStart + m_packet.dts - m_loopFirstDts;
+        }
+
+        qint64 ptsOffset = 0;
+        if (m_packet.pts != AV_NOPTS_VALUE && m_packet.dts != AV_NOPTS_VALUE)
+            ptsOffset = m_packet.pts - m_packet.dts;
+
+        m_packet.dts = streamDts;
+        m_packet.pts = streamDts + ptsOffset;
+        m_endDts = streamDts + (m_packet.duration > 0 ? m_packet.duration : m_frameDuration);
+        return true;
+    }
+
+    return false;
+}
+
+void StandInH264Source::sendPackets()
+{
+    if (!m_havePacket)
+        return;
+
+    AVRational microseconds = { 1, 1000000 };
+    AVRational tb = m_timeBase;
+    qint64 now = m_clock.nsecsElapsed() / 1000;
+
+    while (m_havePacket && av_rescale_q(m_packet.dts, tb, microseconds) <= now)
+    {
+        foreach (StandInRtspSession *session, m_sessions)
+            session->sendPacket(&m_packet, tb);
+
+        av_packet_unref(&m_packet);
+        m_havePacket = readPacket();
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef STAND_IN_H264_SOURCE_H
+#define STAND_IN_H264_SOURCE_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+extern "C" {
+#   include "libavformat/avformat.h"
+}
+
+class StandInRtspSession;
+
+/* Plays the H.264 video of a file in a loop, in real time, to every RTSP
+ * session that is playing. Timestamps keep going up from one loop to the next,
+ * so clients see one endless stream. The file has to be Matroska, the only
+ * container the bundled FFmpeg has a demuxer for. */
+class StandInH264Source : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StandInH264Source(QObject *parent = 0);
+    virtual ~StandInH264Source();
+
+    bool open(const QString &fileName, QString *errorMessage);
+    bool isOpen() const { return m_parameters != 0; }
+
+    /* Of the video stream; valid once open */
+    const AVCodecParameters *codecParameters() const { return m_parameters; }
+    AVRational timeBase() const { return m_timeBase; }
+    /* Session description for DESCRIBE, with the one stream as streamid=0 */
+    QByteArray sdp() const;
+
+    void start();
+
+    void addSession(StandInRtspSession *session);
+    void removeSession(StandInRtspSession *session);
+    int sessionCount() const { return m_sessions.size(); }
+
+private slots:
+    void sendPackets();
+
+private:
+    QString m_fileName;
+    AVFormatContext *m_context;
+    int m_streamIndex;
+    /* Kept apart from the file, which is closed and opened again to loop */
+    AVCodecParameters *m_parameters;
+    AVRational m_timeBase;
+    AVPacket m_packet;
+    bool m_havePacket;
+
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+    /* In the stream's time base: where the current loop starts in the endless
+     * stream, the first timestamp of the loop in the file, and the end of the
+     * last packet sent */
+    qint64 m_loopStart;
+    qint64 m_loopFirstDts;
+    qint64 m_endDts;
+    qint64 m_frameDuration;
+
+    QList<StandInRtspSession *> m_sessions;
+
+    bool openFile(QString *errorMessage);
+    void closeFile();
+    bool readPacket();
+};
+
+#endif // STAND_IN_H264_SOURCE_H
@@ -0,0 +1,163 @@
+#include "StandInHttpServer.h"
+#include "StandInMJpegSource.h"
+#include <QFile>
+#include <QSslSocket>
+#include <QUrl>
+#include <QUrlQuery>
+
+StandInHttpServer::StandInHttpServer(StandInMJpegSource *mjpegSource, QObject *parent)
+    : QTcpServer(parent), m_mjpegSource(mjpegSource), m_cameraCount(0)
+{
+}
+
+bool StandInHttpServer::setCertificate(const QString &certificateFile, const QString &keyFile, QString *errorMessage)
+{
+    QFile certificate(certificateFile);
+    QFile key(keyFile);
+    if (!certificate.open(QIODevice::ReadOnly) || !key.open(QIODevice::ReadOnly))
+    {
+        *errorMessage = QString::fromLatin1("Cannot read %1 or %2").arg(certificateFile, keyFile);
+        return false;
+    }
+
+    m_certificate = QSslCertificate(certificate.readAll());
+    m_key = QSslKey(key.readAll(), QSsl::Rsa);
+    if (m_certificate.isNull() || m_key.isNull())
+    {
+        *errorMessage = QLatin1String("Invalid certificate or key");
+        return false;
+    }
+
+    return true;
+}
+
+void StandInHttpServer::incomingConnection(qintptr socketDescriptor)
+{
+    QSslSocket *socket = new QSslSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor))
+    {
+        delete socket;
+        return;
+    }
+
+    connect(socket, SIGNAL(readyRead()), SLOT(readable()));
+    connect(socket, SIGNAL(disconnected()), SLOT(disconnected()));
+    m_requests.insert(socket, QByteArray());
+
+    socket->setLocalCertificate(m_certificate);
+    socket->setPrivateKey(m_key);
+    socket->startServerEncryption();
+}
+
+void StandInHttpServer::disconnected()
+{
+    QSslSocket *socket = static_cast<QSslSocket *>(sender());
+    m_requests.remove(socket);
+    socket->deleteLater();
+}
+
+void StandInHttpServer::readable()
+{
+    QSslSocket *socket = static_cast<QSslSocket *>(sender());
+    QHash<QSslSocket *, QByteArray>::iterator it = m_requests.find(socket);
+    if (it == m_requests.end())
+        return;
+
+    it->append(socket->readAll());
+
+    /* Requests are answered in order; the client may send more than one */
+    for (;;)
+    {
+        QByteArray &data = *it;
+        int headerEnd = data.indexOf("\r\n\r\n");
+        if (headerEnd < 0)
+            return;
+
+        QList<QByteArray> lines = data.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() < 2)
+        {
+            socket->disconnectFromHost();
+            return;
+        }
+
+        int contentLength = 0;
+        for (int i = 1; i < lines.size(); ++i)
+        {
+            QByteArray line = lines.at(i).trimmed();
+            if (line.toLower().startsWith("content-length:"))
+                contentLength = line.mid(15).trimmed().toInt();
+        }
+
+        int requestEnd = headerEnd + 4 + contentLength;
+        if (data.size() < requestEnd)
+            return;
+        data.remove(0, requestEnd);
+
+        if (!handleRequest(socket, requestLine.at(0), requestLine.at(1)))
+            return;
+    }
+}
+
+/* False once the connection is no longer for requests */
+bool StandInHttpServer::handleRequest(QSslSocket *socket, const QByteArray &method, const QByteArray &target)
+{
+    QUrl url(QString::fromLatin1(target));
+    QString path = url.path();
+
+    if (path == QLatin1String("/ajax/login.php") && method == "POST")
+    {
+        reply(socket, "200 OK", "text/plain", "OK", "Set-Cookie: PHPSESSID=standin; path=/\r\n");
+    }
+    else if (path == QLatin1String("/ajax/devices.php"))
+    {
+        reply(socket, "200 OK", "text/xml", devicesXml());
+    }
+    else if (path == QLatin1String("/ajax/stats.php"))
+    {
+        reply(socket, "200 OK", "text/xml", "<stats><message></message><bc-server-running>up</bc-server-running></stats>");
+    }
+    else if (path == QLatin1String("/media/mjpeg.php"))
+    {
+        int id = QUrlQuery(url).queryItemValue(QLatin1String("id")).toInt();
+        if (id < 1 || id > m_cameraCount)
+        {
+            reply(socket, "404 Not Found", "text/plain", "No such device");
+            return true;
+        }
+
+        /* The stream has the connection from here on */
+        socket->disconnect(this);
+        m_requests.remove(socket);
+        m_mjpegSource->addClient(socket);
+        return false;
+    }
+    else
+    {
+        reply(socket, "404 Not Found", "text/plain", QByteArray());
+    }
+
+    return true;
+}
+
+void StandInHttpServer::reply(QSslSocket *socket, const QByteArray &status, const QByteArray &contentType,
+                              const QByteArray &body, const QByteArray &extraHeaders)
+{
+    QByteArray response = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType
+            + "\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n" + extraHeaders + "\r\n" + body;
+    socket->write(response);
+}
+
+QByteArray StandInHttpServer::devicesXml() const
+{
+    QByteArray xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<devices>\n";
+    for (int id = 1; id <= m_cameraCount; ++id)
+    {
+        xml += "<device id=\"" + QByteArray::number(id) + "\">"
+               "<device_name>Stand-in " + QByteArray::number(id) + "</device_name>"
+               "<ptz_control_protocol>none</ptz_control_protocol>"
+               "<disabled>0</disabled></device>\n";
+    }
+    xml += "</devices>\n";
+    return xml;
+}
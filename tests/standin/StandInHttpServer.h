@@ -0,0 +1,49 @@
+#ifndef STAND_IN_HTTP_SERVER_H
+#define STAND_IN_HTTP_SERVER_H
+
+#include <QHash>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QTcpServer>
+
+class QSslSocket;
+class StandInMJpegSource;
+
+/* The parts of a Bluecherry server's HTTPS interface the live view needs:
+ * logging in, the camera list from devices.php with as many cameras as the
+ * current scale step has, server status, and MJPEG streams. Everything else is
+ * answered with 404. Any user name and password is accepted. */
+class StandInHttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    StandInHttpServer(StandInMJpegSource *mjpegSource, QObject *parent = 0);
+
+    bool setCertificate(const QString &certificateFile, const QString &keyFile, QString *errorMessage);
+
+    int cameraCount() const { return m_cameraCount; }
+    void setCameraCount(int cameraCount) { m_cameraCount = cameraCount; }
+
+protected:
+    virtual void incomingConnection(qintptr socketDescriptor);
+
+private slots:
+    void readable();
+    void disconnected();
+
+private:
+    StandInMJpegSource *m_mjpegSource;
+    QSslCertificate m_certificate;
+    QSslKey m_key;
+    int m_cameraCount;
+    /* Unanswered request data per connection */
+    QHash<QSslSocket *, QByteArray> m_requests;
+
+    bool handleRequest(QSslSocket *socket, const QByteArray &method, const QByteArray &target);
+    void reply(QSslSocket *socket, const QByteArray &status, const QByteArray &contentType,
+               const QByteArray &body, const QByteArray &extraHeaders = QByteArray());
+    QByteArray devicesXml() const;
+};
+
+#endif // STAND_IN_HTTP_SERVER_H
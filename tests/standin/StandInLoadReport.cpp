@@ -0,0 +1,133 @@
+#include "StandInLoadReport.h"
+#include "StandInDelivery.h"
+#include "StandInH264Source.h"
+#include "StandInHttpServer.h"
+#include "StandInMJpegSource.h"
+#include "StandInRtspServer.h"
+#include <QFile>
+#include <cstdio>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+StandInLoadReport::StandInLoadReport(StandInHttpServer *httpServer, StandInRtspServer *rtspServer,
+                                     StandInMJpegSource *mjpegSource, StandInStats *stats, QObject *parent)
+    : QObject(parent), m_httpServer(httpServer), m_rtspServer(rtspServer), m_mjpegSource(mjpegSource),
+      m_stats(stats), m_currentStep(-1), m_stepTime(180), m_settleTime(90), m_clientPid(0), m_timer(this)
+{
+    m_timer.setSingleShot(true);
+}
+
+void StandInLoadReport::setStepTime(int stepTime, int settleTime)
+{
+    m_stepTime = stepTime;
+    m_settleTime = qBound(0, settleTime, stepTime - 1);
+}
+
+void StandInLoadReport::start()
+{
+    printf("%8s %6s %6s %7s %8s %8s %8s %8s %7s %9s %9s %9s\n", "cameras", "mjpeg", "rtsp", "cpu %",
+           "rss MB", "peak MB", "sent", "dropped", "drop %", "mean ms", "p99 ms", "max ms");
+    fflush(stdout);
+
+    m_currentStep = 0;
+    startStep();
+}
+
+void StandInLoadReport::startStep()
+{
+    int cameraCount = m_steps.at(m_currentStep);
+    m_httpServer->setCameraCount(cameraCount);
+    m_rtspServer->setCameraCount(cameraCount);
+
+    m_timer.disconnect(this);
+    connect(&m_timer, SIGNAL(timeout()), SLOT(settled()));
+    m_timer.start(m_settleTime * 1000);
+}
+
+void StandInLoadReport::settled()
+{
+    m_stats->reset();
+    m_firstSample = sampleClient();
+    m_measureClock.start();
+
+    m_timer.disconnect(this);
+    connect(&m_timer, SIGNAL(timeout()), SLOT(stepDone()));
+    m_timer.start((m_stepTime - m_settleTime) * 1000);
+}
+
+void StandInLoadReport::stepDone()
+{
+    ProcessSample sample = sampleClient();
+    qint64 elapsed = m_measureClock.elapsed();
+    LatencySummary latency = m_stats->latency();
+    int units = m_stats->sentUnits() + m_stats->droppedUnits();
+
+    QString cpu = QLatin1String("n/a");
+    QString resident = cpu;
+    QString peakResident = cpu;
+    if (sample.valid && m_firstSample.valid && elapsed > 0)
+    {
+#ifdef Q_OS_LINUX
+        double ticksPerSecond = sysconf(_SC_CLK_TCK);
+#else
+        double ticksPerSecond = 100;
+#endif
+        /* Of one core, as top shows it */
+        cpu = QString::number((sample.cpuTicks - m_firstSample.cpuTicks) / ticksPerSecond * 100000 / elapsed, 'f', 1);
+        resident = QString::number(sample.residentKb / 1024.0, 'f', 1);
+        peakResident = QString::number(sample.peakResidentKb / 1024.0, 'f', 1);
+    }
+
+    printf("%8d %6d %6d %7s %8s %8s %8d %8d %7.2f %9.1f %9.1f %9.1f\n",
+           m_steps.at(m_currentStep), m_mjpegSource->clientCount(), m_rtspServer->source()->sessionCount(),
+           qPrintable(cpu), qPrintable(resident), qPrintable(peakResident),
+           m_stats->sentUnits(), m_stats->droppedUnits(), units ? m_stats->droppedUnits() * 100.0 / units : 0.0,
+           latency.mean() / 1000.0, latency.percentile(99) / 1000.0, latency.max() / 1000.0);
+    fflush(stdout);
+
+    if (++m_currentStep < m_steps.size())
+        startStep();
+    else
+        emit finished();
+}
+
+StandInLoadReport::ProcessSample StandInLoadReport::sampleClient() const
+{
+    ProcessSample sample;
+#ifdef Q_OS_LINUX
+    if (m_clientPid <= 0)
+        return sample;
+
+    QFile stat(QString::fromLatin1("/proc/%1/stat").arg(m_clientPid));
+    if (!stat.open(QIODevice::ReadOnly))
+        return sample;
+
+    /* The command name may contain spaces; fields after it are counted from
+     * state, the third field, so utime and stime are the 14th and 15th */
+    QByteArray line = stat.readAll();
+    QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 13)
+        return sample;
+    sample.cpuTicks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+
+    QFile status(QString::fromLatin1("/proc/%1/status").arg(m_clientPid));
+    if (!status.open(QIODevice::ReadOnly))
+        return sample;
+
+    foreach (const QByteArray &statusLine, status.readAll().split('\n'))
+    {
+        QList<QByteArray> parts = statusLine.simplified().split(' ');
+        if (parts.size() < 2)
+            continue;
+        if (parts.at(0) == "VmRSS:")
+            sample.residentKb = parts.at(1).toLongLong();
+        else if (parts.at(0) == "VmHWM:")
+            sample.peakResidentKb = parts.at(1).toLongLong();
+    }
+
+    sample.valid = true;
+#endif
+    return sample;
+}
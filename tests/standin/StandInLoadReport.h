@@ -0,0 +1,73 @@
+#ifndef STAND_IN_LOAD_REPORT_H
+#define STAND_IN_LOAD_REPORT_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+class StandInHttpServer;
+class StandInMJpegSource;
+class StandInRtspServer;
+class StandInStats;
+
+/* Goes through the scale steps, offering more cameras at each, and prints what
+ * the client made of every step once it had time to settle: its CPU use and
+ * memory, read from /proc for the client's process, and the pictures or frames
+ * it was too slow for and how long they waited, as seen by the servers.
+ *
+ * The client picks up the camera list on its next refresh, within a minute;
+ * cameras still have to be shown in the live view for their streams to start. */
+class StandInLoadReport : public QObject
+{
+    Q_OBJECT
+
+public:
+    StandInLoadReport(StandInHttpServer *httpServer, StandInRtspServer *rtspServer,
+                      StandInMJpegSource *mjpegSource, StandInStats *stats, QObject *parent = 0);
+
+    void setSteps(const QList<int> &cameraCounts) { m_steps = cameraCounts; }
+    /* Seconds; nothing is measured during the first settleTime of a step */
+    void setStepTime(int stepTime, int settleTime);
+    void setClientPid(qint64 pid) { m_clientPid = pid; }
+
+    void start();
+
+signals:
+    void finished();
+
+private slots:
+    void settled();
+    void stepDone();
+
+private:
+    struct ProcessSample
+    {
+        ProcessSample() : valid(false), cpuTicks(0), residentKb(0), peakResidentKb(0) { }
+
+        bool valid;
+        qint64 cpuTicks;
+        qint64 residentKb;
+        qint64 peakResidentKb;
+    };
+
+    StandInHttpServer *m_httpServer;
+    StandInRtspServer *m_rtspServer;
+    StandInMJpegSource *m_mjpegSource;
+    StandInStats *m_stats;
+
+    QList<int> m_steps;
+    int m_currentStep;
+    int m_stepTime;
+    int m_settleTime;
+    qint64 m_clientPid;
+
+    QTimer m_timer;
+    QElapsedTimer m_measureClock;
+    ProcessSample m_firstSample;
+
+    void startStep();
+    ProcessSample sampleClient() const;
+};
+
+#endif // STAND_IN_LOAD_REPORT_H
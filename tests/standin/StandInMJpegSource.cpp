@@ -0,0 +1,175 @@
+#include "StandInMJpegSource.h"
+#include "StandInDelivery.h"
+#include "core/MJpegMultipartParser.h"
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QSslSocket>
+
+const char StandInMJpegSource::boundary[] = "standinboundary";
+
+StandInMJpegSource::StandInMJpegSource(StandInStats *stats, QObject *parent)
+    : QObject(parent), m_stats(stats), m_nextPart(0), m_timer(this)
+{
+    connect(&m_timer, SIGNAL(timeout()), SLOT(sendPicture()));
+}
+
+StandInMJpegSource::~StandInMJpegSource()
+{
+    qDeleteAll(m_clients);
+}
+
+void StandInMJpegSource::addPart(const QByteArray &picture)
+{
+    QByteArray part;
+    part.reserve(picture.size() + 128);
+    part += "--";
+    part += boundary;
+    part += "\r\nContent-Type: image/jpeg\r\nContent-Length: ";
+    part += QByteArray::number(picture.size());
+    part += "\r\n\r\n";
+    part += picture;
+    part += "\r\n";
+    m_parts.append(part);
+}
+
+bool StandInMJpegSource::generatePictures(const QSize &size, int count)
+{
+    m_parts.clear();
+
+    QImage image(size, QImage::Format_RGB32);
+    for (int i = 0; i < count; ++i)
+    {
+        /* Detail everywhere for the encoder, and something that moves */
+        for (int y = 0; y < image.height(); ++y)
+        {
+            QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+            for (int x = 0; x < image.width(); ++x)
+                line[x] = qRgb((x * 7 + i * 4) & 0xff, (y * 3) & 0xff, ((x ^ y) >> 2) & 0xff);
+        }
+
+        QPainter painter(&image);
+        int barWidth = qMax(8, size.width() / 16);
+        painter.fillRect((size.width() - barWidth) * i / qMax(1, count - 1), 0, barWidth, size.height(), Qt::white);
+        painter.end();
+
+        QByteArray picture;
+        QBuffer buffer(&picture);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.save(&buffer, "JPEG", 80))
+            return false;
+
+        addPart(picture);
+    }
+
+    return !m_parts.isEmpty();
+}
+
+bool StandInMJpegSource::loadPictures(const QString &fileName, QString *errorMessage)
+{
+    m_parts.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *errorMessage = file.errorString();
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+
+    /* The file starts with its first boundary */
+    int lineEnd = data.indexOf('\n');
+    QByteArray firstLine = data.left(lineEnd).trimmed();
+    if (lineEnd < 0 || !firstLine.startsWith("--") || firstLine.size() < 3)
+    {
+        *errorMessage = QLatin1String("Not a multipart file");
+        return false;
+    }
+
+    MJpegMultipartParser parser(data.size() + 1);
+    parser.setBoundary(firstLine.mid(2));
+    parser.append(data.constData(), data.size());
+
+    MJpegPart part;
+    while (parser.takePart(&part))
+        addPart(QByteArray(part.buffer.constData() + part.offset, part.size));
+
+    if (m_parts.isEmpty())
+    {
+        *errorMessage = parser.hasError() ? parser.errorMessage() : QLatin1String("No pictures in file");
+        return false;
+    }
+
+    return true;
+}
+
+void StandInMJpegSource::start(int framesPerSecond)
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.start(1000 / qMax(1, framesPerSecond));
+}
+
+void StandInMJpegSource::addClient(QSslSocket *socket)
+{
+    socket->setParent(this);
+    connect(socket, SIGNAL(bytesWritten(qint64)), SLOT(clientBytesWritten(qint64)));
+    connect(socket, SIGNAL(encryptedBytesWritten(qint64)), SLOT(clientEncryptedBytesWritten(qint64)));
+    connect(socket, SIGNAL(disconnected()), SLOT(clientDisconnected()));
+
+    QByteArray header = "HTTP/1.1 200 OK\r\n"
+                        "Content-Type: multipart/x-mixed-replace; boundary=";
+    header += boundary;
+    header += "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+
+    StandInDelivery *delivery = new StandInDelivery(m_stats);
+    /* Two pictures may wait for a client before the next is dropped */
+    if (!m_parts.isEmpty())
+        delivery->setMaximumBacklog(m_parts.first().size() * 2);
+    delivery->otherDataSent(socket->write(header));
+    m_clients.insert(socket, delivery);
+}
+
+void StandInMJpegSource::sendPicture()
+{
+    if (m_parts.isEmpty())
+        return;
+
+    const QByteArray &part = m_parts.at(m_nextPart);
+    m_nextPart = (m_nextPart + 1) % m_parts.size();
+
+    for (QHash<QSslSocket *, StandInDelivery *>::iterator it = m_clients.begin(); it != m_clients.end(); ++it)
+    {
+        /* What is encrypted already waits in the socket underneath */
+        if (it.value()->isBehind(it.key()->bytesToWrite() + it.key()->encryptedBytesToWrite()))
+        {
+            it.value()->unitDropped();
+            continue;
+        }
+
+        it.value()->unitSent(it.key()->write(part));
+    }
+}
+
+void StandInMJpegSource::clientBytesWritten(qint64 bytes)
+{
+    QSslSocket *socket = static_cast<QSslSocket *>(sender());
+    StandInDelivery *delivery = m_clients.value(socket);
+    if (delivery)
+        delivery->bytesEncrypted(bytes, socket->encryptedBytesToWrite());
+}
+
+void StandInMJpegSource::clientEncryptedBytesWritten(qint64 bytes)
+{
+    StandInDelivery *delivery = m_clients.value(static_cast<QSslSocket *>(sender()));
+    if (delivery)
+        delivery->encryptedBytesWritten(bytes);
+}
+
+void StandInMJpegSource::clientDisconnected()
+{
+    QSslSocket *socket = static_cast<QSslSocket *>(sender());
+    delete m_clients.take(socket);
+    socket->deleteLater();
+}
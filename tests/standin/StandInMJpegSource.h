@@ -0,0 +1,55 @@
+#ifndef STAND_IN_MJPEG_SOURCE_H
+#define STAND_IN_MJPEG_SOURCE_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QTimer>
+
+class QSslSocket;
+class StandInDelivery;
+class StandInStats;
+
+/* Sends the same pictures as multipart/x-mixed-replace to every MJPEG client
+ * of every camera, at a fixed rate. Pictures are generated at a given size or
+ * taken from a recorded multipart file, such as those in tests/data/mjpeg, and
+ * are sent in a loop. */
+class StandInMJpegSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StandInMJpegSource(StandInStats *stats, QObject *parent = 0);
+    virtual ~StandInMJpegSource();
+
+    bool generatePictures(const QSize &size, int count);
+    bool loadPictures(const QString &fileName, QString *errorMessage);
+    int pictureCount() const { return m_parts.size(); }
+
+    void start(int framesPerSecond);
+
+    /* Takes over a connection that asked for a stream, right after its request */
+    void addClient(QSslSocket *socket);
+    int clientCount() const { return m_clients.size(); }
+
+private slots:
+    void sendPicture();
+    void clientBytesWritten(qint64 bytes);
+    void clientEncryptedBytesWritten(qint64 bytes);
+    void clientDisconnected();
+
+private:
+    static const char boundary[];
+
+    StandInStats *m_stats;
+    /* Whole parts, boundary and headers included */
+    QList<QByteArray> m_parts;
+    int m_nextPart;
+    QTimer m_timer;
+    QHash<QSslSocket *, StandInDelivery *> m_clients;
+
+    void addPart(const QByteArray &picture);
+};
+
+#endif // STAND_IN_MJPEG_SOURCE_H
@@ -0,0 +1,20 @@
+#include "StandInRtspServer.h"
+#include "StandInRtspSession.h"
+#include <QTcpSocket>
+
+StandInRtspServer::StandInRtspServer(StandInH264Source *source, StandInStats *stats, QObject *parent)
+    : QTcpServer(parent), m_source(source), m_stats(stats), m_cameraCount(0)
+{
+}
+
+void StandInRtspServer::incomingConnection(qintptr socketDescriptor)
+{
+    QTcpSocket *socket = new QTcpSocket;
+    if (!socket->setSocketDescriptor(socketDescriptor))
+    {
+        delete socket;
+        return;
+    }
+
+    new StandInRtspSession(socket, this);
+}
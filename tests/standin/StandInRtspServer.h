@@ -0,0 +1,33 @@
+#ifndef STAND_IN_RTSP_SERVER_H
+#define STAND_IN_RTSP_SERVER_H
+
+#include <QTcpServer>
+
+class StandInH264Source;
+class StandInStats;
+
+/* Serves /live/<camera id> for as many cameras as the current scale step has,
+ * all playing the same H.264 source. */
+class StandInRtspServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    StandInRtspServer(StandInH264Source *source, StandInStats *stats, QObject *parent = 0);
+
+    StandInH264Source *source() const { return m_source; }
+    StandInStats *stats() const { return m_stats; }
+
+    int cameraCount() const { return m_cameraCount; }
+    void setCameraCount(int cameraCount) { m_cameraCount = cameraCount; }
+
+protected:
+    virtual void incomingConnection(qintptr socketDescriptor);
+
+private:
+    StandInH264Source *m_source;
+    StandInStats *m_stats;
+    int m_cameraCount;
+};
+
+#endif // STAND_IN_RTSP_SERVER_H
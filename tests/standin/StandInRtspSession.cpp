@@ -0,0 +1,285 @@
+#include "StandInRtspSession.h"
+#include "StandInH264Source.h"
+#include "StandInRtspServer.h"
+#include <QStringList>
+#include <QTcpSocket>
+#include <QUrl>
+
+extern "C" {
+#   include "libavutil/mem.h"
+}
+
+/* Room for an RTP packet in one TCP segment on any network */
+static const int maximumRtpPacketSize = 1400;
+
+StandInRtspSession::StandInRtspSession(QTcpSocket *socket, StandInRtspServer *server)
+    : QObject(server), m_socket(socket), m_server(server), m_delivery(server->stats()), m_muxer(0),
+      m_playing(false), m_waitForKeyframe(true), m_started(false), m_packetBytes(0)
+{
+    static int lastSessionId = 0;
+    m_sessionId = QByteArray::number(++lastSessionId);
+
+    m_socket->setParent(this);
+    connect(m_socket, SIGNAL(readyRead()), SLOT(readable()));
+    connect(m_socket, SIGNAL(bytesWritten(qint64)), SLOT(bytesWritten(qint64)));
+    connect(m_socket, SIGNAL(disconnected()), SLOT(disconnected()));
+}
+
+StandInRtspSession::~StandInRtspSession()
+{
+    m_server->source()->removeSession(this);
+    closeMuxer();
+}
+
+void StandInRtspSession::disconnected()
+{
+    m_server->source()->removeSession(this);
+    m_playing = false;
+    deleteLater();
+}
+
+void StandInRtspSession::bytesWritten(qint64 bytes)
+{
+    m_delivery.bytesWritten(bytes);
+}
+
+void StandInRtspSession::readable()
+{
+    m_input.append(m_socket->readAll());
+
+    for (;;)
+    {
+        /* RTCP from the client, interleaved like the RTP going the other way */
+        if (m_input.startsWith('$'))
+        {
+            if (m_input.size() < 4)
+                return;
+            int length = (uchar(m_input.at(2)) << 8) | uchar(m_input.at(3));
+            if (m_input.size() < 4 + length)
+                return;
+            m_input.remove(0, 4 + length);
+            continue;
+        }
+
+        int headerEnd = m_input.indexOf("\r\n\r\n");
+        if (headerEnd < 0)
+            return;
+
+        QList<QByteArray> lines = m_input.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+
+        QHash<QByteArray, QByteArray> headers;
+        for (int i = 1; i < lines.size(); ++i)
+        {
+            int colon = lines.at(i).indexOf(':');
+            if (colon > 0)
+                headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+        }
+
+        int requestEnd = headerEnd + 4 + headers.value("content-length").toInt();
+        if (m_input.size() < requestEnd)
+            return;
+        m_input.remove(0, requestEnd);
+
+        if (requestLine.size() < 2 || !handleRequest(requestLine.at(0), requestLine.at(1), headers))
+        {
+            m_socket->disconnectFromHost();
+            return;
+        }
+    }
+}
+
+int StandInRtspSession::cameraId(const QByteArray &url) const
+{
+    /* rtsp://host:port/live/<id>, and /streamid=0 below it for SETUP */
+    QStringList path = QUrl(QString::fromLatin1(url)).path().split(QLatin1Char('/'), QString::SkipEmptyParts);
+    if (path.size() < 2 || path.at(0) != QLatin1String("live"))
+        return 0;
+
+    bool ok = false;
+    int id = path.at(1).toInt(&ok);
+    return ok && id >= 1 && id <= m_server->cameraCount() ? id : 0;
+}
+
+/* False to close the connection */
+bool StandInRtspSession::handleRequest(const QByteArray &method, const QByteArray &url,
+                                       const QHash<QByteArray, QByteArray> &headers)
+{
+    QByteArray cseq = headers.value("cseq");
+
+    if (method == "OPTIONS")
+    {
+        reply("200 OK", cseq, "Public: OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN, GET_PARAMETER\r\n");
+    }
+    else if (method == "DESCRIBE")
+    {
+        QByteArray sdp = m_server->source()->sdp();
+        if (!cameraId(url) || sdp.isEmpty())
+        {
+            reply("404 Not Found", cseq);
+            return true;
+        }
+
+        QByteArray base = url.endsWith('/') ? url : url + '/';
+        reply("200 OK", cseq, "Content-Base: " + base + "\r\nContent-Type: application/sdp\r\n", sdp);
+    }
+    else if (method == "SETUP")
+    {
+        if (!cameraId(url))
+        {
+            reply("404 Not Found", cseq);
+            return true;
+        }
+
+        if (!headers.value("transport").contains("TCP"))
+        {
+            reply("461 Unsupported Transport", cseq);
+            return true;
+        }
+
+        reply("200 OK", cseq, "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\nSession: " + m_sessionId + ";timeout=60\r\n");
+    }
+    else if (method == "PLAY")
+    {
+        if (!m_playing)
+        {
+            if (!openMuxer())
+            {
+                reply("500 Internal Server Error", cseq);
+                return false;
+            }
+
+            m_playing = true;
+            m_server->source()->addSession(this);
+        }
+
+        reply("200 OK", cseq, "Session: " + m_sessionId + "\r\nRange: npt=0.000-\r\n");
+    }
+    else if (method == "GET_PARAMETER" || method == "SET_PARAMETER")
+    {
+        /* Keepalives */
+        reply("200 OK", cseq, "Session: " + m_sessionId + "\r\n");
+    }
+    else if (method == "TEARDOWN")
+    {
+        m_server->source()->removeSession(this);
+        m_playing = false;
+        reply("200 OK", cseq, "Session: " + m_sessionId + "\r\n");
+        return false;
+    }
+    else
+    {
+        reply("501 Not Implemented", cseq);
+    }
+
+    return true;
+}
+
+void StandInRtspSession::reply(const QByteArray &status, const QByteArray &cseq, const QByteArray &headers,
+                               const QByteArray &body)
+{
+    QByteArray response = "RTSP/1.0 " + status + "\r\nCSeq: " + cseq + "\r\n" + headers;
+    if (!body.isEmpty())
+        response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "\r\n" + body;
+
+    m_delivery.otherDataSent(m_socket->write(response));
+}
+
+bool StandInRtspSession::openMuxer()
+{
+    if (avformat_alloc_output_context2(&m_muxer, NULL, "rtp", NULL) < 0)
+        return false;
+
+    AVStream *stream = avformat_new_stream(m_muxer, NULL);
+    if (!stream || avcodec_parameters_copy(stream->codecpar, m_server->source()->codecParameters()) < 0)
+    {
+        closeMuxer();
+        return false;
+    }
+    stream->time_base = m_server->source()->timeBase();
+
+    int bufferSize = 4 * maximumRtpPacketSize;
+    unsigned char *buffer = (unsigned char *)av_malloc(bufferSize);
+    m_muxer->pb = avio_alloc_context(buffer, bufferSize, 1, this, NULL, writeRtp, NULL);
+    if (!m_muxer->pb)
+    {
+        av_free(buffer);
+        closeMuxer();
+        return false;
+    }
+    /* The muxer flushes after every packet, so each write is one RTP packet */
+    m_muxer->pb->max_packet_size = maximumRtpPacketSize;
+
+    if (avformat_write_header(m_muxer, NULL) < 0)
+    {
+        closeMuxer();
+        return false;
+    }
+
+    return true;
+}
+
+void StandInRtspSession::closeMuxer()
+{
+    if (!m_muxer)
+        return;
+
+    if (m_muxer->pb)
+    {
+        av_freep(&m_muxer->pb->buffer);
+        av_freep(&m_muxer->pb);
+    }
+    avformat_free_context(m_muxer);
+    m_muxer = 0;
+}
+
+int StandInRtspSession::writeRtp(void *opaque, uint8_t *data, int size)
+{
+    StandInRtspSession *session = static_cast<StandInRtspSession *>(opaque);
+
+    /* RTCP sender reports have payload types 200 to 204; RTP uses 96, or 224
+     * with the marker bit */
+    uchar channel = size >= 2 && data[1] >= 200 && data[1] <= 204 ? 1 : 0;
+    char header[4] = { '$', char(channel), char((size >> 8) & 0xff), char(size & 0xff) };
+
+    session->m_socket->write(header, sizeof(header));
+    session->m_socket->write(reinterpret_cast<const char *>(data), size);
+    session->m_packetBytes += sizeof(header) + size;
+    return size;
+}
+
+void StandInRtspSession::sendPacket(const AVPacket *packet, AVRational timeBase)
+{
+    if (!m_playing || !m_muxer)
+        return;
+
+    bool keyframe = packet->flags & AV_PKT_FLAG_KEY;
+    if (!m_started)
+    {
+        if (!keyframe)
+            return;
+        m_started = true;
+    }
+
+    if (m_delivery.isBehind(m_socket->bytesToWrite()) || (m_waitForKeyframe && !keyframe))
+    {
+        m_waitForKeyframe = true;
+        m_delivery.unitDropped();
+        return;
+    }
+    m_waitForKeyframe = false;
+
+    AVPacket copy;
+    if (av_packet_ref(&copy, packet) < 0)
+        return;
+    copy.stream_index = 0;
+    av_packet_rescale_ts(&copy, timeBase, m_muxer->streams[0]->time_base);
+
+    m_packetBytes = 0;
+    if (av_write_frame(m_muxer, &copy) < 0)
+        qWarning("stand-in: RTP muxing failed for session %s", m_sessionId.constData());
+    av_packet_unref(&copy);
+
+    m_delivery.unitSent(m_packetBytes);
+}
@@ -0,0 +1,59 @@
+#ifndef STAND_IN_RTSP_SESSION_H
+#define STAND_IN_RTSP_SESSION_H
+
+#include "StandInDelivery.h"
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+
+extern "C" {
+#   include "libavformat/avformat.h"
+}
+
+class QTcpSocket;
+class StandInRtspServer;
+
+/* One RTSP connection. Only RTP over the RTSP connection itself is offered,
+ * as the client always asks for it; RTP packets come from an rtp muxer of the
+ * session's own, so that sequence numbers and timestamps are its own too. */
+class StandInRtspSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    StandInRtspSession(QTcpSocket *socket, StandInRtspServer *server);
+    virtual ~StandInRtspSession();
+
+    /* From the source, while playing */
+    void sendPacket(const AVPacket *packet, AVRational timeBase);
+
+private slots:
+    void readable();
+    void bytesWritten(qint64 bytes);
+    void disconnected();
+
+private:
+    QTcpSocket *m_socket;
+    StandInRtspServer *m_server;
+    StandInDelivery m_delivery;
+    QByteArray m_input;
+    QByteArray m_sessionId;
+
+    AVFormatContext *m_muxer;
+    bool m_playing;
+    /* Nothing is sent before a keyframe, nor after a drop until the next one */
+    bool m_waitForKeyframe;
+    bool m_started;
+    qint64 m_packetBytes;
+
+    static int writeRtp(void *opaque, uint8_t *data, int size);
+
+    bool handleRequest(const QByteArray &method, const QByteArray &url, const QHash<QByteArray, QByteArray> &headers);
+    void reply(const QByteArray &status, const QByteArray &cseq, const QByteArray &headers = QByteArray(),
+               const QByteArray &body = QByteArray());
+    bool openMuxer();
+    void closeMuxer();
+    int cameraId(const QByteArray &url) const;
+};
+
+#endif // STAND_IN_RTSP_SESSION_H
@@ -0,0 +1,189 @@
+#include "StandInDelivery.h"
+#include "StandInH264Source.h"
+#include "StandInHttpServer.h"
+#include "StandInLoadReport.h"
+#include "StandInMJpegSource.h"
+#include "StandInRtspServer.h"
+#include "bluecherry-config.h"
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QHostAddress>
+#include <QProcess>
+#include <QStringList>
+#include <cstdio>
+
+extern "C" {
+#   include "libavformat/avformat.h"
+}
+
+const char *jpegFormatName = "jpeg"; // hack
+
+/* Stand-in for a Bluecherry server on loopback, to put the client under the
+ * load of many cameras without a DVR. Add a server for 127.0.0.1 at --port with
+ * any user name and password, choose MJPEG or RTSP for it, and show all of its
+ * cameras in the live view; see StandInLoadReport for what is measured. */
+
+static QList<int> parseSteps(const QString &value)
+{
+    QList<int> steps;
+    foreach (const QString &step, value.split(QLatin1Char(','), QString::SkipEmptyParts))
+    {
+        bool ok = false;
+        int cameraCount = step.trimmed().toInt(&ok);
+        if (!ok || cameraCount < 1)
+            return QList<int>();
+        steps.append(cameraCount);
+    }
+
+    return steps;
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    app.setApplicationName(QLatin1String("bluecherry-standin"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QLatin1String("Stand-in Bluecherry server for load testing the client"));
+    parser.addHelpOption();
+
+    QCommandLineOption portOption(QLatin1String("port"),
+            QLatin1String("HTTPS port; RTSP is served on the port after it"), QLatin1String("port"),
+            QLatin1String("7001"));
+    QCommandLineOption stepsOption(QLatin1String("steps"),
+            QLatin1String("Camera counts to go through"), QLatin1String("counts"), QLatin1String("16,32,64,100,150"));
+    QCommandLineOption stepTimeOption(QLatin1String("step-time"),
+            QLatin1String("Seconds per step"), QLatin1String("seconds"), QLatin1String("180"));
+    QCommandLineOption settleTimeOption(QLatin1String("settle-time"),
+            QLatin1String("Seconds at the start of each step that aren't measured"), QLatin1String("seconds"),
+            QLatin1String("90"));
+    QCommandLineOption fpsOption(QLatin1String("fps"),
+            QLatin1String("MJPEG pictures per second"), QLatin1String("fps"), QLatin1String("10"));
+    QCommandLineOption sizeOption(QLatin1String("size"),
+            QLatin1String("Size of generated MJPEG pictures"), QLatin1String("WxH"), QLatin1String("1280x720"));
+    QCommandLineOption mjpegFileOption(QLatin1String("mjpeg-file"),
+            QLatin1String("Recorded multipart MJPEG to loop instead of generated pictures"), QLatin1String("file"));
+    QCommandLineOption h264FileOption(QLatin1String("h264-file"),
+            QLatin1String("Matroska file with H.264 video to loop over RTSP; the bundled FFmpeg can't "
+                          "read MP4 or raw H.264, so remux those with ffmpeg -i in -c copy out.mkv"),
+            QLatin1String("file"));
+    QCommandLineOption clientPidOption(QLatin1String("client-pid"),
+            QLatin1String("Process of a running client to measure"), QLatin1String("pid"));
+    QCommandLineOption clientOption(QLatin1String("client"),
+            QLatin1String("Client to start and measure"), QLatin1String("program"));
+    QCommandLineOption certificateOption(QLatin1String("certificate"),
+            QLatin1String("PEM certificate for HTTPS"), QLatin1String("file"),
+            QString::fromLatin1("%1/standin/standin.crt").arg(QString::fromLatin1(TEST_DATA_DIR)));
+    QCommandLineOption keyOption(QLatin1String("key"),
+            QLatin1String("PEM private key for HTTPS"), QLatin1String("file"),
+            QString::fromLatin1("%1/standin/standin.key").arg(QString::fromLatin1(TEST_DATA_DIR)));
+
+    parser.addOption(portOption);
+    parser.addOption(stepsOption);
+    parser.addOption(stepTimeOption);
+    parser.addOption(settleTimeOption);
+    parser.addOption(fpsOption);
+    parser.addOption(sizeOption);
+    parser.addOption(mjpegFileOption);
+    parser.addOption(h264FileOption);
+    parser.addOption(clientPidOption);
+    parser.addOption(clientOption);
+    parser.addOption(certificateOption);
+    parser.addOption(keyOption);
+    parser.process(app);
+
+    int port = parser.value(portOption).toInt();
+    QList<int> steps = parseSteps(parser.value(stepsOption));
+    int stepTime = parser.value(stepTimeOption).toInt();
+    QStringList size = parser.value(sizeOption).split(QLatin1Char('x'));
+    QSize pictureSize = size.size() == 2 ? QSize(size.at(0).toInt(), size.at(1).toInt()) : QSize();
+    int fps = parser.value(fpsOption).toInt();
+
+    if (port < 1 || port > 65534 || steps.isEmpty() || stepTime < 1 || pictureSize.isEmpty() || fps < 1)
+    {
+        fprintf(stderr, "Invalid options; see --help\n");
+        return 1;
+    }
+
+    av_register_all();
+
+    StandInStats stats;
+    QString errorMessage;
+
+    StandInMJpegSource mjpegSource(&stats);
+    if (parser.isSet(mjpegFileOption))
+    {
+        if (!mjpegSource.loadPictures(parser.value(mjpegFileOption), &errorMessage))
+        {
+            fprintf(stderr, "Cannot load MJPEG pictures: %s\n", qPrintable(errorMessage));
+            return 1;
+        }
+    }
+    else if (!mjpegSource.generatePictures(pictureSize, fps))
+    {
+        fprintf(stderr, "Cannot encode MJPEG pictures\n");
+        return 1;
+    }
+
+    StandInH264Source h264Source;
+    if (parser.isSet(h264FileOption) && !h264Source.open(parser.value(h264FileOption), &errorMessage))
+    {
+        fprintf(stderr, "Cannot open H.264 file: %s\n", qPrintable(errorMessage));
+        return 1;
+    }
+
+    StandInHttpServer httpServer(&mjpegSource);
+    if (!httpServer.setCertificate(parser.value(certificateOption), parser.value(keyOption), &errorMessage))
+    {
+        fprintf(stderr, "%s\n", qPrintable(errorMessage));
+        return 1;
+    }
+
+    StandInRtspServer rtspServer(&h264Source, &stats);
+    if (!httpServer.listen(QHostAddress::LocalHost, port) || !rtspServer.listen(QHostAddress::LocalHost, port + 1))
+    {
+        fprintf(stderr, "Cannot listen on ports %d and %d\n", port, port + 1);
+        return 1;
+    }
+
+    mjpegSource.start(fps);
+    if (h264Source.isOpen())
+        h264Source.start();
+    else
+        fprintf(stderr, "No --h264-file; RTSP streams will not play\n");
+
+    QProcess client;
+    qint64 clientPid = parser.value(clientPidOption).toLongLong();
+    if (parser.isSet(clientOption))
+    {
+        client.setProcessChannelMode(QProcess::ForwardedChannels);
+        client.start(parser.value(clientOption), QStringList());
+        if (!client.waitForStarted())
+        {
+            fprintf(stderr, "Cannot start %s\n", qPrintable(parser.value(clientOption)));
+            return 1;
+        }
+        clientPid = client.processId();
+    }
+
+    printf("Serving on https://127.0.0.1:%d and rtsp://127.0.0.1:%d, %d s per step, measuring the last %d s\n",
+           port, port + 1, stepTime, stepTime - qBound(0, parser.value(settleTimeOption).toInt(), stepTime - 1));
+
+    StandInLoadReport report(&httpServer, &rtspServer, &mjpegSource, &stats);
+    report.setSteps(steps);
+    report.setStepTime(stepTime, parser.value(settleTimeOption).toInt());
+    report.setClientPid(clientPid);
+    QObject::connect(&report, SIGNAL(finished()), &app, SLOT(quit()));
+    report.start();
+
+    int result = app.exec();
+
+    if (client.state() != QProcess::NotRunning)
+    {
+        client.terminate();
+        if (!client.waitForFinished(10000))
+            client.kill();
+    }
+
+    return result;
+}